@@ -6,6 +6,7 @@ CGROUP_USER=${SUDO_USER:-$USER}
 CGROUP_USER=${CGROUP_USER:-$(whoami)}
 
 CGROUP=cpu:faasm
+CGROUP_ROOT=/sys/fs/cgroup
 
 if [ "$CGROUP_MODE" == "off" ];
 then
@@ -13,6 +14,16 @@ then
     exit 0
 fi
 
-echo "Setting up cgroup ${CGROUP} for ${CGROUP_USER}"
+if [ -f "${CGROUP_ROOT}/cgroup.controllers" ];
+then
+    # cgroup v2, Faaslets create their own child groups under the base group
+    echo "Setting up cgroup v2 group faasm for ${CGROUP_USER}"
+
+    echo "+cpu +memory" > ${CGROUP_ROOT}/cgroup.subtree_control
+    mkdir -p ${CGROUP_ROOT}/faasm
+    chown -R ${CGROUP_USER}:${CGROUP_USER} ${CGROUP_ROOT}/faasm
+else
+    echo "Setting up cgroup ${CGROUP} for ${CGROUP_USER}"
 
-cgcreate -t ${CGROUP_USER}:${CGROUP_USER} -a ${CGROUP_USER}:${CGROUP_USER} -g ${CGROUP}
\ No newline at end of file
+    cgcreate -t ${CGROUP_USER}:${CGROUP_USER} -a ${CGROUP_USER}:${CGROUP_USER} -g ${CGROUP}
+fi
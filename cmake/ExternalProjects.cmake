@@ -52,6 +52,25 @@ if(FAASM_SGX_XRA)
     set(FAASM_XRA_INCLUDE_PATH ${FAASM_XRA_ROOT_DIR}/include)
 endif()
 
+# Microbenchmark library. The benchmarks are skipped if it's neither installed
+# nor fetched
+if(FAASM_BENCHMARKS)
+    find_package(benchmark QUIET)
+
+    if(NOT benchmark_FOUND AND FAASM_FETCH_BENCHMARK)
+        # Options must be in the cache, as FetchContent ignores CMAKE_ARGS
+        set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+        set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+
+        FetchContent_Declare(benchmark_ext
+            GIT_REPOSITORY "https://github.com/google/benchmark.git"
+            GIT_TAG "v1.5.2"
+        )
+
+        FetchContent_MakeAvailable(benchmark_ext)
+    endif()
+endif()
+
 # General 3rd party dependencies
 ExternalProject_Add(eigen_ext
     GIT_REPOSITORY "https://gitlab.com/shillaker/eigen.git"
@@ -0,0 +1,61 @@
+#include <faasm/faasm.h>
+#include <faasm/input.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define DEFAULT_PAYLOAD_SIZE 64
+
+/**
+ * Echoes its input straight back as output
+ */
+int echoPayload()
+{
+    long inputSize = faasmGetInputSize();
+    std::vector<uint8_t> payload(inputSize);
+    faasmGetInput(payload.data(), inputSize);
+
+    faasmSetOutput(payload.data(), inputSize);
+
+    return 0;
+}
+
+/**
+ * Chains a call with a payload of the size given in the input, and checks the
+ * same payload is returned as output. Used to measure chaining round-trip
+ * latency for different payload sizes.
+ */
+int main(int argc, char* argv[])
+{
+    const char* inputStr = faasm::getStringInput("");
+    int payloadSize = atoi(inputStr);
+    if (payloadSize <= 0) {
+        payloadSize = DEFAULT_PAYLOAD_SIZE;
+    }
+
+    std::vector<uint8_t> payload(payloadSize);
+    for (int i = 0; i < payloadSize; i++) {
+        payload[i] = (uint8_t)(i % 256);
+    }
+
+    unsigned int callId =
+      faasmChain(echoPayload, payload.data(), payload.size());
+
+    std::vector<uint8_t> output(payloadSize, 0);
+    unsigned int result =
+      faasmAwaitCallOutput(callId, output.data(), output.size());
+
+    if (result != 0) {
+        printf("Chained payload call failed\n");
+        return 1;
+    }
+
+    if (output != payload) {
+        printf("Chained payload output not as expected (size %i)\n",
+               payloadSize);
+        return 1;
+    }
+
+    return 0;
+}
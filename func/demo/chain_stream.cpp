@@ -0,0 +1,126 @@
+#include <faasm/faasm.h>
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define N_CHUNKS 32
+#define CHUNK_SIZE 2048
+#define CHUNK_DELAY_US 5000
+
+// Streaming output host interface
+extern "C"
+{
+    void __faasm_write_output_chunk(const unsigned char* chunk, int chunkLen);
+
+    int __faasm_read_call_output_chunk(unsigned int messageId,
+                                       unsigned char* buffer,
+                                       int bufferLen);
+}
+
+long nowMicros()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+uint8_t expectedByte(int idx)
+{
+    return (uint8_t)((idx * 7) % 251);
+}
+
+/**
+ * Produces its output incrementally, with a delay between each chunk
+ */
+int producer()
+{
+    std::vector<uint8_t> chunk(CHUNK_SIZE);
+    for (int c = 0; c < N_CHUNKS; c++) {
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            chunk[i] = expectedByte((c * CHUNK_SIZE) + i);
+        }
+
+        __faasm_write_output_chunk(chunk.data(), CHUNK_SIZE);
+        usleep(CHUNK_DELAY_US);
+    }
+
+    return 0;
+}
+
+/**
+ * Streams the output of a producer, checking the time to first byte is well
+ * before the producer finishes. Then checks a normal await of a producer gets
+ * the whole output.
+ */
+int main(int argc, char* argv[])
+{
+    int totalSize = N_CHUNKS * CHUNK_SIZE;
+
+    // Consume the stream with a smaller buffer than the chunks
+    long start = nowMicros();
+    unsigned int callId = faasmChain(producer, nullptr, 0);
+
+    std::vector<uint8_t> buffer(CHUNK_SIZE / 2);
+    long firstByte = 0;
+    int nBytes = 0;
+    while (true) {
+        int readLen =
+          __faasm_read_call_output_chunk(callId, buffer.data(), buffer.size());
+        if (readLen == 0) {
+            break;
+        }
+
+        if (firstByte == 0) {
+            firstByte = nowMicros();
+        }
+
+        for (int i = 0; i < readLen; i++) {
+            if (buffer[i] != expectedByte(nBytes + i)) {
+                printf("Unexpected byte at %i\n", nBytes + i);
+                return 1;
+            }
+        }
+
+        nBytes += readLen;
+    }
+
+    long end = nowMicros();
+
+    if (faasmAwaitCall(callId) != 0) {
+        printf("Streaming producer failed\n");
+        return 1;
+    }
+
+    if (nBytes != totalSize) {
+        printf("Expected %i streamed bytes but got %i\n", totalSize, nBytes);
+        return 1;
+    }
+
+    long ttfb = firstByte - start;
+    long total = end - start;
+    printf("Time to first byte %lius, total %lius\n", ttfb, total);
+
+    if (ttfb * 2 > total) {
+        printf("Time to first byte too high\n");
+        return 1;
+    }
+
+    // Await without streaming
+    unsigned int awaitCallId = faasmChain(producer, nullptr, 0);
+    std::vector<uint8_t> output(totalSize);
+    if (faasmAwaitCallOutput(awaitCallId, output.data(), output.size()) != 0) {
+        printf("Awaited producer failed\n");
+        return 1;
+    }
+
+    for (int i = 0; i < totalSize; i++) {
+        if (output[i] != expectedByte(i)) {
+            printf("Unexpected awaited byte at %i\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "faasm/faasm.h"
+
+#include <stdio.h>
+
+/**
+ * Spends most of its time in one function and a little in another, for
+ * checking where a profiler attributes samples
+ */
+__attribute__((noinline)) double hotFunction(int n)
+{
+    double d = 1.0;
+    for (int i = 1; i < n; i++) {
+        d = d * 1.000001 + 1.0 / (double)i;
+    }
+
+    return d;
+}
+
+__attribute__((noinline)) double coldFunction(int n)
+{
+    double d = 1.0;
+    for (int i = 1; i < n; i++) {
+        d += 1.0 / (double)i;
+    }
+
+    return d;
+}
+
+int main(int argc, char* argv[])
+{
+    double total = 0;
+    for (int i = 0; i < 20; i++) {
+        total += hotFunction(5000000);
+        total += coldFunction(50000);
+    }
+
+    printf("Hot loop total: %f\n", total);
+
+    return 0;
+}
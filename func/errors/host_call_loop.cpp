@@ -0,0 +1,14 @@
+#include "faasm/faasm.h"
+
+#include <time.h>
+
+// Spends most of its time in a host call that writes to linear memory
+int main(int argc, char* argv[])
+{
+    struct timespec ts;
+    while (true) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+
+    return 0;
+}
@@ -0,0 +1,11 @@
+#include "faasm/faasm.h"
+
+#include <unistd.h>
+
+// Returns once out of a host call that outlasts its time limit
+int main(int argc, char* argv[])
+{
+    usleep(500 * 1000);
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+#include "faasm/faasm.h"
+
+// Kept in linear memory so that every iteration touches it
+volatile long counter = 0;
+
+int main(int argc, char* argv[])
+{
+    while (true) {
+        counter++;
+    }
+
+    return 0;
+}
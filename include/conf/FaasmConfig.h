@@ -0,0 +1,113 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace conf {
+/**
+ * Faasm-specific runtime configuration. Anything that only concerns the Faasm
+ * runtime (rather than the wider Faabric system) lives here, and is read from
+ * the environment in the same way as the Faabric system config.
+ */
+class FaasmConfig
+{
+  public:
+    // Chaining
+    std::string chainedCallFastPath;
+    std::string chainPrewarm;
+    int chainPrewarmThreshold;
+    int chainPrewarmMemoryMb;
+    int outputStreamBufferKb;
+    int outputStreamChunkKb;
+    std::string outputStreamFunctions;
+
+    // Output capture
+    int stdoutBufferKb;
+    std::string stdoutBufferLimits;
+    std::string captureStderr;
+    std::string stdoutSink;
+    std::string stdoutSinkDir;
+
+    // Memoization
+    std::string memoizeFunctions;
+    int memoizeMaxEntries;
+    std::string memoizeDir;
+
+    // Execution
+    int microBatchSize;
+    std::string statelessFunctions;
+    int functionVersionCheckMs;
+    int callTimeLimitMs;
+    int callCpuLimitMs;
+    std::string callTimeLimits;
+    std::string callCpuLimits;
+    std::string meterFunctions;
+
+    // Faaslet pool
+    int poolMinSize;
+    int poolMaxSize;
+    int poolMinFreeMemoryMb;
+    int faasletModuleCacheSize;
+    int faasletModuleCacheMb;
+
+    // Admission
+    int admissionMaxConcurrency;
+    std::string admissionFunctionLimits;
+    std::string admissionUserLimits;
+    std::string admissionWeights;
+    std::string admissionPriorities;
+    int admissionMaxQueued;
+    int admissionMaxBlocked;
+    int admissionQueueTimeoutMs;
+    int admissionMaxHeavy;
+    int admissionHeavyCost;
+
+    // Isolation
+    std::string cgroupGranularity;
+    int cgroupCpuWeight;
+    std::string cgroupCpuMax;
+    int cgroupMemoryMaxMb;
+    int cgroupMemoryHighMb;
+    std::string netnsAttach;
+    std::string netnsCreate;
+    std::string netnsSetupScript;
+    int isolationPoolSize;
+
+    // NUMA
+    std::string numaMode;
+    std::string numaZygoteReplicas;
+
+    // Metrics
+    std::string latencyMetrics;
+    int metricsPort;
+
+    // Profiling
+    std::string perfMap;
+    std::string profileFunctions;
+    int profileIntervalUs;
+    std::string traceFunctions;
+    std::string traceDir;
+    std::string workingSetFunctions;
+
+    FaasmConfig();
+
+    void reset();
+
+    void print();
+
+  private:
+    int getIntParam(const char* name, const char* defaultValue);
+
+    void initialise();
+};
+
+FaasmConfig& getFaasmConfig();
+
+// Checks a comma-separated list of user/function names for the given function
+bool isFunctionInList(const std::string& funcList, const faabric::Message& msg);
+
+// Parses a comma-separated list of key=value pairs with integer values
+std::unordered_map<std::string, int> parseIntMap(const std::string& list);
+}
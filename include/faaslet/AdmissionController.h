@@ -0,0 +1,163 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+#include <wasm/chaining.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace faaslet {
+/**
+ * Host-wide admission control for calls about to execute. Limits how many
+ * calls can run at once on the host, per function and per user. Calls over a
+ * limit wait here, and when a slot frees up the waiting call with the highest
+ * priority goes next. Calls with equal priority are ordered by weighted-fair
+ * queueing between functions, so a burst of one function can't starve the
+ * others.
+ *
+ * Calls to functions whose metered cost is above ADMISSION_HEAVY_COST count as
+ * heavy, and only ADMISSION_MAX_HEAVY heavy calls can run at once, so that
+ * expensive calls aren't co-located on the same host at the same time.
+ *
+ * Calls are rejected if their function already has too many calls waiting,
+ * or if they wait longer than the queue timeout.
+ *
+ * Calls give up their slot while blocked waiting on other calls, and resume
+ * ahead of any new calls once they carry on.
+ *
+ * Faaslets check in here before binding to a function. A function or user
+ * with a concurrency limit only gets as many Faaslets as the limit, plus
+ * ADMISSION_MAX_BLOCKED spare, so that excess calls queue in the scheduler
+ * rather than each taking a Faaslet and blocking until admitted.
+ */
+class AdmissionController
+{
+  public:
+    bool bind(const faabric::Message& msg);
+
+    void unbind(const faabric::Message& msg);
+
+    bool admit(const faabric::Message& msg);
+
+    void suspend(const faabric::Message& msg);
+
+    void resume(const faabric::Message& msg);
+
+    void release(const faabric::Message& msg);
+
+    int getRunningCount();
+
+    int getRunningCount(const std::string& funcStr);
+
+    int getRunningHeavyCount();
+
+    int getWaitingCount();
+
+    long getAdmittedCount();
+
+    long getQueuedCount();
+
+    long getRejectedCount();
+
+    long getDeclinedBindCount();
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+
+    struct Waiter
+    {
+        std::string funcStr;
+        std::string user;
+        bool heavy;
+        int priority;
+        double startTag;
+        double finishTag;
+        long seq;
+        bool resuming;
+    };
+
+    std::list<Waiter*> waiters;
+    long nextSeq = 0;
+
+    // Weighted-fair queueing virtual time, and the finish tag of the last
+    // call queued for each function
+    double virtualTime = 0;
+    std::unordered_map<std::string, double> lastFinishTags;
+
+    int running = 0;
+    std::unordered_map<std::string, int> runningByFunction;
+    std::unordered_map<std::string, int> runningByUser;
+    std::unordered_map<std::string, int> waitingByFunction;
+    std::unordered_set<unsigned int> runningHeavyCalls;
+
+    // Faaslets bound to each function and user, and how many of them are
+    // awaiting other calls, so will leave the function's queue alone
+    std::unordered_map<std::string, int> boundByFunction;
+    std::unordered_map<std::string, int> boundByUser;
+    std::unordered_map<std::string, int> awaitingByFunction;
+    std::unordered_map<std::string, int> awaitingByUser;
+
+    std::atomic<long> admittedCount = 0;
+    std::atomic<long> queuedCount = 0;
+    std::atomic<long> rejectedCount = 0;
+    std::atomic<long> declinedBindCount = 0;
+
+    // Parsed forms of the config lists, refreshed when the config changes
+    struct ParsedList
+    {
+        std::string raw;
+        std::unordered_map<std::string, int> values;
+    };
+
+    ParsedList functionLimits;
+    ParsedList userLimits;
+    ParsedList weights;
+    ParsedList priorities;
+
+    int lookup(ParsedList& parsed,
+               const std::string& raw,
+               const std::string& key,
+               int defaultValue);
+
+    bool isHeavy(const std::string& funcStr);
+
+    bool hasCapacity(const Waiter& waiter);
+
+    Waiter* getNextWaiter();
+
+    bool doAdmit(const faabric::Message& msg, bool resuming);
+
+    void start(const Waiter& waiter, unsigned int messageId);
+};
+
+AdmissionController& getAdmissionController();
+
+/**
+ * Holds an admission slot for as long as it's in scope, except while the call
+ * is awaiting other calls. Throws if the call is rejected. Threads are part of
+ * a call that's already been admitted, so don't need a slot of their own.
+ */
+class AdmissionTicket : public wasm::AwaitHooks
+{
+  public:
+    explicit AdmissionTicket(const faabric::Message& msgIn);
+
+    ~AdmissionTicket() override;
+
+    void beforeAwait() override;
+
+    void afterAwait() override;
+
+  private:
+    const faabric::Message& msg;
+    bool admitted = false;
+};
+}
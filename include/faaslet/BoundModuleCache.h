@@ -0,0 +1,75 @@
+#pragma once
+
+#include <wasm/WasmModule.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace faaslet {
+/**
+ * Small LRU of bound modules kept for one Faaslet slot in the pool. When the
+ * Faaslet in a slot finishes, its module is kept here rather than destroyed,
+ * so that whichever Faaslet next runs in the slot can pick it back up for a
+ * call to the same function without cloning or binding again. This lets a
+ * small pool serve many low-traffic functions without thrashing.
+ *
+ * The cache is bounded both by the number of modules and by the total size of
+ * their linear memories.
+ */
+class BoundModuleCache
+{
+  public:
+    BoundModuleCache(int maxModulesIn, size_t maxMemoryBytesIn);
+
+    std::unique_ptr<wasm::WasmModule> take(const std::string& key);
+
+    void put(const std::string& key, std::unique_ptr<wasm::WasmModule> module);
+
+    size_t getModuleCount();
+
+    size_t getMemoryBytes();
+
+    long getHitCount();
+
+    long getMissCount();
+
+    long getEvictionCount();
+
+    void clear();
+
+  private:
+    std::mutex mx;
+
+    const size_t maxModules;
+    const size_t maxMemoryBytes;
+    size_t memoryBytes = 0;
+
+    struct CachedModule
+    {
+        std::unique_ptr<wasm::WasmModule> module;
+        size_t memoryBytes;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    std::list<std::string> lru;
+    std::unordered_map<std::string, CachedModule> modules;
+
+    std::atomic<long> hitCount = 0;
+    std::atomic<long> missCount = 0;
+    std::atomic<long> evictionCount = 0;
+
+    void evictOldest();
+};
+
+std::string getBoundModuleKey(const faabric::Message& msg, long version);
+
+// Incremented whenever Faaslets are flushed, and part of every key, so that
+// modules kept from before a flush are never reused
+long getFlushGeneration();
+
+void incrementFlushGeneration();
+}
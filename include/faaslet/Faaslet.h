@@ -1,20 +1,30 @@
 #pragma once
 
-#include <system/NetworkNamespace.h>
+#include "BoundModuleCache.h"
+#include "PoolController.h"
+
+#include <system/CGroup.h>
+#include <system/IsolationManager.h>
 
 #include <faabric/executor/FaabricExecutor.h>
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/util/func.h>
 
 #include <wasm/WasmModule.h>
+#include <wavm/WAVMWasmModule.h>
 
+#include <chrono>
 #include <string>
 
 namespace faaslet {
 class Faaslet final : public faabric::executor::FaabricExecutor
 {
   public:
-    explicit Faaslet(int threadIdx);
+    explicit Faaslet(int threadIdx,
+                     PoolController* controllerIn = nullptr,
+                     BoundModuleCache* moduleCacheIn = nullptr);
+
+    ~Faaslet() override;
 
     std::unique_ptr<wasm::WasmModule> module;
 
@@ -33,7 +43,51 @@ class Faaslet final : public faabric::executor::FaabricExecutor
 
   private:
     int isolationIdx;
-    std::unique_ptr<isolation::NetworkNamespace> ns;
+    std::unique_ptr<isolation::IsolationContext> isolationContext;
+
+    // The cgroup this Faaslet has joined, either its isolation context's own
+    // leaf or one created here
+    std::unique_ptr<isolation::CGroup> cgroup;
+    isolation::CGroup* joinedCgroup = nullptr;
+    bool isolationJoined = false;
+
+    PoolController* controller;
+    bool controllerBound = false;
+
+    // The call this Faaslet was bound with, if admission control counted it
+    bool admissionBound = false;
+    faabric::Message admissionBindMsg;
+
+    // Version of the function's artefacts the module was created from, and
+    // the zygote it was copied from
+    long boundVersion = -1;
+    std::shared_ptr<wasm::WAVMWasmModule> zygote;
+    std::chrono::steady_clock::time_point lastVersionCheck;
+
+    // Modules kept for this Faaslet's slot in the pool. The key is cleared
+    // if the module shouldn't be kept, e.g. it's been restored from a
+    // snapshot
+    BoundModuleCache* moduleCache;
+    std::string boundModuleKey;
+    long boundFlushGeneration = 0;
+
+    void joinIsolation(const faabric::Message& msg);
+
+    void joinCgroup(const faabric::Message& msg);
+
+    void bindModule(const faabric::Message& msg);
+
+    bool isVersionStale(const faabric::Message& msg);
+
+    bool executeFunction(faabric::Message& msg);
+
+    void executeBatch(faabric::Message& msg);
+
+    void tidyCall(faabric::Message& call);
+
+    void appendCapturedStdout(faabric::Message& call);
+
+    void resetModule(const faabric::Message& call);
 };
 
 void preloadPythonRuntime();
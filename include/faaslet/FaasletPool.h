@@ -1,12 +1,18 @@
 #pragma once
 
 #include "Faaslet.h"
+#include "MetricsServer.h"
+#include "PoolController.h"
 
 #if FAASM_SGX
 #include <sgx/faasm_sgx_system.h>
 #endif
 
+#include <conf/FaasmConfig.h>
 #include <faabric/executor/FaabricPool.h>
+#include <system/CGroup.h>
+#include <system/IsolationManager.h>
+#include <system/LatencyMetrics.h>
 
 using namespace faabric::executor;
 
@@ -15,7 +21,12 @@ class FaasletPool : public FaabricPool
 {
   public:
     explicit FaasletPool(int nThreads)
-      : FaabricPool(nThreads)
+      : FaasletPool(nThreads, nThreads)
+    {}
+
+    FaasletPool(int minSize, int maxSize)
+      : FaabricPool(maxSize)
+      , controller(minSize, maxSize)
     {
         // Create an enclave if necessary
 #if FAASM_SGX
@@ -23,14 +34,74 @@ class FaasletPool : public FaabricPool
         // sgx::checkSgxSetup();
 #endif
 
+        // Set up the bound module caches, one per slot
+        conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+        if (faasmConf.faasletModuleCacheSize > 0) {
+            for (int i = 0; i < maxSize; i++) {
+                moduleCaches.emplace_back(std::make_unique<BoundModuleCache>(
+                  faasmConf.faasletModuleCacheSize,
+                  (size_t)faasmConf.faasletModuleCacheMb * 1024 * 1024));
+            }
+        }
+
+        // Set up the base cgroup for the Faaslets' child groups
+        isolation::initBaseCgroup(faasmConf.cgroupMemoryMaxMb * 1024L * 1024L,
+                                  faasmConf.cgroupMemoryHighMb * 1024L * 1024L);
+
+        // Pre-create isolation contexts for the Faaslets to take when bound
+        isolation::IsolationOptions options;
+        options.createNamespaces = faasmConf.netnsCreate == "on";
+        options.netnsSetupScript = faasmConf.netnsSetupScript;
+        options.ownCgroups =
+          isolation::detectCgroupVersion() == isolation::CgroupVersion::cg_v2 &&
+          faasmConf.cgroupGranularity != "function";
+        options.cgroupLimits.cpuWeight = faasmConf.cgroupCpuWeight;
+        options.cgroupLimits.cpuMax = faasmConf.cgroupCpuMax;
+
+        isolation::IsolationManager& isolationManager =
+          isolation::getIsolationManager();
+        isolationManager.configure(options);
+        isolationManager.prewarm(faasmConf.isolationPoolSize);
+
+        // Record latencies, and serve them locally if configured
+        isolation::getLatencyRegistry().setEnabled(faasmConf.latencyMetrics ==
+                                                   "on");
+        if (faasmConf.metricsPort > 0) {
+            metricsServer =
+              std::make_unique<MetricsServer>(faasmConf.metricsPort);
+            metricsServer->start();
+        }
+
         // Prepare the Python runtime up front
         preloadPythonRuntime();
     }
 
+    PoolController& getController() { return controller; }
+
+    BoundModuleCache* getModuleCache(int threadIdx)
+    {
+        if (threadIdx < 0 || threadIdx >= (int)moduleCaches.size()) {
+            return nullptr;
+        }
+
+        return moduleCaches.at(threadIdx).get();
+    }
+
   protected:
     std::unique_ptr<FaabricExecutor> createExecutor(int threadIdx)
     {
-        return std::make_unique<Faaslet>(threadIdx);
+        // Wait until the pool needs another Faaslet
+        controller.admit([this] { return this->isShutdown(); });
+
+        return std::make_unique<Faaslet>(
+          threadIdx, &controller, getModuleCache(threadIdx));
     }
+
+  private:
+    PoolController controller;
+
+    std::vector<std::unique_ptr<BoundModuleCache>> moduleCaches;
+
+    std::unique_ptr<MetricsServer> metricsServer;
 };
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cpprest/http_listener.h>
+
+#include <memory>
+#include <string>
+
+#define METRICS_PATH "/metrics"
+#define PROFILE_PATH_PREFIX "/profile/"
+#define TRACE_PATH_PREFIX "/trace/"
+
+namespace faaslet {
+/**
+ * Serves the host's latency histograms in Prometheus text format on
+ * localhost, for scraping by a local agent, along with the folded stacks of
+ * any profiled functions and the traces of recently traced calls.
+ */
+class MetricsServer
+{
+  public:
+    explicit MetricsServer(int portIn);
+
+    ~MetricsServer();
+
+    void start();
+
+    void stop();
+
+    int getPort();
+
+    static void handleGet(const web::http::http_request& request);
+
+  private:
+    int port;
+
+    std::unique_ptr<web::http::experimental::listener::http_listener>
+      listener;
+};
+}
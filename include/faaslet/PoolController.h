@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace faaslet {
+/**
+ * Decides how many Faaslets a pool should be running. The pool always runs at
+ * least its minimum size, and grows towards its maximum size only while there
+ * are bind messages waiting that the current Faaslets can't pick up, and the
+ * host isn't short of memory. Faaslets above the minimum are released when
+ * they time out idle, and new ones wait here until they're needed again.
+ */
+class PoolController
+{
+  public:
+    PoolController(int minSizeIn, int maxSizeIn);
+
+    void admit(const std::function<bool()>& isShutdown);
+
+    void notifyBound();
+
+    void release(bool wasBound);
+
+    bool shouldGrow();
+
+    int getMinSize();
+
+    int getMaxSize();
+
+    int getActiveCount();
+
+    int getBoundCount();
+
+    int getPeakCount();
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+
+    const int minSize;
+    const int maxSize;
+
+    int activeCount = 0;
+    int unboundCount = 0;
+    int boundCount = 0;
+    int peakCount = 0;
+
+    bool shouldGrowUnlocked();
+};
+
+long getAvailableMemoryMb();
+}
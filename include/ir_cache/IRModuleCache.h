@@ -5,6 +5,7 @@
 
 #include <faabric/util/config.h>
 #include <shared_mutex>
+#include <unordered_set>
 
 // Note that page size in wasm is 64kiB
 #define ONE_MB_PAGES 16
@@ -48,6 +49,8 @@ class IRModuleCache
                                 const std::string& func,
                                 const std::string& path);
 
+    void evictFunction(const std::string& user, const std::string& func);
+
     void clear();
 
   private:
@@ -56,6 +59,13 @@ class IRModuleCache
     std::unordered_map<std::string, Runtime::ModuleRef> compiledModuleMap;
     std::unordered_map<std::string, int> originalTableSizes;
 
+    // Object files read while loading main modules, until they're compiled
+    std::unordered_map<std::string, std::vector<uint8_t>> pendingObjectBytes;
+
+    // Keys of the main and shared modules loaded for each function
+    std::unordered_map<std::string, std::unordered_set<std::string>>
+      functionKeys;
+
     faabric::util::SystemConfig& conf;
 
     int getModuleCount(const std::string& key);
@@ -76,6 +86,10 @@ class IRModuleCache
                                                const std::string& path);
 
     IR::Module& getModuleFromMap(const std::string& key);
+
+    void addFunctionKey(const std::string& user,
+                        const std::string& func,
+                        const std::string& key);
 };
 
 IRModuleCache& getIRModuleCache();
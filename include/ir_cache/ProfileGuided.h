@@ -0,0 +1,139 @@
+#pragma once
+
+#include <WAVM/IR/Module.h>
+#include <WAVM/Runtime/Runtime.h>
+
+#include <proto/faabric.pb.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define PGO_COUNTER_PREFIX "__faasm_pgo_"
+#define PGO_ENTRY_PREFIX PGO_COUNTER_PREFIX "entry_"
+#define PGO_EDGE_PREFIX PGO_COUNTER_PREFIX "edge_"
+
+#define PGO_PROFILE_EXT ".profile"
+
+// Exported counter of instructions executed by metered builds
+#define METER_COUNTER_NAME "__faasm_meter_instructions"
+
+// Appended to object files built from a plan, followed by the plan's size
+#define PGO_TRAILER_MAGIC "FAASMPGO"
+
+// Only call sites at least this hot are inlined, and only callees up to this
+// size, until the module has grown by the given budget
+#define PGO_INLINE_MIN_CALLS 1000
+#define PGO_INLINE_MAX_CALLEE_BYTES 512
+#define PGO_INLINE_MAX_GROWTH_BYTES (256 * 1024)
+
+using namespace WAVM;
+
+namespace wasm {
+// Call sites are identified by the caller's function definition index and the
+// ordinal of the call within the caller's code
+typedef std::pair<Uptr, Uptr> PgoCallSite;
+
+struct PgoEdge
+{
+    Uptr callee = 0;
+    uint64_t count = 0;
+};
+
+/**
+ * Counts of function entries (keyed on definition index) and of direct calls
+ * at each call site, as collected by an instrumented build.
+ */
+struct PgoProfile
+{
+    std::map<Uptr, uint64_t> entryCounts;
+    std::map<PgoCallSite, PgoEdge> edgeCounts;
+
+    bool empty() const;
+
+    void add(const PgoProfile& other);
+
+    void subtract(const PgoProfile& other);
+
+    std::string toString() const;
+
+    static PgoProfile fromString(const std::string& str);
+};
+
+enum class PgoMode
+{
+    none,
+    instrument,
+    optimise,
+};
+
+/**
+ * The transformation a function's object file was built with. The same
+ * transformation must be applied to the IR module when the object is loaded.
+ * Metering is applied after any profile-guided transformation.
+ */
+struct PgoPlan
+{
+    PgoMode mode = PgoMode::none;
+    std::set<PgoCallSite> inlinedSites;
+    bool metered = false;
+
+    std::string toString() const;
+
+    static PgoPlan fromString(const std::string& str);
+};
+
+void instrumentModule(IR::Module& module);
+
+bool isInstrumented(const IR::Module& module);
+
+void meterModule(IR::Module& module);
+
+bool isMetered(const IR::Module& module);
+
+int64_t readMeterCounter(Runtime::Instance* instance,
+                         Runtime::Context* context);
+
+PgoPlan planInlining(const IR::Module& module, const PgoProfile& profile);
+
+void inlineCallSites(IR::Module& module, const std::set<PgoCallSite>& sites);
+
+void applyPgoPlan(IR::Module& module, const PgoPlan& plan);
+
+void appendPgoPlan(std::vector<uint8_t>& objectBytes, const PgoPlan& plan);
+
+PgoPlan extractPgoPlan(std::vector<uint8_t>& objectBytes);
+
+PgoProfile readPgoCounters(Runtime::Instance* instance,
+                           Runtime::Context* context,
+                           const IR::Module& module);
+
+std::string getPgoProfilePath(const faabric::Message& msg);
+
+/**
+ * Accumulates the counts collected by each function's instrumented calls,
+ * and keeps them persisted next to the function's object file.
+ */
+class PgoProfileStore
+{
+  public:
+    void record(const faabric::Message& msg, const PgoProfile& counts);
+
+    PgoProfile getProfile(const faabric::Message& msg);
+
+    void reset(const faabric::Message& msg);
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    std::unordered_map<std::string, PgoProfile> profiles;
+
+    PgoProfile& loadProfile(const faabric::Message& msg);
+};
+
+PgoProfileStore& getPgoProfileStore();
+}
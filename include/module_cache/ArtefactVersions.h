@@ -0,0 +1,31 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace module_cache {
+/**
+ * Records which version of each function's artefacts is cached on this host.
+ * When a newer version has been uploaded, everything cached for just that
+ * function is evicted: zygotes, IR modules, local copies of its files and
+ * memoized results. Other functions are unaffected.
+ */
+class ArtefactVersions
+{
+  public:
+    long refresh(const faabric::Message& msg);
+
+    long getCachedVersion(const faabric::Message& msg);
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    std::unordered_map<std::string, long> cachedVersions;
+};
+
+ArtefactVersions& getArtefactVersions();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace module_cache {
+/**
+ * Uses the host's chaining call graph to predict which functions will be
+ * chained by an incoming call, and creates their zygotes in the background so
+ * that the chained calls don't pay the cold start.
+ *
+ * Zygotes created speculatively count towards a memory budget until they are
+ * used by a real call. Each prewarm reserves its expected size when it's
+ * queued, and unused prewarms are evicted least recently predicted first to
+ * make room for new ones.
+ */
+class ChainPrewarmer
+{
+  public:
+    ChainPrewarmer();
+
+    ~ChainPrewarmer();
+
+    void prewarmChildren(const faabric::Message& msg);
+
+    void recordBind(const faabric::Message& msg);
+
+    void waitForPrewarms();
+
+    void clear();
+
+    long getPrewarmCount();
+
+    long getHitCount();
+
+    long getMissCount();
+
+    long getSkippedCount();
+
+    long getEvictedCount();
+
+    size_t getPrewarmedBytes();
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+    std::deque<faabric::Message> queue;
+    std::thread worker;
+    bool running = false;
+    int inFlight = 0;
+
+    // Zygotes queued or created by the prewarmer but not yet used, along with
+    // the bytes reserved for them
+    struct Prewarm
+    {
+        faabric::Message msg;
+        size_t bytes = 0;
+        bool ready = false;
+        std::list<std::string>::iterator lruIt;
+    };
+    std::unordered_map<std::string, Prewarm> prewarms;
+    std::list<std::string> lru;
+    size_t reservedBytes = 0;
+
+    // Zygote sizes seen so far, used to estimate reservations
+    std::unordered_map<std::string, size_t> knownBytes;
+
+    std::atomic<long> prewarmCount = 0;
+    std::atomic<long> hitCount = 0;
+    std::atomic<long> missCount = 0;
+    std::atomic<long> skippedCount = 0;
+    std::atomic<long> evictedCount = 0;
+
+    void workerLoop();
+
+    void doPrewarm(const faabric::Message& msg);
+
+    size_t estimateBytes(const std::string& key, size_t budgetBytes);
+
+    bool makeRoom(size_t bytes, size_t budgetBytes);
+
+    void removePrewarm(const std::string& key);
+};
+
+ChainPrewarmer& getChainPrewarmer();
+}
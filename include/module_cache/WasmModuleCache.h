@@ -6,7 +6,12 @@ namespace module_cache {
 class WasmModuleCache
 {
   public:
-    wasm::WAVMWasmModule& getCachedModule(const faabric::Message& msg);
+    std::shared_ptr<wasm::WAVMWasmModule> getCachedModule(
+      const faabric::Message& msg);
+
+    bool isModuleCached(const faabric::Message& msg);
+
+    void evictFunction(const faabric::Message& msg);
 
     void clear();
 
@@ -14,13 +19,41 @@ class WasmModuleCache
 
   private:
     std::shared_mutex mx;
-    std::unordered_map<std::string, wasm::WAVMWasmModule> cachedModuleMap;
+    std::unordered_map<std::string, std::shared_ptr<wasm::WAVMWasmModule>>
+      cachedModuleMap;
+
+    // NUMA node on which each zygote's memory was written
+    std::unordered_map<std::string, int> homeNodes;
+
+    // Zygotes created from each zygote, i.e. special zygotes and replicas
+    std::unordered_map<std::string, std::vector<std::string>> derivedKeys;
 
     std::string getCachedModuleKey(const faabric::Message& msg);
 
     std::string getBaseCachedModuleKey(const faabric::Message& msg);
 
     int getCachedModuleCount(const std::string& key);
+
+    void recordHomeNode(const std::string& key);
+
+    void evictKey(const std::string& key);
+
+    std::shared_ptr<wasm::WAVMWasmModule> doCreateBaseModule(
+      const faabric::Message& msg,
+      const std::string& baseKey);
+
+    std::shared_ptr<wasm::WAVMWasmModule> doCreateSpecialModule(
+      const faabric::Message& msg,
+      const std::string& baseKey,
+      const std::string& specialKey);
+
+    std::shared_ptr<wasm::WAVMWasmModule> getNodeLocalModule(
+      const std::string& key,
+      std::shared_ptr<wasm::WAVMWasmModule> module);
+
+    std::shared_ptr<wasm::WAVMWasmModule> findModule(const std::string& key);
+
+    std::shared_ptr<wasm::WAVMWasmModule> doFindModule(const std::string& key);
 };
 
 WasmModuleCache& getWasmModuleCache();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <dirent.h>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -97,7 +98,7 @@ class FileDescriptor
 
     size_t copyDirentsToWasiBuffer(uint8_t* buffer, size_t bufferLen);
 
-    Stat stat(const std::string& relativePath = "");
+    Stat stat(const std::string& relativePath = "") const;
 
     bool unlink(const std::string& relativePath = "");
 
@@ -120,29 +121,29 @@ class FileDescriptor
 
     uint16_t seek(int64_t offset, int wasiWhence, uint64_t* newOffset);
 
-    uint64_t tell();
+    uint64_t tell() const;
 
     uint8_t wasiPreopenType;
 
-    int getLinuxFd();
+    int getLinuxFd() const;
 
-    int getLinuxFlags();
+    int getLinuxFlags() const;
 
-    int getLinuxErrno();
+    int getLinuxErrno() const;
 
-    uint16_t getWasiErrno();
+    uint16_t getWasiErrno() const;
 
-    uint64_t getActualRightsBase();
+    uint64_t getActualRightsBase() const;
 
-    uint64_t getActualRightsInheriting();
+    uint64_t getActualRightsInheriting() const;
 
     void setActualRights(uint64_t rights, uint64_t inheriting);
 
-    std::string absPath(const std::string& relativePath);
+    std::string absPath(const std::string& relativePath) const;
 
     void setPath(const std::string& newPath);
 
-    std::string getPath();
+    std::string getPath() const;
 
     int duplicate(const FileDescriptor& other);
 
@@ -164,8 +165,10 @@ class FileDescriptor
 
     uint16_t wasiErrno = 0;
 
+    // Directory entries are only loaded on the first readdir, and are shared
+    // between copies of the descriptor rather than copied
     bool dirContentsLoaded = false;
-    std::vector<DirEnt> dirContents;
+    std::shared_ptr<const std::vector<DirEnt>> dirContents;
     int dirContentsIdx = 0;
 };
 }
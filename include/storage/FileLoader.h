@@ -6,6 +6,10 @@
 #include <string>
 #include <vector>
 
+namespace wasm {
+struct PgoPlan;
+}
+
 #define HASH_EXT ".md5"
 
 #define EMPTY_FILE_RESPONSE "Empty response"
@@ -82,16 +86,26 @@ class FileLoader
 
     virtual void flushFunctionFiles() = 0;
 
+    virtual void flushFunctionFiles(const faabric::Message& msg) = 0;
+
     void codegenForFunction(faabric::Message& msg);
 
     void codegenForSharedObject(const std::string& inputPath);
 
+    wasm::PgoPlan pgoCodegenForFunction(faabric::Message& msg, bool instrument);
+
   protected:
     std::vector<uint8_t> doCodegen(std::vector<uint8_t>& bytes,
-                                   const std::string& fileName);
+                                   const std::string& fileName,
+                                   bool meter = false);
 
     std::vector<uint8_t> hashBytes(const std::vector<uint8_t>& bytes);
 
+    std::vector<uint8_t> hashCodegenInput(const std::vector<uint8_t>& bytes,
+                                          bool meter);
+
+    bool shouldMeter(const faabric::Message& msg);
+
     std::string getHashFilePath(const std::string& path);
 };
 
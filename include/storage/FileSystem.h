@@ -4,9 +4,18 @@
 
 #include <proto/faabric.pb.h>
 
+#include <memory>
 #include <unordered_map>
 
 namespace storage {
+/**
+ * A module's table of file descriptors. The table and the descriptors in it
+ * are shared copy-on-write between copies of the filesystem, so cloning a
+ * module from its zygote doesn't copy any descriptors. Lookups that only read
+ * a descriptor share it. A clone only gets its own copy of the table when it
+ * opens, duplicates or changes a descriptor, and its own copy of a descriptor
+ * when it changes it.
+ */
 class FileSystem
 {
   public:
@@ -16,6 +25,8 @@ class FileSystem
 
     storage::FileDescriptor& getFileDescriptor(int fd);
 
+    const storage::FileDescriptor& lookupFileDescriptor(int fd) const;
+
     int openFileDescriptor(int rootFd,
                            const std::string& path,
                            uint64_t rightsBase,
@@ -34,13 +45,24 @@ class FileSystem
 
     std::string getPathForFd(int fd);
 
+    size_t getFileDescriptorCount();
+
+    size_t getOwnedFileDescriptorCount();
+
     void printDebugInfo();
 
   private:
     int nextFd;
 
-    std::unordered_map<int, storage::FileDescriptor> fileDescriptors;
+    using FdTable =
+      std::unordered_map<int, std::shared_ptr<storage::FileDescriptor>>;
+
+    std::shared_ptr<FdTable> fileDescriptors = std::make_shared<FdTable>();
 
     int getNewFd();
+
+    FdTable& getMutableTable();
+
+    storage::FileDescriptor& addFileDescriptor(int fd);
 };
 }
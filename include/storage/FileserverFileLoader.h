@@ -56,6 +56,8 @@ class FileserverFileLoader : public FileLoader
 
     void flushFunctionFiles() override;
 
+    void flushFunctionFiles(const faabric::Message& msg) override;
+
     void uploadFunction(faabric::Message& msg) override
     {
         throw std::runtime_error(
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace storage {
+/**
+ * Version of each function's uploaded artefacts. Uploading a function bumps
+ * its version in Redis, and hosts check for a new version at most every
+ * FUNCTION_VERSION_CHECK_MS. This lets hosts evict just the stale artefacts
+ * for that function rather than flushing everything.
+ */
+class FunctionVersions
+{
+  public:
+    long getVersion(const faabric::Message& msg);
+
+    long bumpVersion(const faabric::Message& msg);
+
+    void clear();
+
+  private:
+    std::mutex mx;
+
+    // Last known version, and when it was read from Redis
+    std::unordered_map<std::string, std::pair<long, long>> versions;
+};
+
+FunctionVersions& getFunctionVersions();
+
+std::string getFunctionVersionKey(const faabric::Message& msg);
+}
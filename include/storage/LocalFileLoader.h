@@ -68,6 +68,8 @@ class LocalFileLoader : public FileLoader
 
     void flushFunctionFiles() override;
 
+    void flushFunctionFiles(const faabric::Message& msg) override;
+
   private:
     std::vector<uint8_t> loadHashForPath(const std::string& path);
 
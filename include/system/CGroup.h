@@ -10,19 +10,53 @@ enum CgroupMode
     cg_on
 };
 
+enum CgroupVersion
+{
+    cg_v1,
+    cg_v2
+};
+
+/**
+ * Limits applied to a cgroup v2 child group. These map directly onto the
+ * cpu.weight and cpu.max interface files.
+ */
+struct CGroupLimits
+{
+    int cpuWeight = 100;
+    std::string cpuMax = "max";
+};
+
 class CGroup
 {
   public:
     explicit CGroup(const std::string& name);
 
+    void create(const CGroupLimits& limits);
+
     void addCurrentThread();
 
     const std::string getName();
 
     const CgroupMode getMode();
 
+    const CgroupVersion getVersion();
+
   private:
     std::string name;
     CgroupMode mode;
+    CgroupVersion version;
+
+    void disable(const std::string& reason);
 };
+
+// Root of the cgroup hierarchy, overridable for tests
+void setCgroupRoot(const std::string& root);
+
+std::string getCgroupRoot();
+
+CgroupVersion detectCgroupVersion();
+
+// Sets up the base group with the given memory limits (in bytes, zero for no
+// limit) and moves this process into it. Only applies to cgroup v2.
+void initBaseCgroup(long memoryMaxBytes, long memoryHighBytes);
 }
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// Records the enclosing scope as a span in the current call's trace, if it's
+// being traced. Category and name must be string literals.
+#define TRACE_SPAN(category, name)                                             \
+    isolation::TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(category, name);
+
+namespace isolation {
+/**
+ * A complete event, with times in microseconds of the steady clock.
+ */
+struct TraceEvent
+{
+    const char* category;
+    const char* name;
+    long startUs;
+    long durationUs;
+};
+
+/**
+ * Events recorded while executing a single call. Only the thread executing
+ * the call records into it, so it needs no locking.
+ */
+struct CallTrace
+{
+    unsigned long traceId = 0;
+    unsigned int messageId = 0;
+    std::string funcStr;
+    std::vector<TraceEvent> events;
+};
+
+long traceMicros(const std::chrono::steady_clock::time_point& t);
+
+CallTrace* getActiveCallTrace();
+
+void setActiveCallTrace(CallTrace* trace);
+
+void recordTraceSpan(const char* category,
+                     const char* name,
+                     const std::chrono::steady_clock::time_point& start);
+
+/**
+ * Records its own lifetime as a span. Does nothing but check a thread-local
+ * pointer when the current call isn't being traced.
+ */
+class TraceSpan
+{
+  public:
+    TraceSpan(const char* categoryIn, const char* nameIn);
+
+    ~TraceSpan();
+
+  private:
+    const char* category;
+    const char* name;
+    CallTrace* trace;
+    std::chrono::steady_clock::time_point start;
+};
+
+std::string callTracesToChromeJson(
+  const std::vector<std::shared_ptr<CallTrace>>& traces);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "CGroup.h"
+#include "NetworkNamespace.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace isolation {
+struct IsolationOptions
+{
+    // Create any missing network namespaces rather than requiring them to be
+    // set up beforehand, running the setup script (if any) on each new one
+    bool createNamespaces = false;
+    std::string netnsSetupScript;
+
+    // Give each context its own cgroup v2 leaf with these limits
+    bool ownCgroups = false;
+    CGroupLimits cgroupLimits;
+};
+
+/**
+ * A network namespace and cgroup leaf that can be handed to a Faaslet and
+ * recycled when it finishes. The network namespace is only joined when a
+ * thread needs it, and each thread running in the context (the Faaslet's and
+ * any guest threads it spawns) joins it separately.
+ */
+class IsolationContext
+{
+  public:
+    IsolationContext(int idxIn, bool ownCgroup, const CGroupLimits& limits);
+
+    int getIdx();
+
+    NetworkNamespace& getNetworkNamespace();
+
+    CGroup* getCgroup();
+
+    // These apply to the calling thread only
+    void attachNetwork();
+
+    void detachNetwork();
+
+    bool isNetworkAttached();
+
+  private:
+    int idx;
+    NetworkNamespace ns;
+    std::unique_ptr<CGroup> cgroup;
+};
+
+/**
+ * Hands out isolation contexts from a pool, creating new ones as needed.
+ * Contexts have their own indices, independent of the Faaslets' thread
+ * indices, so the number of namespaces follows demand rather than the pool
+ * size.
+ */
+class IsolationManager
+{
+  public:
+    void configure(const IsolationOptions& optionsIn);
+
+    void prewarm(int nContexts);
+
+    std::unique_ptr<IsolationContext> acquire();
+
+    void release(std::unique_ptr<IsolationContext> context);
+
+    int getCreatedCount();
+
+    int getFreeCount();
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    IsolationOptions options;
+
+    std::vector<std::unique_ptr<IsolationContext>> freeContexts;
+    int nextIdx = 1;
+
+    std::unique_ptr<IsolationContext> createContext(int idx);
+
+    void createNamespace(const std::string& name, int idx);
+};
+
+IsolationManager& getIsolationManager();
+
+// The context the current thread is running in
+void setThreadIsolationContext(IsolationContext* context);
+
+IsolationContext* getThreadIsolationContext();
+
+// Joins the current thread's network namespace if it hasn't already
+void attachThreadNetwork();
+
+/**
+ * Runs the current thread in the given context while in scope, so that guest
+ * threads use the same network namespace as the call that spawned them. The
+ * namespace is left again if it was joined in the meantime.
+ */
+class ThreadIsolationScope
+{
+  public:
+    explicit ThreadIsolationScope(IsolationContext* context);
+
+    ~ThreadIsolationScope();
+
+  private:
+    IsolationContext* previousContext;
+    bool wasAttached;
+};
+
+long getNetworkAttachCount();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <system/CallTrace.h>
+
+#include <faabric/util/timing.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Bucket upper bounds are powers of two microseconds from 1us to ~67s, with a
+// final bucket for anything longer
+#define LATENCY_BUCKETS 28
+#define MAX_LATENCY_METRICS 64
+
+#define LATENCY_METRIC_NAME "faasm_latency_seconds"
+
+// Times the enclosed block into the named histogram, and into the current
+// call's trace if it's being traced, as well as logging it like
+// PROF_START/PROF_END in tracing builds
+#define LATENCY_START(name)                                                    \
+    PROF_START(name)                                                           \
+    const auto name##LatencyStart = std::chrono::steady_clock::now();
+
+#define LATENCY_END(name)                                                      \
+    PROF_END(name)                                                             \
+    {                                                                          \
+        static const int name##MetricId =                                      \
+          isolation::getLatencyRegistry().getMetricId(#name);                  \
+        isolation::getLatencyRegistry().recordSince(name##MetricId,            \
+                                                    name##LatencyStart);       \
+        isolation::recordTraceSpan("lifecycle", #name, name##LatencyStart);    \
+    }
+
+namespace isolation {
+/**
+ * Merged view of a single histogram. Bucket counts are not cumulative.
+ */
+struct LatencySnapshot
+{
+    std::string name;
+    std::array<uint64_t, LATENCY_BUCKETS> buckets = {};
+    uint64_t count = 0;
+    uint64_t sumMicros = 0;
+};
+
+/**
+ * Counts for every metric recorded by a single thread.
+ */
+struct ThreadLatencyBuckets
+{
+    struct Metric
+    {
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> buckets;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sumMicros;
+    };
+
+    std::array<Metric, MAX_LATENCY_METRICS> metrics;
+
+    ThreadLatencyBuckets();
+
+    void reset();
+};
+
+/**
+ * Host-wide latency histograms for runtime operations. Each thread records
+ * into its own buckets with relaxed atomic increments, so recording never
+ * takes a lock or contends with other threads. Reading merges the buckets of
+ * all threads, including those that have since exited.
+ */
+class LatencyRegistry
+{
+  public:
+    int getMetricId(const std::string& name);
+
+    void record(int metricId, long micros);
+
+    void recordSince(int metricId,
+                     const std::chrono::steady_clock::time_point& start);
+
+    void setEnabled(bool enabledIn);
+
+    bool isEnabled();
+
+    std::vector<LatencySnapshot> getSnapshots();
+
+    LatencySnapshot getSnapshot(const std::string& name);
+
+    std::string getPrometheusText();
+
+    void clear();
+
+    void addThread(ThreadLatencyBuckets* threadBuckets);
+
+    void removeThread(ThreadLatencyBuckets* threadBuckets);
+
+  private:
+    std::atomic<bool> enabled = true;
+
+    std::mutex mx;
+    std::vector<std::string> metricNames;
+    std::vector<ThreadLatencyBuckets*> threads;
+    ThreadLatencyBuckets exitedThreads;
+};
+
+LatencyRegistry& getLatencyRegistry();
+
+int getLatencyBucket(long micros);
+}
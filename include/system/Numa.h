@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define NUMA_SYSFS_DIR "/sys/devices/system/node"
+
+namespace isolation {
+/**
+ * The host's NUMA nodes and the CPUs on each, as reported by sysfs. Hosts
+ * without NUMA information are treated as having a single node.
+ */
+class NumaTopology
+{
+  public:
+    explicit NumaTopology(const std::string& sysfsDir = NUMA_SYSFS_DIR);
+
+    int getNodeCount();
+
+    bool isNuma();
+
+    const std::vector<int>& getNodeIds();
+
+    const std::vector<int>& getNodeCpus(int nodeId);
+
+    int getNodeForCpu(int cpu);
+
+    int getCurrentNode();
+
+    int pinCurrentThread(int idx, bool toCore);
+
+    int pinCurrentThreadToNode(int nodeId);
+
+  private:
+    std::vector<int> nodeIds;
+    std::vector<std::vector<int>> nodeCpus;
+
+    size_t getNodeIndex(int nodeId);
+};
+
+NumaTopology& getNumaTopology();
+
+std::vector<int> parseCpuList(const std::string& cpuList);
+
+void setCurrentThreadAffinity(const std::vector<int>& cpus);
+
+std::vector<int> getCurrentThreadAffinity();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bits of /proc/self/pagemap entries
+#define PAGEMAP_EXCLUSIVE (1ULL << 56)
+#define PAGEMAP_FILE_OR_SHARED (1ULL << 61)
+#define PAGEMAP_SWAPPED (1ULL << 62)
+#define PAGEMAP_PRESENT (1ULL << 63)
+
+// Entries read from the pagemap at a time
+#define PAGEMAP_BATCH_SIZE 4096
+
+// Flags for each page returned by readPageStates
+#define PAGE_TOUCHED 1
+#define PAGE_DIRTIED 2
+
+namespace isolation {
+std::vector<uint8_t> readPageStates(const uint8_t* start, size_t nBytes);
+}
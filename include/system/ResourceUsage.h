@@ -0,0 +1,79 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace isolation {
+/**
+ * Resources used by a single finished call. The CPU time is that of the
+ * executing thread. The memory figure is the size of the module's linear
+ * memory when the call finished. This includes the zygote's pages, and on a
+ * reused module any growth from earlier calls, so isn't the call's own peak.
+ * Start and end times are in microseconds of the steady clock.
+ * Instructions are only counted for functions built with metering, and are -1
+ * otherwise.
+ */
+struct CallResourceUsage
+{
+    long cpuTimeMicros = 0;
+    long finalMemoryBytes = 0;
+    long startMicros = 0;
+    long endMicros = 0;
+    long instructions = -1;
+};
+
+/**
+ * Bounded host-wide record of resource usage for recently finished calls,
+ * keyed on message ID. The oldest entries are dropped once full.
+ */
+class ResourceUsageLog
+{
+  public:
+    explicit ResourceUsageLog(size_t capacityIn);
+
+    void record(unsigned int messageId, const CallResourceUsage& usage);
+
+    bool getUsage(unsigned int messageId, CallResourceUsage& usage);
+
+    size_t getSize();
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    const size_t capacity;
+    std::deque<unsigned int> order;
+    std::unordered_map<unsigned int, CallResourceUsage> usages;
+};
+
+ResourceUsageLog& getResourceUsageLog();
+
+/**
+ * Measures the resources used by a call for as long as it's in scope. CPU time
+ * is taken from the executing thread's rusage, so nothing is read from the
+ * cgroup filesystem on the call path.
+ */
+class ResourceUsageMeter
+{
+  public:
+    explicit ResourceUsageMeter(unsigned int messageIdIn);
+
+    ~ResourceUsageMeter();
+
+    void setInstructions(long instructionsIn);
+
+    void setFinalMemory(long finalMemoryBytesIn);
+
+  private:
+    unsigned int messageId;
+    long startCpuMicros;
+    long startMicros;
+    long instructions = -1;
+    long finalMemoryBytes = 0;
+};
+
+long getThreadCpuMicros();
+
+long getSteadyClockMicros();
+}
@@ -45,6 +45,8 @@ class WAMRWasmModule final : public WasmModule
 
     uint8_t* wasmPointerToNative(int32_t wasmPtr) override;
 
+    size_t getMemorySizeBytes() override;
+
   private:
     bool _isBound;
 
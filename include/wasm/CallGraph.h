@@ -0,0 +1,47 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wasm {
+/**
+ * Per-host model of which functions chain which others. Counts the number of
+ * times each function is called, and the number of times it chains each of
+ * its children, so that we can estimate how likely a call to a given function
+ * is to be followed by a call to each of its children.
+ */
+class CallGraph
+{
+  public:
+    void recordCall(const faabric::Message& msg);
+
+    void recordChainedCall(const faabric::Message& parent,
+                           const faabric::Message& child);
+
+    long getCallCount(const faabric::Message& msg);
+
+    long getChainedCallCount(const faabric::Message& parent,
+                             const faabric::Message& child);
+
+    std::vector<std::string> getLikelyChildren(const faabric::Message& msg,
+                                               int minPercentage);
+
+    void clear();
+
+  private:
+    std::shared_mutex mx;
+
+    std::unordered_map<std::string, long> callCounts;
+
+    // Parent -> (child function -> count). Children are always chained by
+    // functions of the same user, so we only need the function name
+    std::unordered_map<std::string, std::unordered_map<std::string, long>>
+      chainedCallCounts;
+};
+
+CallGraph& getCallGraph();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <system/CallTrace.h>
+
+#include <proto/faabric.pb.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TRACE_LOG_CAPACITY 1000
+
+namespace wasm {
+/**
+ * Decides which calls are traced, and keeps the traces of recently finished
+ * calls. A call is traced if its function is listed in TRACE_FUNCTIONS, if it
+ * was enabled individually, or if it was chained by, or is an MPI rank of, a
+ * traced call, in which case it shares that call's trace ID. By default a
+ * trace's ID is the ID of the call that started it.
+ *
+ * Each call's events are recorded into a buffer owned by the thread executing
+ * it, so recording takes no locks. When TRACE_DIR is set, each trace is
+ * written there as Chrome trace-event JSON whenever one of its calls
+ * finishes.
+ */
+class CallTracer
+{
+  public:
+    bool shouldTrace(const faabric::Message& msg, unsigned long& traceId);
+
+    void enableForCall(unsigned int messageId, unsigned long traceId = 0);
+
+    void startCall(const faabric::Message& msg);
+
+    void resumeCall(const faabric::Message& msg);
+
+    void finishCall(const faabric::Message& msg);
+
+    void propagateToCall(unsigned int messageId);
+
+    void propagateToMpiWorld(int worldId);
+
+    void joinMpiWorld(const faabric::Message& msg, int worldId);
+
+    std::vector<std::shared_ptr<isolation::CallTrace>> getTrace(
+      unsigned long traceId);
+
+    std::string getTraceJson(unsigned long traceId);
+
+    std::string getTraceFilePath(unsigned long traceId);
+
+    void clear();
+
+  private:
+    std::mutex mx;
+
+    // Calls and MPI worlds to trace, with the trace they belong to. Worlds
+    // are also mapped to the call that created them, until it finishes.
+    std::atomic<size_t> enabledCount = 0;
+    std::unordered_map<unsigned int, unsigned long> enabledCalls;
+    std::unordered_map<int, std::pair<unsigned long, unsigned int>>
+      tracedWorlds;
+
+    // Finished calls, oldest first
+    std::deque<std::shared_ptr<isolation::CallTrace>> finishedCalls;
+
+    void writeTraceFile(unsigned long traceId);
+};
+
+CallTracer& getCallTracer();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <time.h>
+
+namespace wasm {
+/**
+ * Wall-clock and CPU time limits for a call, in milliseconds. Zero means no
+ * limit.
+ */
+struct CallTimeLimits
+{
+    long wallMs = 0;
+    long cpuMs = 0;
+
+    bool isLimited() const { return wallMs > 0 || cpuMs > 0; }
+};
+
+CallTimeLimits getCallTimeLimits(const faabric::Message& msg);
+
+/**
+ * Background thread enforcing time limits on executing calls. Each call arms
+ * a watch with its limits and a callback to interrupt it, and disarms it when
+ * it's finished. If a limit passes first, the watchdog invokes the callback
+ * from its own thread, and again on every check until the watch is disarmed.
+ * The callback can therefore ignore a check, e.g. while the call is in host
+ * code, and catch the call on a later one.
+ *
+ * The callback is only ever invoked while the watchdog holds its lock, so once
+ * disarm has returned the callback won't run.
+ */
+class ExecutionWatchdog
+{
+  public:
+    ~ExecutionWatchdog();
+
+    int arm(const CallTimeLimits& limits, std::function<void()> interrupt);
+
+    bool disarm(int watchId, std::string& reason);
+
+    int getWatchCount();
+
+    long getInterruptCount();
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+    std::thread watchdogThread;
+    bool running = false;
+
+    struct Watch
+    {
+        std::chrono::steady_clock::time_point deadline;
+        long cpuLimitMicros;
+        clockid_t cpuClock;
+        long startCpuMicros;
+        std::function<void()> interrupt;
+        bool fired = false;
+        std::string reason;
+    };
+
+    std::unordered_map<int, Watch> watches;
+    int nextWatchId = 1;
+
+    std::atomic<long> interruptCount = 0;
+
+    void run();
+
+    void checkWatches();
+};
+
+ExecutionWatchdog& getExecutionWatchdog();
+
+long getCpuClockMicros(clockid_t clock);
+
+class CallTimeoutException : public std::runtime_error
+{
+  public:
+    explicit CallTimeoutException(const std::string& reason)
+      : std::runtime_error(reason)
+    {}
+};
+}
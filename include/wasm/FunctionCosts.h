@@ -0,0 +1,41 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Weight given to each new call in a function's moving average
+#define FUNCTION_COST_EWMA_WEIGHT 0.2
+
+namespace wasm {
+/**
+ * Exponentially weighted moving average of the instructions executed by each
+ * function's calls, for functions built with metering. Used to predict how
+ * expensive a call will be before it runs.
+ */
+class FunctionCosts
+{
+  public:
+    void record(const faabric::Message& msg, int64_t instructions);
+
+    double getAverage(const std::string& funcStr);
+
+    long getCallCount(const std::string& funcStr);
+
+    void clear();
+
+  private:
+    struct Cost
+    {
+        double average = 0;
+        long calls = 0;
+    };
+
+    std::mutex mx;
+    std::unordered_map<std::string, Cost> costs;
+};
+
+FunctionCosts& getFunctionCosts();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace wasm {
+/**
+ * Input and output of a chained call that is executed on this host. These are
+ * handed directly between caller and callee rather than being serialised into
+ * the protobuf messages.
+ */
+struct LocalCallBuffer
+{
+    unsigned int callerId = 0;
+    std::vector<uint8_t> input;
+
+    // The callee writes the output while the caller may be reading it
+    std::mutex outputMx;
+    bool hasOutput = false;
+    std::vector<uint8_t> output;
+
+    // Guarded by the registry's lock
+    bool callerFinished = false;
+    bool calleeFinished = false;
+};
+
+/**
+ * Host-wide registry of the buffers for chained calls which take the local
+ * fast path. Buffers are keyed on message ID, and are removed once the caller
+ * has collected the result. Buffers for calls the caller never awaits are
+ * removed once both the caller and the callee have finished.
+ */
+class LocalCallBuffers
+{
+  public:
+    void addCall(unsigned int messageId,
+                 unsigned int callerId,
+                 const std::vector<uint8_t>& input);
+
+    bool isLocalCall(unsigned int messageId);
+
+    size_t getInputSize(unsigned int messageId);
+
+    size_t readInput(unsigned int messageId, uint8_t* buffer, size_t bufferLen);
+
+    void writeOutput(unsigned int messageId, const uint8_t* data, size_t len);
+
+    bool readOutput(unsigned int messageId, std::vector<uint8_t>& output);
+
+    std::shared_ptr<LocalCallBuffer> getBuffer(unsigned int messageId);
+
+    std::shared_ptr<LocalCallBuffer> removeCall(unsigned int messageId);
+
+    void finishCall(unsigned int messageId);
+
+    size_t getCallCount();
+
+    void clear();
+
+  private:
+    std::shared_mutex mx;
+    std::unordered_map<unsigned int, std::shared_ptr<LocalCallBuffer>> buffers;
+
+    // IDs of the buffered calls made by each caller
+    std::unordered_map<unsigned int, std::vector<unsigned int>> callerCalls;
+
+    void doRemoveCall(unsigned int messageId);
+};
+
+LocalCallBuffers& getLocalCallBuffers();
+
+// Input/ output for a call, taking the local buffers into account
+size_t getCallInputSize(const faabric::Message& msg);
+
+size_t readCallInput(const faabric::Message& msg,
+                     uint8_t* buffer,
+                     size_t bufferLen);
+
+void writeCallOutput(faabric::Message& msg, const uint8_t* data, size_t len);
+
+std::vector<uint8_t> getCallInput(const faabric::Message& msg);
+
+std::vector<uint8_t> getCallOutput(const faabric::Message& msg);
+}
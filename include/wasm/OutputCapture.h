@@ -0,0 +1,59 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define OUTPUT_TRUNCATED_MARKER "[output truncated, {} bytes dropped]\n"
+
+namespace wasm {
+/**
+ * Captured output of a single call, held in a fixed-size ring buffer. Once the
+ * buffer is full, the oldest output is dropped, and a marker saying how much
+ * was dropped is put in front of what's left when it's read.
+ *
+ * Complete lines can also be streamed to a local sink as they're written,
+ * either the log or a file per function, so the full output is available
+ * without having to hold it in memory.
+ */
+class OutputCapture
+{
+  public:
+    OutputCapture(const faabric::Message& msg, size_t capacityBytesIn);
+
+    ~OutputCapture();
+
+    void write(const char* data, size_t len);
+
+    std::string read();
+
+    size_t getCapacityBytes();
+
+    size_t getWrittenBytes();
+
+    size_t getDroppedBytes();
+
+  private:
+    std::mutex mx;
+
+    std::vector<char> buffer;
+    size_t head = 0;
+    size_t bufferedBytes = 0;
+    size_t writtenBytes = 0;
+
+    // Streaming to the sink
+    std::string sink;
+    std::string funcStr;
+    unsigned int messageId;
+    std::string partialLine;
+    int sinkFd = -1;
+
+    void streamLines(const char* data, size_t len);
+
+    void writeLine(const std::string& line);
+};
+
+size_t getOutputCaptureBytes(const faabric::Message& msg);
+}
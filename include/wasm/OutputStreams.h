@@ -0,0 +1,164 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace wasm {
+/**
+ * Bounded in-memory stream of output chunks, used when a chained call runs on
+ * the same host as its caller. Writers block while the stream is full, so a
+ * fast producer can't get ahead of a slow consumer by more than the stream's
+ * capacity.
+ */
+class OutputStream
+{
+  public:
+    explicit OutputStream(size_t capacityBytesIn);
+
+    void write(const uint8_t* data, size_t len, int timeoutMs);
+
+    size_t read(uint8_t* buffer, size_t bufferLen, int timeoutMs);
+
+    void close();
+
+    void abandon();
+
+    bool isClosed();
+
+    bool hasWritten();
+
+    size_t getBufferedBytes();
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+
+    const size_t capacityBytes;
+    std::deque<std::vector<uint8_t>> chunks;
+    size_t headOffset = 0;
+    size_t bufferedBytes = 0;
+
+    bool closed = false;
+    bool written = false;
+
+    // Set once the reader has gone, after which writes are dropped
+    bool abandoned = false;
+};
+
+/**
+ * Caller-side state for reading the output of a chained call.
+ */
+struct OutputStreamReader
+{
+    unsigned int callerId = 0;
+    bool isLocal = false;
+    bool isStreamed = false;
+    std::shared_ptr<OutputStream> localStream = nullptr;
+
+    // Current chunk being read
+    std::vector<uint8_t> chunk;
+    size_t offset = 0;
+    bool eof = false;
+
+    // If the callee didn't stream, we have to take the output (and hence the
+    // result) from the result message. Memoized calls are never dispatched,
+    // so start with their result.
+    bool hasResult = false;
+    faabric::Message result;
+};
+
+/**
+ * Callee-side state for a call whose output doesn't go through a local
+ * stream. Whether there's a remote reader is only checked once per call.
+ */
+struct RemoteStreamWriter
+{
+    bool hasReader = false;
+    bool hasWritten = false;
+};
+
+/**
+ * Host-wide registry of output streams. Callers register a reader for every
+ * call they chain, which is dropped when the call is awaited or the caller
+ * finishes. Only calls to functions listed in OUTPUT_STREAM_FUNCTIONS stream
+ * their output: on the local fast path through an in-memory stream, and on
+ * other hosts through Redis in chunks. Other calls hand back their output in
+ * one go once they finish.
+ */
+class OutputStreams
+{
+  public:
+    void addReader(unsigned int messageId,
+                   unsigned int callerId,
+                   bool isLocal,
+                   bool isStreamed);
+
+    void addCompletedReader(unsigned int messageId,
+                            unsigned int callerId,
+                            const std::vector<uint8_t>& output);
+
+    std::shared_ptr<OutputStreamReader> getReader(unsigned int messageId);
+
+    std::shared_ptr<OutputStream> getLocalStream(unsigned int messageId);
+
+    void removeReader(unsigned int messageId);
+
+    void finishCall(unsigned int callerId);
+
+    std::shared_ptr<RemoteStreamWriter> getRemoteWriter(
+      unsigned int messageId);
+
+    std::shared_ptr<RemoteStreamWriter> addRemoteWriter(unsigned int messageId,
+                                                        bool hasReader);
+
+    std::shared_ptr<RemoteStreamWriter> removeRemoteWriter(
+      unsigned int messageId);
+
+    size_t getReaderCount();
+
+    void clear();
+
+  private:
+    std::shared_mutex mx;
+    std::unordered_map<unsigned int, std::shared_ptr<OutputStreamReader>>
+      readers;
+
+    // IDs of the calls each caller has readers for
+    std::unordered_map<unsigned int, std::vector<unsigned int>> callerReaders;
+
+    std::shared_ptr<OutputStreamReader> doRemoveReader(unsigned int messageId);
+
+    // Callee-side state for calls that aren't on the local fast path
+    std::unordered_map<unsigned int, std::shared_ptr<RemoteStreamWriter>>
+      remoteWriters;
+};
+
+OutputStreams& getOutputStreams();
+
+std::string getOutputStreamKey(unsigned int messageId);
+
+std::string getOutputStreamReaderKey(unsigned int messageId);
+
+bool isOutputStreamed(const faabric::Message& msg);
+
+// Callee side
+void writeCallOutputChunk(faabric::Message& msg,
+                          const uint8_t* data,
+                          size_t len);
+
+void closeCallOutputStream(const faabric::Message& msg);
+
+// Caller side
+size_t readCallOutputChunk(unsigned int messageId,
+                           uint8_t* buffer,
+                           size_t bufferLen);
+
+std::vector<uint8_t> drainCallOutputStream(unsigned int messageId);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace wasm {
+struct ResultCacheEntry
+{
+    std::string name;
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> output;
+};
+
+/**
+ * Memoizes the output of pure functions, keyed on the function and a hash of
+ * its input. Functions must opt in via the MEMOIZE_FUNCTIONS config, as only
+ * functions whose output depends solely on their input can be memoized.
+ *
+ * Entries are held in a bounded in-memory LRU, and can optionally be persisted
+ * to the local filesystem so that they survive the LRU and restarts. The full
+ * input is stored alongside each entry to rule out hash collisions.
+ */
+class ResultCache
+{
+  public:
+    bool isMemoizable(const faabric::Message& msg);
+
+    bool getResult(const faabric::Message& msg,
+                   const std::vector<uint8_t>& input,
+                   std::vector<uint8_t>& output);
+
+    void putResult(const faabric::Message& msg,
+                   const std::vector<uint8_t>& input,
+                   const std::vector<uint8_t>& output);
+
+    long getHitCount();
+
+    long getMissCount();
+
+    long getEvictionCount();
+
+    size_t getEntryCount();
+
+    void clearFunction(const faabric::Message& msg);
+
+    void clear();
+
+  private:
+    std::mutex mx;
+
+    std::list<std::string> lru;
+    std::unordered_map<
+      std::string,
+      std::pair<ResultCacheEntry, std::list<std::string>::iterator>>
+      entries;
+
+    std::string memoizedFunctionsStr;
+    std::unordered_set<std::string> memoizedFunctions;
+
+    std::atomic<long> hitCount = 0;
+    std::atomic<long> missCount = 0;
+    std::atomic<long> evictionCount = 0;
+
+    void insertEntry(const std::string& key, const ResultCacheEntry& entry);
+
+    bool loadEntry(const std::string& path, ResultCacheEntry& entry);
+
+    void persistEntry(const std::string& path, const ResultCacheEntry& entry);
+};
+
+ResultCache& getResultCache();
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "OutputCapture.h"
 #include "WasmEnvironment.h"
 
 #include <faabric/state/State.h>
@@ -82,6 +83,9 @@ class WasmModule
 
     void clearCapturedStdout();
 
+    // ----- Metering -----
+    int64_t getMeteredInstructions();
+
     // ----- Memory management -----
     virtual uint32_t mmapMemory(uint32_t length);
 
@@ -96,6 +100,8 @@ class WasmModule
 
     virtual uint8_t* wasmPointerToNative(int32_t wasmPtr);
 
+    virtual size_t getMemorySizeBytes();
+
     // ----- CoW memory -----
     virtual void writeMemoryToFd(int fd);
 
@@ -126,15 +132,17 @@ class WasmModule
 
     WasmEnvironment wasmEnvironment;
 
-    int stdoutMemFd;
-    ssize_t stdoutSize;
+    std::unique_ptr<OutputCapture> stdoutCapture;
 
     // Argc/argv
     unsigned int argc;
     std::vector<std::string> argv;
     size_t argvBufferSize;
 
-    int getStdoutFd();
+    // Instructions executed by the last call, or -1 if it wasn't metered
+    int64_t meteredInstructions = -1;
+
+    OutputCapture& getStdoutCapture();
 
     virtual void doSnapshot(std::ostream& outStream);
 
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <proto/faabric.pb.h>
+
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Regions of linear memory, with the stack at the bottom
+#define WORKING_SET_STACK 0
+#define WORKING_SET_DATA 1
+#define WORKING_SET_HEAP 2
+#define WORKING_SET_N_REGIONS 3
+
+namespace wasm {
+struct RegionPages
+{
+    long pages = 0;
+    long touched = 0;
+    long dirtied = 0;
+};
+
+/**
+ * The host pages of linear memory touched and dirtied by a call, from the
+ * stack at the bottom of memory, through the data, to the heap from
+ * __heap_base upwards. The heap includes anything mapped by the call, e.g.
+ * thread stacks. Offsets are in bytes of linear memory.
+ */
+struct CallWorkingSet
+{
+    size_t pageSize = 0;
+    size_t dataStart = 0;
+    size_t heapStart = 0;
+    size_t memoryBytes = 0;
+
+    // Flags from isolation::readPageStates for each page
+    std::vector<uint8_t> pageStates;
+
+    std::array<RegionPages, WORKING_SET_N_REGIONS> getRegionPages() const;
+
+    std::string toString() const;
+};
+
+/**
+ * Per-call totals and maxima for a region, along with the pages touched or
+ * dirtied by any call. The region's size is the largest seen.
+ */
+struct RegionReport
+{
+    long pages = 0;
+    long totalTouched = 0;
+    long maxTouched = 0;
+    long totalDirtied = 0;
+    long maxDirtied = 0;
+    long everTouched = 0;
+    long everDirtied = 0;
+};
+
+struct WorkingSetReport
+{
+    long calls = 0;
+    size_t pageSize = 0;
+    std::array<RegionReport, WORKING_SET_N_REGIONS> regions;
+
+    std::string toString() const;
+};
+
+/**
+ * Working sets of the calls to each function listed in WORKING_SET_FUNCTIONS,
+ * combined into a report per function.
+ */
+class FunctionWorkingSets
+{
+  public:
+    bool shouldAnalyse(const faabric::Message& msg);
+
+    void record(const faabric::Message& msg, const CallWorkingSet& workingSet);
+
+    bool getReport(const std::string& funcStr, WorkingSetReport& report);
+
+    void clear();
+
+  private:
+    struct FunctionWorkingSet
+    {
+        WorkingSetReport report;
+
+        // Pages touched or dirtied by any call
+        CallWorkingSet combined;
+    };
+
+    std::mutex mx;
+    std::unordered_map<std::string, FunctionWorkingSet> workingSets;
+};
+
+FunctionWorkingSets& getFunctionWorkingSets();
+}
@@ -16,4 +16,33 @@ int makeChainedCall(const std::string& functionName,
                     int wasmFuncPtr,
                     const char* pyFunc,
                     const std::vector<uint8_t>& inputData);
+
+/**
+ * Hooks run when the executing call blocks waiting on other calls, and when
+ * it carries on. These let the executor give up anything it holds on behalf
+ * of the call while it waits, e.g. its admission slot.
+ */
+class AwaitHooks
+{
+  public:
+    virtual ~AwaitHooks() = default;
+
+    virtual void beforeAwait() = 0;
+
+    virtual void afterAwait() = 0;
+};
+
+void setThreadAwaitHooks(AwaitHooks* hooks);
+
+/**
+ * Runs the thread's await hooks around a blocking wait on other calls. Nested
+ * scopes only run the hooks once.
+ */
+class AwaitScope
+{
+  public:
+    AwaitScope();
+
+    ~AwaitScope();
+};
 }
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <WAVM/IR/Module.h>
+#include <WAVM/Runtime/Runtime.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace wasm {
+struct PerfMapEntry
+{
+    uintptr_t start = 0;
+    size_t size = 0;
+    std::string name;
+};
+
+/**
+ * Publishes the addresses of JIT-compiled guest functions in
+ * /tmp/perf-<pid>.map, so that perf can attribute samples in guest code to
+ * the functions' source names. Entries are grouped into regions, one per
+ * instantiated module, which are removed when the module's code is unloaded.
+ */
+class PerfMap
+{
+  public:
+    PerfMap();
+
+    uint64_t addRegion(const std::vector<PerfMapEntry>& entries);
+
+    void removeRegion(uint64_t regionId);
+
+    size_t getEntryCount();
+
+    std::string getPath();
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    std::string path;
+    uint64_t nextRegionId = 1;
+    std::map<uint64_t, std::vector<PerfMapEntry>> regions;
+
+    void writeEntries(const std::vector<PerfMapEntry>& entries, bool append);
+};
+
+PerfMap& getPerfMap();
+
+/**
+ * Keeps a region in the perf map for as long as it's alive. Shared between a
+ * module and its clones, which run the same code.
+ */
+class PerfMapRegion
+{
+  public:
+    explicit PerfMapRegion(uint64_t regionIdIn);
+
+    ~PerfMapRegion();
+
+    uint64_t getRegionId();
+
+  private:
+    uint64_t regionId;
+};
+
+std::vector<PerfMapEntry> getPerfMapEntries(WAVM::Runtime::Instance* instance,
+                                            WAVM::IR::Module& irModule,
+                                            const std::string& prefix);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <wavm/PerfMap.h>
+
+#include <proto/faabric.pb.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+#define PROFILE_MAX_DEPTH 64
+#define PROFILE_MAX_SAMPLES 4096
+#define PROFILE_LOG_CAPACITY 1000
+
+// Frames at the top of each sample belonging to the signal handler, if the
+// interrupted instruction can't be found
+#define PROFILE_HANDLER_FRAMES 3
+
+#define PROFILE_HOST_FRAME "[host]"
+
+namespace wasm {
+// Counts of each call stack, with frames joined root first by semicolons
+typedef std::map<std::string, long> FoldedStacks;
+
+struct ProfileSample
+{
+    void* pc = nullptr;
+    int depth = 0;
+    void* frames[PROFILE_MAX_DEPTH];
+};
+
+/**
+ * Samples the current thread's stack at a fixed interval of the thread's CPU
+ * time, using a per-thread timer which delivers SIGPROF. Samples are taken
+ * into a preallocated buffer in the signal handler, and only resolved into
+ * guest function names once the profiler has stopped.
+ */
+class SamplingProfiler
+{
+  public:
+    explicit SamplingProfiler(int intervalUsIn);
+
+    ~SamplingProfiler();
+
+    void start();
+
+    void stop();
+
+    size_t getSampleCount();
+
+    size_t getDroppedCount();
+
+    FoldedStacks getFoldedStacks(std::vector<PerfMapEntry> codeRanges);
+
+    void takeSample(void* pc);
+
+  private:
+    int intervalUs;
+    bool running = false;
+    timer_t timerId;
+
+    std::vector<ProfileSample> samples;
+    std::atomic<size_t> sampleCount = 0;
+    std::atomic<size_t> droppedCount = 0;
+};
+
+/**
+ * Bounded host-wide record of the profiles of recently profiled calls, keyed
+ * on message ID, along with the combined profile of each function.
+ */
+class CallProfiles
+{
+  public:
+    bool shouldProfile(const faabric::Message& msg);
+
+    void enableForCall(unsigned int messageId);
+
+    void record(const faabric::Message& msg, const FoldedStacks& stacks);
+
+    bool getCallProfile(unsigned int messageId, FoldedStacks& stacks);
+
+    FoldedStacks getFunctionProfile(const std::string& funcStr);
+
+    void clear();
+
+  private:
+    std::mutex mx;
+    std::atomic<size_t> enabledCallCount = 0;
+    std::set<unsigned int> enabledCalls;
+
+    std::deque<unsigned int> order;
+    std::unordered_map<unsigned int, FoldedStacks> callProfiles;
+    std::unordered_map<std::string, FoldedStacks> functionProfiles;
+};
+
+CallProfiles& getCallProfiles();
+
+std::string foldedStacksToString(const FoldedStacks& stacks);
+}
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <ir_cache/ProfileGuided.h>
 #include <wasm/WasmModule.h>
 #include <wavm/LoadedDynamicModule.h>
+#include <wavm/PerfMap.h>
 
 #include <WAVM/Runtime/Intrinsics.h>
 #include <WAVM/Runtime/Linker.h>
 #include <WAVM/Runtime/Runtime.h>
 
+#include <atomic>
+
+namespace isolation {
+class IsolationContext;
+}
+
 namespace wasm {
 WAVM_DECLARE_INTRINSIC_MODULE(env)
 
@@ -19,7 +27,32 @@ class PlatformThreadPool;
 }
 
 std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& wasmBytes,
-                                 const std::string& fileName);
+                                 const std::string& fileName,
+                                 bool meter = false);
+
+std::vector<uint8_t> wavmPgoCodegen(std::vector<uint8_t>& wasmBytes,
+                                    const std::string& fileName,
+                                    const PgoProfile* profile,
+                                    PgoPlan& plan,
+                                    bool meter = false);
+
+/**
+ * Owns an fd holding a zygote's memory. Shared between the zygote and the
+ * modules cloned from it, which map their memory from it, so the fd is
+ * closed once the last of them is gone.
+ */
+class MemoryFd
+{
+  public:
+    explicit MemoryFd(int fdIn);
+
+    ~MemoryFd();
+
+    int getFd();
+
+  private:
+    int fd;
+};
 
 class WAVMWasmModule final
   : public WasmModule
@@ -56,6 +89,8 @@ class WAVMWasmModule final
 
     uint8_t* wasmPointerToNative(int32_t wasmPtr) override;
 
+    size_t getMemorySizeBytes() override;
+
     // ----- Environment variables
     void writeWasmEnvToMemory(uint32_t envPointers,
                               uint32_t envBuffer) override;
@@ -65,6 +100,8 @@ class WAVMWasmModule final
 
     void mapMemoryFromFd() override;
 
+    int getMemoryFd();
+
     // ----- Debug -----
     void printDebugInfo() override;
 
@@ -107,6 +144,8 @@ class WAVMWasmModule final
     // ----- Disassembly -----
     std::map<std::string, std::string> buildDisassemblyMap();
 
+    std::vector<PerfMapEntry> getCodeRanges();
+
     // ----- Dynamic linking -----
     int dynamicLoadModule(const std::string& path,
                           WAVM::Runtime::Context* context);
@@ -141,7 +180,7 @@ class WAVMWasmModule final
     WAVM::Runtime::GCPointer<WAVM::Runtime::Instance> wasiModule;
     WAVM::Runtime::GCPointer<WAVM::Runtime::Instance> moduleInstance;
 
-    int memoryFd = -1;
+    std::shared_ptr<MemoryFd> memoryFd;
     size_t memoryFdSize = 0;
 
     bool _isBound = false;
@@ -157,6 +196,21 @@ class WAVMWasmModule final
     std::unordered_map<std::string, std::pair<int, bool>> globalOffsetMemoryMap;
     std::unordered_map<std::string, int> missingGlobalOffsetEntries;
 
+    // Regions of the perf map holding this module's code
+    std::vector<std::shared_ptr<PerfMapRegion>> perfMapRegions;
+
+    // Whether the main module was built to count calls for profile-guided
+    // optimisation
+    bool pgoInstrumented = false;
+
+    // Whether the main module was built to count instructions, and how many
+    // were counted by threads spawned by the current call
+    bool metered = false;
+    std::atomic<int64_t> threadInstructions = 0;
+
+    // Isolation context of the current call, shared with its guest threads
+    isolation::IsolationContext* isolationContext = nullptr;
+
     static WAVM::Runtime::Instance* getEnvModule();
 
     static WAVM::Runtime::Instance* getWasiModule();
@@ -191,6 +245,8 @@ class WAVMWasmModule final
 
     void prepareOpenMPContext(const faabric::Message& msg);
 
+    void recordWorkingSet(const faabric::Message& msg);
+
     std::unique_ptr<openmp::PlatformThreadPool> OMPPool;
 
     uint32_t createMemoryGuardRegion();
@@ -0,0 +1,241 @@
+#include "FaasmConfig.h"
+
+#include <faabric/util/environment.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <boost/algorithm/string.hpp>
+
+using namespace faabric::util;
+
+namespace conf {
+FaasmConfig& getFaasmConfig()
+{
+    static FaasmConfig conf;
+    return conf;
+}
+
+FaasmConfig::FaasmConfig()
+{
+    this->initialise();
+}
+
+void FaasmConfig::initialise()
+{
+    // Chaining
+    chainedCallFastPath = getEnvVar("CHAINED_CALL_FAST_PATH", "on");
+    chainPrewarm = getEnvVar("CHAIN_PREWARM", "off");
+    chainPrewarmThreshold = getIntParam("CHAIN_PREWARM_THRESHOLD", "50");
+    chainPrewarmMemoryMb = getIntParam("CHAIN_PREWARM_MEMORY_MB", "512");
+    outputStreamBufferKb = getIntParam("OUTPUT_STREAM_BUFFER_KB", "1024");
+    outputStreamChunkKb = getIntParam("OUTPUT_STREAM_CHUNK_KB", "64");
+    outputStreamFunctions = getEnvVar("OUTPUT_STREAM_FUNCTIONS", "");
+
+    // Output capture
+    stdoutBufferKb = getIntParam("STDOUT_BUFFER_KB", "64");
+    stdoutBufferLimits = getEnvVar("STDOUT_BUFFER_LIMITS", "");
+    captureStderr = getEnvVar("CAPTURE_STDERR", "off");
+    stdoutSink = getEnvVar("STDOUT_SINK", "off");
+    stdoutSinkDir = getEnvVar("STDOUT_SINK_DIR", "/tmp/faasm/stdout");
+
+    // Memoization
+    memoizeFunctions = getEnvVar("MEMOIZE_FUNCTIONS", "");
+    memoizeMaxEntries = getIntParam("MEMOIZE_MAX_ENTRIES", "1000");
+    memoizeDir = getEnvVar("MEMOIZE_DIR", "");
+
+    // Execution
+    microBatchSize = getIntParam("MICRO_BATCH_SIZE", "1");
+    statelessFunctions = getEnvVar("STATELESS_FUNCTIONS", "");
+    functionVersionCheckMs = getIntParam("FUNCTION_VERSION_CHECK_MS", "1000");
+    callTimeLimitMs = getIntParam("CALL_TIME_LIMIT_MS", "0");
+    callCpuLimitMs = getIntParam("CALL_CPU_LIMIT_MS", "0");
+    callTimeLimits = getEnvVar("CALL_TIME_LIMITS", "");
+    callCpuLimits = getEnvVar("CALL_CPU_LIMITS", "");
+    meterFunctions = getEnvVar("METER_FUNCTIONS", "");
+
+    // Faaslet pool
+    poolMinSize = getIntParam("POOL_MIN_SIZE", "5");
+    poolMaxSize = getIntParam("POOL_MAX_SIZE", "5");
+    poolMinFreeMemoryMb = getIntParam("POOL_MIN_FREE_MEMORY_MB", "512");
+    faasletModuleCacheSize = getIntParam("FAASLET_MODULE_CACHE_SIZE", "0");
+    faasletModuleCacheMb = getIntParam("FAASLET_MODULE_CACHE_MB", "256");
+
+    // Admission
+    admissionMaxConcurrency = getIntParam("ADMISSION_MAX_CONCURRENCY", "0");
+    admissionFunctionLimits = getEnvVar("ADMISSION_FUNCTION_LIMITS", "");
+    admissionUserLimits = getEnvVar("ADMISSION_USER_LIMITS", "");
+    admissionWeights = getEnvVar("ADMISSION_WEIGHTS", "");
+    admissionPriorities = getEnvVar("ADMISSION_PRIORITIES", "");
+    admissionMaxQueued = getIntParam("ADMISSION_MAX_QUEUED", "0");
+    admissionMaxBlocked = getIntParam("ADMISSION_MAX_BLOCKED", "0");
+    admissionQueueTimeoutMs =
+      getIntParam("ADMISSION_QUEUE_TIMEOUT_MS", "60000");
+    admissionMaxHeavy = getIntParam("ADMISSION_MAX_HEAVY", "0");
+    admissionHeavyCost = getIntParam("ADMISSION_HEAVY_COST", "100000000");
+
+    // Isolation
+    cgroupGranularity = getEnvVar("CGROUP_GRANULARITY", "faaslet");
+    cgroupCpuWeight = getIntParam("CGROUP_CPU_WEIGHT", "100");
+    cgroupCpuMax = getEnvVar("CGROUP_CPU_MAX", "max");
+    cgroupMemoryMaxMb = getIntParam("CGROUP_MEMORY_MAX_MB", "0");
+    cgroupMemoryHighMb = getIntParam("CGROUP_MEMORY_HIGH_MB", "0");
+    netnsAttach = getEnvVar("NETNS_ATTACH", "lazy");
+    netnsCreate = getEnvVar("NETNS_CREATE", "off");
+    netnsSetupScript = getEnvVar("NETNS_SETUP_SCRIPT", "");
+    isolationPoolSize = getIntParam("ISOLATION_POOL_SIZE", "0");
+
+    // NUMA
+    numaMode = getEnvVar("NUMA_MODE", "off");
+    numaZygoteReplicas = getEnvVar("NUMA_ZYGOTE_REPLICAS", "on");
+
+    // Metrics
+    latencyMetrics = getEnvVar("LATENCY_METRICS", "on");
+    metricsPort = getIntParam("METRICS_PORT", "0");
+
+    // Profiling
+    perfMap = getEnvVar("PERF_MAP", "off");
+    profileFunctions = getEnvVar("PROFILE_FUNCTIONS", "");
+    profileIntervalUs = getIntParam("PROFILE_INTERVAL_US", "1000");
+    traceFunctions = getEnvVar("TRACE_FUNCTIONS", "");
+    traceDir = getEnvVar("TRACE_DIR", "");
+    workingSetFunctions = getEnvVar("WORKING_SET_FUNCTIONS", "");
+}
+
+int FaasmConfig::getIntParam(const char* name, const char* defaultValue)
+{
+    int value = std::stoi(getEnvVar(name, defaultValue));
+
+    return value;
+}
+
+void FaasmConfig::reset()
+{
+    this->initialise();
+}
+
+void FaasmConfig::print()
+{
+    const std::shared_ptr<spdlog::logger>& logger = getLogger();
+
+    logger->info("--- Chaining ---");
+    logger->info("CHAINED_CALL_FAST_PATH     {}", chainedCallFastPath);
+    logger->info("CHAIN_PREWARM              {}", chainPrewarm);
+    logger->info("CHAIN_PREWARM_THRESHOLD    {}", chainPrewarmThreshold);
+    logger->info("CHAIN_PREWARM_MEMORY_MB    {}", chainPrewarmMemoryMb);
+    logger->info("OUTPUT_STREAM_BUFFER_KB    {}", outputStreamBufferKb);
+    logger->info("OUTPUT_STREAM_CHUNK_KB     {}", outputStreamChunkKb);
+    logger->info("OUTPUT_STREAM_FUNCTIONS    {}", outputStreamFunctions);
+
+    logger->info("--- Output capture ---");
+    logger->info("STDOUT_BUFFER_KB           {}", stdoutBufferKb);
+    logger->info("STDOUT_BUFFER_LIMITS       {}", stdoutBufferLimits);
+    logger->info("CAPTURE_STDERR             {}", captureStderr);
+    logger->info("STDOUT_SINK                {}", stdoutSink);
+    logger->info("STDOUT_SINK_DIR            {}", stdoutSinkDir);
+
+    logger->info("--- Memoization ---");
+    logger->info("MEMOIZE_FUNCTIONS          {}", memoizeFunctions);
+    logger->info("MEMOIZE_MAX_ENTRIES        {}", memoizeMaxEntries);
+    logger->info("MEMOIZE_DIR                {}", memoizeDir);
+
+    logger->info("--- Execution ---");
+    logger->info("MICRO_BATCH_SIZE           {}", microBatchSize);
+    logger->info("STATELESS_FUNCTIONS        {}", statelessFunctions);
+    logger->info("FUNCTION_VERSION_CHECK_MS  {}", functionVersionCheckMs);
+    logger->info("CALL_TIME_LIMIT_MS         {}", callTimeLimitMs);
+    logger->info("CALL_CPU_LIMIT_MS          {}", callCpuLimitMs);
+    logger->info("CALL_TIME_LIMITS           {}", callTimeLimits);
+    logger->info("CALL_CPU_LIMITS            {}", callCpuLimits);
+    logger->info("METER_FUNCTIONS            {}", meterFunctions);
+
+    logger->info("--- Faaslet pool ---");
+    logger->info("POOL_MIN_SIZE              {}", poolMinSize);
+    logger->info("POOL_MAX_SIZE              {}", poolMaxSize);
+    logger->info("POOL_MIN_FREE_MEMORY_MB    {}", poolMinFreeMemoryMb);
+    logger->info("FAASLET_MODULE_CACHE_SIZE  {}", faasletModuleCacheSize);
+    logger->info("FAASLET_MODULE_CACHE_MB    {}", faasletModuleCacheMb);
+
+    logger->info("--- Admission ---");
+    logger->info("ADMISSION_MAX_CONCURRENCY  {}", admissionMaxConcurrency);
+    logger->info("ADMISSION_FUNCTION_LIMITS  {}", admissionFunctionLimits);
+    logger->info("ADMISSION_USER_LIMITS      {}", admissionUserLimits);
+    logger->info("ADMISSION_WEIGHTS          {}", admissionWeights);
+    logger->info("ADMISSION_PRIORITIES       {}", admissionPriorities);
+    logger->info("ADMISSION_MAX_QUEUED       {}", admissionMaxQueued);
+    logger->info("ADMISSION_MAX_BLOCKED      {}", admissionMaxBlocked);
+    logger->info("ADMISSION_QUEUE_TIMEOUT_MS {}", admissionQueueTimeoutMs);
+    logger->info("ADMISSION_MAX_HEAVY        {}", admissionMaxHeavy);
+    logger->info("ADMISSION_HEAVY_COST       {}", admissionHeavyCost);
+
+    logger->info("--- Isolation ---");
+    logger->info("CGROUP_GRANULARITY         {}", cgroupGranularity);
+    logger->info("CGROUP_CPU_WEIGHT          {}", cgroupCpuWeight);
+    logger->info("CGROUP_CPU_MAX             {}", cgroupCpuMax);
+    logger->info("CGROUP_MEMORY_MAX_MB       {}", cgroupMemoryMaxMb);
+    logger->info("CGROUP_MEMORY_HIGH_MB      {}", cgroupMemoryHighMb);
+    logger->info("NETNS_ATTACH               {}", netnsAttach);
+    logger->info("NETNS_CREATE               {}", netnsCreate);
+    logger->info("NETNS_SETUP_SCRIPT         {}", netnsSetupScript);
+    logger->info("ISOLATION_POOL_SIZE        {}", isolationPoolSize);
+
+    logger->info("--- NUMA ---");
+    logger->info("NUMA_MODE                  {}", numaMode);
+    logger->info("NUMA_ZYGOTE_REPLICAS       {}", numaZygoteReplicas);
+
+    logger->info("--- Metrics ---");
+    logger->info("LATENCY_METRICS            {}", latencyMetrics);
+    logger->info("METRICS_PORT               {}", metricsPort);
+
+    logger->info("--- Profiling ---");
+    logger->info("PERF_MAP                   {}", perfMap);
+    logger->info("PROFILE_FUNCTIONS          {}", profileFunctions);
+    logger->info("PROFILE_INTERVAL_US        {}", profileIntervalUs);
+    logger->info("TRACE_FUNCTIONS            {}", traceFunctions);
+    logger->info("TRACE_DIR                  {}", traceDir);
+    logger->info("WORKING_SET_FUNCTIONS      {}", workingSetFunctions);
+}
+
+bool isFunctionInList(const std::string& funcList, const faabric::Message& msg)
+{
+    if (funcList.empty()) {
+        return false;
+    }
+
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    std::vector<std::string> funcs;
+    boost::split(funcs, funcList, [](char c) { return c == ','; });
+    for (auto& f : funcs) {
+        boost::trim(f);
+        if (f == funcStr) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::unordered_map<std::string, int> parseIntMap(const std::string& list)
+{
+    std::unordered_map<std::string, int> values;
+    if (list.empty()) {
+        return values;
+    }
+
+    std::vector<std::string> pairs;
+    boost::split(pairs, list, [](char c) { return c == ','; });
+    for (auto& pair : pairs) {
+        size_t eqIdx = pair.find('=');
+        if (eqIdx == std::string::npos) {
+            getLogger()->warn("Ignoring invalid key=value pair: {}", pair);
+            continue;
+        }
+
+        std::string key = boost::trim_copy(pair.substr(0, eqIdx));
+        std::string value = boost::trim_copy(pair.substr(eqIdx + 1));
+        values[key] = std::stoi(value);
+    }
+
+    return values;
+}
+}
@@ -0,0 +1,479 @@
+#include "AdmissionController.h"
+
+#include <conf/FaasmConfig.h>
+#include <wasm/FunctionCosts.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+#define ADMISSION_CHECK_INTERVAL_MS 100
+
+// Calls carrying on after an await go ahead of new calls
+#define RESUMED_PRIORITY INT_MAX
+
+namespace faaslet {
+AdmissionController& getAdmissionController()
+{
+    static AdmissionController controller;
+    return controller;
+}
+
+static int getCount(const std::unordered_map<std::string, int>& counts,
+                    const std::string& key)
+{
+    auto it = counts.find(key);
+    if (it == counts.end()) {
+        return 0;
+    }
+
+    return it->second;
+}
+
+static void decrementCount(std::unordered_map<std::string, int>& counts,
+                           const std::string& key)
+{
+    if (--counts[key] <= 0) {
+        counts.erase(key);
+    }
+}
+
+/**
+ * Called by a Faaslet about to bind to the call's function. Returns false if
+ * the function, or its user, already has as many Faaslets as its concurrency
+ * limit plus ADMISSION_MAX_BLOCKED, not counting those awaiting other calls.
+ * The Faaslet should then stay free for other functions, while the function's
+ * calls wait in its queue for the Faaslets it already has. Every bind must be
+ * matched by an unbind.
+ */
+bool AdmissionController::bind(const faabric::Message& msg)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+    const std::string& user = msg.user();
+
+    faabric::util::UniqueLock lock(mx);
+
+    int maxBlocked = std::max(faasmConf.admissionMaxBlocked, 0);
+    int functionActive = getCount(boundByFunction, funcStr) -
+                         getCount(awaitingByFunction, funcStr);
+    int userActive =
+      getCount(boundByUser, user) - getCount(awaitingByUser, user);
+
+    bool saturated = false;
+    int functionLimit =
+      lookup(functionLimits, faasmConf.admissionFunctionLimits, funcStr, 0);
+    if (functionLimit > 0 && functionActive >= functionLimit + maxBlocked) {
+        saturated = true;
+    }
+
+    // The function must keep a Faaslet of its own to pick up its calls
+    int userLimit = lookup(userLimits, faasmConf.admissionUserLimits, user, 0);
+    if (userLimit > 0 && functionActive > 0 &&
+        userActive >= userLimit + maxBlocked) {
+        saturated = true;
+    }
+
+    if (saturated) {
+        declinedBindCount++;
+        faabric::util::getLogger()->debug(
+          "Declining bind to {}, already has enough Faaslets", funcStr);
+        return false;
+    }
+
+    boundByFunction[funcStr]++;
+    boundByUser[user]++;
+
+    return true;
+}
+
+void AdmissionController::unbind(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    faabric::util::UniqueLock lock(mx);
+    decrementCount(boundByFunction, funcStr);
+    decrementCount(boundByUser, msg.user());
+}
+
+/**
+ * Blocks until the call can run, returning false if it's rejected. Every call
+ * admitted must be released once it's finished.
+ */
+bool AdmissionController::admit(const faabric::Message& msg)
+{
+    return doAdmit(msg, false);
+}
+
+/**
+ * Gives up the call's slot while it awaits other calls. Its Faaslet won't
+ * pick up any more of the function's calls in the meantime, so another can
+ * bind to the function, e.g. to run a call it's waiting on.
+ */
+void AdmissionController::suspend(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    {
+        faabric::util::UniqueLock lock(mx);
+        awaitingByFunction[funcStr]++;
+        awaitingByUser[msg.user()]++;
+    }
+
+    release(msg);
+}
+
+/**
+ * Takes a slot back for a suspended call. The call is already part way
+ * through, so is never rejected.
+ */
+void AdmissionController::resume(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    {
+        faabric::util::UniqueLock lock(mx);
+        decrementCount(awaitingByFunction, funcStr);
+        decrementCount(awaitingByUser, msg.user());
+    }
+
+    doAdmit(msg, true);
+}
+
+bool AdmissionController::doAdmit(const faabric::Message& msg, bool resuming)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+    bool heavy = isHeavy(funcStr);
+
+    faabric::util::UniqueLock lock(mx);
+
+    Waiter waiter;
+    waiter.funcStr = funcStr;
+    waiter.user = msg.user();
+    waiter.heavy = heavy;
+    waiter.priority =
+      resuming ? RESUMED_PRIORITY
+               : lookup(priorities, faasmConf.admissionPriorities, funcStr, 0);
+    waiter.seq = nextSeq++;
+    waiter.resuming = resuming;
+
+    // Each call for a function finishes 1/weight after the previous one in
+    // virtual time, so functions with higher weights get more turns
+    int weight =
+      std::max(1, lookup(weights, faasmConf.admissionWeights, funcStr, 1));
+    waiter.startTag = std::max(virtualTime, lastFinishTags[funcStr]);
+    waiter.finishTag = waiter.startTag + 1.0 / weight;
+
+    waiters.push_back(&waiter);
+    waitingByFunction[funcStr]++;
+
+    auto removeWaiter = [this, &waiter, &funcStr] {
+        waiters.remove(&waiter);
+        if (--waitingByFunction[funcStr] == 0) {
+            waitingByFunction.erase(funcStr);
+        }
+    };
+
+    bool mustWait = getNextWaiter() != &waiter;
+    if (mustWait) {
+        int maxQueued = faasmConf.admissionMaxQueued;
+        if (!resuming && maxQueued > 0 &&
+            waitingByFunction[funcStr] > maxQueued) {
+            removeWaiter();
+            rejectedCount++;
+
+            logger->warn("Rejecting {}, {} calls already queued",
+                         funcStr,
+                         maxQueued);
+            return false;
+        }
+
+        if (!resuming) {
+            queuedCount++;
+        }
+        logger->debug("Queueing {} for admission", funcStr);
+    }
+
+    // Resumed calls have already had their turn
+    if (!resuming) {
+        lastFinishTags[funcStr] = waiter.finishTag;
+    }
+
+    int timeoutMs = resuming ? 0 : faasmConf.admissionQueueTimeoutMs;
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeoutMs);
+
+    while (getNextWaiter() != &waiter) {
+        if (timeoutMs > 0 && std::chrono::steady_clock::now() >= deadline) {
+            removeWaiter();
+            rejectedCount++;
+            cv.notify_all();
+
+            logger->warn("Rejecting {}, queued for over {}ms",
+                         funcStr,
+                         timeoutMs);
+            return false;
+        }
+
+        cv.wait_for(lock,
+                    std::chrono::milliseconds(ADMISSION_CHECK_INTERVAL_MS));
+    }
+
+    removeWaiter();
+    if (!resuming) {
+        virtualTime = std::max(virtualTime, waiter.startTag);
+    }
+    start(waiter, msg.id());
+
+    // Other waiters may also fit in the remaining capacity
+    if (mustWait) {
+        cv.notify_all();
+    }
+
+    return true;
+}
+
+void AdmissionController::release(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    faabric::util::UniqueLock lock(mx);
+
+    running--;
+    if (--runningByFunction[funcStr] <= 0) {
+        runningByFunction.erase(funcStr);
+    }
+    if (--runningByUser[msg.user()] <= 0) {
+        runningByUser.erase(msg.user());
+    }
+    runningHeavyCalls.erase(msg.id());
+
+    if (!waiters.empty()) {
+        cv.notify_all();
+    }
+}
+
+void AdmissionController::start(const Waiter& waiter, unsigned int messageId)
+{
+    running++;
+    runningByFunction[waiter.funcStr]++;
+    runningByUser[waiter.user]++;
+    if (!waiter.resuming) {
+        admittedCount++;
+    }
+
+    if (waiter.heavy) {
+        runningHeavyCalls.insert(messageId);
+    }
+}
+
+/**
+ * Whether the function's calls are predicted to be heavy, from the moving
+ * average of their metered instructions. Functions that aren't metered never
+ * are.
+ */
+bool AdmissionController::isHeavy(const std::string& funcStr)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    if (faasmConf.admissionMaxHeavy <= 0) {
+        return false;
+    }
+
+    return wasm::getFunctionCosts().getAverage(funcStr) >=
+           faasmConf.admissionHeavyCost;
+}
+
+int AdmissionController::lookup(ParsedList& parsed,
+                                const std::string& raw,
+                                const std::string& key,
+                                int defaultValue)
+{
+    if (parsed.raw != raw) {
+        parsed.raw = raw;
+        parsed.values = conf::parseIntMap(raw);
+    }
+
+    auto it = parsed.values.find(key);
+    if (it == parsed.values.end()) {
+        return defaultValue;
+    }
+
+    return it->second;
+}
+
+bool AdmissionController::hasCapacity(const Waiter& waiter)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    const std::string& funcStr = waiter.funcStr;
+    const std::string& user = waiter.user;
+
+    int maxConcurrency = faasmConf.admissionMaxConcurrency;
+    if (maxConcurrency > 0 && running >= maxConcurrency) {
+        return false;
+    }
+
+    int maxHeavy = faasmConf.admissionMaxHeavy;
+    if (waiter.heavy && maxHeavy > 0 &&
+        (int)runningHeavyCalls.size() >= maxHeavy) {
+        return false;
+    }
+
+    int functionLimit =
+      lookup(functionLimits, faasmConf.admissionFunctionLimits, funcStr, 0);
+    if (functionLimit > 0) {
+        auto it = runningByFunction.find(funcStr);
+        if (it != runningByFunction.end() && it->second >= functionLimit) {
+            return false;
+        }
+    }
+
+    int userLimit = lookup(userLimits, faasmConf.admissionUserLimits, user, 0);
+    if (userLimit > 0) {
+        auto it = runningByUser.find(user);
+        if (it != runningByUser.end() && it->second >= userLimit) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Picks the waiting call to admit next out of those with capacity: highest
+ * priority first, then earliest virtual finish time, then arrival order.
+ */
+AdmissionController::Waiter* AdmissionController::getNextWaiter()
+{
+    Waiter* next = nullptr;
+    for (Waiter* w : waiters) {
+        if (!hasCapacity(*w)) {
+            continue;
+        }
+
+        if (next == nullptr || w->priority > next->priority ||
+            (w->priority == next->priority &&
+             (w->finishTag < next->finishTag ||
+              (w->finishTag == next->finishTag && w->seq < next->seq)))) {
+            next = w;
+        }
+    }
+
+    return next;
+}
+
+int AdmissionController::getRunningCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return running;
+}
+
+int AdmissionController::getRunningCount(const std::string& funcStr)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    auto it = runningByFunction.find(funcStr);
+    if (it == runningByFunction.end()) {
+        return 0;
+    }
+
+    return it->second;
+}
+
+int AdmissionController::getRunningHeavyCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return (int)runningHeavyCalls.size();
+}
+
+int AdmissionController::getWaitingCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return (int)waiters.size();
+}
+
+long AdmissionController::getAdmittedCount()
+{
+    return admittedCount.load();
+}
+
+long AdmissionController::getQueuedCount()
+{
+    return queuedCount.load();
+}
+
+long AdmissionController::getRejectedCount()
+{
+    return rejectedCount.load();
+}
+
+long AdmissionController::getDeclinedBindCount()
+{
+    return declinedBindCount.load();
+}
+
+void AdmissionController::clear()
+{
+    faabric::util::UniqueLock lock(mx);
+
+    virtualTime = 0;
+    lastFinishTags.clear();
+
+    running = 0;
+    runningByFunction.clear();
+    runningByUser.clear();
+    waitingByFunction.clear();
+    runningHeavyCalls.clear();
+
+    boundByFunction.clear();
+    boundByUser.clear();
+    awaitingByFunction.clear();
+    awaitingByUser.clear();
+
+    admittedCount = 0;
+    queuedCount = 0;
+    rejectedCount = 0;
+    declinedBindCount = 0;
+}
+
+AdmissionTicket::AdmissionTicket(const faabric::Message& msgIn)
+  : msg(msgIn)
+{
+    // Threads run as part of a call that's already been admitted. Making them
+    // wait here could leave their parent holding a slot while waiting forever
+    // on them.
+    if (!msg.snapshotkey().empty()) {
+        return;
+    }
+
+    if (!getAdmissionController().admit(msg)) {
+        throw std::runtime_error("Call rejected by admission control");
+    }
+
+    admitted = true;
+    wasm::setThreadAwaitHooks(this);
+}
+
+AdmissionTicket::~AdmissionTicket()
+{
+    if (admitted) {
+        wasm::setThreadAwaitHooks(nullptr);
+        getAdmissionController().release(msg);
+    }
+}
+
+void AdmissionTicket::beforeAwait()
+{
+    getAdmissionController().suspend(msg);
+}
+
+void AdmissionTicket::afterAwait()
+{
+    getAdmissionController().resume(msg);
+}
+}
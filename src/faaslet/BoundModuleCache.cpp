@@ -0,0 +1,146 @@
+#include "BoundModuleCache.h"
+
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+
+namespace faaslet {
+BoundModuleCache::BoundModuleCache(int maxModulesIn, size_t maxMemoryBytesIn)
+  : maxModules(std::max(maxModulesIn, 0))
+  , maxMemoryBytes(maxMemoryBytesIn)
+{}
+
+/**
+ * Removes and returns the module for the given key, or nullptr if it's not
+ * cached.
+ */
+std::unique_ptr<wasm::WasmModule> BoundModuleCache::take(
+  const std::string& key)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = modules.find(key);
+    if (it == modules.end()) {
+        missCount++;
+        return nullptr;
+    }
+
+    std::unique_ptr<wasm::WasmModule> module = std::move(it->second.module);
+    memoryBytes -= it->second.memoryBytes;
+    lru.erase(it->second.lruIt);
+    modules.erase(it);
+
+    hitCount++;
+    return module;
+}
+
+void BoundModuleCache::put(const std::string& key,
+                           std::unique_ptr<wasm::WasmModule> module)
+{
+    if (maxModules == 0 || module == nullptr) {
+        return;
+    }
+
+    size_t moduleBytes = module->getMemorySizeBytes();
+    if (moduleBytes > maxMemoryBytes) {
+        faabric::util::getLogger()->debug(
+          "Not caching {} module of {} bytes, over budget", key, moduleBytes);
+        return;
+    }
+
+    std::scoped_lock<std::mutex> guard(mx);
+
+    // Replace any existing module for the same key
+    auto existing = modules.find(key);
+    if (existing != modules.end()) {
+        memoryBytes -= existing->second.memoryBytes;
+        lru.erase(existing->second.lruIt);
+        modules.erase(existing);
+    }
+
+    while (!lru.empty() && (modules.size() >= maxModules ||
+                            memoryBytes + moduleBytes > maxMemoryBytes)) {
+        evictOldest();
+    }
+
+    lru.push_front(key);
+    modules[key] = CachedModule{ std::move(module), moduleBytes, lru.begin() };
+    memoryBytes += moduleBytes;
+}
+
+/**
+ * Must be called with the lock held.
+ */
+void BoundModuleCache::evictOldest()
+{
+    const std::string& key = lru.back();
+    auto it = modules.find(key);
+
+    faabric::util::getLogger()->debug("Evicting bound module {}", key);
+
+    memoryBytes -= it->second.memoryBytes;
+    modules.erase(it);
+    lru.pop_back();
+
+    evictionCount++;
+}
+
+size_t BoundModuleCache::getModuleCount()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    return modules.size();
+}
+
+size_t BoundModuleCache::getMemoryBytes()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    return memoryBytes;
+}
+
+long BoundModuleCache::getHitCount()
+{
+    return hitCount;
+}
+
+long BoundModuleCache::getMissCount()
+{
+    return missCount;
+}
+
+long BoundModuleCache::getEvictionCount()
+{
+    return evictionCount;
+}
+
+void BoundModuleCache::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    lru.clear();
+    modules.clear();
+    memoryBytes = 0;
+}
+
+static std::atomic<long> flushGeneration = 0;
+
+/**
+ * Modules are only reused for the same version of the same function, and only
+ * if there's been no flush since they were kept.
+ */
+std::string getBoundModuleKey(const faabric::Message& msg, long version)
+{
+    return faabric::util::funcToString(msg, false) + "_v" +
+           std::to_string(version) + "_g" + std::to_string(flushGeneration) +
+           (msg.issgx() ? "_sgx" : "");
+}
+
+long getFlushGeneration()
+{
+    return flushGeneration;
+}
+
+void incrementFlushGeneration()
+{
+    flushGeneration++;
+}
+}
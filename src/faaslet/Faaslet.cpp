@@ -1,14 +1,30 @@
 #include "Faaslet.h"
+#include "AdmissionController.h"
 #include "storage/FileLoader.h"
+#include <algorithm>
 #include <stdexcept>
 #include <system/CGroup.h>
-#include <system/NetworkNamespace.h>
+#include <system/IsolationManager.h>
+#include <system/LatencyMetrics.h>
+#include <system/Numa.h>
+#include <system/ResourceUsage.h>
 
+#include <conf/FaasmConfig.h>
 #include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/bytes.h>
+#include <faabric/util/clock.h>
 #include <faabric/util/config.h>
 #include <faabric/util/locks.h>
-#include <faabric/util/timing.h>
+#include <faabric/util/queue.h>
+#include <module_cache/ArtefactVersions.h>
+#include <module_cache/ChainPrewarmer.h>
 #include <module_cache/WasmModuleCache.h>
+#include <wasm/CallGraph.h>
+#include <wasm/CallTracer.h>
+#include <wasm/FunctionCosts.h>
+#include <wasm/LocalCallBuffers.h>
+#include <wasm/OutputStreams.h>
+#include <wasm/ResultCache.h>
 
 #include <wamr/WAMRWasmModule.h>
 #include <wavm/WAVMWasmModule.h>
@@ -24,6 +40,24 @@ namespace faaslet {
 
 std::mutex flushMutex;
 
+/**
+ * Records how long the call waited between being created and starting to
+ * execute, covering the scheduler's queues as well as admission. Only as
+ * precise as the message's timestamp, i.e. to the millisecond.
+ */
+static void recordCallQueued(const faabric::Message& msg)
+{
+    if (msg.timestamp() <= 0) {
+        return;
+    }
+
+    static const int metricId = getLatencyRegistry().getMetricId("callQueued");
+
+    long nowMs = faabric::util::getGlobalClock().epochMillis();
+    long queuedMs = std::max(nowMs - (long)msg.timestamp(), 0L);
+    getLatencyRegistry().record(metricId, queuedMs * 1000);
+}
+
 void preloadPythonRuntime()
 {
     auto logger = faabric::util::getLogger();
@@ -69,67 +103,272 @@ void Faaslet::flush()
         module->flush();
     }
 
-    // Clear module cache on this host
+    // Drop any modules kept for this Faaslet's slot, and make sure none from
+    // before the flush are kept or reused afterwards
+    incrementFlushGeneration();
+    if (moduleCache != nullptr) {
+        moduleCache->clear();
+    }
+
+    // Clear module cache on this host, waiting for any prewarming first
+    module_cache::getChainPrewarmer().clear();
     module_cache::getWasmModuleCache().clear();
 
     // Terminate this Faaslet
     throw faabric::util::ExecutorFinishedException("Faaslet flushed");
 }
 
-Faaslet::Faaslet(int threadIdxIn)
+Faaslet::Faaslet(int threadIdxIn,
+                 PoolController* controllerIn,
+                 BoundModuleCache* moduleCacheIn)
   : FaabricExecutor(threadIdxIn)
+  , isolationIdx(threadIdx + 1)
+  , controller(controllerIn)
+  , moduleCache(moduleCacheIn)
+{}
+
+/**
+ * Joins this Faaslet's NUMA node, and takes an isolation context for its
+ * network namespace and cgroup. This is deferred until the Faaslet is first
+ * bound, so that idle Faaslets don't hold any isolation resources.
+ */
+void Faaslet::joinIsolation(const faabric::Message& msg)
 {
-    // Set up network namespace
-    isolationIdx = threadIdx + 1;
-    std::string netnsName = BASE_NETNS_NAME + std::to_string(isolationIdx);
-    ns = std::make_unique<NetworkNamespace>(netnsName);
-    ns->addCurrentThread();
+    if (isolationJoined) {
+        return;
+    }
 
-    // Add this thread to the cgroup
-    CGroup cgroup(BASE_CGROUP_NAME);
-    cgroup.addCurrentThread();
+    // Pin to a NUMA node before cloning, so that the clone is made from the
+    // node's own copy of the zygote
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    if (faasmConf.numaMode != "off") {
+        getNumaTopology().pinCurrentThread(isolationIdx,
+                                           faasmConf.numaMode == "core");
+    }
+
+    // Take a network namespace and cgroup leaf from the isolation manager.
+    // Unless configured otherwise, the namespace is only joined if the
+    // function opens a socket, so other functions skip the setns.
+    isolationContext = getIsolationManager().acquire();
+    setThreadIsolationContext(isolationContext.get());
+    if (faasmConf.netnsAttach == "eager") {
+        isolationContext->attachNetwork();
+    }
+
+    isolationJoined = true;
+}
+
+/**
+ * Adds this thread to the cgroup for the given call. Under cgroup v2 each
+ * Faaslet (or each function) gets its own child group, under v1 they all
+ * share one. With a group per function, the thread moves whenever it's bound
+ * to a different function, so is only ever accounted to the one it's serving.
+ */
+void Faaslet::joinCgroup(const faabric::Message& msg)
+{
+    CGroup* contextCgroup = isolationContext->getCgroup();
+    if (contextCgroup != nullptr) {
+        if (joinedCgroup != contextCgroup) {
+            contextCgroup->addCurrentThread();
+            joinedCgroup = contextCgroup;
+        }
+
+        return;
+    }
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    std::string cgroupName = BASE_CGROUP_NAME;
+    if (detectCgroupVersion() == CgroupVersion::cg_v2) {
+        if (faasmConf.cgroupGranularity == "function") {
+            cgroupName += "/" + msg.user() + "_" + msg.function();
+        } else {
+            cgroupName += "/faaslet_" + std::to_string(isolationIdx);
+        }
+    }
+
+    if (cgroup != nullptr && cgroup->getName() == cgroupName) {
+        return;
+    }
+
+    CGroupLimits limits;
+    limits.cpuWeight = faasmConf.cgroupCpuWeight;
+    limits.cpuMax = faasmConf.cgroupCpuMax;
+
+    cgroup = std::make_unique<CGroup>(cgroupName);
+    cgroup->create(limits);
+    cgroup->addCurrentThread();
+    joinedCgroup = cgroup.get();
 }
 
 void Faaslet::postFinish()
 {
-    ns->removeCurrentThread();
+    if (admissionBound) {
+        getAdmissionController().unbind(admissionBindMsg);
+        admissionBound = false;
+    }
+
+    // Hand back the isolation context, leaving its network namespace if it
+    // was joined
+    if (isolationJoined) {
+        setThreadIsolationContext(nullptr);
+        getIsolationManager().release(std::move(isolationContext));
+    }
+
+    // Keep the module for the next Faaslet in this slot if possible
+    if (moduleCache != nullptr && module != nullptr &&
+        !boundModuleKey.empty() &&
+        boundFlushGeneration == getFlushGeneration()) {
+        moduleCache->put(boundModuleKey, std::move(module));
+    }
+
+    // Release the cloned module straight away rather than when the executor
+    // is eventually destroyed
+    module.reset();
+    zygote.reset();
+}
+
+Faaslet::~Faaslet()
+{
+    if (controller != nullptr) {
+        controller->release(controllerBound);
+    }
 }
 
 void Faaslet::preFinishCall(faabric::Message& call,
                             bool success,
                             const std::string& errorMsg)
 {
-    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
-    const std::string funcStr = faabric::util::funcToString(call, true);
+    wasm::CallTracer& tracer = wasm::getCallTracer();
+    tracer.resumeCall(call);
+
+    {
+        LATENCY_START(preFinishCall)
+
+        tidyCall(call);
+
+        // Always reset, including at the end of a batch, so that a module
+        // is never kept or reused with a previous call's state
+        resetModule(call);
+
+        LATENCY_END(preFinishCall)
+    }
+
+    tracer.finishCall(call);
+}
+
+/**
+ * Adds the call's captured output, and drops anything kept for it locally.
+ */
+void Faaslet::tidyCall(faabric::Message& call)
+{
+    appendCapturedStdout(call);
+
+    // Let any caller reading the output know it's finished
+    wasm::closeCallOutputStream(call);
+
+    // Drop local buffers and readers nobody will read any more
+    wasm::getLocalCallBuffers().finishCall(call.id());
+    wasm::getOutputStreams().finishCall(call.id());
+}
 
-    // Add captured stdout if necessary
+void Faaslet::appendCapturedStdout(faabric::Message& call)
+{
+    // Add captured stdout if necessary. This goes through the call's output
+    // buffer, so that callers on the local fast path get it too.
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
     if (conf.captureStdout == "on") {
         std::string moduleStdout = module->getCapturedStdout();
         if (!moduleStdout.empty()) {
-            std::string newOutput = moduleStdout + "\n" + call.outputdata();
-            call.set_outputdata(newOutput);
-
-            module->clearCapturedStdout();
+            std::vector<uint8_t> output = wasm::getCallOutput(call);
+            std::string newOutput = moduleStdout + "\n" +
+                                    std::string(output.begin(), output.end());
+            wasm::writeCallOutput(
+              call, BYTES_CONST(newOutput.c_str()), newOutput.size());
         }
+
+        // Calls in a batch run on the same module, so this call's output
+        // mustn't be handed on to the next
+        module->clearCapturedStdout();
     }
+}
 
+void Faaslet::resetModule(const faabric::Message& call)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
     if (conf.wasmVm == "wavm") {
-        // Restore from zygote
-        logger->debug("Resetting module {} from zygote", funcStr);
-        module_cache::WasmModuleCache& registry =
-          module_cache::getWasmModuleCache();
-        wasm::WAVMWasmModule& cachedModule = registry.getCachedModule(call);
+        LATENCY_START(moduleReset)
+
+        // Restore from the zygote the module was created from, which is for
+        // the version we're bound to even if a newer one has been cached
+        faabric::util::getLogger()->debug(
+          "Resetting module {} from zygote",
+          faabric::util::funcToString(call, true));
 
         auto* wavmModulePtr = dynamic_cast<wasm::WAVMWasmModule*>(module.get());
-        *wavmModulePtr = cachedModule;
+        *wavmModulePtr = *zygote;
+
+        LATENCY_END(moduleReset)
     }
 }
 
 void Faaslet::postBind(const faabric::Message& msg, bool force)
+{
+    // Stay free for other functions if this one already has all the Faaslets
+    // it can use. Threads run as part of calls that already have a Faaslet.
+    if (!admissionBound && msg.snapshotkey().empty()) {
+        if (!getAdmissionController().bind(msg)) {
+            throw faabric::util::ExecutorFinishedException(
+              "Function has enough Faaslets");
+        }
+
+        admissionBound = true;
+        admissionBindMsg = msg;
+    }
+
+    joinIsolation(msg);
+
+    if (controller != nullptr && !controllerBound) {
+        controller->notifyBound();
+        controllerBound = true;
+    }
+
+    bindModule(msg);
+}
+
+/**
+ * Creates this Faaslet's module for the latest version of the function,
+ * evicting anything cached on this host for older versions.
+ */
+void Faaslet::bindModule(const faabric::Message& msg)
 {
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
 
+    joinCgroup(msg);
+
+    boundVersion = module_cache::getArtefactVersions().refresh(msg);
+    boundFlushGeneration = getFlushGeneration();
+    boundModuleKey = getBoundModuleKey(msg, boundVersion);
+    lastVersionCheck = std::chrono::steady_clock::now();
+
+    // Reuse a module left by a previous Faaslet in this slot
+    if (moduleCache != nullptr) {
+        std::unique_ptr<wasm::WasmModule> cached =
+          moduleCache->take(boundModuleKey);
+        if (cached != nullptr) {
+            faabric::util::getLogger()->debug(
+              "Faaslet {} reusing bound module {}", id, boundModuleKey);
+            module = std::move(cached);
+
+            // Hold on to the zygote to reset from
+            if (conf.wasmVm == "wavm") {
+                module_cache::WasmModuleCache& registry =
+                  module_cache::getWasmModuleCache();
+                zygote = registry.getCachedModule(msg);
+            }
+            return;
+        }
+    }
+
     // Instantiate the right wasm module for the chosen runtime
     if (conf.wasmVm == "wamr") {
 #if (FAASM_SGX)
@@ -146,17 +385,20 @@ void Faaslet::postBind(const faabric::Message& msg, bool force)
 
         module->bindToFunction(msg);
     } else if (conf.wasmVm == "wavm") {
-        PROF_START(snapshotRestore)
+        LATENCY_START(snapshotRestore)
 
-        // Load snapshot from cache
+        // Check whether this function was prewarmed
+        module_cache::getChainPrewarmer().recordBind(msg);
+
+        // Load snapshot from cache, keeping hold of it to reset from
         module_cache::WasmModuleCache& registry =
           module_cache::getWasmModuleCache();
-        wasm::WAVMWasmModule& snapshot = registry.getCachedModule(msg);
+        zygote = registry.getCachedModule(msg);
 
         // Use snapshot to restore WAVM module
-        module = std::make_unique<wasm::WAVMWasmModule>(snapshot);
+        module = std::make_unique<wasm::WAVMWasmModule>(*zygote);
 
-        PROF_END(snapshotRestore)
+        LATENCY_END(snapshotRestore)
     } else {
         faabric::util::getLogger()->error("Unrecognised wasm VM: {}",
                                           conf.wasmVm);
@@ -164,28 +406,214 @@ void Faaslet::postBind(const faabric::Message& msg, bool force)
     }
 }
 
+bool Faaslet::isVersionStale(const faabric::Message& msg)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto sinceCheck = std::chrono::duration_cast<std::chrono::milliseconds>(
+      now - lastVersionCheck);
+    if (sinceCheck.count() < conf::getFaasmConfig().functionVersionCheckMs) {
+        return false;
+    }
+
+    lastVersionCheck = now;
+    return module_cache::getArtefactVersions().refresh(msg) != boundVersion;
+}
+
 bool Faaslet::doExecute(faabric::Message& msg)
+{
+    bool success = executeFunction(msg);
+
+    // Run other queued calls for the function in the same batch
+    if (success && conf::getFaasmConfig().microBatchSize > 1 &&
+        msg.snapshotkey().empty()) {
+        executeBatch(msg);
+    }
+
+    return success;
+}
+
+/**
+ * Drains up to MICRO_BATCH_SIZE - 1 further queued calls for the bound
+ * function, runs them back to back after the given call, then publishes
+ * their results together. The executor publishes the given call's result
+ * straight afterwards, so the whole batch finishes at once.
+ *
+ * The module is reset from the zygote before each call in the batch, unless
+ * the function is declared stateless, in which case it's only reset after a
+ * failed call. It's always reset at the end of the batch in preFinishCall.
+ */
+void Faaslet::executeBatch(faabric::Message& msg)
+{
+    auto logger = faabric::util::getLogger();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    bool isStateless =
+      conf::isFunctionInList(faasmConf.statelessFunctions, msg);
+    auto functionQueue = sch.getFunctionQueue(msg);
+
+    // The first call's output must be taken before the rest of the batch
+    // runs on the module
+    appendCapturedStdout(msg);
+
+    std::vector<faabric::Message> batch;
+    bool needsReset = !isStateless;
+    while ((int)batch.size() < faasmConf.microBatchSize - 1) {
+        if (functionQueue->size() == 0) {
+            break;
+        }
+
+        // Another Faaslet may have taken the message in the meantime
+        faabric::Message batchMsg;
+        try {
+            batchMsg = functionQueue->dequeue(1);
+        } catch (faabric::util::QueueTimeoutException& e) {
+            break;
+        }
+
+        if (needsReset) {
+            resetModule(batchMsg);
+        }
+
+        // Errors are handled as the executor would for a single call
+        bool success;
+        std::string errorMessage;
+        try {
+            success = executeFunction(batchMsg);
+        } catch (const std::exception& e) {
+            errorMessage = "Error: " + std::string(e.what());
+            logger->error(errorMessage);
+            success = false;
+            batchMsg.set_returnvalue(1);
+        }
+
+        if (!success && errorMessage.empty()) {
+            errorMessage = "Call failed (return value=" +
+                           std::to_string(batchMsg.returnvalue()) + ")";
+        }
+
+        wasm::CallTracer& tracer = wasm::getCallTracer();
+        tracer.resumeCall(batchMsg);
+        tidyCall(batchMsg);
+        tracer.finishCall(batchMsg);
+
+        if (!success) {
+            batchMsg.set_outputdata(errorMessage);
+        }
+
+        // A failed call may have left the module in any state
+        needsReset = !isStateless || !success;
+
+        batch.emplace_back(batchMsg);
+    }
+
+    if (batch.empty()) {
+        return;
+    }
+
+    logger->debug("Faaslet {} executed batch of {} extra {} calls",
+                  id,
+                  batch.size(),
+                  faabric::util::funcToString(msg, false));
+
+    // The tracer's active call must be the first one again for the rest of
+    // the executor's handling of it
+    wasm::getCallTracer().resumeCall(msg);
+
+    for (auto& batchMsg : batch) {
+        sch.setFunctionResult(batchMsg);
+        sch.notifyCallFinished(batchMsg);
+    }
+}
+
+bool Faaslet::executeFunction(faabric::Message& msg)
 {
     auto logger = faabric::util::getLogger();
 
+    wasm::getCallTracer().startCall(msg);
+
+    ResourceUsageMeter usageMeter(msg.id());
+
+    // Rebind if the function has been uploaded again since we were bound.
+    // Faaslets for other functions carry on as they are. This is checked at
+    // most every FUNCTION_VERSION_CHECK_MS, as a new version is only seen
+    // that often anyway.
+    if (isVersionStale(msg)) {
+        logger->debug("Faaslet {} rebinding to new version of {}",
+                      id,
+                      faabric::util::funcToString(msg, false));
+
+        TRACE_SPAN("lifecycle", "rebind")
+        bindModule(msg);
+    }
+
+    // Serve the result from the cache if we've seen this input before
+    wasm::ResultCache& resultCache = wasm::getResultCache();
+    bool memoizable = resultCache.isMemoizable(msg);
+    std::vector<uint8_t> input;
+    if (memoizable) {
+        input = wasm::getCallInput(msg);
+
+        std::vector<uint8_t> output;
+        if (resultCache.getResult(msg, input, output)) {
+            logger->debug("Memoized result for {}",
+                          faabric::util::funcToString(msg, true));
+
+            wasm::writeCallOutput(msg, output.data(), output.size());
+            msg.set_returnvalue(0);
+            return true;
+        }
+    }
+
     // Check if we need to restore from a different snapshot
     auto conf = faabric::util::getSystemConfig();
     if (conf.wasmVm == "wavm") {
         const std::string snapshotKey = msg.snapshotkey();
         if (!snapshotKey.empty() && !msg.issgx()) {
-            PROF_START(snapshotOverride)
+            LATENCY_START(snapshotOverride)
 
             module_cache::WasmModuleCache& registry =
               module_cache::getWasmModuleCache();
-            wasm::WAVMWasmModule& snapshot = registry.getCachedModule(msg);
-            module = std::make_unique<wasm::WAVMWasmModule>(snapshot);
+            zygote = registry.getCachedModule(msg);
+            module = std::make_unique<wasm::WAVMWasmModule>(*zygote);
+            boundModuleKey.clear();
 
-            PROF_END(snapshotOverride)
+            LATENCY_END(snapshotOverride)
         }
+
+        // Warm up any functions this call is likely to chain
+        wasm::getCallGraph().recordCall(msg);
+        module_cache::getChainPrewarmer().prewarmChildren(msg);
+    }
+
+    // Execute the function, holding an admission slot while it runs
+    bool success;
+    {
+        LATENCY_START(admissionWait)
+        AdmissionTicket ticket(msg);
+        LATENCY_END(admissionWait)
+
+        recordCallQueued(msg);
+
+        LATENCY_START(callExecute)
+        success = module->execute(msg);
+        LATENCY_END(callExecute)
+    }
+
+    usageMeter.setFinalMemory(module->getMemorySizeBytes());
+
+    // Metered calls feed into their function's predicted cost
+    int64_t instructions = module->getMeteredInstructions();
+    if (instructions >= 0) {
+        usageMeter.setInstructions(instructions);
+        wasm::getFunctionCosts().record(msg, instructions);
+    }
+
+    // Only successful calls are memoized
+    if (memoizable && success && msg.returnvalue() == 0) {
+        resultCache.putResult(msg, input, wasm::getCallOutput(msg));
     }
 
-    // Execute the function
-    bool success = module->execute(msg);
     return success;
 }
 }
@@ -0,0 +1,100 @@
+#include "MetricsServer.h"
+
+#include <faabric/util/logging.h>
+#include <system/LatencyMetrics.h>
+#include <wasm/CallTracer.h>
+#include <wavm/SamplingProfiler.h>
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace web::http;
+using namespace web::http::experimental::listener;
+
+namespace faaslet {
+MetricsServer::MetricsServer(int portIn)
+  : port(portIn)
+{}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+void MetricsServer::start()
+{
+    if (listener != nullptr) {
+        return;
+    }
+
+    std::string addr = "http://127.0.0.1:" + std::to_string(port);
+    listener = std::make_unique<http_listener>(addr);
+    listener->support(methods::GET, MetricsServer::handleGet);
+    listener->open().wait();
+
+    faabric::util::getLogger()->info(
+      "Serving metrics on {}{}", addr, METRICS_PATH);
+}
+
+void MetricsServer::stop()
+{
+    if (listener == nullptr) {
+        return;
+    }
+
+    listener->close().wait();
+    listener = nullptr;
+}
+
+int MetricsServer::getPort()
+{
+    return port;
+}
+
+void MetricsServer::handleGet(const http_request& request)
+{
+    std::string path = request.relative_uri().path();
+
+    // Profiles are requested as /profile/<user>/<function>
+    if (path.rfind(PROFILE_PATH_PREFIX, 0) == 0) {
+        std::string funcStr = path.substr(strlen(PROFILE_PATH_PREFIX));
+        wasm::FoldedStacks stacks =
+          wasm::getCallProfiles().getFunctionProfile(funcStr);
+
+        if (stacks.empty()) {
+            request.reply(status_codes::NotFound, "No profile\n");
+        } else {
+            request.reply(status_codes::OK,
+                          wasm::foldedStacksToString(stacks));
+        }
+        return;
+    }
+
+    // Traces are requested as /trace/<trace ID>
+    if (path.rfind(TRACE_PATH_PREFIX, 0) == 0) {
+        unsigned long traceId = std::strtoul(
+          path.c_str() + strlen(TRACE_PATH_PREFIX), nullptr, 10);
+        wasm::CallTracer& tracer = wasm::getCallTracer();
+
+        if (traceId == 0 || tracer.getTrace(traceId).empty()) {
+            request.reply(status_codes::NotFound, "No trace\n");
+        } else {
+            http_response response(status_codes::OK);
+            response.set_body(tracer.getTraceJson(traceId),
+                              "application/json");
+            request.reply(response);
+        }
+        return;
+    }
+
+    if (path != METRICS_PATH) {
+        request.reply(status_codes::NotFound, "Not found\n");
+        return;
+    }
+
+    http_response response(status_codes::OK);
+    response.set_body(isolation::getLatencyRegistry().getPrometheusText(),
+                      "text/plain; version=0.0.4");
+    request.reply(response);
+}
+}
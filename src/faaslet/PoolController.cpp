@@ -0,0 +1,151 @@
+#include "PoolController.h"
+
+#include <conf/FaasmConfig.h>
+
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#define SCALE_CHECK_INTERVAL_MS 10
+
+namespace faaslet {
+PoolController::PoolController(int minSizeIn, int maxSizeIn)
+  : minSize(std::min(minSizeIn, maxSizeIn))
+  , maxSize(maxSizeIn)
+{}
+
+/**
+ * Blocks until the pool needs another Faaslet. Called before each Faaslet is
+ * created, so Faaslets over the minimum only exist while there's demand.
+ */
+void PoolController::admit(const std::function<bool()>& isShutdown)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    while (!shouldGrowUnlocked()) {
+        if (isShutdown()) {
+            break;
+        }
+
+        cv.wait_for(lock, std::chrono::milliseconds(SCALE_CHECK_INTERVAL_MS));
+    }
+
+    activeCount++;
+    unboundCount++;
+    peakCount = std::max(peakCount, activeCount);
+
+    faabric::util::getLogger()->debug(
+      "Admitted Faaslet ({} active, {} bound)", activeCount, boundCount);
+}
+
+void PoolController::notifyBound()
+{
+    faabric::util::UniqueLock lock(mx);
+    unboundCount--;
+    boundCount++;
+}
+
+void PoolController::release(bool wasBound)
+{
+    faabric::util::UniqueLock lock(mx);
+    activeCount--;
+
+    if (wasBound) {
+        boundCount--;
+    } else {
+        unboundCount--;
+    }
+
+    faabric::util::getLogger()->debug(
+      "Released Faaslet ({} active, {} bound)", activeCount, boundCount);
+
+    cv.notify_all();
+}
+
+bool PoolController::shouldGrow()
+{
+    faabric::util::UniqueLock lock(mx);
+    return shouldGrowUnlocked();
+}
+
+bool PoolController::shouldGrowUnlocked()
+{
+    if (activeCount < minSize) {
+        return true;
+    }
+
+    if (activeCount >= maxSize) {
+        return false;
+    }
+
+    // Only grow if there are binds waiting that no idle Faaslet will take
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    long pendingBinds = (long)sch.getBindQueue()->size();
+    if (pendingBinds <= unboundCount) {
+        return false;
+    }
+
+    // Don't grow if the host is short of memory
+    long minFreeMb = conf::getFaasmConfig().poolMinFreeMemoryMb;
+    if (minFreeMb > 0 && getAvailableMemoryMb() < minFreeMb) {
+        faabric::util::getLogger()->warn(
+          "Not growing Faaslet pool, under {}MB memory available", minFreeMb);
+        return false;
+    }
+
+    return true;
+}
+
+int PoolController::getMinSize()
+{
+    return minSize;
+}
+
+int PoolController::getMaxSize()
+{
+    return maxSize;
+}
+
+int PoolController::getActiveCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return activeCount;
+}
+
+int PoolController::getBoundCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return boundCount;
+}
+
+int PoolController::getPeakCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return peakCount;
+}
+
+long getAvailableMemoryMb()
+{
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        std::istringstream ss(line);
+        std::string key;
+        long valueKb;
+        ss >> key >> valueKb;
+
+        if (key == "MemAvailable:") {
+            return valueKb / 1024;
+        }
+    }
+
+    // Can't tell, so assume there's no pressure
+    return std::numeric_limits<long>::max();
+}
+}
@@ -1,4 +1,5 @@
 #include "IRModuleCache.h"
+#include "ProfileGuided.h"
 
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
@@ -40,6 +41,16 @@ std::string getModuleKey(const std::string& user,
     return key;
 }
 
+/**
+ * Must be called with the full lock held.
+ */
+void IRModuleCache::addFunctionKey(const std::string& user,
+                                   const std::string& func,
+                                   const std::string& key)
+{
+    functionKeys[user + "/" + func].insert(key);
+}
+
 int IRModuleCache::getModuleCount(const std::string& key)
 {
     faabric::util::SharedLock lock(registryMutex);
@@ -116,12 +127,23 @@ Runtime::ModuleRef IRModuleCache::getCompiledMainModule(const std::string& user,
     if (getCompiledModuleCount(key) == 0) {
         faabric::util::FullLock registryLock(registryMutex);
         if (compiledModuleMap.count(key) == 0) {
+            addFunctionKey(user, func, key);
             IR::Module& module = getModuleFromMap(key);
 
-            storage::FileLoader& functionLoader = storage::getFileLoader();
-            faabric::Message msg = faabric::util::messageFactory(user, func);
-            std::vector<uint8_t> objectFileBytes =
-              functionLoader.loadFunctionObjectFile(msg);
+            // Use the object file read when loading the IR module, so that
+            // the two match
+            std::vector<uint8_t> objectFileBytes;
+            auto pendingIt = pendingObjectBytes.find(key);
+            if (pendingIt != pendingObjectBytes.end()) {
+                objectFileBytes = std::move(pendingIt->second);
+                pendingObjectBytes.erase(pendingIt);
+            } else {
+                storage::FileLoader& functionLoader = storage::getFileLoader();
+                faabric::Message msg =
+                  faabric::util::messageFactory(user, func);
+                objectFileBytes = functionLoader.loadFunctionObjectFile(msg);
+                extractPgoPlan(objectFileBytes);
+            }
 
             if (!objectFileBytes.empty()) {
                 compiledModuleMap[key] =
@@ -151,6 +173,7 @@ Runtime::ModuleRef IRModuleCache::getCompiledSharedModule(
             logger->debug(
               "Loading compiled shared module {}/{} - {}", user, func, path);
 
+            addFunctionKey(user, func, key);
             IR::Module& module = getModuleFromMap(key);
 
             storage::FileLoader& functionLoader = storage::getFileLoader();
@@ -178,6 +201,7 @@ IR::Module& IRModuleCache::getMainModule(const std::string& user,
         faabric::util::FullLock registryLock(registryMutex);
         if (moduleMap.count(key) == 0) {
             logger->debug("Loading main module {}/{}", user, func);
+            addFunctionKey(user, func, key);
 
             storage::FileLoader& functionLoader = storage::getFileLoader();
 
@@ -201,6 +225,19 @@ IR::Module& IRModuleCache::getMainModule(const std::string& user,
                   "wast_file", (const char*)wasmBytes.data(), parseErrors);
             }
 
+            // Objects built with profile-guided optimisation record how the
+            // module was transformed, which the IR module must match
+            std::vector<uint8_t> objectFileBytes =
+              functionLoader.loadFunctionObjectFile(msg);
+            PgoPlan plan = extractPgoPlan(objectFileBytes);
+            if (plan.mode != PgoMode::none) {
+                logger->debug("Applying profile-guided plan to {}/{}",
+                              user,
+                              func);
+                applyPgoPlan(module, plan);
+            }
+            pendingObjectBytes[key] = std::move(objectFileBytes);
+
             // Force maximum size
             module.memories.defs[0].type.size.max = (U64)MAX_MEMORY_PAGES;
 
@@ -228,6 +265,7 @@ IR::Module& IRModuleCache::getSharedModule(const std::string& user,
         faabric::util::FullLock lock(registryMutex);
         if (moduleMap.count(key) == 0) {
             logger->debug("Loading shared module {}/{} - {}", user, func, path);
+            addFunctionKey(user, func, key);
 
             storage::FileLoader& functionLoader = storage::getFileLoader();
 
@@ -292,6 +330,33 @@ bool IRModuleCache::isCompiledModuleCached(const std::string& user,
     return getCompiledModuleCount(key) > 0;
 }
 
+/**
+ * Removes the main module and any shared modules loaded for the given
+ * function, leaving other functions' modules in place.
+ */
+void IRModuleCache::evictFunction(const std::string& user,
+                                  const std::string& func)
+{
+    faabric::util::FullLock lock(registryMutex);
+
+    auto it = functionKeys.find(user + "/" + func);
+    if (it == functionKeys.end()) {
+        return;
+    }
+
+    faabric::util::getLogger()->debug(
+      "Evicting IR modules for {}/{}", user, func);
+
+    for (const std::string& key : it->second) {
+        moduleMap.erase(key);
+        compiledModuleMap.erase(key);
+        originalTableSizes.erase(key);
+        pendingObjectBytes.erase(key);
+    }
+
+    functionKeys.erase(it);
+}
+
 void IRModuleCache::clear()
 {
     faabric::util::FullLock lock(registryMutex);
@@ -302,5 +367,7 @@ void IRModuleCache::clear()
     moduleMap.clear();
     compiledModuleMap.clear();
     originalTableSizes.clear();
+    pendingObjectBytes.clear();
+    functionKeys.clear();
 }
 }
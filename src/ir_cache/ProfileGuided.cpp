@@ -0,0 +1,1035 @@
+#include "ProfileGuided.h"
+
+#include <WAVM/IR/Operators.h>
+#include <WAVM/IR/Types.h>
+#include <WAVM/IR/Value.h>
+#include <WAVM/Inline/Serialization.h>
+
+#include <faabric/util/files.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+
+namespace wasm {
+// ------------------------------------
+// Profiles and plans
+// ------------------------------------
+
+bool PgoProfile::empty() const
+{
+    return entryCounts.empty() && edgeCounts.empty();
+}
+
+void PgoProfile::add(const PgoProfile& other)
+{
+    for (auto& e : other.entryCounts) {
+        entryCounts[e.first] += e.second;
+    }
+
+    for (auto& e : other.edgeCounts) {
+        PgoEdge& edge = edgeCounts[e.first];
+        edge.callee = e.second.callee;
+        edge.count += e.second.count;
+    }
+}
+
+/**
+ * Removes the counts in a previous snapshot of the same counters, leaving
+ * only what was counted since.
+ */
+void PgoProfile::subtract(const PgoProfile& other)
+{
+    for (auto& e : other.entryCounts) {
+        auto it = entryCounts.find(e.first);
+        if (it != entryCounts.end()) {
+            it->second -= std::min(it->second, e.second);
+        }
+    }
+
+    for (auto& e : other.edgeCounts) {
+        auto it = edgeCounts.find(e.first);
+        if (it != edgeCounts.end()) {
+            it->second.count -= std::min(it->second.count, e.second.count);
+        }
+    }
+}
+
+/**
+ * One count per line, as "entry <function> <count>" or
+ * "edge <caller> <site> <callee> <count>".
+ */
+std::string PgoProfile::toString() const
+{
+    std::stringstream ss;
+    for (auto& e : entryCounts) {
+        ss << "entry " << e.first << " " << e.second << std::endl;
+    }
+
+    for (auto& e : edgeCounts) {
+        ss << "edge " << e.first.first << " " << e.first.second << " "
+           << e.second.callee << " " << e.second.count << std::endl;
+    }
+
+    return ss.str();
+}
+
+PgoProfile PgoProfile::fromString(const std::string& str)
+{
+    PgoProfile profile;
+
+    std::stringstream ss(str);
+    std::string line;
+    while (std::getline(ss, line)) {
+        std::stringstream ls(line);
+        std::string kind;
+        ls >> kind;
+
+        if (kind == "entry") {
+            Uptr func;
+            uint64_t count;
+            if (ls >> func >> count) {
+                profile.entryCounts[func] += count;
+            }
+        } else if (kind == "edge") {
+            Uptr caller;
+            Uptr site;
+            PgoEdge edge;
+            if (ls >> caller >> site >> edge.callee >> edge.count) {
+                profile.edgeCounts[{ caller, site }] = edge;
+            }
+        }
+    }
+
+    return profile;
+}
+
+std::string PgoPlan::toString() const
+{
+    std::stringstream ss;
+    switch (mode) {
+        case PgoMode::instrument:
+            ss << "instrument" << std::endl;
+            break;
+        case PgoMode::optimise:
+            ss << "optimise" << std::endl;
+            for (auto& s : inlinedSites) {
+                ss << "inline " << s.first << " " << s.second << std::endl;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (metered) {
+        ss << "meter" << std::endl;
+    }
+
+    return ss.str();
+}
+
+PgoPlan PgoPlan::fromString(const std::string& str)
+{
+    PgoPlan plan;
+
+    std::stringstream ss(str);
+    std::string line;
+    while (std::getline(ss, line)) {
+        std::stringstream ls(line);
+        std::string kind;
+        ls >> kind;
+
+        if (kind == "instrument") {
+            plan.mode = PgoMode::instrument;
+        } else if (kind == "optimise") {
+            plan.mode = PgoMode::optimise;
+        } else if (kind == "meter") {
+            plan.metered = true;
+        } else if (kind == "inline") {
+            PgoCallSite site;
+            if (ls >> site.first >> site.second) {
+                plan.inlinedSites.insert(site);
+            }
+        }
+    }
+
+    return plan;
+}
+
+// ------------------------------------
+// Rewriting function bodies
+// ------------------------------------
+
+/**
+ * Re-encodes every operator as it's decoded. Rewrites override the operators
+ * they change.
+ */
+struct CopyingVisitor
+{
+    typedef void Result;
+
+    explicit CopyingVisitor(IR::OperatorEncoderStream& encoderIn)
+      : encoder(encoderIn)
+    {}
+
+#define VISIT_OP(opcode, name, nameString, Imm, ...)                           \
+    void name(Imm imm) { encoder.name(imm); }
+    WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+    void unknown(IR::Opcode opcode)
+    {
+        throw std::runtime_error("Unknown opcode rewriting function");
+    }
+
+    IR::OperatorEncoderStream& encoder;
+};
+
+/**
+ * Visits every operator without doing anything, for scanning code.
+ */
+struct ScanningVisitor
+{
+    typedef void Result;
+
+#define VISIT_OP(opcode, name, nameString, Imm, ...)                           \
+    void name(Imm imm) {}
+    WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+
+    void unknown(IR::Opcode opcode)
+    {
+        throw std::runtime_error("Unknown opcode scanning function");
+    }
+};
+
+template<typename Visitor>
+void decodeFunction(const IR::FunctionDef& funcDef, Visitor& visitor)
+{
+    IR::OperatorDecoderStream decoder(funcDef.code);
+    while (decoder) {
+        decoder.decodeOp(visitor);
+    }
+}
+
+/**
+ * Records the callee of each direct call, in order.
+ */
+struct CallSiteVisitor : ScanningVisitor
+{
+    std::vector<Uptr> callees;
+    bool hasTailCalls = false;
+
+    void call(IR::FunctionImm imm) { callees.emplace_back(imm.functionIndex); }
+
+    template<typename Imm> void return_call(Imm imm) { hasTailCalls = true; }
+
+    template<typename Imm> void return_call_indirect(Imm imm)
+    {
+        hasTailCalls = true;
+    }
+};
+
+static void emitIncrement(IR::OperatorEncoderStream& encoder,
+                          Uptr globalIdx,
+                          I64 amount = 1)
+{
+    encoder.global_get({ globalIdx });
+    encoder.i64_const({ amount });
+    encoder.i64_add(IR::NoImm());
+    encoder.global_set({ globalIdx });
+}
+
+static Uptr addCounter(IR::Module& module, const std::string& name)
+{
+    Uptr globalIdx = module.globals.size();
+
+    module.globals.defs.push_back(
+      { IR::GlobalType(IR::ValueType::i64, true),
+        IR::InitializerExpression(I64(0)) });
+    module.exports.push_back({ name, IR::ExternKind::global, globalIdx });
+
+    return globalIdx;
+}
+
+// ------------------------------------
+// Instrumentation
+// ------------------------------------
+
+struct InstrumentingVisitor : CopyingVisitor
+{
+    InstrumentingVisitor(IR::OperatorEncoderStream& encoderIn,
+                         IR::Module& moduleIn,
+                         Uptr callerIn)
+      : CopyingVisitor(encoderIn)
+      , module(moduleIn)
+      , caller(callerIn)
+    {}
+
+    void call(IR::FunctionImm imm)
+    {
+        std::string name = PGO_EDGE_PREFIX + std::to_string(caller) + "_" +
+                           std::to_string(site) + "_" +
+                           std::to_string(imm.functionIndex);
+        emitIncrement(encoder, addCounter(module, name));
+        encoder.call(imm);
+        site++;
+    }
+
+    IR::Module& module;
+    Uptr caller;
+    Uptr site = 0;
+};
+
+/**
+ * Adds a counter to the entry of every function and before every direct call.
+ * Each counter is a mutable global exported under a name saying what it
+ * counts, so they can be read back from an instance without any other
+ * bookkeeping. Appending globals leaves existing global indices unchanged.
+ */
+void instrumentModule(IR::Module& module)
+{
+    for (Uptr d = 0; d < module.functions.defs.size(); d++) {
+        IR::FunctionDef& funcDef = module.functions.defs[d];
+
+        Serialization::ArrayOutputStream stream;
+        IR::OperatorEncoderStream encoder(stream);
+
+        Uptr entryCounter =
+          addCounter(module, PGO_ENTRY_PREFIX + std::to_string(d));
+        emitIncrement(encoder, entryCounter);
+
+        InstrumentingVisitor visitor(encoder, module, d);
+        decodeFunction(funcDef, visitor);
+
+        funcDef.code = stream.getBytes();
+    }
+}
+
+bool isInstrumented(const IR::Module& module)
+{
+    for (auto& e : module.exports) {
+        if (e.name.rfind(PGO_COUNTER_PREFIX, 0) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+PgoProfile readPgoCounters(Runtime::Instance* instance,
+                           Runtime::Context* context,
+                           const IR::Module& module)
+{
+    PgoProfile profile;
+
+    for (auto& e : module.exports) {
+        if (e.kind != IR::ExternKind::global ||
+            e.name.rfind(PGO_COUNTER_PREFIX, 0) != 0) {
+            continue;
+        }
+
+        Runtime::Global* global = Runtime::asGlobalNullable(
+          Runtime::getInstanceExport(instance, e.name.c_str()));
+        if (global == nullptr) {
+            continue;
+        }
+
+        uint64_t count = (uint64_t)Runtime::getGlobalValue(context, global).i64;
+
+        if (e.name.rfind(PGO_ENTRY_PREFIX, 0) == 0) {
+            Uptr func = std::stoul(e.name.substr(strlen(PGO_ENTRY_PREFIX)));
+            profile.entryCounts[func] = count;
+        } else if (e.name.rfind(PGO_EDGE_PREFIX, 0) == 0) {
+            Uptr caller;
+            Uptr site;
+            PgoEdge edge;
+            sscanf(e.name.c_str() + strlen(PGO_EDGE_PREFIX),
+                   "%lu_%lu_%lu",
+                   &caller,
+                   &site,
+                   &edge.callee);
+            edge.count = count;
+            profile.edgeCounts[{ caller, site }] = edge;
+        }
+    }
+
+    return profile;
+}
+
+// ------------------------------------
+// Metering
+// ------------------------------------
+
+struct CountingVisitor : ScanningVisitor
+{
+    Uptr current = 0;
+
+#define VISIT_OP(opcode, name, nameString, Imm, ...)                           \
+    void name(Imm imm) { current++; }
+    WAVM_ENUM_OPERATORS(VISIT_OP)
+#undef VISIT_OP
+};
+
+/**
+ * Counts the operators in each straight-line run of code, i.e. up to and
+ * including the next operator that starts, ends or branches out of a block.
+ */
+struct MeterScanningVisitor : CountingVisitor
+{
+    std::vector<Uptr> runLengths;
+
+    void endRun()
+    {
+        runLengths.emplace_back(current + 1);
+        current = 0;
+    }
+
+    void block(IR::ControlStructureImm imm) { endRun(); }
+    void loop(IR::ControlStructureImm imm) { endRun(); }
+    void if_(IR::ControlStructureImm imm) { endRun(); }
+    void else_(IR::NoImm imm) { endRun(); }
+    void end(IR::NoImm imm) { endRun(); }
+    void br(IR::BranchImm imm) { endRun(); }
+    void br_if(IR::BranchImm imm) { endRun(); }
+    void br_table(IR::BranchTableImm imm) { endRun(); }
+    void return_(IR::NoImm imm) { endRun(); }
+    void unreachable(IR::NoImm imm) { endRun(); }
+};
+
+/**
+ * Adds each run's length to the counter as the run starts. The last run ends
+ * with the function's own end, so nothing is added after it.
+ */
+struct MeteringVisitor : CopyingVisitor
+{
+    MeteringVisitor(IR::OperatorEncoderStream& encoderIn,
+                    const std::vector<Uptr>& runLengthsIn,
+                    Uptr counterIn)
+      : CopyingVisitor(encoderIn)
+      , runLengths(runLengthsIn)
+      , counter(counterIn)
+    {
+        startRun();
+    }
+
+    void startRun()
+    {
+        if (run < runLengths.size()) {
+            emitIncrement(encoder, counter, (I64)runLengths[run]);
+        }
+    }
+
+    void endRun()
+    {
+        run++;
+        startRun();
+    }
+
+    void block(IR::ControlStructureImm imm)
+    {
+        encoder.block(imm);
+        endRun();
+    }
+
+    void loop(IR::ControlStructureImm imm)
+    {
+        encoder.loop(imm);
+        endRun();
+    }
+
+    void if_(IR::ControlStructureImm imm)
+    {
+        encoder.if_(imm);
+        endRun();
+    }
+
+    void else_(IR::NoImm imm)
+    {
+        encoder.else_(imm);
+        endRun();
+    }
+
+    void end(IR::NoImm imm)
+    {
+        encoder.end(imm);
+        endRun();
+    }
+
+    void br(IR::BranchImm imm)
+    {
+        encoder.br(imm);
+        endRun();
+    }
+
+    void br_if(IR::BranchImm imm)
+    {
+        encoder.br_if(imm);
+        endRun();
+    }
+
+    void br_table(IR::BranchTableImm imm)
+    {
+        encoder.br_table(imm);
+        endRun();
+    }
+
+    void return_(IR::NoImm imm)
+    {
+        encoder.return_(imm);
+        endRun();
+    }
+
+    void unreachable(IR::NoImm imm)
+    {
+        encoder.unreachable(imm);
+        endRun();
+    }
+
+    const std::vector<Uptr>& runLengths;
+    Uptr counter;
+    Uptr run = 0;
+};
+
+/**
+ * Counts the wasm operators each call executes in a single exported counter.
+ * Each straight-line run of code adds its length to the counter as it starts,
+ * so the count is exact unless a run is left part way through by a trap or
+ * exit. The counter itself isn't counted.
+ */
+void meterModule(IR::Module& module)
+{
+    Uptr counter = addCounter(module, METER_COUNTER_NAME);
+
+    for (auto& funcDef : module.functions.defs) {
+        MeterScanningVisitor scanner;
+        decodeFunction(funcDef, scanner);
+
+        Serialization::ArrayOutputStream stream;
+        IR::OperatorEncoderStream encoder(stream);
+
+        MeteringVisitor visitor(encoder, scanner.runLengths, counter);
+        decodeFunction(funcDef, visitor);
+
+        funcDef.code = stream.getBytes();
+    }
+}
+
+bool isMetered(const IR::Module& module)
+{
+    for (auto& e : module.exports) {
+        if (e.name == METER_COUNTER_NAME) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Reads the counter of a metered module in the given context, or returns -1
+ * if the module isn't metered.
+ */
+int64_t readMeterCounter(Runtime::Instance* instance,
+                         Runtime::Context* context)
+{
+    Runtime::Global* global = Runtime::asGlobalNullable(
+      Runtime::getInstanceExport(instance, METER_COUNTER_NAME));
+    if (global == nullptr) {
+        return -1;
+    }
+
+    return Runtime::getGlobalValue(context, global).i64;
+}
+
+// ------------------------------------
+// Inlining
+// ------------------------------------
+
+/**
+ * Copies an inlined callee's body, moving its locals and branch tables into
+ * the caller's, and turning returns into branches out of the block that
+ * replaces the callee's own body.
+ */
+struct InlinedBodyVisitor : CopyingVisitor
+{
+    InlinedBodyVisitor(IR::OperatorEncoderStream& encoderIn,
+                       Uptr localBaseIn,
+                       Uptr tableBaseIn)
+      : CopyingVisitor(encoderIn)
+      , localBase(localBaseIn)
+      , tableBase(tableBaseIn)
+    {}
+
+    void block(IR::ControlStructureImm imm)
+    {
+        depth++;
+        encoder.block(imm);
+    }
+
+    void loop(IR::ControlStructureImm imm)
+    {
+        depth++;
+        encoder.loop(imm);
+    }
+
+    void if_(IR::ControlStructureImm imm)
+    {
+        depth++;
+        encoder.if_(imm);
+    }
+
+    template<typename Imm> void try_(Imm imm)
+    {
+        depth++;
+        encoder.try_(imm);
+    }
+
+    void end(IR::NoImm imm)
+    {
+        // The callee's last end closes the block standing in for its body
+        if (depth > 0) {
+            depth--;
+        }
+        encoder.end(imm);
+    }
+
+    void return_(IR::NoImm imm) { encoder.br({ depth }); }
+
+    template<typename Imm> void local_get(Imm imm)
+    {
+        imm.variableIndex += localBase;
+        encoder.local_get(imm);
+    }
+
+    template<typename Imm> void local_set(Imm imm)
+    {
+        imm.variableIndex += localBase;
+        encoder.local_set(imm);
+    }
+
+    template<typename Imm> void local_tee(Imm imm)
+    {
+        imm.variableIndex += localBase;
+        encoder.local_tee(imm);
+    }
+
+    void br_table(IR::BranchTableImm imm)
+    {
+        imm.branchTableIndex += tableBase;
+        encoder.br_table(imm);
+    }
+
+    Uptr localBase;
+    Uptr tableBase;
+
+    // Control structures open within the callee, not counting its body
+    Uptr depth = 0;
+};
+
+struct InliningVisitor : CopyingVisitor
+{
+    InliningVisitor(IR::OperatorEncoderStream& encoderIn,
+                    IR::Module& moduleIn,
+                    const std::vector<IR::FunctionDef>& originalDefsIn,
+                    IR::FunctionDef& callerDefIn,
+                    Uptr callerIn,
+                    const std::set<PgoCallSite>& sitesIn)
+      : CopyingVisitor(encoderIn)
+      , module(moduleIn)
+      , originalDefs(originalDefsIn)
+      , callerDef(callerDefIn)
+      , caller(callerIn)
+      , sites(sitesIn)
+    {}
+
+    void call(IR::FunctionImm imm)
+    {
+        Uptr thisSite = site++;
+        if (sites.count({ caller, thisSite }) == 0) {
+            encoder.call(imm);
+            return;
+        }
+
+        inlineCall(imm.functionIndex - module.functions.imports.size());
+    }
+
+    /**
+     * Each callee gets its own locals in the caller, reused by every site
+     * inlining it. Parameters come first, as in the callee.
+     */
+    Uptr getLocalBase(Uptr callee)
+    {
+        auto it = localBases.find(callee);
+        if (it != localBases.end()) {
+            return it->second;
+        }
+
+        const IR::FunctionDef& calleeDef = originalDefs.at(callee);
+        IR::FunctionType calleeType = module.types[calleeDef.type.index];
+        IR::FunctionType callerType = module.types[callerDef.type.index];
+
+        Uptr base = callerType.params().size() +
+                    callerDef.nonParameterLocalTypes.size();
+        for (auto t : calleeType.params()) {
+            callerDef.nonParameterLocalTypes.push_back(t);
+        }
+        for (auto t : calleeDef.nonParameterLocalTypes) {
+            callerDef.nonParameterLocalTypes.push_back(t);
+        }
+
+        localBases[callee] = base;
+        return base;
+    }
+
+    void emitZero(IR::ValueType type)
+    {
+        switch (type) {
+            case IR::ValueType::i32:
+                encoder.i32_const({ 0 });
+                break;
+            case IR::ValueType::i64:
+                encoder.i64_const({ 0 });
+                break;
+            case IR::ValueType::f32:
+                encoder.f32_const({ 0.0f });
+                break;
+            case IR::ValueType::f64:
+                encoder.f64_const({ 0.0 });
+                break;
+            default:
+                throw std::runtime_error("Cannot inline local of this type");
+        }
+    }
+
+    void inlineCall(Uptr callee)
+    {
+        const IR::FunctionDef& calleeDef = originalDefs.at(callee);
+        IR::FunctionType calleeType = module.types[calleeDef.type.index];
+        Uptr nParams = calleeType.params().size();
+        Uptr base = getLocalBase(callee);
+
+        // Pop the arguments into the parameters, last first
+        for (Uptr p = nParams; p > 0; p--) {
+            encoder.local_set({ base + p - 1 });
+        }
+
+        // Locals must start zeroed on every call
+        for (Uptr l = 0; l < calleeDef.nonParameterLocalTypes.size(); l++) {
+            emitZero(calleeDef.nonParameterLocalTypes[l]);
+            encoder.local_set({ base + nParams + l });
+        }
+
+        // The block stands in for the callee's body, which closes it
+        IR::ControlStructureImm blockImm;
+        if (calleeType.results().size() == 0) {
+            blockImm.type.format = IR::IndexedBlockType::noParametersOrResult;
+        } else {
+            blockImm.type.format = IR::IndexedBlockType::oneResult;
+            blockImm.type.resultType = calleeType.results()[0];
+        }
+        encoder.block(blockImm);
+
+        Uptr tableBase = callerDef.branchTables.size();
+        for (auto& t : calleeDef.branchTables) {
+            callerDef.branchTables.push_back(t);
+        }
+
+        InlinedBodyVisitor bodyVisitor(encoder, base, tableBase);
+        decodeFunction(calleeDef, bodyVisitor);
+    }
+
+    IR::Module& module;
+    const std::vector<IR::FunctionDef>& originalDefs;
+    IR::FunctionDef& callerDef;
+    Uptr caller;
+    const std::set<PgoCallSite>& sites;
+
+    Uptr site = 0;
+    std::map<Uptr, Uptr> localBases;
+};
+
+/**
+ * Checks a callee is small and simple enough to inline into another function
+ */
+static bool canInline(const IR::Module& module, Uptr caller, Uptr callee)
+{
+    if (callee == caller || callee >= module.functions.defs.size()) {
+        return false;
+    }
+
+    const IR::FunctionDef& calleeDef = module.functions.defs[callee];
+    if (calleeDef.code.size() > PGO_INLINE_MAX_CALLEE_BYTES) {
+        return false;
+    }
+
+    IR::FunctionType calleeType = module.types[calleeDef.type.index];
+    if (calleeType.results().size() > 1) {
+        return false;
+    }
+
+    for (auto t : calleeDef.nonParameterLocalTypes) {
+        if (t != IR::ValueType::i32 && t != IR::ValueType::i64 &&
+            t != IR::ValueType::f32 && t != IR::ValueType::f64) {
+            return false;
+        }
+    }
+
+    CallSiteVisitor visitor;
+    decodeFunction(calleeDef, visitor);
+    return !visitor.hasTailCalls;
+}
+
+/**
+ * Picks the hottest direct call sites whose callees can be inlined, up to a
+ * limit on how much code is added. Counts from a different build of the
+ * function are ignored where the call they refer to no longer matches.
+ */
+PgoPlan planInlining(const IR::Module& module, const PgoProfile& profile)
+{
+    PgoPlan plan;
+    plan.mode = PgoMode::optimise;
+
+    Uptr nImports = module.functions.imports.size();
+
+    std::vector<std::vector<Uptr>> callSites(module.functions.defs.size());
+    for (Uptr d = 0; d < module.functions.defs.size(); d++) {
+        CallSiteVisitor visitor;
+        decodeFunction(module.functions.defs[d], visitor);
+        callSites[d] = visitor.callees;
+    }
+
+    std::vector<std::pair<PgoCallSite, PgoEdge>> candidates;
+    for (auto& e : profile.edgeCounts) {
+        Uptr caller = e.first.first;
+        Uptr site = e.first.second;
+        const PgoEdge& edge = e.second;
+
+        if (edge.count < PGO_INLINE_MIN_CALLS ||
+            caller >= callSites.size() || site >= callSites[caller].size() ||
+            callSites[caller][site] != edge.callee || edge.callee < nImports) {
+            continue;
+        }
+
+        if (!canInline(module, caller, edge.callee - nImports)) {
+            continue;
+        }
+
+        candidates.emplace_back(e);
+    }
+
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const std::pair<PgoCallSite, PgoEdge>& a,
+                 const std::pair<PgoCallSite, PgoEdge>& b) {
+                  return a.second.count > b.second.count;
+              });
+
+    size_t growth = 0;
+    for (auto& c : candidates) {
+        Uptr callee = c.second.callee - nImports;
+        size_t calleeSize = module.functions.defs[callee].code.size();
+        if (growth + calleeSize > PGO_INLINE_MAX_GROWTH_BYTES) {
+            continue;
+        }
+
+        growth += calleeSize;
+        plan.inlinedSites.insert(c.first);
+    }
+
+    return plan;
+}
+
+/**
+ * Inlines the given call sites. Callees are always inlined as they were
+ * before any inlining, so the result only depends on the sites.
+ */
+void inlineCallSites(IR::Module& module, const std::set<PgoCallSite>& sites)
+{
+    if (sites.empty()) {
+        return;
+    }
+
+    const std::vector<IR::FunctionDef> originalDefs = module.functions.defs;
+
+    std::set<Uptr> callers;
+    for (auto& s : sites) {
+        callers.insert(s.first);
+    }
+
+    for (Uptr caller : callers) {
+        if (caller >= module.functions.defs.size()) {
+            throw std::runtime_error("Inlining into missing function");
+        }
+
+        IR::FunctionDef& callerDef = module.functions.defs[caller];
+
+        Serialization::ArrayOutputStream stream;
+        IR::OperatorEncoderStream encoder(stream);
+
+        InliningVisitor visitor(
+          encoder, module, originalDefs, callerDef, caller, sites);
+        decodeFunction(originalDefs[caller], visitor);
+
+        callerDef.code = stream.getBytes();
+    }
+}
+
+void applyPgoPlan(IR::Module& module, const PgoPlan& plan)
+{
+    switch (plan.mode) {
+        case PgoMode::instrument:
+            instrumentModule(module);
+            break;
+        case PgoMode::optimise:
+            inlineCallSites(module, plan.inlinedSites);
+            break;
+        default:
+            break;
+    }
+
+    if (plan.metered) {
+        meterModule(module);
+    }
+}
+
+// ------------------------------------
+// Object file trailers
+// ------------------------------------
+
+/**
+ * Records the plan at the end of the object file, so that the object and the
+ * plan it was built with are always replaced together.
+ */
+void appendPgoPlan(std::vector<uint8_t>& objectBytes, const PgoPlan& plan)
+{
+    if (plan.mode == PgoMode::none && !plan.metered) {
+        return;
+    }
+
+    std::string planStr = plan.toString();
+    uint64_t planSize = planStr.size();
+
+    objectBytes.insert(objectBytes.end(), planStr.begin(), planStr.end());
+
+    auto* sizeBytes = reinterpret_cast<const uint8_t*>(&planSize);
+    objectBytes.insert(
+      objectBytes.end(), sizeBytes, sizeBytes + sizeof(planSize));
+
+    const char* magic = PGO_TRAILER_MAGIC;
+    objectBytes.insert(objectBytes.end(), magic, magic + strlen(magic));
+}
+
+/**
+ * Removes the plan from the end of an object file, if there is one.
+ */
+PgoPlan extractPgoPlan(std::vector<uint8_t>& objectBytes)
+{
+    size_t magicLen = strlen(PGO_TRAILER_MAGIC);
+    size_t trailerLen = magicLen + sizeof(uint64_t);
+    if (objectBytes.size() < trailerLen ||
+        memcmp(objectBytes.data() + objectBytes.size() - magicLen,
+               PGO_TRAILER_MAGIC,
+               magicLen) != 0) {
+        return PgoPlan();
+    }
+
+    uint64_t planSize;
+    memcpy(&planSize,
+           objectBytes.data() + objectBytes.size() - trailerLen,
+           sizeof(planSize));
+    if (planSize > objectBytes.size() - trailerLen) {
+        throw std::runtime_error("Invalid profile-guided plan in object file");
+    }
+
+    size_t planStart = objectBytes.size() - trailerLen - planSize;
+    std::string planStr(objectBytes.begin() + planStart,
+                        objectBytes.begin() + planStart + planSize);
+    objectBytes.resize(planStart);
+
+    return PgoPlan::fromString(planStr);
+}
+
+// ------------------------------------
+// Persisted profiles
+// ------------------------------------
+
+std::string getPgoProfilePath(const faabric::Message& msg)
+{
+    return faabric::util::getFunctionObjectFile(msg) + PGO_PROFILE_EXT;
+}
+
+PgoProfileStore& getPgoProfileStore()
+{
+    static PgoProfileStore store;
+    return store;
+}
+
+/**
+ * Must be called with the lock held. Counts already on disk, e.g. from
+ * another run, are included.
+ */
+PgoProfile& PgoProfileStore::loadProfile(const faabric::Message& msg)
+{
+    std::string funcStr = faabric::util::funcToString(msg, false);
+    auto it = profiles.find(funcStr);
+    if (it != profiles.end()) {
+        return it->second;
+    }
+
+    PgoProfile& profile = profiles[funcStr];
+
+    std::string path = getPgoProfilePath(msg);
+    if (boost::filesystem::exists(path)) {
+        profile = PgoProfile::fromString(faabric::util::readFileToString(path));
+    }
+
+    return profile;
+}
+
+/**
+ * Adds the counts from a call, and rewrites the persisted profile. The file
+ * is replaced with a rename so readers never see it partially written.
+ */
+void PgoProfileStore::record(const faabric::Message& msg,
+                             const PgoProfile& counts)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    PgoProfile& profile = loadProfile(msg);
+    profile.add(counts);
+
+    std::string path = getPgoProfilePath(msg);
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+    std::string profileStr = profile.toString();
+    faabric::util::writeBytesToFile(
+      tmpPath, std::vector<uint8_t>(profileStr.begin(), profileStr.end()));
+    boost::filesystem::rename(tmpPath, path);
+}
+
+PgoProfile PgoProfileStore::getProfile(const faabric::Message& msg)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    return loadProfile(msg);
+}
+
+/**
+ * Discards a function's counts, e.g. when it's instrumented afresh.
+ */
+void PgoProfileStore::reset(const faabric::Message& msg)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    profiles.erase(faabric::util::funcToString(msg, false));
+    boost::filesystem::remove(getPgoProfilePath(msg));
+}
+
+void PgoProfileStore::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    profiles.clear();
+}
+}
@@ -0,0 +1,71 @@
+#include "ArtefactVersions.h"
+#include "WasmModuleCache.h"
+
+#include <ir_cache/IRModuleCache.h>
+#include <storage/FileLoader.h>
+#include <storage/FunctionVersions.h>
+#include <wasm/ResultCache.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+namespace module_cache {
+ArtefactVersions& getArtefactVersions()
+{
+    static ArtefactVersions v;
+    return v;
+}
+
+/**
+ * Evicts anything cached for the given function if it's older than the latest
+ * version, and returns that version.
+ */
+long ArtefactVersions::refresh(const faabric::Message& msg)
+{
+    long version = storage::getFunctionVersions().getVersion(msg);
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    std::scoped_lock<std::mutex> guard(mx);
+    auto it = cachedVersions.find(funcStr);
+    if (it == cachedVersions.end()) {
+        // Nothing has been checked for this function yet, so whatever gets
+        // cached will be this version
+        cachedVersions[funcStr] = version;
+        return version;
+    }
+
+    if (it->second >= version) {
+        return it->second;
+    }
+
+    faabric::util::getLogger()->info(
+      "Evicting {} version {} for version {}", funcStr, it->second, version);
+
+    getWasmModuleCache().evictFunction(msg);
+    wasm::getIRModuleCache().evictFunction(msg.user(), msg.function());
+    storage::getFileLoader().flushFunctionFiles(msg);
+    wasm::getResultCache().clearFunction(msg);
+
+    it->second = version;
+    return version;
+}
+
+long ArtefactVersions::getCachedVersion(const faabric::Message& msg)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    std::scoped_lock<std::mutex> guard(mx);
+    auto it = cachedVersions.find(funcStr);
+    if (it == cachedVersions.end()) {
+        return -1;
+    }
+
+    return it->second;
+}
+
+void ArtefactVersions::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    cachedVersions.clear();
+}
+}
@@ -0,0 +1,330 @@
+#include "ChainPrewarmer.h"
+#include "ArtefactVersions.h"
+#include "WasmModuleCache.h"
+
+#include <conf/FaasmConfig.h>
+#include <wasm/CallGraph.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+namespace module_cache {
+ChainPrewarmer& getChainPrewarmer()
+{
+    static ChainPrewarmer p;
+    return p;
+}
+
+ChainPrewarmer::ChainPrewarmer()
+{
+    // Make sure the module cache outlives the background thread
+    getWasmModuleCache();
+}
+
+ChainPrewarmer::~ChainPrewarmer()
+{
+    {
+        faabric::util::UniqueLock lock(mx);
+        running = false;
+        queue.clear();
+    }
+
+    cv.notify_all();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+/**
+ * Queues up prewarming of any functions likely to be chained by this call.
+ * This returns immediately, the prewarming itself happens in the background.
+ */
+void ChainPrewarmer::prewarmChildren(const faabric::Message& msg)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    if (faasmConf.chainPrewarm != "on") {
+        return;
+    }
+
+    std::vector<std::string> children = wasm::getCallGraph().getLikelyChildren(
+      msg, faasmConf.chainPrewarmThreshold);
+    if (children.empty()) {
+        return;
+    }
+
+    WasmModuleCache& cache = getWasmModuleCache();
+    size_t budgetBytes = (size_t)faasmConf.chainPrewarmMemoryMb * 1024 * 1024;
+
+    faabric::util::UniqueLock lock(mx);
+    for (const auto& child : children) {
+        faabric::Message childMsg =
+          faabric::util::messageFactory(msg.user(), child);
+        const std::string key = faabric::util::funcToString(childMsg, false);
+
+        // Skip if already being prewarmed, but note it's been predicted again
+        auto it = prewarms.find(key);
+        if (it != prewarms.end()) {
+            lru.splice(lru.begin(), lru, it->second.lruIt);
+            continue;
+        }
+
+        // Skip if already warm
+        if (cache.isModuleCached(childMsg)) {
+            continue;
+        }
+
+        size_t bytes = estimateBytes(key, budgetBytes);
+        if (budgetBytes == 0 || !makeRoom(bytes, budgetBytes)) {
+            faabric::util::getLogger()->debug(
+              "Not prewarming {}, over budget ({} bytes reserved)",
+              key,
+              reservedBytes);
+            skippedCount++;
+            continue;
+        }
+
+        lru.push_front(key);
+        Prewarm& prewarm = prewarms[key];
+        prewarm.msg = childMsg;
+        prewarm.bytes = bytes;
+        prewarm.lruIt = lru.begin();
+        reservedBytes += bytes;
+
+        queue.emplace_back(childMsg);
+    }
+
+    if (queue.empty()) {
+        return;
+    }
+
+    if (!running) {
+        running = true;
+        worker = std::thread(&ChainPrewarmer::workerLoop, this);
+    }
+
+    cv.notify_one();
+}
+
+void ChainPrewarmer::workerLoop()
+{
+    while (true) {
+        faabric::Message msg;
+        {
+            faabric::util::UniqueLock lock(mx);
+            cv.wait(lock, [this] { return !running || !queue.empty(); });
+
+            if (!running) {
+                return;
+            }
+
+            msg = queue.front();
+            queue.pop_front();
+            inFlight++;
+        }
+
+        doPrewarm(msg);
+
+        {
+            faabric::util::UniqueLock lock(mx);
+            inFlight--;
+        }
+
+        cv.notify_all();
+    }
+}
+
+void ChainPrewarmer::doPrewarm(const faabric::Message& msg)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+    const std::string key = faabric::util::funcToString(msg, false);
+
+    logger->debug("Prewarming chained function {}", key);
+
+    size_t memBytes = 0;
+    try {
+        // Record the version being cached, evicting anything older
+        getArtefactVersions().refresh(msg);
+
+        std::shared_ptr<wasm::WAVMWasmModule> module =
+          getWasmModuleCache().getCachedModule(msg);
+        memBytes = WAVM::Runtime::getMemoryNumPages(module->defaultMemory) *
+                   WASM_BYTES_PER_PAGE;
+    } catch (std::exception& e) {
+        logger->warn("Failed to prewarm {}: {}", key, e.what());
+
+        faabric::util::UniqueLock lock(mx);
+        removePrewarm(key);
+        return;
+    }
+
+    prewarmCount++;
+
+    // Swap the reservation for the real size. If a real call for this
+    // function bound in the meantime, the zygote was not speculative, so it
+    // no longer counts towards the budget.
+    faabric::util::UniqueLock lock(mx);
+    knownBytes[key] = memBytes;
+
+    auto it = prewarms.find(key);
+    if (it != prewarms.end()) {
+        reservedBytes = reservedBytes - it->second.bytes + memBytes;
+        it->second.bytes = memBytes;
+        it->second.ready = true;
+    }
+}
+
+/**
+ * Estimates the size of a function's zygote from the last time it was
+ * created, or from other zygotes if it's never been seen. With nothing to go
+ * on the whole budget is reserved, so only one unknown function is prewarmed
+ * at a time. Must be called with the lock held.
+ */
+size_t ChainPrewarmer::estimateBytes(const std::string& key,
+                                     size_t budgetBytes)
+{
+    auto it = knownBytes.find(key);
+    if (it != knownBytes.end()) {
+        return it->second;
+    }
+
+    if (knownBytes.empty()) {
+        return budgetBytes;
+    }
+
+    size_t totalBytes = 0;
+    for (const auto& p : knownBytes) {
+        totalBytes += p.second;
+    }
+
+    return totalBytes / knownBytes.size();
+}
+
+/**
+ * Evicts unused prewarmed zygotes, least recently predicted first, until the
+ * given number of bytes fits in the budget. Zygotes still queued or being
+ * created are left alone. Must be called with the lock held.
+ */
+bool ChainPrewarmer::makeRoom(size_t bytes, size_t budgetBytes)
+{
+    auto it = lru.end();
+    while (reservedBytes + bytes > budgetBytes && it != lru.begin()) {
+        it--;
+
+        Prewarm& prewarm = prewarms.at(*it);
+        if (!prewarm.ready) {
+            continue;
+        }
+
+        faabric::util::getLogger()->debug(
+          "Evicting unused prewarmed zygote {}", *it);
+        getWasmModuleCache().evictFunction(prewarm.msg);
+        evictedCount++;
+
+        const std::string key = *it;
+        it++;
+        removePrewarm(key);
+    }
+
+    return reservedBytes + bytes <= budgetBytes;
+}
+
+/**
+ * Must be called with the lock held.
+ */
+void ChainPrewarmer::removePrewarm(const std::string& key)
+{
+    auto it = prewarms.find(key);
+    if (it == prewarms.end()) {
+        return;
+    }
+
+    reservedBytes -= it->second.bytes;
+    lru.erase(it->second.lruIt);
+    prewarms.erase(it);
+}
+
+/**
+ * Records a function binding on this host, checking whether its zygote was
+ * created by the prewarmer (a hit) or will have to be created now (a miss).
+ * Must be called before the module cache is used for the bind.
+ */
+void ChainPrewarmer::recordBind(const faabric::Message& msg)
+{
+    if (conf::getFaasmConfig().chainPrewarm != "on") {
+        return;
+    }
+
+    const std::string key = faabric::util::funcToString(msg, false);
+
+    faabric::util::UniqueLock lock(mx);
+    auto it = prewarms.find(key);
+    if (it != prewarms.end()) {
+        // Only a hit if the prewarm finished before we needed it
+        if (it->second.ready) {
+            hitCount++;
+        } else {
+            missCount++;
+        }
+
+        removePrewarm(key);
+    } else if (!getWasmModuleCache().isModuleCached(msg)) {
+        missCount++;
+    }
+}
+
+void ChainPrewarmer::waitForPrewarms()
+{
+    faabric::util::UniqueLock lock(mx);
+    cv.wait(lock, [this] { return queue.empty() && inFlight == 0; });
+}
+
+void ChainPrewarmer::clear()
+{
+    waitForPrewarms();
+
+    faabric::util::UniqueLock lock(mx);
+    prewarms.clear();
+    lru.clear();
+    reservedBytes = 0;
+    knownBytes.clear();
+
+    prewarmCount = 0;
+    hitCount = 0;
+    missCount = 0;
+    skippedCount = 0;
+    evictedCount = 0;
+}
+
+long ChainPrewarmer::getPrewarmCount()
+{
+    return prewarmCount;
+}
+
+long ChainPrewarmer::getHitCount()
+{
+    return hitCount;
+}
+
+long ChainPrewarmer::getMissCount()
+{
+    return missCount;
+}
+
+long ChainPrewarmer::getSkippedCount()
+{
+    return skippedCount;
+}
+
+long ChainPrewarmer::getEvictedCount()
+{
+    return evictedCount;
+}
+
+size_t ChainPrewarmer::getPrewarmedBytes()
+{
+    faabric::util::UniqueLock lock(mx);
+    return reservedBytes;
+}
+}
@@ -1,5 +1,8 @@
 #include "WasmModuleCache.h"
 
+#include <conf/FaasmConfig.h>
+#include <system/Numa.h>
+
 #include <faabric/util/config.h>
 #include <faabric/util/func.h>
 #include <faabric/util/locks.h>
@@ -14,6 +17,7 @@ WasmModuleCache& getWasmModuleCache()
 
 size_t WasmModuleCache::getTotalCachedModuleCount()
 {
+    faabric::util::SharedLock lock(mx);
     return cachedModuleMap.size();
 }
 
@@ -24,6 +28,11 @@ int WasmModuleCache::getCachedModuleCount(const std::string& key)
     return count;
 }
 
+bool WasmModuleCache::isModuleCached(const faabric::Message& msg)
+{
+    return getCachedModuleCount(getCachedModuleKey(msg)) > 0;
+}
+
 std::string WasmModuleCache::getBaseCachedModuleKey(const faabric::Message& msg)
 {
     std::string key = msg.user() + "/" + msg.function();
@@ -45,62 +54,224 @@ std::string WasmModuleCache::getCachedModuleKey(const faabric::Message& msg)
  * default module with its zygote function executed, (same for all instances),
  * or one of many "special" cached modules, those restored from snapshots
  * captured at arbitrary points (e.g. when spawning a thread).
+ *
+ * Modules are handed out as shared pointers, so a module evicted while
+ * callers are still copying from it lives until they're done with it.
  */
-wasm::WAVMWasmModule& WasmModuleCache::getCachedModule(
+std::shared_ptr<wasm::WAVMWasmModule> WasmModuleCache::getCachedModule(
   const faabric::Message& msg)
 {
-    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
-
     // Get the keys for both types of cached module
     const std::string baseKey = getBaseCachedModuleKey(msg);
     const std::string specialKey = getCachedModuleKey(msg);
 
-    // Check for the base cached module
-    if (getCachedModuleCount(baseKey) == 0) {
+    std::shared_ptr<wasm::WAVMWasmModule> module = findModule(specialKey);
+    if (module == nullptr) {
         faabric::util::FullLock lock(mx);
-        if (cachedModuleMap.count(baseKey) == 0) {
-            // Instantiate the base module
-            logger->debug("Creating new base zygote: {}", baseKey);
-            wasm::WAVMWasmModule& module = cachedModuleMap[baseKey];
-            module.bindToFunction(msg);
-
-            // Write memory to fd (to allow copy-on-write cloning)
-            int fd = memfd_create(baseKey.c_str(), 0);
-            module.writeMemoryToFd(fd);
+        module = doFindModule(specialKey);
+        if (module == nullptr && specialKey == baseKey) {
+            module = doCreateBaseModule(msg, baseKey);
+        } else if (module == nullptr) {
+            module = doCreateSpecialModule(msg, baseKey, specialKey);
         }
     }
 
-    // Stop now if we're just looking for the base cached module
-    if (specialKey == baseKey) {
-        return cachedModuleMap[baseKey];
+    return getNodeLocalModule(specialKey, module);
+}
+
+/**
+ * Must be called with the full lock held.
+ */
+std::shared_ptr<wasm::WAVMWasmModule> WasmModuleCache::doCreateBaseModule(
+  const faabric::Message& msg,
+  const std::string& baseKey)
+{
+    // Instantiate the base module
+    faabric::util::getLogger()->debug("Creating new base zygote: {}", baseKey);
+    auto module = std::make_shared<wasm::WAVMWasmModule>();
+    module->bindToFunction(msg);
+
+    // Write memory to fd (to allow copy-on-write cloning)
+    int fd = memfd_create(baseKey.c_str(), 0);
+    module->writeMemoryToFd(fd);
+
+    cachedModuleMap[baseKey] = module;
+    recordHomeNode(baseKey);
+
+    return module;
+}
+
+/**
+ * Must be called with the full lock held.
+ */
+std::shared_ptr<wasm::WAVMWasmModule> WasmModuleCache::doCreateSpecialModule(
+  const faabric::Message& msg,
+  const std::string& baseKey,
+  const std::string& specialKey)
+{
+    std::shared_ptr<wasm::WAVMWasmModule> baseModule = doFindModule(baseKey);
+    if (baseModule == nullptr) {
+        baseModule = doCreateBaseModule(msg, baseKey);
     }
 
-    // See if we already have the special cached module
-    if (getCachedModuleCount(specialKey) == 0) {
-        faabric::util::FullLock lock(mx);
-        if (cachedModuleMap.count(specialKey) == 0) {
-            // Get the base module and the special module
-            logger->debug("Creating new special zygote: {}", specialKey);
-            wasm::WAVMWasmModule& baseModule = cachedModuleMap[baseKey];
-            wasm::WAVMWasmModule& specialModule = cachedModuleMap[specialKey];
+    // Clone the special module from the base one
+    faabric::util::getLogger()->debug("Creating new special zygote: {}",
+                                      specialKey);
+    auto specialModule = std::make_shared<wasm::WAVMWasmModule>(*baseModule);
+
+    // Restore the special module
+    specialModule->restoreFromState(specialKey, msg.snapshotsize());
+
+    // Write memory to fd
+    int fd = memfd_create(specialKey.c_str(), 0);
+    specialModule->writeMemoryToFd(fd);
+
+    cachedModuleMap[specialKey] = specialModule;
+    derivedKeys[baseKey].emplace_back(specialKey);
+    recordHomeNode(specialKey);
+
+    return specialModule;
+}
+
+static bool isReplicatingZygotes()
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    return faasmConf.numaMode != "off" &&
+           faasmConf.numaZygoteReplicas == "on" &&
+           isolation::getNumaTopology().isNuma();
+}
+
+/**
+ * Must be called with the full lock held.
+ */
+void WasmModuleCache::recordHomeNode(const std::string& key)
+{
+    if (isReplicatingZygotes()) {
+        homeNodes[key] = isolation::getNumaTopology().getCurrentNode();
+    }
+}
+
+/**
+ * Returns a copy of the given zygote whose memory lives on the caller's NUMA
+ * node. Faaslets are pinned to nodes, so clones from the local copy avoid
+ * their copy-on-write reads crossing the interconnect. Copies are only made
+ * for nodes that actually use the zygote.
+ */
+std::shared_ptr<wasm::WAVMWasmModule> WasmModuleCache::getNodeLocalModule(
+  const std::string& key,
+  std::shared_ptr<wasm::WAVMWasmModule> module)
+{
+    if (!isReplicatingZygotes()) {
+        return module;
+    }
+
+    int node = isolation::getNumaTopology().getCurrentNode();
+    std::string replicaKey = key + "#node" + std::to_string(node);
+    {
+        faabric::util::SharedLock lock(mx);
+        auto it = homeNodes.find(key);
+        if (it == homeNodes.end() || it->second == node) {
+            return module;
+        }
+
+        std::shared_ptr<wasm::WAVMWasmModule> replica =
+          doFindModule(replicaKey);
+        if (replica != nullptr) {
+            return replica;
+        }
+    }
+
+    // Copying the zygote's memory takes a while, so the replica is built
+    // without the lock. This thread is on the target node, so the replica's
+    // pages will be allocated there as they're written.
+    faabric::util::getLogger()->debug(
+      "Creating node {} replica of zygote {}", node, key);
+
+    auto replica = std::make_shared<wasm::WAVMWasmModule>(*module);
+    int fd = memfd_create(replicaKey.c_str(), 0);
+    replica->writeMemoryToFd(fd);
+
+    faabric::util::FullLock lock(mx);
 
-            // Clone the special module from the base one
-            specialModule = baseModule;
+    // Another thread on this node may have got there first
+    std::shared_ptr<wasm::WAVMWasmModule> existing = doFindModule(replicaKey);
+    if (existing != nullptr) {
+        return existing;
+    }
+
+    // Only keep the replica if the original is still the cached one, i.e.
+    // hasn't been evicted or replaced meanwhile
+    if (doFindModule(key) == module) {
+        cachedModuleMap[replicaKey] = replica;
+        homeNodes[replicaKey] = node;
+        derivedKeys[key].emplace_back(replicaKey);
+    }
+
+    return replica;
+}
+
+std::shared_ptr<wasm::WAVMWasmModule> WasmModuleCache::findModule(
+  const std::string& key)
+{
+    faabric::util::SharedLock lock(mx);
+    return doFindModule(key);
+}
 
-            // Restore the special module
-            specialModule.restoreFromState(specialKey, msg.snapshotsize());
+/**
+ * Must be called with the lock held. Lookups never insert, so they're safe
+ * under the shared lock.
+ */
+std::shared_ptr<wasm::WAVMWasmModule> WasmModuleCache::doFindModule(
+  const std::string& key)
+{
+    auto it = cachedModuleMap.find(key);
+    if (it == cachedModuleMap.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+/**
+ * Removes the zygotes for the given function, along with any special zygotes
+ * and replicas made from them. Anyone still holding one of them keeps it
+ * until they let go.
+ */
+void WasmModuleCache::evictFunction(const faabric::Message& msg)
+{
+    const std::string baseKey = getBaseCachedModuleKey(msg);
+
+    faabric::util::FullLock lock(mx);
+    if (cachedModuleMap.count(baseKey) > 0) {
+        faabric::util::getLogger()->debug("Evicting zygotes for {}", baseKey);
+        evictKey(baseKey);
+    }
+}
+
+/**
+ * Must be called with the full lock held.
+ */
+void WasmModuleCache::evictKey(const std::string& key)
+{
+    auto it = derivedKeys.find(key);
+    if (it != derivedKeys.end()) {
+        std::vector<std::string> derived = it->second;
+        derivedKeys.erase(it);
 
-            // Write memory to fd
-            int fd = memfd_create(specialKey.c_str(), 0);
-            specialModule.writeMemoryToFd(fd);
+        for (const auto& derivedKey : derived) {
+            evictKey(derivedKey);
         }
     }
 
-    return cachedModuleMap[specialKey];
+    cachedModuleMap.erase(key);
+    homeNodes.erase(key);
 }
 
 void WasmModuleCache::clear()
 {
+    faabric::util::FullLock lock(mx);
     cachedModuleMap.clear();
+    homeNodes.clear();
+    derivedKeys.clear();
 }
 }
@@ -0,0 +1,133 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/AdmissionController.h>
+#include <faaslet/FaasletPool.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <thread>
+
+#define HEAVY_FIB_NUM "32"
+#define LIGHT_INTERVAL_MS 20
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    double mean = total / latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-16s mean=%8.3fms  p50=%8.3fms  p99=%8.3fms\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99);
+}
+
+/**
+ * Measures the latency of a light function while a burst of a heavy function
+ * is running, with and without admission control. Without it, the heavy calls
+ * compete with the light ones for every core. With it, the heavy function is
+ * limited to half the cores and the light function is given priority.
+ *
+ * With admission control, the heavy function only binds as many Faaslets as
+ * its limit, and its other calls queue in the scheduler, so the rest of the
+ * pool is left free for the light function.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int nLight = 200;
+    if (argc > 1) {
+        nLight = std::stoi(argv[1]);
+    }
+
+    int nCores = (int)std::thread::hardware_concurrency();
+    int nHeavy = 2 * nCores;
+    int nThreads = nHeavy + 2;
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    conf.boundTimeout = 60000;
+    conf.unboundTimeout = 60000;
+    conf.globalMessageTimeout = 120000;
+    conf.maxNodes = nThreads;
+    conf.maxNodesPerFunction = nHeavy;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    faaslet::FaasletPool pool(nThreads);
+    pool.startThreadPool();
+
+    faaslet::AdmissionController& admission = faaslet::getAdmissionController();
+
+    for (bool limited : { false, true }) {
+        if (limited) {
+            faasmConf.admissionMaxConcurrency = nCores;
+            faasmConf.admissionFunctionLimits =
+              "demo/fibonacci=" + std::to_string(std::max(1, nCores / 2));
+            faasmConf.admissionPriorities = "demo/echo=10";
+        } else {
+            faasmConf.admissionMaxConcurrency = 0;
+            faasmConf.admissionFunctionLimits = "";
+            faasmConf.admissionPriorities = "";
+        }
+        admission.clear();
+
+        // Start the burst of heavy calls
+        std::vector<unsigned int> heavyIds;
+        for (int i = 0; i < nHeavy; i++) {
+            faabric::Message call =
+              faabric::util::messageFactory("demo", "fibonacci");
+            call.set_inputdata(HEAVY_FIB_NUM);
+            sch.callFunction(call);
+            heavyIds.push_back(call.id());
+        }
+
+        // Measure light calls while the burst runs
+        std::vector<double> latencies;
+        for (int i = 0; i < nLight; i++) {
+            faabric::Message call =
+              faabric::util::messageFactory("demo", "echo");
+            call.set_inputdata("ping");
+
+            auto start = std::chrono::steady_clock::now();
+            sch.callFunction(call);
+            sch.getFunctionResult(call.id(), conf.globalMessageTimeout);
+            auto end = std::chrono::steady_clock::now();
+
+            latencies.push_back(
+              std::chrono::duration<double, std::milli>(end - start).count());
+
+            std::this_thread::sleep_for(
+              std::chrono::milliseconds(LIGHT_INTERVAL_MS));
+        }
+
+        for (unsigned int id : heavyIds) {
+            sch.getFunctionResult(id, conf.globalMessageTimeout);
+        }
+
+        printLatencies(limited ? "admission=on" : "admission=off", latencies);
+        printf("%-16s admitted=%li  queued=%li  rejected=%li\n",
+               "",
+               admission.getAdmittedCount(),
+               admission.getQueuedCount(),
+               admission.getRejectedCount());
+    }
+
+    faasmConf.reset();
+
+    pool.shutdown();
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/FaasletPool.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <chrono>
+
+/**
+ * Submits a burst of calls to a trivial function and waits for them all to
+ * finish, returning the throughput in calls/sec.
+ */
+double runBurst(int nCalls)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    std::vector<unsigned int> callIds;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message call = faabric::util::messageFactory("demo", "noop");
+        sch.callFunction(call);
+        callIds.emplace_back(call.id());
+    }
+
+    for (auto callId : callIds) {
+        const faabric::Message result =
+          sch.getFunctionResult(callId, conf.globalMessageTimeout);
+
+        if (result.returnvalue() != 0) {
+            faabric::util::getLogger()->error("Noop call failed: {}",
+                                              result.outputdata());
+            throw std::runtime_error("Noop call failed");
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(end - start).count();
+    return nCalls / secs;
+}
+
+/**
+ * Measures the throughput of a trivial function with different micro-batch
+ * sizes, with and without the function being declared stateless.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int nCalls = 5000;
+    if (argc > 1) {
+        nCalls = std::stoi(argv[1]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    conf.boundTimeout = 60000;
+    conf.unboundTimeout = 60000;
+    conf.globalMessageTimeout = 60000;
+
+    int nThreads = 4;
+    conf.maxNodes = nThreads;
+    conf.maxNodesPerFunction = nThreads;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    faaslet::FaasletPool pool(nThreads);
+    pool.startThreadPool();
+
+    const int originalBatchSize = faasmConf.microBatchSize;
+    const std::string originalStateless = faasmConf.statelessFunctions;
+
+    // Warm up
+    runBurst(nThreads);
+
+    for (int batchSize : { 1, 4, 16, 64 }) {
+        for (const std::string stateless : { "", "demo/noop" }) {
+            // Stateless functions only skip resets within a batch
+            if (batchSize == 1 && !stateless.empty()) {
+                continue;
+            }
+
+            faasmConf.microBatchSize = batchSize;
+            faasmConf.statelessFunctions = stateless;
+
+            double callsPerSec = runBurst(nCalls);
+            printf("batch=%-3i stateless=%-3s %10.1f calls/sec\n",
+                   batchSize,
+                   stateless.empty() ? "no" : "yes",
+                   callsPerSec);
+        }
+    }
+
+    faasmConf.microBatchSize = originalBatchSize;
+    faasmConf.statelessFunctions = originalStateless;
+
+    pool.shutdown();
+
+    return 0;
+}
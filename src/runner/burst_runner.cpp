@@ -0,0 +1,142 @@
+#include <faaslet/FaasletPool.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#define N_BURSTS 5
+#define BURST_SIZE 40
+#define IDLE_GAP_MS 2000
+#define KEEP_ALIVE_MS 500
+#define FIB_INPUT "22"
+
+long getResidentMemoryMb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream ss(line);
+        std::string key;
+        long valueKb;
+        ss >> key >> valueKb;
+
+        if (key == "VmRSS:") {
+            return valueKb / 1024;
+        }
+    }
+
+    return 0;
+}
+
+std::vector<double> runBurst()
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    std::vector<unsigned int> callIds;
+    std::vector<std::chrono::steady_clock::time_point> starts;
+    for (int i = 0; i < BURST_SIZE; i++) {
+        faabric::Message call =
+          faabric::util::messageFactory("demo", "fibonacci");
+        call.set_inputdata(FIB_INPUT);
+
+        starts.emplace_back(std::chrono::steady_clock::now());
+        sch.callFunction(call);
+        callIds.emplace_back(call.id());
+    }
+
+    // Note that results are collected in order, so a latency includes any
+    // time spent waiting on earlier results
+    std::vector<double> latencies;
+    for (int i = 0; i < BURST_SIZE; i++) {
+        const faabric::Message result =
+          sch.getFunctionResult(callIds.at(i), conf.globalMessageTimeout);
+        auto end = std::chrono::steady_clock::now();
+
+        if (result.returnvalue() != 0) {
+            throw std::runtime_error("Burst call failed");
+        }
+
+        latencies.emplace_back(
+          std::chrono::duration<double, std::milli>(end - starts.at(i))
+            .count());
+    }
+
+    return latencies;
+}
+
+void runPool(int minSize, int maxSize)
+{
+    faaslet::FaasletPool pool(minSize, maxSize);
+    pool.startThreadPool();
+
+    std::vector<double> latencies;
+    long peakRssMb = 0;
+    long idleRssMb = 0;
+
+    for (int b = 0; b < N_BURSTS; b++) {
+        std::vector<double> burstLatencies = runBurst();
+        latencies.insert(
+          latencies.end(), burstLatencies.begin(), burstLatencies.end());
+        peakRssMb = std::max(peakRssMb, getResidentMemoryMb());
+
+        // Idle for longer than the keep-alive
+        std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_GAP_MS));
+        idleRssMb = getResidentMemoryMb();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    faaslet::PoolController& controller = pool.getController();
+    printf("pool=%i-%-3i p50=%8.3fms  p99=%8.3fms  peak_faaslets=%-3i "
+           "peak_rss=%5liMB  idle_rss=%5liMB\n",
+           minSize,
+           maxSize,
+           p50,
+           p99,
+           controller.getPeakCount(),
+           peakRssMb,
+           idleRssMb);
+
+    pool.shutdown();
+}
+
+/**
+ * Compares a fixed-size Faaslet pool with an adaptive one under bursty load,
+ * measuring call latency and resident memory.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int maxSize = 8;
+    if (argc > 1) {
+        maxSize = std::stoi(argv[1]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.boundTimeout = KEEP_ALIVE_MS;
+    conf.unboundTimeout = KEEP_ALIVE_MS;
+    conf.globalMessageTimeout = 60000;
+    conf.maxNodes = maxSize;
+    conf.maxNodesPerFunction = maxSize;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    // Fixed
+    runPool(maxSize, maxSize);
+
+    // Adaptive
+    runPool(1, maxSize);
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/FaasletPool.h>
+#include <wasm/WasmModule.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#define SMALL_PAYLOAD_BYTES 64
+#define LARGE_PAYLOAD_BYTES 10 * ONE_MB_BYTES
+
+double runChainedPayload(int payloadSize)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    faabric::Message call =
+      faabric::util::messageFactory("demo", "chain_payload");
+    call.set_inputdata(std::to_string(payloadSize));
+
+    auto start = std::chrono::steady_clock::now();
+    sch.callFunction(call);
+
+    const faabric::Message result =
+      sch.getFunctionResult(call.id(), conf.globalMessageTimeout);
+    auto end = std::chrono::steady_clock::now();
+
+    if (result.returnvalue() != 0) {
+        faabric::util::getLogger()->error("Chained payload call failed: {}",
+                                          result.outputdata());
+        throw std::runtime_error("Chained payload call failed");
+    }
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) /
+                  latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-24s mean=%8.3fms  p50=%8.3fms  p99=%8.3fms\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99);
+}
+
+/**
+ * Measures the round-trip latency of chained calls with small and large
+ * payloads, with and without the local chaining fast path.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+    const std::shared_ptr<spdlog::logger> logger = faabric::util::getLogger();
+
+    int nRuns = 20;
+    if (argc > 1) {
+        nRuns = std::stoi(argv[1]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    conf.boundTimeout = 60000;
+    conf.unboundTimeout = 60000;
+    conf.globalMessageTimeout = 60000;
+    conf.chainedCallTimeout = 60000;
+
+    int nThreads = 4;
+    conf.maxNodes = nThreads;
+    conf.maxNodesPerFunction = nThreads;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    faaslet::FaasletPool pool(nThreads);
+    pool.startThreadPool();
+
+    const std::string originalFastPath = faasmConf.chainedCallFastPath;
+
+    for (const std::string fastPath : { "off", "on" }) {
+        faasmConf.chainedCallFastPath = fastPath;
+
+        for (int payloadSize : { SMALL_PAYLOAD_BYTES, LARGE_PAYLOAD_BYTES }) {
+            // Warm up
+            runChainedPayload(payloadSize);
+
+            std::vector<double> latencies;
+            for (int i = 0; i < nRuns; i++) {
+                latencies.push_back(runChainedPayload(payloadSize));
+            }
+
+            std::string label = fmt::format(
+              "fast_path={} bytes={}", fastPath, payloadSize);
+            printLatencies(label, latencies);
+        }
+    }
+
+    faasmConf.chainedCallFastPath = originalFastPath;
+
+    pool.shutdown();
+
+    return 0;
+}
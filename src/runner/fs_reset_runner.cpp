@@ -0,0 +1,146 @@
+#include <storage/FileDescriptor.h>
+#include <storage/FileSystem.h>
+#include <storage/SharedFiles.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/files.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include <WAVM/WASI/WASIABI.h>
+#include <boost/filesystem.hpp>
+
+#define FS_RESET_DIR "fs_reset"
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    double mean = total / latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-16s mean=%8.3fus  p50=%8.3fus  p99=%8.3fus  total=%8.1fus\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99,
+           total);
+}
+
+/**
+ * Times resetting a filesystem from a zygote, optionally accessing every
+ * descriptor afterwards, which forces each to be copied as was done on every
+ * reset before descriptors were shared.
+ */
+std::vector<double> timeResets(storage::FileSystem& zygote,
+                               const std::vector<int>& fds,
+                               int nResets,
+                               bool touchAll)
+{
+    std::vector<double> latencies;
+    storage::FileSystem clone;
+
+    for (int i = 0; i < nResets; i++) {
+        auto start = std::chrono::steady_clock::now();
+        clone = zygote;
+        if (touchAll) {
+            for (int fd : fds) {
+                clone.getFileDescriptor(fd);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        latencies.emplace_back(
+          std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    return latencies;
+}
+
+/**
+ * Measures the cost of resetting a module's filesystem from its zygote when
+ * the zygote has many directories open and listed, as is the case for
+ * runtimes like Python. Creates a tree of directories under the runtime root,
+ * opens and lists each in a zygote filesystem, then compares copy-on-write
+ * resets with resets that copy every descriptor.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int nDirs = 200;
+    int nFilesPerDir = 100;
+    int nResets = 1000;
+    if (argc > 1) {
+        nDirs = std::stoi(argv[1]);
+    }
+    if (argc > 2) {
+        nFilesPerDir = std::stoi(argv[2]);
+    }
+    if (argc > 3) {
+        nResets = std::stoi(argv[3]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    boost::filesystem::path rootDir(conf.runtimeFilesDir);
+    rootDir.append(FS_RESET_DIR);
+    boost::filesystem::remove_all(rootDir);
+
+    for (int d = 0; d < nDirs; d++) {
+        boost::filesystem::path dirPath = rootDir;
+        dirPath.append("dir_" + std::to_string(d));
+        boost::filesystem::create_directories(dirPath);
+
+        for (int f = 0; f < nFilesPerDir; f++) {
+            boost::filesystem::path filePath = dirPath;
+            filePath.append("file_" + std::to_string(f) + ".py");
+            faabric::util::writeBytesToFile(filePath.string(), { 0 });
+        }
+    }
+
+    storage::SharedFiles::clear();
+    storage::FileSystem zygote;
+    zygote.prepareFilesystem();
+
+    // Open and list every directory, as an interpreter would on startup
+    std::vector<int> fds;
+    for (int d = 0; d < nDirs; d++) {
+        std::string wasmPath =
+          std::string(FS_RESET_DIR) + "/dir_" + std::to_string(d);
+        int fd = zygote.openFileDescriptor(
+          DEFAULT_ROOT_FD, wasmPath, 0, 0, 0, __WASI_O_DIRECTORY, 0);
+        if (fd < 0) {
+            faabric::util::getLogger()->error("Failed to open {}", wasmPath);
+            throw std::runtime_error("Failed to open directory");
+        }
+
+        storage::FileDescriptor& desc = zygote.getFileDescriptor(fd);
+        while (!desc.iterFinished()) {
+            desc.iterNext();
+        }
+
+        fds.emplace_back(fd);
+    }
+
+    printf("Zygote has %lu fds, %i dirs of %i files\n",
+           zygote.getFileDescriptorCount(),
+           nDirs,
+           nFilesPerDir);
+
+    std::vector<double> cowLatencies =
+      timeResets(zygote, fds, nResets, false);
+    std::vector<double> touchedLatencies =
+      timeResets(zygote, fds, nResets, true);
+
+    printLatencies("copy-on-write", cowLatencies);
+    printLatencies("all-copied", touchedLatencies);
+
+    boost::filesystem::remove_all(rootDir);
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/Faaslet.h>
+#include <system/IsolationManager.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <chrono>
+
+/**
+ * Runs the function on a fresh Faaslet each time, returning the mean time
+ * taken to bind the Faaslet (including joining its isolation).
+ */
+double runFaaslets(const std::string& user,
+                   const std::string& function,
+                   int nRuns)
+{
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    double totalMs = 0;
+    for (int i = 0; i < nRuns; i++) {
+        faaslet::Faaslet w(i % 10);
+
+        faabric::Message call = faabric::util::messageFactory(user, function);
+        sch.callFunction(call);
+
+        // Time the bind, then execute
+        auto start = std::chrono::steady_clock::now();
+        w.processNextMessage();
+        auto end = std::chrono::steady_clock::now();
+        w.processNextMessage();
+
+        sch.getFunctionResult(call.id(), 1000);
+        w.finish();
+
+        totalMs +=
+          std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    return totalMs / nRuns;
+}
+
+/**
+ * Measures Faaslet start time with network namespaces joined eagerly on bind
+ * versus lazily when a socket is opened, with and without pre-created
+ * isolation contexts. Needs to run as root with NETNS_MODE=on (and either the
+ * namespaces set up, or NETNS_CREATE=on) to see the cost of setns.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    std::string user = "demo";
+    std::string function = "noop";
+    int nRuns = 100;
+    if (argc > 2) {
+        user = argv[1];
+        function = argv[2];
+    }
+    if (argc > 3) {
+        nRuns = std::stoi(argv[3]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faabric::scheduler::getScheduler().setTestMode(true);
+    faabric::redis::Redis::getQueue().flushAll();
+
+    if (conf.netNsMode != "on") {
+        printf("NETNS_MODE is off, setns won't be called either way\n");
+    }
+
+    const std::string originalAttach = faasmConf.netnsAttach;
+    isolation::IsolationManager& manager = isolation::getIsolationManager();
+
+    // Warm up
+    runFaaslets(user, function, 1);
+
+    for (const std::string attach : { "eager", "lazy" }) {
+        for (bool prewarm : { false, true }) {
+            faasmConf.netnsAttach = attach;
+            manager.clear();
+            if (prewarm) {
+                manager.prewarm(10);
+            }
+
+            double meanMs = runFaaslets(user, function, nRuns);
+            printf("attach=%-5s prewarm=%-3s bind=%8.3fms  attached=%li\n",
+                   attach.c_str(),
+                   prewarm ? "on" : "off",
+                   meanMs,
+                   isolation::getNetworkAttachCount());
+        }
+    }
+
+    faasmConf.netnsAttach = originalAttach;
+
+    return 0;
+}
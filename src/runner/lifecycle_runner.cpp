@@ -0,0 +1,326 @@
+#include <ir_cache/IRModuleCache.h>
+#include <module_cache/WasmModuleCache.h>
+#include <storage/FileLoader.h>
+#include <wamr/WAMRWasmModule.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+typedef std::map<std::string, std::vector<double>> PhaseLatencies;
+
+// Order in which phases are reported
+const std::vector<std::string> PHASES = { "codegenLoad", "coldBind", "bind",
+                                          "zygote",      "clone",    "execute",
+                                          "reset" };
+
+double microsSince(const std::chrono::steady_clock::time_point& start)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+double percentile(const std::vector<double>& sorted, int pct)
+{
+    size_t idx = (sorted.size() * pct) / 100;
+    return sorted.at(std::min(idx, sorted.size() - 1));
+}
+
+/**
+ * Builds the JSON object describing a single run, with the distribution of
+ * each phase in microseconds.
+ */
+std::string resultToJson(const faabric::Message& msg,
+                         const std::string& vm,
+                         int concurrency,
+                         int nIterations,
+                         PhaseLatencies& latencies)
+{
+    std::stringstream ss;
+    ss << "    {\"user\": \"" << msg.user() << "\", \"function\": \""
+       << msg.function() << "\", \"vm\": \"" << vm
+       << "\", \"concurrency\": " << concurrency
+       << ", \"iterations\": " << nIterations << ", \"phases\": {";
+
+    bool first = true;
+    for (const auto& phase : PHASES) {
+        auto it = latencies.find(phase);
+        if (it == latencies.end() || it->second.empty()) {
+            continue;
+        }
+
+        std::vector<double>& sorted = it->second;
+        std::sort(sorted.begin(), sorted.end());
+        double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+
+        char buf[512];
+        snprintf(buf,
+                 sizeof(buf),
+                 "\"%s\": {\"count\": %lu, \"mean_us\": %.3f, "
+                 "\"min_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, "
+                 "\"p99_us\": %.3f, \"max_us\": %.3f}",
+                 phase.c_str(),
+                 sorted.size(),
+                 total / sorted.size(),
+                 sorted.front(),
+                 percentile(sorted, 50),
+                 percentile(sorted, 90),
+                 percentile(sorted, 99),
+                 sorted.back());
+
+        ss << (first ? "\n      " : ",\n      ") << buf;
+        first = false;
+    }
+
+    ss << "\n    }}";
+    return ss.str();
+}
+
+void checkCall(bool success, const faabric::Message& msg)
+{
+    if (!success || msg.returnvalue() != 0) {
+        faabric::util::getLogger()->error(
+          "Call to {} failed: {}",
+          faabric::util::funcToString(msg, false),
+          msg.outputdata());
+        throw std::runtime_error("Call failed");
+    }
+}
+
+/**
+ * Clones from the zygote, executes, and resets from the zygote, as a Faaslet
+ * does for each call.
+ */
+void runWavmCalls(const faabric::Message& baseMsg,
+                  int nIterations,
+                  PhaseLatencies& latencies)
+{
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      module_cache::getWasmModuleCache().getCachedModule(baseMsg);
+
+    for (int i = 0; i < nIterations; i++) {
+        faabric::Message msg = baseMsg;
+        faabric::util::setMessageId(msg);
+
+        auto start = std::chrono::steady_clock::now();
+        wasm::WAVMWasmModule module(*zygote);
+        latencies["clone"].emplace_back(microsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        bool success = module.execute(msg);
+        latencies["execute"].emplace_back(microsSince(start));
+        checkCall(success, msg);
+
+        start = std::chrono::steady_clock::now();
+        module = *zygote;
+        latencies["reset"].emplace_back(microsSince(start));
+    }
+}
+
+void runWamrCalls(const faabric::Message& baseMsg,
+                  int nIterations,
+                  PhaseLatencies& latencies)
+{
+    for (int i = 0; i < nIterations; i++) {
+        faabric::Message msg = baseMsg;
+        faabric::util::setMessageId(msg);
+
+        auto start = std::chrono::steady_clock::now();
+        wasm::WAMRWasmModule module;
+        module.bindToFunction(msg);
+        latencies["bind"].emplace_back(microsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        bool success = module.execute(msg);
+        latencies["execute"].emplace_back(microsSince(start));
+        checkCall(success, msg);
+    }
+}
+
+/**
+ * Times each phase of the WAVM lifecycle from scratch. The caches are cleared
+ * on each iteration so that the cold bind and zygote creation are measured
+ * every time.
+ */
+PhaseLatencies runWavmLifecycle(const faabric::Message& msg, int nIterations)
+{
+    storage::FileLoader& loader = storage::getFileLoader();
+    module_cache::WasmModuleCache& moduleCache =
+      module_cache::getWasmModuleCache();
+
+    PhaseLatencies latencies;
+    for (int i = 0; i < nIterations; i++) {
+        moduleCache.clear();
+        wasm::getIRModuleCache().clear();
+
+        auto start = std::chrono::steady_clock::now();
+        loader.loadFunctionObjectFile(msg);
+        latencies["codegenLoad"].emplace_back(microsSince(start));
+
+        {
+            start = std::chrono::steady_clock::now();
+            wasm::WAVMWasmModule module;
+            module.bindToFunction(msg);
+            latencies["coldBind"].emplace_back(microsSince(start));
+        }
+
+        {
+            start = std::chrono::steady_clock::now();
+            wasm::WAVMWasmModule module;
+            module.bindToFunction(msg);
+            latencies["bind"].emplace_back(microsSince(start));
+        }
+
+        start = std::chrono::steady_clock::now();
+        moduleCache.getCachedModule(msg);
+        latencies["zygote"].emplace_back(microsSince(start));
+
+        runWavmCalls(msg, 1, latencies);
+    }
+
+    return latencies;
+}
+
+PhaseLatencies runWamrLifecycle(const faabric::Message& msg, int nIterations)
+{
+    storage::FileLoader& loader = storage::getFileLoader();
+
+    PhaseLatencies latencies;
+    for (int i = 0; i < nIterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        loader.loadFunctionWamrAotFile(msg);
+        latencies["codegenLoad"].emplace_back(microsSince(start));
+
+        runWamrCalls(msg, 1, latencies);
+    }
+
+    return latencies;
+}
+
+/**
+ * Runs calls on the given number of threads at once, all cloning from the
+ * same zygote with WAVM, to expose contention between them.
+ */
+PhaseLatencies runConcurrent(const faabric::Message& msg,
+                             const std::string& vm,
+                             int concurrency,
+                             int nIterations)
+{
+    if (vm == "wavm") {
+        module_cache::getWasmModuleCache().getCachedModule(msg);
+    }
+
+    std::vector<PhaseLatencies> threadLatencies(concurrency);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < concurrency; t++) {
+        threads.emplace_back([&msg, &vm, &threadLatencies, t, nIterations] {
+            if (vm == "wavm") {
+                runWavmCalls(msg, nIterations, threadLatencies.at(t));
+            } else {
+                runWamrCalls(msg, nIterations, threadLatencies.at(t));
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    PhaseLatencies merged;
+    for (auto& latencies : threadLatencies) {
+        for (auto& p : latencies) {
+            merged[p.first].insert(
+              merged[p.first].end(), p.second.begin(), p.second.end());
+        }
+    }
+
+    return merged;
+}
+
+/**
+ * Measures each phase of a function's lifecycle, i.e. loading the generated
+ * code, binding, creating the zygote, cloning, executing and resetting. Runs
+ * each function with both WAVM and WAMR (which has no zygote, so is bound
+ * afresh for every call), optionally with a number of threads running calls
+ * at once. Runs locally without the scheduler, and prints the results as
+ * JSON.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (argc < 4) {
+        logger->error("Usage: lifecycle_runner <iterations> <concurrency> "
+                      "<user/function> [user/function ...]");
+        return 1;
+    }
+
+    int nIterations = std::stoi(argv[1]);
+    int concurrency = std::stoi(argv[2]);
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+    const std::string originalVm = conf.wasmVm;
+
+    std::vector<std::string> results;
+    for (int a = 3; a < argc; a++) {
+        std::string funcStr = argv[a];
+        size_t slashIdx = funcStr.find('/');
+        if (slashIdx == std::string::npos) {
+            logger->error("Expected user/function but got {}", funcStr);
+            return 1;
+        }
+
+        faabric::Message msg = faabric::util::messageFactory(
+          funcStr.substr(0, slashIdx), funcStr.substr(slashIdx + 1));
+
+        for (const std::string vm : { "wavm", "wamr" }) {
+            conf.wasmVm = vm;
+
+            PhaseLatencies latencies;
+            try {
+                if (vm == "wavm") {
+                    latencies = runWavmLifecycle(msg, nIterations);
+                } else {
+                    latencies = runWamrLifecycle(msg, nIterations);
+                }
+            } catch (std::exception& e) {
+                logger->warn("Skipping {} on {}: {}", funcStr, vm, e.what());
+                continue;
+            }
+
+            results.emplace_back(
+              resultToJson(msg, vm, 1, nIterations, latencies));
+
+            if (concurrency > 1) {
+                PhaseLatencies concurrentLatencies =
+                  runConcurrent(msg, vm, concurrency, nIterations);
+                results.emplace_back(resultToJson(
+                  msg, vm, concurrency, nIterations, concurrentLatencies));
+            }
+        }
+    }
+
+    conf.wasmVm = originalVm;
+    module_cache::getWasmModuleCache().clear();
+    wasm::tearDownWAMRGlobally();
+
+    printf("{\n  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        printf("%s%s\n",
+               results.at(i).c_str(),
+               i < results.size() - 1 ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    return 0;
+}
@@ -0,0 +1,387 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/FaasletPool.h>
+#include <system/ResourceUsage.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#define LOAD_WINDOW_MS 1000
+#define BURST_SIZE 20
+#define N_COLLECTORS 32
+#define DRAIN_TIMEOUT_MS 60000
+
+struct FunctionSpec
+{
+    std::string user;
+    std::string function;
+    double weight = 1;
+    size_t inputBytes = 0;
+};
+
+struct PendingCall
+{
+    unsigned int messageId = 0;
+    int funcIdx = 0;
+    long arrivalMicros = 0;
+};
+
+/**
+ * A finished call. Start and end are when the Faaslet started and finished
+ * executing it. The start is -1 if it's no longer in the resource usage log,
+ * in which case the end is when its result was collected.
+ */
+struct CallSample
+{
+    int funcIdx = 0;
+    long arrivalMicros = 0;
+    long startMicros = -1;
+    long endMicros = -1;
+    bool success = false;
+};
+
+/**
+ * Calls waiting for their results, oldest first. An ID of zero tells a
+ * collector to stop.
+ */
+class PendingCalls
+{
+  public:
+    void push(const PendingCall& call)
+    {
+        {
+            std::scoped_lock<std::mutex> guard(mx);
+            calls.push_back(call);
+        }
+        cv.notify_one();
+    }
+
+    PendingCall pop()
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        cv.wait(lock, [this] { return !calls.empty(); });
+
+        PendingCall call = calls.front();
+        calls.pop_front();
+        return call;
+    }
+
+  private:
+    std::mutex mx;
+    std::condition_variable cv;
+    std::deque<PendingCall> calls;
+};
+
+bool parseFunctionSpec(const std::string& str, FunctionSpec& spec)
+{
+    // Specs are user/function[:weight[:input bytes]]
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    while (true) {
+        size_t next = str.find(':', pos);
+        parts.emplace_back(str.substr(pos, next - pos));
+        if (next == std::string::npos) {
+            break;
+        }
+        pos = next + 1;
+    }
+
+    size_t slashIdx = parts.at(0).find('/');
+    if (slashIdx == std::string::npos || parts.size() > 3) {
+        return false;
+    }
+
+    spec.user = parts.at(0).substr(0, slashIdx);
+    spec.function = parts.at(0).substr(slashIdx + 1);
+    if (parts.size() > 1) {
+        spec.weight = std::stod(parts.at(1));
+    }
+    if (parts.size() > 2) {
+        spec.inputBytes = std::stoul(parts.at(2));
+    }
+
+    return spec.weight > 0;
+}
+
+double percentileMs(std::vector<long>& micros, double percentile)
+{
+    if (micros.empty()) {
+        return 0;
+    }
+
+    std::sort(micros.begin(), micros.end());
+    size_t idx = (size_t)(percentile * (micros.size() - 1) / 100.0);
+    return micros.at(idx) / 1000.0;
+}
+
+/**
+ * Prints the queueing delay and latency of the given calls, along with the
+ * throughput of the calls that completed in the same period.
+ */
+void printStats(const std::string& label,
+                long offered,
+                long completed,
+                const std::vector<CallSample>& samples,
+                double seconds)
+{
+    std::vector<long> queueing;
+    std::vector<long> latencies;
+    long failed = 0;
+    for (auto& s : samples) {
+        if (!s.success) {
+            failed++;
+            continue;
+        }
+
+        if (s.startMicros >= 0) {
+            queueing.emplace_back(s.startMicros - s.arrivalMicros);
+        }
+        latencies.emplace_back(s.endMicros - s.arrivalMicros);
+    }
+
+    printf("%-16s offered=%-6li done=%-6li tput=%8.1f/s  "
+           "queue p50=%8.3fms p99=%8.3fms  "
+           "lat p50=%8.3fms p99=%8.3fms p99.9=%8.3fms  failed=%li\n",
+           label.c_str(),
+           offered,
+           completed,
+           completed / seconds,
+           percentileMs(queueing, 50),
+           percentileMs(queueing, 99),
+           percentileMs(latencies, 50),
+           percentileMs(latencies, 99),
+           percentileMs(latencies, 99.9),
+           failed);
+}
+
+void collectResults(PendingCalls& pending,
+                    std::vector<CallSample>& samples,
+                    std::mutex& samplesMx)
+{
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    isolation::ResourceUsageLog& usageLog = isolation::getResourceUsageLog();
+
+    while (true) {
+        PendingCall call = pending.pop();
+        if (call.messageId == 0) {
+            return;
+        }
+
+        CallSample sample;
+        sample.funcIdx = call.funcIdx;
+        sample.arrivalMicros = call.arrivalMicros;
+
+        try {
+            const faabric::Message result =
+              sch.getFunctionResult(call.messageId, DRAIN_TIMEOUT_MS);
+
+            // Use the times the call actually ran, as collecting results in
+            // order means this thread may see it finish late
+            isolation::CallResourceUsage usage;
+            if (usageLog.getUsage(call.messageId, usage)) {
+                sample.startMicros = usage.startMicros;
+                sample.endMicros = usage.endMicros;
+            } else {
+                sample.endMicros = isolation::getSteadyClockMicros();
+            }
+            sample.success = result.returnvalue() == 0;
+        } catch (std::exception& e) {
+            faabric::util::getLogger()->error(
+              "No result for call {}: {}", call.messageId, e.what());
+        }
+
+        std::scoped_lock<std::mutex> guard(samplesMx);
+        samples.emplace_back(sample);
+    }
+}
+
+/**
+ * Drives a local Faaslet pool with an open-loop load, i.e. calls arrive on
+ * schedule regardless of how many are still running, so that queueing shows
+ * up in the latencies rather than slowing the load down. Arrivals are either
+ * evenly spaced, a Poisson process, or Poisson-distributed bursts of
+ * BURST_SIZE calls at once. Each call is to one of the given functions, picked
+ * according to their weights, with an input of random bytes of the given
+ * size.
+ *
+ * Prints the throughput, queueing delay (time from arrival to execution
+ * starting) and latency (time from arrival to execution finishing) for each
+ * window of calls arriving in LOAD_WINDOW_MS, then for each function over the
+ * whole run. Uses the pool size from the Faasm config, and keeps state in
+ * memory.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (argc < 5) {
+        logger->error("Usage: load_runner <constant|poisson|bursty> "
+                      "<calls per second> <seconds> "
+                      "<user/function[:weight[:input bytes]]> [...]");
+        return 1;
+    }
+
+    std::string arrivals = argv[1];
+    double rate = std::stod(argv[2]);
+    double durationSeconds = std::stod(argv[3]);
+    if (arrivals != "constant" && arrivals != "poisson" &&
+        arrivals != "bursty") {
+        logger->error("Unrecognised arrival process: {}", arrivals);
+        return 1;
+    }
+
+    std::vector<FunctionSpec> specs;
+    std::vector<double> weights;
+    for (int a = 4; a < argc; a++) {
+        FunctionSpec spec;
+        if (!parseFunctionSpec(argv[a], spec)) {
+            logger->error("Invalid function spec: {}", argv[a]);
+            return 1;
+        }
+        specs.emplace_back(spec);
+        weights.emplace_back(spec.weight);
+    }
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+    conf.maxNodes = faasmConf.poolMaxSize;
+    conf.maxNodesPerFunction = faasmConf.poolMaxSize;
+    conf.globalMessageTimeout = DRAIN_TIMEOUT_MS;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    faaslet::FaasletPool pool(faasmConf.poolMinSize, faasmConf.poolMaxSize);
+    pool.startThreadPool();
+
+    PendingCalls pending;
+    std::vector<CallSample> samples;
+    std::mutex samplesMx;
+    std::vector<std::thread> collectors;
+    for (int i = 0; i < N_COLLECTORS; i++) {
+        collectors.emplace_back(collectResults,
+                                std::ref(pending),
+                                std::ref(samples),
+                                std::ref(samplesMx));
+    }
+
+    std::mt19937 rng(std::random_device{}());
+    std::discrete_distribution<int> pickFunction(weights.begin(),
+                                                 weights.end());
+    std::uniform_int_distribution<int> randomByte(0, 255);
+    double meanGapMicros = 1e6 / rate;
+    if (arrivals == "bursty") {
+        meanGapMicros *= BURST_SIZE;
+    }
+    std::exponential_distribution<double> poissonGap(1.0 / meanGapMicros);
+
+    // Generate the load, keeping to the schedule even when behind it
+    auto start = std::chrono::steady_clock::now();
+    long startMicros = isolation::getSteadyClockMicros();
+    long endMicros = startMicros + (long)(durationSeconds * 1e6);
+    double nextArrival = startMicros;
+    long nCalls = 0;
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    while (nextArrival < endMicros) {
+        std::this_thread::sleep_until(
+          start + std::chrono::microseconds((long)nextArrival - startMicros));
+
+        int funcIdx = pickFunction(rng);
+        const FunctionSpec& spec = specs.at(funcIdx);
+        faabric::Message call =
+          faabric::util::messageFactory(spec.user, spec.function);
+
+        if (spec.inputBytes > 0) {
+            std::string input(spec.inputBytes, 0);
+            for (auto& c : input) {
+                c = (char)randomByte(rng);
+            }
+            call.set_inputdata(input);
+        }
+
+        sch.callFunction(call);
+        pending.push({ call.id(), funcIdx, (long)nextArrival });
+        nCalls++;
+
+        if (arrivals == "constant") {
+            nextArrival += meanGapMicros;
+        } else if (arrivals == "poisson" || nCalls % BURST_SIZE == 0) {
+            nextArrival += poissonGap(rng);
+        }
+    }
+
+    long generatedMicros = isolation::getSteadyClockMicros() - startMicros;
+    if (generatedMicros > (long)(durationSeconds * 1e6 * 1.01)) {
+        logger->warn("Fell behind the arrival schedule by {}ms",
+                     generatedMicros / 1000 - (long)(durationSeconds * 1e3));
+    }
+
+    for (int i = 0; i < N_COLLECTORS; i++) {
+        pending.push({ 0, 0, 0 });
+    }
+    for (auto& t : collectors) {
+        t.join();
+    }
+
+    pool.shutdown();
+
+    // Latencies are grouped by the window in which calls arrived, and
+    // throughput by the window in which they finished
+    long windowMicros = LOAD_WINDOW_MS * 1000L;
+    std::map<long, std::vector<CallSample>> windows;
+    std::map<long, long> windowCompletions;
+    std::map<int, std::vector<CallSample>> functions;
+    std::map<int, long> functionCompletions;
+    for (auto& s : samples) {
+        windows[(s.arrivalMicros - startMicros) / windowMicros].emplace_back(s);
+        functions[s.funcIdx].emplace_back(s);
+
+        if (s.success) {
+            windowCompletions[(s.endMicros - startMicros) / windowMicros]++;
+            functionCompletions[s.funcIdx]++;
+        }
+    }
+
+    printf("%s arrivals at %.1f calls/s for %.1fs, %li calls\n",
+           arrivals.c_str(),
+           rate,
+           durationSeconds,
+           nCalls);
+
+    for (auto& w : windows) {
+        std::string label =
+          "t=" + std::to_string(w.first * LOAD_WINDOW_MS) + "ms";
+        printStats(label,
+                   w.second.size(),
+                   windowCompletions[w.first],
+                   w.second,
+                   LOAD_WINDOW_MS / 1000.0);
+    }
+
+    printf("\n");
+    long nCompleted = 0;
+    for (auto& f : functions) {
+        const FunctionSpec& spec = specs.at(f.first);
+        printStats(spec.user + "/" + spec.function,
+                   f.second.size(),
+                   functionCompletions[f.first],
+                   f.second,
+                   durationSeconds);
+        nCompleted += functionCompletions[f.first];
+    }
+    printStats("all", nCalls, nCompleted, samples, durationSeconds);
+
+    return 0;
+}
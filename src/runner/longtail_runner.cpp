@@ -0,0 +1,164 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/FaasletPool.h>
+#include <storage/FileLoader.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/files.h>
+#include <faabric/util/func.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#define LONGTAIL_USER "longtail"
+#define N_FUNCTIONS 100
+#define ZIPF_EXPONENT 1.0
+
+double runFunction(int funcIdx)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    faabric::Message call = faabric::util::messageFactory(
+      LONGTAIL_USER, "f" + std::to_string(funcIdx));
+
+    auto start = std::chrono::steady_clock::now();
+    sch.callFunction(call);
+
+    const faabric::Message result =
+      sch.getFunctionResult(call.id(), conf.globalMessageTimeout);
+    auto end = std::chrono::steady_clock::now();
+
+    if (result.returnvalue() != 0) {
+        faabric::util::getLogger()->error("Call to f{} failed: {}",
+                                          funcIdx,
+                                          result.outputdata());
+        throw std::runtime_error("Long-tail call failed");
+    }
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    double mean = total / latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-16s mean=%8.3fms  p50=%8.3fms  p99=%8.3fms  total=%8.1fms\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99,
+           total);
+}
+
+/**
+ * Measures call latency for a long tail of functions served by a small pool,
+ * with and without each Faaslet slot keeping an LRU of bound modules. Each
+ * function is a copy of demo/noop, and calls follow a Zipf distribution over
+ * the functions. Executors are given a short bound timeout, so slots are
+ * constantly rebound to different functions.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int nRuns = 1000;
+    int cacheSize = 8;
+    if (argc > 1) {
+        nRuns = std::stoi(argv[1]);
+    }
+    if (argc > 2) {
+        cacheSize = std::stoi(argv[2]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    conf.boundTimeout = 100;
+    conf.unboundTimeout = 60000;
+    conf.globalMessageTimeout = 60000;
+
+    int nThreads = 4;
+    conf.maxNodes = nThreads;
+    conf.maxNodesPerFunction = nThreads;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    // Upload copies of the noop function
+    faabric::Message noopMsg = faabric::util::messageFactory("demo", "noop");
+    std::vector<uint8_t> wasmBytes =
+      faabric::util::readFileToBytes(faabric::util::getFunctionFile(noopMsg));
+
+    storage::FileLoader& fileLoader = storage::getFileLoader();
+    for (int i = 0; i < N_FUNCTIONS; i++) {
+        faabric::Message uploadMsg = faabric::util::messageFactory(
+          LONGTAIL_USER, "f" + std::to_string(i));
+        uploadMsg.set_inputdata(wasmBytes.data(), wasmBytes.size());
+        fileLoader.uploadFunction(uploadMsg);
+    }
+
+    // Zipf weights over the functions
+    std::vector<double> weights;
+    for (int i = 0; i < N_FUNCTIONS; i++) {
+        weights.push_back(1.0 / std::pow(i + 1, ZIPF_EXPONENT));
+    }
+
+    const int originalCacheSize = faasmConf.faasletModuleCacheSize;
+
+    for (int size : { 0, cacheSize }) {
+        // The pool creates the per-slot caches on construction
+        faasmConf.faasletModuleCacheSize = size;
+        faaslet::FaasletPool pool(nThreads);
+        pool.startThreadPool();
+
+        // Warm up the zygotes for every function
+        for (int i = 0; i < N_FUNCTIONS; i++) {
+            runFunction(i);
+        }
+
+        // Same sequence of functions for each run
+        std::mt19937 gen(0);
+        std::discrete_distribution<int> dist(weights.begin(), weights.end());
+
+        std::vector<double> latencies;
+        for (int i = 0; i < nRuns; i++) {
+            latencies.push_back(runFunction(dist(gen)));
+        }
+
+        std::string label = "lru=" + std::to_string(size);
+        printLatencies(label, latencies);
+
+        if (size > 0) {
+            long hits = 0;
+            long misses = 0;
+            long evictions = 0;
+            for (int t = 0; t < nThreads; t++) {
+                faaslet::BoundModuleCache* cache = pool.getModuleCache(t);
+                hits += cache->getHitCount();
+                misses += cache->getMissCount();
+                evictions += cache->getEvictionCount();
+            }
+
+            printf("%-16s hits=%li  misses=%li  evictions=%li\n",
+                   "",
+                   hits,
+                   misses,
+                   evictions);
+        }
+
+        pool.shutdown();
+    }
+
+    faasmConf.faasletModuleCacheSize = originalCacheSize;
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <conf/FaasmConfig.h>
+#include <faaslet/FaasletPool.h>
+#include <wasm/ResultCache.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#define N_DISTINCT_INPUTS 8
+#define MIN_FIB_NUM 20
+#define ZIPF_EXPONENT 1.1
+
+double runFibonacci(int fibNum)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    faabric::Message call = faabric::util::messageFactory("demo", "fibonacci");
+    call.set_inputdata(std::to_string(fibNum));
+
+    auto start = std::chrono::steady_clock::now();
+    sch.callFunction(call);
+
+    const faabric::Message result =
+      sch.getFunctionResult(call.id(), conf.globalMessageTimeout);
+    auto end = std::chrono::steady_clock::now();
+
+    if (result.returnvalue() != 0) {
+        faabric::util::getLogger()->error("Fibonacci call failed: {}",
+                                          result.outputdata());
+        throw std::runtime_error("Fibonacci call failed");
+    }
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    double mean = total / latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-16s mean=%8.3fms  p50=%8.3fms  p99=%8.3fms  total=%8.1fms\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99,
+           total);
+}
+
+/**
+ * Measures call latency for a pure function with and without memoization,
+ * where the inputs follow a Zipf distribution (i.e. a few inputs are very
+ * popular, as with retries and fan-outs).
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int nRuns = 200;
+    if (argc > 1) {
+        nRuns = std::stoi(argv[1]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    conf.boundTimeout = 60000;
+    conf.unboundTimeout = 60000;
+    conf.globalMessageTimeout = 60000;
+
+    int nThreads = 4;
+    conf.maxNodes = nThreads;
+    conf.maxNodesPerFunction = nThreads;
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.flushAll();
+
+    faaslet::FaasletPool pool(nThreads);
+    pool.startThreadPool();
+
+    // Zipf weights over the distinct inputs
+    std::vector<double> weights;
+    for (int i = 0; i < N_DISTINCT_INPUTS; i++) {
+        weights.push_back(1.0 / std::pow(i + 1, ZIPF_EXPONENT));
+    }
+
+    const std::string originalFunctions = faasmConf.memoizeFunctions;
+    wasm::ResultCache& resultCache = wasm::getResultCache();
+
+    for (const std::string memoFuncs : { "", "demo/fibonacci" }) {
+        faasmConf.memoizeFunctions = memoFuncs;
+        resultCache.clear();
+
+        // Same sequence of inputs for each run
+        std::mt19937 gen(0);
+        std::discrete_distribution<int> dist(weights.begin(), weights.end());
+
+        // Warm up
+        runFibonacci(MIN_FIB_NUM);
+        resultCache.clear();
+
+        std::vector<double> latencies;
+        for (int i = 0; i < nRuns; i++) {
+            latencies.push_back(runFibonacci(MIN_FIB_NUM + dist(gen)));
+        }
+
+        std::string label = memoFuncs.empty() ? "memoize=off" : "memoize=on";
+        printLatencies(label, latencies);
+
+        if (!memoFuncs.empty()) {
+            printf("%-16s hits=%li  misses=%li  evictions=%li\n",
+                   "",
+                   resultCache.getHitCount(),
+                   resultCache.getMissCount(),
+                   resultCache.getEvictionCount());
+        }
+    }
+
+    faasmConf.memoizeFunctions = originalFunctions;
+
+    pool.shutdown();
+
+    return 0;
+}
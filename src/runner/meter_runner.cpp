@@ -0,0 +1,128 @@
+#include <ir_cache/IRModuleCache.h>
+#include <module_cache/WasmModuleCache.h>
+#include <storage/FileLoader.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+/**
+ * Runs calls from a fresh zygote using whatever object file is currently in
+ * place, and returns the latency of each in microseconds, sorted, along with
+ * the instructions counted by the last call.
+ */
+std::vector<double> timeCalls(const faabric::Message& baseMsg,
+                              int nIterations,
+                              int64_t& instructions)
+{
+    module_cache::getWasmModuleCache().clear();
+    wasm::getIRModuleCache().clear();
+
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      module_cache::getWasmModuleCache().getCachedModule(baseMsg);
+
+    std::vector<double> latencies;
+    for (int i = 0; i < nIterations; i++) {
+        faabric::Message msg = baseMsg;
+        faabric::util::setMessageId(msg);
+
+        wasm::WAVMWasmModule module(*zygote);
+
+        auto start = std::chrono::steady_clock::now();
+        bool success = module.execute(msg);
+        auto end = std::chrono::steady_clock::now();
+
+        if (!success || msg.returnvalue() != 0) {
+            faabric::util::getLogger()->error(
+              "Call to {} failed: {}",
+              faabric::util::funcToString(msg, false),
+              msg.outputdata());
+            throw std::runtime_error("Call failed");
+        }
+
+        latencies.emplace_back(
+          std::chrono::duration<double, std::micro>(end - start).count());
+        instructions = module.getMeteredInstructions();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    printf("  %-12s mean %10.1fus  p50 %10.1fus  min %10.1fus\n",
+           label.c_str(),
+           total / latencies.size(),
+           latencies.at(latencies.size() / 2),
+           latencies.front());
+}
+
+/**
+ * Measures the overhead of instruction-count metering by running each
+ * function built with and without it. The plain object is left in place.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (argc < 3) {
+        logger->error("Usage: meter_runner <iterations> <user/function> "
+                      "[user/function ...]");
+        return 1;
+    }
+
+    int nIterations = std::stoi(argv[1]);
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+    conf.wasmVm = "wavm";
+
+    storage::FileLoader& loader = storage::getFileLoader();
+
+    for (int a = 2; a < argc; a++) {
+        std::string funcStr = argv[a];
+        size_t slashIdx = funcStr.find('/');
+        if (slashIdx == std::string::npos) {
+            logger->error("Expected user/function but got {}", funcStr);
+            return 1;
+        }
+
+        faabric::Message msg = faabric::util::messageFactory(
+          funcStr.substr(0, slashIdx), funcStr.substr(slashIdx + 1));
+        std::vector<uint8_t> wasmBytes = loader.loadFunctionWasm(msg);
+
+        int64_t instructions;
+        loader.uploadFunctionObjectFile(
+          msg, wasm::wavmCodegen(wasmBytes, funcStr, true));
+        std::vector<double> metered = timeCalls(msg, nIterations, instructions);
+
+        int64_t unused;
+        loader.uploadFunctionObjectFile(
+          msg, wasm::wavmCodegen(wasmBytes, funcStr, false));
+        std::vector<double> baseline = timeCalls(msg, nIterations, unused);
+
+        double baselineP50 = baseline.at(baseline.size() / 2);
+        double meteredP50 = metered.at(metered.size() / 2);
+
+        printf("%s (%i calls, %li instructions per call)\n",
+               funcStr.c_str(),
+               nIterations,
+               instructions);
+        printLatencies("baseline", baseline);
+        printLatencies("metered", metered);
+        printf("  Overhead (p50) %.1f%%\n",
+               100.0 * (meteredP50 - baselineP50) / baselineP50);
+    }
+
+    module_cache::getWasmModuleCache().clear();
+
+    return 0;
+}
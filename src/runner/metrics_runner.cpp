@@ -0,0 +1,108 @@
+#include <module_cache/WasmModuleCache.h>
+#include <system/LatencyMetrics.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#define RECORD_LOOP_ITERATIONS 10000000
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    double mean = total / latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-16s mean=%8.3fus  p50=%8.3fus  p99=%8.3fus\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99);
+}
+
+/**
+ * Clones the function from its zygote and executes it, as a Faaslet does for
+ * each call, returning the time taken in microseconds.
+ */
+double runCall(const faabric::Message& baseMsg)
+{
+    faabric::Message msg = baseMsg;
+    faabric::util::setMessageId(msg);
+
+    auto start = std::chrono::steady_clock::now();
+    wasm::WAVMWasmModule module(
+      *module_cache::getWasmModuleCache().getCachedModule(msg));
+    bool success = module.execute(msg);
+    auto end = std::chrono::steady_clock::now();
+
+    if (!success || msg.returnvalue() != 0) {
+        faabric::util::getLogger()->error("Call failed: {}", msg.outputdata());
+        throw std::runtime_error("Call failed");
+    }
+
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+/**
+ * Measures the overhead of latency recording. First times a single record in
+ * a tight loop, then runs a no-op function with recording on and off,
+ * interleaving the two so that both see the same conditions.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    std::string user = "demo";
+    std::string function = "noop";
+    int nRuns = 10000;
+    if (argc > 2) {
+        user = argv[1];
+        function = argv[2];
+    }
+    if (argc > 3) {
+        nRuns = std::stoi(argv[3]);
+    }
+
+    isolation::LatencyRegistry& registry = isolation::getLatencyRegistry();
+
+    // Cost of a single record
+    int metricId = registry.getMetricId("metricsRunner");
+    auto loopStart = std::chrono::steady_clock::now();
+    for (long i = 0; i < RECORD_LOOP_ITERATIONS; i++) {
+        registry.record(metricId, i & 0xFFFF);
+    }
+    auto loopEnd = std::chrono::steady_clock::now();
+    double recordNanos =
+      std::chrono::duration<double, std::nano>(loopEnd - loopStart).count() /
+      RECORD_LOOP_ITERATIONS;
+    printf("Single record: %.2fns\n", recordNanos);
+
+    // Cost on a no-op function
+    faabric::Message msg = faabric::util::messageFactory(user, function);
+    module_cache::getWasmModuleCache().getCachedModule(msg);
+    runCall(msg);
+
+    std::vector<double> onLatencies;
+    std::vector<double> offLatencies;
+    for (int i = 0; i < nRuns; i++) {
+        registry.setEnabled(true);
+        onLatencies.emplace_back(runCall(msg));
+
+        registry.setEnabled(false);
+        offLatencies.emplace_back(runCall(msg));
+    }
+    registry.setEnabled(true);
+
+    printLatencies("metrics on", onLatencies);
+    printLatencies("metrics off", offLatencies);
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <conf/FaasmConfig.h>
+#include <module_cache/WasmModuleCache.h>
+#include <system/Numa.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <chrono>
+#include <thread>
+
+/**
+ * Clones the zygote and executes the function on the given node, returning
+ * the mean time per call.
+ */
+double runOnNode(int node, const faabric::Message& baseMsg, int nRuns)
+{
+    double totalMs = 0;
+
+    std::thread t([node, &baseMsg, nRuns, &totalMs] {
+        isolation::getNumaTopology().pinCurrentThreadToNode(node);
+
+        module_cache::WasmModuleCache& registry =
+          module_cache::getWasmModuleCache();
+
+        for (int i = 0; i < nRuns; i++) {
+            faabric::Message msg = baseMsg;
+            faabric::util::setMessageId(msg);
+
+            auto start = std::chrono::steady_clock::now();
+            wasm::WAVMWasmModule module(*registry.getCachedModule(msg));
+            bool success = module.execute(msg);
+            auto end = std::chrono::steady_clock::now();
+
+            if (!success || msg.returnvalue() != 0) {
+                faabric::util::getLogger()->error("Call failed: {}",
+                                                  msg.outputdata());
+                throw std::runtime_error("Call failed");
+            }
+
+            totalMs +=
+              std::chrono::duration<double, std::milli>(end - start).count();
+        }
+    });
+    t.join();
+
+    return totalMs / nRuns;
+}
+
+/**
+ * Measures the effect of NUMA placement on a memory-bandwidth-bound function.
+ * The zygote is created on the first node, then the function is cloned and
+ * run on every node, first cloning straight from the zygote (remote for all
+ * but the first node), then from node-local replicas.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    std::string user = "omp";
+    std::string function = "intel_nstreams";
+    std::string cmdline = "1 10 1000000 0";
+    int nRuns = 10;
+    if (argc > 2) {
+        user = argv[1];
+        function = argv[2];
+    }
+    if (argc > 3) {
+        cmdline = argv[3];
+    }
+    if (argc > 4) {
+        nRuns = std::stoi(argv[4]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    conf.captureStdout = "on";
+
+    isolation::NumaTopology& topology = isolation::getNumaTopology();
+    const std::vector<int>& nodes = topology.getNodeIds();
+    if (!topology.isNuma()) {
+        printf("Single NUMA node, only local access will be measured\n");
+    }
+
+    faabric::Message msg = faabric::util::messageFactory(user, function);
+    msg.set_cmdline(cmdline);
+
+    const std::string originalMode = faasmConf.numaMode;
+    const std::string originalReplicas = faasmConf.numaZygoteReplicas;
+    faasmConf.numaMode = "node";
+
+    for (const std::string replicas : { "off", "on" }) {
+        faasmConf.numaZygoteReplicas = replicas;
+        module_cache::getWasmModuleCache().clear();
+
+        // Create the zygote on the first node
+        std::thread zygoteThread([&topology, &nodes, &msg] {
+            topology.pinCurrentThreadToNode(nodes.front());
+            module_cache::getWasmModuleCache().getCachedModule(msg);
+        });
+        zygoteThread.join();
+
+        // Warm up any replicas
+        for (int node : nodes) {
+            runOnNode(node, msg, 1);
+        }
+
+        for (int node : nodes) {
+            double meanMs = runOnNode(node, msg, nRuns);
+            bool isLocal = node == nodes.front() || replicas == "on";
+
+            printf("node=%-2i replicas=%-3s access=%-6s mean=%8.3fms\n",
+                   node,
+                   replicas.c_str(),
+                   isLocal ? "local" : "remote",
+                   meanMs);
+        }
+    }
+
+    faasmConf.numaMode = originalMode;
+    faasmConf.numaZygoteReplicas = originalReplicas;
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <ir_cache/IRModuleCache.h>
+#include <ir_cache/ProfileGuided.h>
+#include <module_cache/WasmModuleCache.h>
+#include <storage/FileLoader.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <WAVM/IR/Module.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#define TOP_FUNCTIONS 5
+
+/**
+ * Runs calls from a fresh zygote using whatever object file is currently in
+ * place, and returns the latency of each in microseconds, sorted.
+ */
+std::vector<double> timeCalls(const faabric::Message& baseMsg, int nIterations)
+{
+    module_cache::getWasmModuleCache().clear();
+    wasm::getIRModuleCache().clear();
+
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      module_cache::getWasmModuleCache().getCachedModule(baseMsg);
+
+    std::vector<double> latencies;
+    for (int i = 0; i < nIterations; i++) {
+        faabric::Message msg = baseMsg;
+        faabric::util::setMessageId(msg);
+
+        wasm::WAVMWasmModule module(*zygote);
+
+        auto start = std::chrono::steady_clock::now();
+        bool success = module.execute(msg);
+        auto end = std::chrono::steady_clock::now();
+
+        if (!success || msg.returnvalue() != 0) {
+            faabric::util::getLogger()->error(
+              "Call to {} failed: {}",
+              faabric::util::funcToString(msg, false),
+              msg.outputdata());
+            throw std::runtime_error("Call failed");
+        }
+
+        latencies.emplace_back(
+          std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    double total = std::accumulate(latencies.begin(), latencies.end(), 0.0);
+    printf("  %-12s mean %10.1fus  p50 %10.1fus  min %10.1fus\n",
+           label.c_str(),
+           total / latencies.size(),
+           latencies.at(latencies.size() / 2),
+           latencies.front());
+}
+
+/**
+ * Prints the functions entered most often, named from the module's name
+ * section where there is one.
+ */
+void printHottestFunctions(const faabric::Message& msg,
+                           const wasm::PgoProfile& profile)
+{
+    IR::Module& module =
+      wasm::getIRModuleCache().getModule(msg.user(), msg.function(), "");
+    IR::DisassemblyNames names;
+    IR::getDisassemblyNames(module, names);
+
+    std::vector<std::pair<Uptr, uint64_t>> entries(profile.entryCounts.begin(),
+                                                   profile.entryCounts.end());
+    std::sort(entries.begin(),
+              entries.end(),
+              [](const std::pair<Uptr, uint64_t>& a,
+                 const std::pair<Uptr, uint64_t>& b) {
+                  return a.second > b.second;
+              });
+
+    printf("  Hottest functions:\n");
+    for (size_t i = 0; i < std::min<size_t>(TOP_FUNCTIONS, entries.size());
+         i++) {
+        Uptr funcIdx = module.functions.imports.size() + entries[i].first;
+        std::string name = funcIdx < names.functions.size()
+                             ? names.functions[funcIdx].name
+                             : std::to_string(funcIdx);
+        printf("    %12lu  %s\n", entries[i].second, name.c_str());
+    }
+}
+
+/**
+ * Benchmarks profile-guided recompilation of each function. Runs calls with
+ * the plain object, then with an instrumented build that collects counts, then
+ * with the build optimised using those counts, which is left in place.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (argc < 3) {
+        logger->error(
+          "Usage: pgo_runner <iterations> <user/function> [user/function ...]");
+        return 1;
+    }
+
+    int nIterations = std::stoi(argv[1]);
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+    conf.wasmVm = "wavm";
+
+    storage::FileLoader& loader = storage::getFileLoader();
+
+    for (int a = 2; a < argc; a++) {
+        std::string funcStr = argv[a];
+        size_t slashIdx = funcStr.find('/');
+        if (slashIdx == std::string::npos) {
+            logger->error("Expected user/function but got {}", funcStr);
+            return 1;
+        }
+
+        faabric::Message msg = faabric::util::messageFactory(
+          funcStr.substr(0, slashIdx), funcStr.substr(slashIdx + 1));
+
+        // Start from a plain object
+        std::vector<uint8_t> wasmBytes = loader.loadFunctionWasm(msg);
+        loader.uploadFunctionObjectFile(
+          msg, wasm::wavmCodegen(wasmBytes, funcStr));
+        std::vector<double> baseline = timeCalls(msg, nIterations);
+
+        loader.pgoCodegenForFunction(msg, true);
+        std::vector<double> instrumented = timeCalls(msg, nIterations);
+        wasm::PgoProfile profile = wasm::getPgoProfileStore().getProfile(msg);
+
+        wasm::PgoPlan plan = loader.pgoCodegenForFunction(msg, false);
+        std::vector<double> optimised = timeCalls(msg, nIterations);
+
+        printf("%s (%i calls, %lu call sites inlined)\n",
+               funcStr.c_str(),
+               nIterations,
+               plan.inlinedSites.size());
+        printLatencies("baseline", baseline);
+        printLatencies("instrumented", instrumented);
+        printLatencies("optimised", optimised);
+        printf("  Speedup (p50) %.3fx\n",
+               baseline.at(baseline.size() / 2) /
+                 optimised.at(optimised.size() / 2));
+        printHottestFunctions(msg, profile);
+    }
+
+    module_cache::getWasmModuleCache().clear();
+
+    return 0;
+}
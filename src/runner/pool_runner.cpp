@@ -1,5 +1,6 @@
 #include <faabric/util/logging.h>
 
+#include <conf/FaasmConfig.h>
 #include <faaslet/FaasletPool.h>
 
 #include <faabric/endpoint/FaabricEndpoint.h>
@@ -14,8 +15,11 @@ int main()
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
 
     // Start the worker pool
-    logger->info("Starting faaslet pool in the background");
-    FaasletPool p(5);
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    logger->info("Starting faaslet pool in the background ({}-{} Faaslets)",
+                 faasmConf.poolMinSize,
+                 faasmConf.poolMaxSize);
+    FaasletPool p(faasmConf.poolMinSize, faasmConf.poolMaxSize);
     FaabricMain w(p);
     w.startBackground();
 
@@ -0,0 +1,106 @@
+#include <conf/FaasmConfig.h>
+#include <module_cache/ChainPrewarmer.h>
+#include <module_cache/WasmModuleCache.h>
+#include <wasm/CallGraph.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+/**
+ * Times the cold start of the second stage of a two-stage pipeline, i.e.
+ * getting its zygote and cloning a module from it, as a Faaslet does when
+ * it's first bound to the function.
+ */
+double runSecondStage(const faabric::Message& parent,
+                      const faabric::Message& child,
+                      bool prewarm)
+{
+    module_cache::ChainPrewarmer& prewarmer =
+      module_cache::getChainPrewarmer();
+    module_cache::WasmModuleCache& cache = module_cache::getWasmModuleCache();
+
+    // Start from cold each time
+    prewarmer.clear();
+    cache.clear();
+
+    // The first stage would be executing while its children are prewarmed
+    if (prewarm) {
+        prewarmer.prewarmChildren(parent);
+        prewarmer.waitForPrewarms();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    prewarmer.recordBind(child);
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      cache.getCachedModule(child);
+    wasm::WAVMWasmModule module(*zygote);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void printLatencies(const std::string& label, std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) /
+                  latencies.size();
+    double p50 = latencies.at(latencies.size() / 2);
+    double p99 = latencies.at((latencies.size() * 99) / 100);
+
+    printf("%-16s mean=%8.3fms  p50=%8.3fms  p99=%8.3fms\n",
+           label.c_str(),
+           mean,
+           p50,
+           p99);
+}
+
+/**
+ * Measures the cold-start latency of the second stage of a two-stage
+ * pipeline, with and without prewarming from the call graph.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    int nRuns = 20;
+    if (argc > 1) {
+        nRuns = std::stoi(argv[1]);
+    }
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.chainPrewarm = "on";
+    faasmConf.chainPrewarmThreshold = 50;
+
+    faabric::Message parent =
+      faabric::util::messageFactory("demo", "chain_named_a");
+    faabric::Message child =
+      faabric::util::messageFactory("demo", "chain_named_b");
+
+    // Teach the call graph about the pipeline
+    wasm::CallGraph& graph = wasm::getCallGraph();
+    graph.recordCall(parent);
+    graph.recordChainedCall(parent, child);
+
+    for (bool prewarm : { false, true }) {
+        // Warm up
+        runSecondStage(parent, child, prewarm);
+
+        std::vector<double> latencies;
+        for (int i = 0; i < nRuns; i++) {
+            latencies.push_back(runSecondStage(parent, child, prewarm));
+        }
+
+        printLatencies(prewarm ? "prewarm=on" : "prewarm=off", latencies);
+    }
+
+    module_cache::getChainPrewarmer().clear();
+    module_cache::getWasmModuleCache().clear();
+
+    return 0;
+}
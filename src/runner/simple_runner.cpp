@@ -93,10 +93,11 @@ bool runWithWavm(faabric::Message& m, int runCount)
     // Create the module
     module_cache::WasmModuleCache& registry =
       module_cache::getWasmModuleCache();
-    wasm::WAVMWasmModule& cachedModule = registry.getCachedModule(m);
+    std::shared_ptr<wasm::WAVMWasmModule> cachedModule =
+      registry.getCachedModule(m);
 
     // Create new module from cache
-    wasm::WAVMWasmModule module(cachedModule);
+    wasm::WAVMWasmModule module(*cachedModule);
 
     // Run repeated executions
     for (int i = 0; i < runCount; i++) {
@@ -108,7 +109,7 @@ bool runWithWavm(faabric::Message& m, int runCount)
         }
 
         // Reset using cached module
-        module = cachedModule;
+        module = *cachedModule;
     }
 
     return success;
@@ -0,0 +1,92 @@
+#include <conf/FaasmConfig.h>
+#include <module_cache/WasmModuleCache.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+
+#include <chrono>
+
+/**
+ * Executes the function repeatedly from its zygote, returning the mean time
+ * per call.
+ */
+double runFunction(const faabric::Message& baseMsg, int nRuns)
+{
+    module_cache::WasmModuleCache& registry =
+      module_cache::getWasmModuleCache();
+
+    double totalMs = 0;
+    for (int i = 0; i < nRuns; i++) {
+        faabric::Message msg = baseMsg;
+        faabric::util::setMessageId(msg);
+
+        wasm::WAVMWasmModule module(*registry.getCachedModule(msg));
+
+        auto start = std::chrono::steady_clock::now();
+        bool success = module.execute(msg);
+        auto end = std::chrono::steady_clock::now();
+
+        if (!success || msg.returnvalue() != 0) {
+            faabric::util::getLogger()->error("Call failed: {}",
+                                              msg.outputdata());
+            throw std::runtime_error("Call failed");
+        }
+
+        totalMs +=
+          std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    return totalMs / nRuns;
+}
+
+/**
+ * Measures the overhead of enforcing call time limits on compute-bound
+ * functions. Limits are set high enough that they're never hit, so any
+ * difference is the cost of watching the call.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    std::string user = "demo";
+    std::string function = "fibonacci";
+    std::string input = "30";
+    int nRuns = 20;
+    if (argc > 2) {
+        user = argv[1];
+        function = argv[2];
+    }
+    if (argc > 3) {
+        input = argv[3];
+    }
+    if (argc > 4) {
+        nRuns = std::stoi(argv[4]);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    conf.captureStdout = "on";
+
+    faabric::Message msg = faabric::util::messageFactory(user, function);
+    msg.set_inputdata(input);
+
+    // Warm up
+    runFunction(msg, 1);
+
+    const int originalWallLimit = faasmConf.callTimeLimitMs;
+    const int originalCpuLimit = faasmConf.callCpuLimitMs;
+
+    for (const std::string limits : { "off", "wall", "cpu" }) {
+        faasmConf.callTimeLimitMs = limits == "wall" ? 3600000 : 0;
+        faasmConf.callCpuLimitMs = limits == "cpu" ? 3600000 : 0;
+
+        double meanMs = runFunction(msg, nRuns);
+        printf("limits=%-4s mean=%8.3fms\n", limits.c_str(), meanMs);
+    }
+
+    faasmConf.callTimeLimitMs = originalWallLimit;
+    faasmConf.callCpuLimitMs = originalCpuLimit;
+
+    return 0;
+}
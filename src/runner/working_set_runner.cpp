@@ -0,0 +1,78 @@
+#include <conf/FaasmConfig.h>
+#include <module_cache/WasmModuleCache.h>
+#include <wasm/WorkingSet.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+/**
+ * Runs calls to a function, each from a fresh copy of its zygote as in a
+ * Faaslet, and prints how many pages of each region of linear memory the
+ * calls touched and dirtied. Pages touched by no call are candidates for
+ * leaving out of the zygote, and dirtied pages are what each call pays to
+ * copy and reset.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (argc < 3) {
+        logger->error("Usage: working_set_runner <user/function> <calls> "
+                      "[input]");
+        return 1;
+    }
+
+    std::string funcStr = argv[1];
+    int nCalls = std::stoi(argv[2]);
+    std::string input = argc > 3 ? argv[3] : "";
+
+    size_t slashIdx = funcStr.find('/');
+    if (slashIdx == std::string::npos) {
+        logger->error("Expected user/function but got {}", funcStr);
+        return 1;
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+    conf.wasmVm = "wavm";
+    conf::getFaasmConfig().workingSetFunctions = funcStr;
+
+    faabric::Message baseMsg = faabric::util::messageFactory(
+      funcStr.substr(0, slashIdx), funcStr.substr(slashIdx + 1));
+    baseMsg.set_inputdata(input);
+
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      module_cache::getWasmModuleCache().getCachedModule(baseMsg);
+
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message msg = baseMsg;
+        faabric::util::setMessageId(msg);
+
+        wasm::WAVMWasmModule module(*zygote);
+        bool success = module.execute(msg);
+        if (!success || msg.returnvalue() != 0) {
+            logger->warn("Call {} to {} failed: {}",
+                         i,
+                         funcStr,
+                         msg.outputdata());
+        }
+    }
+
+    wasm::WorkingSetReport report;
+    if (!wasm::getFunctionWorkingSets().getReport(funcStr, report)) {
+        logger->error("No working set recorded for {}", funcStr);
+        return 1;
+    }
+
+    printf("Working set of %s (zygote memory %lu bytes)\n",
+           funcStr.c_str(),
+           zygote->getMemorySizeBytes());
+    printf("%s", report.toString().c_str());
+
+    module_cache::getWasmModuleCache().clear();
+
+    return 0;
+}
@@ -129,7 +129,7 @@ uint16_t errnoToWasi(int errnoIn)
     }
 }
 
-std::string FileDescriptor::getPath()
+std::string FileDescriptor::getPath() const
 {
     return path;
 }
@@ -139,7 +139,7 @@ void FileDescriptor::setPath(const std::string& newPath)
     path = newPath;
 }
 
-std::string FileDescriptor::absPath(const std::string& relativePath)
+std::string FileDescriptor::absPath(const std::string& relativePath) const
 {
     std::string res;
 
@@ -187,7 +187,7 @@ void FileDescriptor::iterReset()
     // Reset iterator state
     dirContentsLoaded = false;
     dirContentsIdx = 0;
-    dirContents.clear();
+    dirContents.reset();
 }
 
 void FileDescriptor::loadDirContents()
@@ -216,6 +216,7 @@ void FileDescriptor::loadDirContents()
     }
 
     // Load all directory entries
+    auto entries = std::make_shared<std::vector<DirEnt>>();
     uint64_t nextIdx = 0;
     struct dirent* direntPtr;
     while ((direntPtr = ::readdir(dirPtr)) != nullptr) {
@@ -232,12 +233,14 @@ void FileDescriptor::loadDirContents()
         nextEnt.ino = direntPtr->d_ino;
         nextEnt.path = std::string(direntPtr->d_name);
 
-        dirContents.push_back(nextEnt);
+        entries->push_back(nextEnt);
     }
 
     // Close iterator
     closedir(dirPtr);
-    logger->debug("Loaded {} entries for {}", dirContents.size(), realPath);
+    logger->debug("Loaded {} entries for {}", entries->size(), realPath);
+
+    dirContents = entries;
 
     // Set flag
     dirContentsLoaded = true;
@@ -263,7 +266,7 @@ bool FileDescriptor::iterStarted()
 
 bool FileDescriptor::iterFinished()
 {
-    return dirContentsLoaded && (dirContentsIdx >= dirContents.size());
+    return dirContentsLoaded && (dirContentsIdx >= dirContents->size());
 }
 
 DirEnt FileDescriptor::iterNext()
@@ -278,10 +281,10 @@ DirEnt FileDescriptor::iterNext()
         throw std::runtime_error(
           fmt::format("Accessing index {} in directory length {}",
                       dirContentsIdx,
-                      dirContents.size()));
+                      dirContents->size()));
     }
 
-    DirEnt nextEntry = dirContents.at(dirContentsIdx);
+    DirEnt nextEntry = dirContents->at(dirContentsIdx);
 
     // Increment the iterator
     dirContentsIdx++;
@@ -530,7 +533,7 @@ bool FileDescriptor::rename(const std::string& newPath,
     return true;
 }
 
-Stat FileDescriptor::stat(const std::string& relativePath)
+Stat FileDescriptor::stat(const std::string& relativePath) const
 {
     struct stat nativeStat
     {};
@@ -650,38 +653,38 @@ uint16_t FileDescriptor::seek(int64_t offset,
     return __WASI_ESUCCESS;
 }
 
-uint64_t FileDescriptor::tell()
+uint64_t FileDescriptor::tell() const
 {
     off_t result = ::lseek(linuxFd, 0, SEEK_CUR);
     return result;
 }
 
-int FileDescriptor::getLinuxFd()
+int FileDescriptor::getLinuxFd() const
 {
     return linuxFd;
 }
 
-int FileDescriptor::getLinuxFlags()
+int FileDescriptor::getLinuxFlags() const
 {
     return linuxFlags;
 }
 
-int FileDescriptor::getLinuxErrno()
+int FileDescriptor::getLinuxErrno() const
 {
     return linuxErrno;
 }
 
-uint16_t FileDescriptor::getWasiErrno()
+uint16_t FileDescriptor::getWasiErrno() const
 {
     return wasiErrno;
 }
 
-uint64_t FileDescriptor::getActualRightsBase()
+uint64_t FileDescriptor::getActualRightsBase() const
 {
     return actualRightsBase;
 }
 
-uint64_t FileDescriptor::getActualRightsInheriting()
+uint64_t FileDescriptor::getActualRightsInheriting() const
 {
     return actualRightsInheriting;
 }
@@ -1,4 +1,5 @@
 #include "FileLoader.h"
+#include "FunctionVersions.h"
 #include <boost/filesystem/operations.hpp>
 #include <stdexcept>
 
@@ -10,6 +11,8 @@
 #include <wamr/WAMRWasmModule.h>
 #endif
 
+#include <conf/FaasmConfig.h>
+#include <ir_cache/ProfileGuided.h>
 #include <wavm/WAVMWasmModule.h>
 
 #include <faabric/util/config.h>
@@ -18,6 +21,7 @@
 #include <faabric/util/logging.h>
 
 #include <boost/filesystem.hpp>
+#include <cstring>
 
 namespace storage {
 
@@ -31,13 +35,42 @@ std::vector<uint8_t> FileLoader::hashBytes(const std::vector<uint8_t>& bytes)
     return result;
 }
 
+/**
+ * Hashes the input to codegen. Metering changes the generated code, so it's
+ * part of the hash, and turning it on or off regenerates the object.
+ */
+std::vector<uint8_t> FileLoader::hashCodegenInput(
+  const std::vector<uint8_t>& bytes,
+  bool meter)
+{
+    if (!meter) {
+        return hashBytes(bytes);
+    }
+
+    std::vector<uint8_t> meteredBytes = bytes;
+    const char* suffix = METER_COUNTER_NAME;
+    meteredBytes.insert(meteredBytes.end(), suffix, suffix + strlen(suffix));
+    return hashBytes(meteredBytes);
+}
+
+/**
+ * Only WAVM objects can be metered.
+ */
+bool FileLoader::shouldMeter(const faabric::Message& msg)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    return conf.wasmVm == "wavm" &&
+           conf::isFunctionInList(conf::getFaasmConfig().meterFunctions, msg);
+}
+
 std::string FileLoader::getHashFilePath(const std::string& path)
 {
     return path + HASH_EXT;
 }
 
 std::vector<uint8_t> FileLoader::doCodegen(std::vector<uint8_t>& bytes,
-                                           const std::string& fileName)
+                                           const std::string& fileName,
+                                           bool meter)
 {
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
     if (conf.wasmVm == "wamr") {
@@ -48,7 +81,7 @@ std::vector<uint8_t> FileLoader::doCodegen(std::vector<uint8_t>& bytes,
         return wasm::wamrCodegen(bytes);
 #endif
     } else {
-        return wasm::wavmCodegen(bytes, fileName);
+        return wasm::wavmCodegen(bytes, fileName, meter);
     }
 }
 
@@ -64,7 +97,8 @@ void FileLoader::codegenForFunction(faabric::Message& msg)
     }
 
     // Compare hashes
-    std::vector<uint8_t> newHash = hashBytes(bytes);
+    bool meter = shouldMeter(msg);
+    std::vector<uint8_t> newHash = hashCodegenInput(bytes, meter);
     std::vector<uint8_t> oldHash;
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
     if (conf.wasmVm == "wamr") {
@@ -85,7 +119,7 @@ void FileLoader::codegenForFunction(faabric::Message& msg)
     // Run the actual codegen
     std::vector<uint8_t> objBytes;
     try {
-        objBytes = doCodegen(bytes, funcStr);
+        objBytes = doCodegen(bytes, funcStr, meter);
     } catch (std::runtime_error& ex) {
         logger->error("Codegen failed for " + funcStr);
         throw ex;
@@ -101,6 +135,56 @@ void FileLoader::codegenForFunction(faabric::Message& msg)
     }
 }
 
+/**
+ * Replaces a function's WAVM object file with either an instrumented build,
+ * which collects counts as it runs, or one optimised using the counts
+ * collected so far. The hash is kept, so normal codegen leaves the new object
+ * in place until the function's wasm changes.
+ */
+wasm::PgoPlan FileLoader::pgoCodegenForFunction(faabric::Message& msg,
+                                                bool instrument)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    if (conf.wasmVm != "wavm") {
+        throw std::runtime_error("Profile-guided codegen only supports WAVM");
+    }
+
+    std::vector<uint8_t> bytes = loadFunctionWasm(msg);
+    if (bytes.empty()) {
+        throw std::runtime_error("Loaded empty bytes for " + funcStr);
+    }
+
+    wasm::PgoProfileStore& profiles = wasm::getPgoProfileStore();
+
+    bool meter = shouldMeter(msg);
+    wasm::PgoPlan plan;
+    std::vector<uint8_t> objBytes;
+    if (instrument) {
+        objBytes = wasm::wavmPgoCodegen(bytes, funcStr, nullptr, plan, meter);
+    } else {
+        wasm::PgoProfile profile = profiles.getProfile(msg);
+        if (profile.empty()) {
+            throw std::runtime_error("No profile collected for " + funcStr);
+        }
+
+        objBytes = wasm::wavmPgoCodegen(bytes, funcStr, &profile, plan, meter);
+    }
+
+    uploadFunctionObjectFile(msg, objBytes);
+    uploadFunctionObjectHash(msg, hashCodegenInput(bytes, meter));
+
+    // Counts from an earlier instrumented build no longer apply
+    if (instrument) {
+        profiles.reset(msg);
+    }
+
+    // Make hosts drop any code cached from the old object
+    getFunctionVersions().bumpVersion(msg);
+
+    return plan;
+}
+
 void FileLoader::codegenForSharedObject(const std::string& inputPath)
 {
     auto logger = faabric::util::getLogger();
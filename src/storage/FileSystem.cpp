@@ -10,9 +10,9 @@ namespace storage {
 void FileSystem::prepareFilesystem()
 {
     // Predefined stdin, stdout and stderr
-    fileDescriptors.emplace(0, storage::FileDescriptor::stdinFactory());
-    fileDescriptors.emplace(1, storage::FileDescriptor::stdoutFactory());
-    fileDescriptors.emplace(2, storage::FileDescriptor::stderrFactory());
+    addFileDescriptor(0) = storage::FileDescriptor::stdinFactory();
+    addFileDescriptor(1) = storage::FileDescriptor::stdoutFactory();
+    addFileDescriptor(2) = storage::FileDescriptor::stderrFactory();
 
     // Add roots, note that they are predefined as the file descriptors
     // just above the stdxxx's (i.e. > 3)
@@ -47,7 +47,7 @@ void FileSystem::createPreopenedFileDescriptor(int fd, const std::string& path)
 
     // Add to this module's fds
     fileDesc.wasiPreopenType = __WASI_PREOPENTYPE_DIR;
-    fileDescriptors.emplace(fd, fileDesc);
+    addFileDescriptor(fd) = fileDesc;
 }
 
 int FileSystem::getNewFd()
@@ -58,13 +58,34 @@ int FileSystem::getNewFd()
     return thisFd;
 }
 
+/**
+ * Copies the table if it's shared with another filesystem, so that it can be
+ * changed without affecting the other.
+ */
+FileSystem::FdTable& FileSystem::getMutableTable()
+{
+    if (fileDescriptors.use_count() > 1) {
+        fileDescriptors = std::make_shared<FdTable>(*fileDescriptors);
+    }
+
+    return *fileDescriptors;
+}
+
+storage::FileDescriptor& FileSystem::addFileDescriptor(int fd)
+{
+    auto desc = std::make_shared<storage::FileDescriptor>();
+    getMutableTable()[fd] = desc;
+    return *desc;
+}
+
 std::string FileSystem::getPathForFd(int fd)
 {
-    if (fileDescriptors.count(fd) == 0) {
+    auto it = fileDescriptors->find(fd);
+    if (it == fileDescriptors->end()) {
         return "";
     }
 
-    return fileDescriptors[fd].getPath();
+    return it->second->getPath();
 }
 
 int FileSystem::openFileDescriptor(int rootFd,
@@ -77,7 +98,7 @@ int FileSystem::openFileDescriptor(int rootFd,
 {
     auto logger = faabric::util::getLogger();
 
-    storage::FileDescriptor& rootFileDesc = getFileDescriptor(rootFd);
+    const storage::FileDescriptor& rootFileDesc = lookupFileDescriptor(rootFd);
 
     std::string fullPath;
     if (SharedFiles::isPathShared(relativePath)) {
@@ -92,7 +113,7 @@ int FileSystem::openFileDescriptor(int rootFd,
 
     // Initialise the new fd
     int thisFd = getNewFd();
-    FileDescriptor& fileDesc = fileDescriptors[thisFd];
+    FileDescriptor& fileDesc = addFileDescriptor(thisFd);
     fileDesc.setPath(fullPath);
 
     // AND requested rights with those of the root file descriptor. Rights for
@@ -117,24 +138,49 @@ int FileSystem::openFileDescriptor(int rootFd,
 
 bool FileSystem::fileDescriptorExists(int fd)
 {
-    return fileDescriptors.count(fd) > 0;
+    return fileDescriptors->count(fd) > 0;
 }
 
+/**
+ * Returns the descriptor for the given fd, copying it first if it's shared
+ * with another filesystem, as the caller may change it (e.g. by seeking or
+ * reading a directory). Callers that only read it should use
+ * lookupFileDescriptor instead.
+ */
 storage::FileDescriptor& FileSystem::getFileDescriptor(int fd)
 {
-    if (fileDescriptors.count(fd) == 0) {
+    if (fileDescriptors->count(fd) == 0) {
         throw std::runtime_error("File descriptor does not exist");
     }
 
-    return fileDescriptors.at(fd);
+    std::shared_ptr<storage::FileDescriptor>& desc = getMutableTable().at(fd);
+    if (desc.use_count() > 1) {
+        desc = std::make_shared<storage::FileDescriptor>(*desc);
+    }
+
+    return *desc;
+}
+
+/**
+ * Returns the descriptor for the given fd without copying anything, so it
+ * stays shared with any other filesystem.
+ */
+const storage::FileDescriptor& FileSystem::lookupFileDescriptor(int fd) const
+{
+    auto it = fileDescriptors->find(fd);
+    if (it == fileDescriptors->end()) {
+        throw std::runtime_error("File descriptor does not exist");
+    }
+
+    return *it->second;
 }
 
 int FileSystem::dup(int fd)
 {
     int newFd = getNewFd();
 
-    FileDescriptor& originalDesc = getFileDescriptor(fd);
-    FileDescriptor& newDesc = fileDescriptors[newFd];
+    const FileDescriptor& originalDesc = lookupFileDescriptor(fd);
+    FileDescriptor& newDesc = addFileDescriptor(newFd);
     newDesc.duplicate(originalDesc);
 
     return newFd;
@@ -142,10 +188,15 @@ int FileSystem::dup(int fd)
 
 void FileSystem::tearDown()
 {
-    for (auto& f : fileDescriptors) {
-        // Only close non-preopened fds
-        if (f.second.wasiPreopenType != __WASI_PREOPENTYPE_DIR) {
-            f.second.close();
+    for (auto& f : *fileDescriptors) {
+        // Only close non-preopened fds that aren't shared with another
+        // filesystem
+        if (f.second.use_count() > 1) {
+            continue;
+        }
+
+        if (f.second->wasiPreopenType != __WASI_PREOPENTYPE_DIR) {
+            f.second->close();
         }
     }
 }
@@ -160,11 +211,32 @@ void FileSystem::clearSharedFiles()
     boost::filesystem::remove_all(conf.sharedFilesDir);
 }
 
+size_t FileSystem::getFileDescriptorCount()
+{
+    return fileDescriptors->size();
+}
+
+/**
+ * Returns how many descriptors this filesystem holds its own copy of, i.e.
+ * that aren't shared with any other.
+ */
+size_t FileSystem::getOwnedFileDescriptorCount()
+{
+    size_t count = 0;
+    for (auto& f : *fileDescriptors) {
+        if (f.second.use_count() == 1) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
 void FileSystem::printDebugInfo()
 {
     printf("--- Open file descriptors ---\n");
-    for (auto p : fileDescriptors) {
-        printf("    %s\n", p.second.getPath().c_str());
+    for (auto& p : *fileDescriptors) {
+        printf("    %s\n", p.second->getPath().c_str());
     }
 }
 
@@ -173,6 +173,18 @@ void FileserverFileLoader::flushFunctionFiles()
     boost::filesystem::remove_all(conf.objectFileDir);
 }
 
+void FileserverFileLoader::flushFunctionFiles(const faabric::Message& msg)
+{
+    // Remove just this function's local copies, so that they're fetched
+    // again from the file server on the next load
+    for (const std::string& path : { faabric::util::getFunctionFile(msg),
+                                     faabric::util::getFunctionObjectFile(msg),
+                                     faabric::util::getFunctionAotFile(msg) }) {
+        boost::filesystem::remove(path);
+        boost::filesystem::remove(getHashFilePath(path));
+    }
+}
+
 // --------------------------------------------------------
 // TODO: implement hashing and hash storage in fileserver mode
 // --------------------------------------------------------
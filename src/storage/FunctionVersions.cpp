@@ -0,0 +1,72 @@
+#include "FunctionVersions.h"
+
+#include <conf/FaasmConfig.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <chrono>
+
+namespace storage {
+FunctionVersions& getFunctionVersions()
+{
+    static FunctionVersions v;
+    return v;
+}
+
+std::string getFunctionVersionKey(const faabric::Message& msg)
+{
+    return "function_version_" + faabric::util::funcToString(msg, false);
+}
+
+static long getNowMillis()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+long FunctionVersions::getVersion(const faabric::Message& msg)
+{
+    const std::string key = getFunctionVersionKey(msg);
+    long now = getNowMillis();
+    int checkIntervalMs = conf::getFaasmConfig().functionVersionCheckMs;
+
+    std::scoped_lock<std::mutex> guard(mx);
+    auto it = versions.find(key);
+    if (it != versions.end() && now - it->second.second < checkIntervalMs) {
+        return it->second.first;
+    }
+
+    // Functions that have never been uploaded through the upload server
+    // are at version zero
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    long version = redis.getLong(key);
+    versions[key] = std::make_pair(version, now);
+
+    return version;
+}
+
+long FunctionVersions::bumpVersion(const faabric::Message& msg)
+{
+    const std::string key = getFunctionVersionKey(msg);
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    long version = redis.incrByLong(key, 1);
+
+    faabric::util::getLogger()->debug("Bumped {} to version {}",
+                                      faabric::util::funcToString(msg, false),
+                                      version);
+
+    std::scoped_lock<std::mutex> guard(mx);
+    versions[key] = std::make_pair(version, getNowMillis());
+
+    return version;
+}
+
+void FunctionVersions::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    versions.clear();
+}
+}
@@ -8,6 +8,7 @@
 #include <faabric/util/logging.h>
 
 #include <boost/filesystem.hpp>
+#include <unistd.h>
 
 namespace storage {
 std::vector<uint8_t> LocalFileLoader::loadFunctionWasm(
@@ -143,9 +144,12 @@ void LocalFileLoader::uploadFunctionObjectFile(
   const faabric::Message& msg,
   const std::vector<uint8_t>& objBytes)
 {
-    // Write the file
+    // Write the file alongside and move it into place, so that hosts loading
+    // the object never see it partially written
     std::string objFilePath = faabric::util::getFunctionObjectFile(msg);
-    faabric::util::writeBytesToFile(objFilePath, objBytes);
+    std::string tmpPath = objFilePath + ".tmp." + std::to_string(getpid());
+    faabric::util::writeBytesToFile(tmpPath, objBytes);
+    boost::filesystem::rename(tmpPath, objFilePath);
 }
 
 void LocalFileLoader::uploadFunctionAotFile(
@@ -184,6 +188,11 @@ void LocalFileLoader::flushFunctionFiles()
     // host are the master copies.
 }
 
+void LocalFileLoader::flushFunctionFiles(const faabric::Message& msg)
+{
+    // As above, these are the master copies
+}
+
 void LocalFileLoader::writeHashForFile(const std::string& path,
                                        const std::vector<uint8_t>& hash)
 {
@@ -1,26 +1,77 @@
 #include "CGroup.h"
+#include "LatencyMetrics.h"
 
 #include <faabric/util/config.h>
 #include <faabric/util/logging.h>
-#include <faabric/util/timing.h>
 
 #include <mutex>
 
 #include <boost/filesystem.hpp>
 #include <syscall.h>
+#include <unistd.h>
 
 using namespace boost::filesystem;
 
 namespace isolation {
-static const std::string BASE_DIR = "/sys/fs/cgroup/";
+static const std::string DEFAULT_ROOT = "/sys/fs/cgroup/";
 static const std::string CG_CPU = "cpu";
 
 static const std::vector<std::string> controllers = { CG_CPU };
 
 static std::mutex groupMutex;
 
+static std::string& cgroupRoot()
+{
+    static std::string root = DEFAULT_ROOT;
+    return root;
+}
+
+void setCgroupRoot(const std::string& root)
+{
+    cgroupRoot() = root;
+}
+
+std::string getCgroupRoot()
+{
+    return cgroupRoot();
+}
+
+/**
+ * The unified (v2) hierarchy has a cgroup.controllers file at its root, which
+ * doesn't exist under v1.
+ */
+CgroupVersion detectCgroupVersion()
+{
+    path controllersPath(getCgroupRoot());
+    controllersPath.append("cgroup.controllers");
+
+    if (exists(controllersPath)) {
+        return CgroupVersion::cg_v2;
+    }
+
+    return CgroupVersion::cg_v1;
+}
+
+static path getGroupPath(const std::string& name)
+{
+    path groupPath(getCgroupRoot());
+    groupPath.append(name);
+    return groupPath;
+}
+
+static bool writeCgroupFile(const path& filePath, const std::string& value)
+{
+    std::ofstream outfile;
+    outfile.open(filePath.string(), std::ios_base::app);
+    outfile << value << std::endl;
+    outfile.flush();
+
+    return !outfile.fail();
+}
+
 CGroup::CGroup(const std::string& name)
   : name(name)
+  , version(detectCgroupVersion())
 {
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
 
@@ -41,6 +92,67 @@ const CgroupMode CGroup::getMode()
     return this->mode;
 }
 
+const CgroupVersion CGroup::getVersion()
+{
+    return this->version;
+}
+
+/**
+ * Cgroups are often unavailable, e.g. when running unprivileged in a
+ * container, in which case we carry on without them.
+ */
+void CGroup::disable(const std::string& reason)
+{
+    faabric::util::getLogger()->warn(
+      "Disabling cgroup {}: {}", this->name, reason);
+    mode = CgroupMode::cg_off;
+}
+
+/**
+ * Creates this group as a threaded child group under cgroup v2, and applies
+ * the given CPU limits. The group's parent must be the (domain) base group
+ * set up by initBaseCgroup. Under v1 all Faaslets share the base group, which
+ * is created externally, so this is a no-op.
+ */
+void CGroup::create(const CGroupLimits& limits)
+{
+    if (mode == CgroupMode::cg_off || version == CgroupVersion::cg_v1) {
+        return;
+    }
+
+    path groupPath = getGroupPath(this->name);
+
+    // Groups may be shared between Faaslets, so creation needs a lock
+    std::scoped_lock<std::mutex> guard(groupMutex);
+
+    boost::system::error_code ec;
+    if (!exists(groupPath)) {
+        create_directories(groupPath, ec);
+        if (ec) {
+            disable("failed to create " + groupPath.string());
+            return;
+        }
+    }
+
+    // Threaded groups let us place individual threads, rather than whole
+    // processes, which is what we need for Faaslets
+    path typePath = groupPath;
+    typePath.append("cgroup.type");
+    if (!writeCgroupFile(typePath, "threaded")) {
+        disable("failed to make group threaded");
+        return;
+    }
+
+    path weightPath = groupPath;
+    weightPath.append("cpu.weight");
+    path maxPath = groupPath;
+    maxPath.append("cpu.max");
+    if (!writeCgroupFile(weightPath, std::to_string(limits.cpuWeight)) ||
+        !writeCgroupFile(maxPath, limits.cpuMax)) {
+        disable("failed to set CPU limits");
+    }
+}
+
 pid_t getCurrentTid()
 {
     auto tid = (pid_t)syscall(SYS_gettid);
@@ -70,18 +182,83 @@ void CGroup::addCurrentThread()
         return;
     }
 
-    PROF_START(cGroupAdd)
-    // Get lock and add to controllers
-    std::scoped_lock<std::mutex> guard(groupMutex);
+    LATENCY_START(cGroupAdd)
+    if (version == CgroupVersion::cg_v2) {
+        // Writing to cgroup.threads migrates the thread atomically, so no
+        // need for the global lock here
+        path threadsPath = getGroupPath(this->name);
+        threadsPath.append("cgroup.threads");
+
+        pid_t threadId = getCurrentTid();
+        if (!writeCgroupFile(threadsPath, std::to_string(threadId))) {
+            disable("failed to migrate thread " + std::to_string(threadId));
+        } else {
+            logger->debug(
+              "Added thread id {} to {}", threadId, threadsPath.string());
+        }
+    } else {
+        // Get lock and add to controllers
+        std::scoped_lock<std::mutex> guard(groupMutex);
+
+        for (const std::string& controller : controllers) {
+            path tasksPath(getCgroupRoot());
+            tasksPath.append(controller);
+            tasksPath.append(this->name);
+            tasksPath.append("tasks");
+
+            addCurrentThreadToTasks(tasksPath);
+        }
+    }
+    LATENCY_END(cGroupAdd)
+}
+
+void initBaseCgroup(long memoryMaxBytes, long memoryHighBytes)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    if (conf.cgroupMode != "on" ||
+        detectCgroupVersion() != CgroupVersion::cg_v2) {
+        return;
+    }
+
+    path basePath = getGroupPath(BASE_CGROUP_NAME);
+    if (!exists(basePath)) {
+        logger->warn("No base cgroup at {}", basePath.string());
+        return;
+    }
+
+    // Threaded children need the process itself to live in the base group
+    path procsPath = basePath;
+    procsPath.append("cgroup.procs");
+    if (!writeCgroupFile(procsPath, std::to_string(getpid()))) {
+        logger->warn("Failed to move process into {}", basePath.string());
+        return;
+    }
+
+    // Delegate the CPU controller to the per-Faaslet groups
+    path subtreePath = basePath;
+    subtreePath.append("cgroup.subtree_control");
+    if (!writeCgroupFile(subtreePath, "+cpu")) {
+        logger->warn("Failed to enable cpu controller in {}",
+                     basePath.string());
+    }
+
+    // The memory controller isn't threaded, so memory can only be limited
+    // for the process as a whole
+    path memMaxPath = basePath;
+    memMaxPath.append("memory.max");
+    path memHighPath = basePath;
+    memHighPath.append("memory.high");
 
-    for (const std::string& controller : controllers) {
-        path tasksPath(BASE_DIR);
-        tasksPath.append(controller);
-        tasksPath.append(this->name);
-        tasksPath.append("tasks");
+    std::string maxValue =
+      memoryMaxBytes > 0 ? std::to_string(memoryMaxBytes) : "max";
+    std::string highValue =
+      memoryHighBytes > 0 ? std::to_string(memoryHighBytes) : "max";
 
-        addCurrentThreadToTasks(tasksPath);
+    if (!writeCgroupFile(memMaxPath, maxValue) ||
+        !writeCgroupFile(memHighPath, highValue)) {
+        logger->warn("Failed to set memory limits on {}", basePath.string());
     }
-    PROF_END(cGroupAdd)
 }
 }
@@ -0,0 +1,137 @@
+#include "CallTrace.h"
+
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+namespace isolation {
+static thread_local CallTrace* activeCallTrace = nullptr;
+
+long traceMicros(const std::chrono::steady_clock::time_point& t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             t.time_since_epoch())
+      .count();
+}
+
+CallTrace* getActiveCallTrace()
+{
+    return activeCallTrace;
+}
+
+void setActiveCallTrace(CallTrace* trace)
+{
+    activeCallTrace = trace;
+}
+
+void recordTraceSpan(const char* category,
+                     const char* name,
+                     const std::chrono::steady_clock::time_point& start)
+{
+    CallTrace* trace = activeCallTrace;
+    if (trace == nullptr) {
+        return;
+    }
+
+    long startUs = traceMicros(start);
+    long endUs = traceMicros(std::chrono::steady_clock::now());
+    trace->events.push_back({ category, name, startUs, endUs - startUs });
+}
+
+TraceSpan::TraceSpan(const char* categoryIn, const char* nameIn)
+  : category(categoryIn)
+  , name(nameIn)
+  , trace(activeCallTrace)
+{
+    if (trace != nullptr) {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    // The call may have finished inside the span, in which case it's dropped
+    if (trace != nullptr && trace == activeCallTrace) {
+        recordTraceSpan(category, name, start);
+    }
+}
+
+static std::string escapeJson(const std::string& str)
+{
+    std::string escaped;
+    for (char c : str) {
+        switch (c) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\b':
+                escaped += "\\b";
+                break;
+            case '\f':
+                escaped += "\\f";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default: {
+                // Any other control characters as unicode escapes
+                if ((unsigned char)c < 0x20) {
+                    char buf[7];
+                    snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                    escaped += buf;
+                } else {
+                    escaped += c;
+                }
+            }
+        }
+    }
+
+    return escaped;
+}
+
+/**
+ * Renders traces in the Chrome trace-event format, readable by
+ * chrome://tracing and Perfetto. Each call is shown as its own thread, named
+ * after the call.
+ */
+std::string callTracesToChromeJson(
+  const std::vector<std::shared_ptr<CallTrace>>& traces)
+{
+    int pid = getpid();
+
+    std::stringstream ss;
+    ss << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+    bool first = true;
+    for (auto& t : traces) {
+        ss << (first ? "\n" : ",\n");
+        first = false;
+
+        ss << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+           << ", \"tid\": " << t->messageId
+           << ", \"args\": {\"name\": \"" << escapeJson(t->funcStr) << " ("
+           << t->messageId << ")\"}}";
+
+        for (auto& e : t->events) {
+            ss << ",\n{\"name\": \"" << escapeJson(e.name)
+               << "\", \"cat\": \"" << escapeJson(e.category)
+               << "\", \"ph\": \"X\", \"ts\": " << e.startUs
+               << ", \"dur\": " << e.durationUs << ", \"pid\": " << pid
+               << ", \"tid\": " << t->messageId
+               << ", \"args\": {\"traceId\": " << t->traceId << "}}";
+        }
+    }
+
+    ss << "\n]}\n";
+    return ss.str();
+}
+}
@@ -0,0 +1,346 @@
+#include "IsolationManager.h"
+#include "LatencyMetrics.h"
+
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#define NETNS_DIR "/var/run/netns"
+
+namespace isolation {
+static thread_local IsolationContext* threadContext = nullptr;
+
+// Namespaces are joined per thread, so each tracks the context it has joined
+static thread_local IsolationContext* attachedContext = nullptr;
+
+static std::atomic<long> networkAttachCount = 0;
+
+IsolationManager& getIsolationManager()
+{
+    static IsolationManager manager;
+    return manager;
+}
+
+void setThreadIsolationContext(IsolationContext* context)
+{
+    threadContext = context;
+}
+
+IsolationContext* getThreadIsolationContext()
+{
+    return threadContext;
+}
+
+/**
+ * Called before anything that needs the network, e.g. opening a socket.
+ * Threads not running in a context are left alone.
+ */
+void attachThreadNetwork()
+{
+    if (threadContext != nullptr && !threadContext->isNetworkAttached()) {
+        threadContext->attachNetwork();
+    }
+}
+
+ThreadIsolationScope::ThreadIsolationScope(IsolationContext* context)
+  : previousContext(threadContext)
+  , wasAttached(context != nullptr && context->isNetworkAttached())
+{
+    threadContext = context;
+}
+
+ThreadIsolationScope::~ThreadIsolationScope()
+{
+    if (threadContext != nullptr && !wasAttached &&
+        threadContext->isNetworkAttached()) {
+        threadContext->detachNetwork();
+    }
+
+    threadContext = previousContext;
+}
+
+long getNetworkAttachCount()
+{
+    return networkAttachCount.load();
+}
+
+// ------------------------------------
+// Contexts
+// ------------------------------------
+
+IsolationContext::IsolationContext(int idxIn,
+                                   bool ownCgroup,
+                                   const CGroupLimits& limits)
+  : idx(idxIn)
+  , ns(BASE_NETNS_NAME + std::to_string(idxIn))
+{
+    if (ownCgroup) {
+        cgroup = std::make_unique<CGroup>(std::string(BASE_CGROUP_NAME) +
+                                          "/ctx_" + std::to_string(idx));
+        cgroup->create(limits);
+    }
+}
+
+int IsolationContext::getIdx()
+{
+    return idx;
+}
+
+NetworkNamespace& IsolationContext::getNetworkNamespace()
+{
+    return ns;
+}
+
+CGroup* IsolationContext::getCgroup()
+{
+    return cgroup.get();
+}
+
+void IsolationContext::attachNetwork()
+{
+    if (attachedContext == this) {
+        return;
+    }
+
+    ns.addCurrentThread();
+    attachedContext = this;
+
+    if (ns.getMode() == NetworkIsolationMode::ns_on) {
+        networkAttachCount++;
+    }
+}
+
+void IsolationContext::detachNetwork()
+{
+    if (attachedContext != this) {
+        return;
+    }
+
+    ns.removeCurrentThread();
+    attachedContext = nullptr;
+}
+
+bool IsolationContext::isNetworkAttached()
+{
+    return attachedContext == this;
+}
+
+// ------------------------------------
+// Manager
+// ------------------------------------
+
+void IsolationManager::configure(const IsolationOptions& optionsIn)
+{
+    faabric::util::UniqueLock lock(mx);
+    options = optionsIn;
+}
+
+/**
+ * Creates contexts up front so that Faaslets don't pay for it when they're
+ * first bound.
+ */
+void IsolationManager::prewarm(int nContexts)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    while ((int)freeContexts.size() < nContexts) {
+        freeContexts.emplace_back(createContext(nextIdx++));
+    }
+}
+
+std::unique_ptr<IsolationContext> IsolationManager::acquire()
+{
+    faabric::util::UniqueLock lock(mx);
+
+    if (freeContexts.empty()) {
+        return createContext(nextIdx++);
+    }
+
+    // Reuse the most recently released context, whose cgroup is most likely
+    // to be warm
+    std::unique_ptr<IsolationContext> context =
+      std::move(freeContexts.back());
+    freeContexts.pop_back();
+
+    return context;
+}
+
+void IsolationManager::release(std::unique_ptr<IsolationContext> context)
+{
+    if (context == nullptr) {
+        return;
+    }
+
+    // Must be back in the parent namespace before anyone else can use it
+    if (context->isNetworkAttached()) {
+        context->detachNetwork();
+    }
+
+    faabric::util::UniqueLock lock(mx);
+    freeContexts.emplace_back(std::move(context));
+}
+
+std::unique_ptr<IsolationContext> IsolationManager::createContext(int idx)
+{
+    LATENCY_START(isolationContextCreate)
+
+    std::string netnsName = BASE_NETNS_NAME + std::to_string(idx);
+    if (options.createNamespaces) {
+        createNamespace(netnsName, idx);
+    }
+
+    auto context = std::make_unique<IsolationContext>(
+      idx, options.ownCgroups, options.cgroupLimits);
+
+    faabric::util::getLogger()->debug("Created isolation context {}", idx);
+
+    LATENCY_END(isolationContextCreate)
+    return context;
+}
+
+/**
+ * Runs the setup script directly, without a shell, returning its exit status
+ * or -1 if it couldn't be run or didn't exit normally.
+ */
+static int runSetupScript(const std::string& script,
+                          const std::string& name,
+                          int idx)
+{
+    std::string idxStr = std::to_string(idx);
+    std::vector<char*> argv = { const_cast<char*>(script.c_str()),
+                                const_cast<char*>(name.c_str()),
+                                const_cast<char*>(idxStr.c_str()),
+                                nullptr };
+
+    pid_t pid;
+    int err = posix_spawnp(
+      &pid, script.c_str(), nullptr, nullptr, argv.data(), environ);
+    if (err != 0) {
+        faabric::util::getLogger()->error(
+          "Failed to run {}: {}", script, std::strerror(err));
+        return -1;
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    if (!WIFEXITED(status)) {
+        return -1;
+    }
+
+    return WEXITSTATUS(status);
+}
+
+/**
+ * Does the same as ip netns add, i.e. creates a new network namespace from a
+ * short-lived thread and bind mounts it under /var/run/netns so that it
+ * outlives the thread. Loopback is brought up, and anything else (interfaces,
+ * routes, traffic shaping) is left to the setup script.
+ */
+void IsolationManager::createNamespace(const std::string& name, int idx)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    boost::filesystem::path nsPath(NETNS_DIR);
+    nsPath.append(name);
+    if (boost::filesystem::exists(nsPath)) {
+        return;
+    }
+
+    boost::filesystem::create_directories(NETNS_DIR);
+    int fd = ::open(nsPath.c_str(), O_RDONLY | O_CREAT | O_EXCL, 0);
+    if (fd < 0) {
+        logger->error("Failed to create {}: {}", nsPath.string(), errno);
+        throw std::runtime_error("Failed to create network namespace");
+    }
+    ::close(fd);
+
+    bool success = false;
+    std::thread t([&nsPath, &success] {
+        if (unshare(CLONE_NEWNET) != 0) {
+            return;
+        }
+
+        std::string selfNs =
+          "/proc/self/task/" + std::to_string(syscall(SYS_gettid)) + "/ns/net";
+        if (mount(selfNs.c_str(), nsPath.c_str(), "none", MS_BIND, nullptr) !=
+            0) {
+            return;
+        }
+
+        // Bring up loopback
+        int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock >= 0) {
+            struct ifreq ifr = {};
+            strncpy(ifr.ifr_name, "lo", IFNAMSIZ);
+            ifr.ifr_flags = IFF_UP | IFF_RUNNING;
+            ioctl(sock, SIOCSIFFLAGS, &ifr);
+            ::close(sock);
+        }
+
+        success = true;
+    });
+    t.join();
+
+    if (!success) {
+        boost::filesystem::remove(nsPath);
+        logger->error("Failed to create network namespace {}: {}",
+                      name,
+                      std::strerror(errno));
+        throw std::runtime_error("Failed to create network namespace");
+    }
+
+    if (!options.netnsSetupScript.empty()) {
+        int res = runSetupScript(options.netnsSetupScript, name, idx);
+        if (res != 0) {
+            // Don't leave a half set up namespace for the next attempt
+            umount2(nsPath.c_str(), MNT_DETACH);
+            boost::filesystem::remove(nsPath);
+
+            logger->error(
+              "Network namespace setup failed for {} ({})", name, res);
+            throw std::runtime_error("Network namespace setup failed");
+        }
+    }
+
+    logger->debug("Created network namespace {}", name);
+}
+
+int IsolationManager::getCreatedCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return nextIdx - 1;
+}
+
+int IsolationManager::getFreeCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return (int)freeContexts.size();
+}
+
+void IsolationManager::clear()
+{
+    faabric::util::UniqueLock lock(mx);
+    freeContexts.clear();
+    nextIdx = 1;
+    networkAttachCount = 0;
+}
+}
@@ -0,0 +1,249 @@
+#include "LatencyMetrics.h"
+
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace isolation {
+LatencyRegistry& getLatencyRegistry()
+{
+    static LatencyRegistry registry;
+    return registry;
+}
+
+/**
+ * Registers this thread's buckets with the registry while the thread is
+ * alive, and folds them into the registry's totals when it exits.
+ */
+class ThreadLatencyBucketsHolder
+{
+  public:
+    ThreadLatencyBucketsHolder()
+    {
+        getLatencyRegistry().addThread(&buckets);
+    }
+
+    ~ThreadLatencyBucketsHolder()
+    {
+        getLatencyRegistry().removeThread(&buckets);
+    }
+
+    ThreadLatencyBuckets buckets;
+};
+
+ThreadLatencyBuckets& getThreadLatencyBuckets()
+{
+    static thread_local ThreadLatencyBucketsHolder holder;
+    return holder.buckets;
+}
+
+/**
+ * Returns the index of the smallest bucket whose bound (2^i us) the given
+ * duration fits in.
+ */
+int getLatencyBucket(long micros)
+{
+    if (micros <= 1) {
+        return 0;
+    }
+
+    int bucket = 64 - __builtin_clzl((unsigned long)(micros - 1));
+    return std::min(bucket, LATENCY_BUCKETS - 1);
+}
+
+ThreadLatencyBuckets::ThreadLatencyBuckets()
+{
+    reset();
+}
+
+void ThreadLatencyBuckets::reset()
+{
+    for (auto& m : metrics) {
+        for (auto& b : m.buckets) {
+            b.store(0, std::memory_order_relaxed);
+        }
+        m.count.store(0, std::memory_order_relaxed);
+        m.sumMicros.store(0, std::memory_order_relaxed);
+    }
+}
+
+void mergeLatencyBuckets(ThreadLatencyBuckets& src, ThreadLatencyBuckets& dest)
+{
+    for (int i = 0; i < MAX_LATENCY_METRICS; i++) {
+        ThreadLatencyBuckets::Metric& s = src.metrics[i];
+        ThreadLatencyBuckets::Metric& d = dest.metrics[i];
+
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            d.buckets[b].fetch_add(s.buckets[b].load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+        }
+        d.count.fetch_add(s.count.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+        d.sumMicros.fetch_add(s.sumMicros.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+    }
+}
+
+int LatencyRegistry::getMetricId(const std::string& name)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = std::find(metricNames.begin(), metricNames.end(), name);
+    if (it != metricNames.end()) {
+        return it - metricNames.begin();
+    }
+
+    if (metricNames.size() >= MAX_LATENCY_METRICS) {
+        faabric::util::getLogger()->error(
+          "Too many latency metrics, cannot add {}", name);
+        throw std::runtime_error("Too many latency metrics");
+    }
+
+    metricNames.emplace_back(name);
+    return metricNames.size() - 1;
+}
+
+void LatencyRegistry::record(int metricId, long micros)
+{
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    ThreadLatencyBuckets::Metric& m =
+      getThreadLatencyBuckets().metrics[metricId];
+
+    m.buckets[getLatencyBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+    m.count.fetch_add(1, std::memory_order_relaxed);
+    m.sumMicros.fetch_add(std::max(micros, 0L), std::memory_order_relaxed);
+}
+
+void LatencyRegistry::recordSince(
+  int metricId,
+  const std::chrono::steady_clock::time_point& start)
+{
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    record(metricId,
+           std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+             .count());
+}
+
+void LatencyRegistry::setEnabled(bool enabledIn)
+{
+    enabled = enabledIn;
+}
+
+bool LatencyRegistry::isEnabled()
+{
+    return enabled;
+}
+
+void LatencyRegistry::addThread(ThreadLatencyBuckets* threadBuckets)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    threads.emplace_back(threadBuckets);
+}
+
+void LatencyRegistry::removeThread(ThreadLatencyBuckets* threadBuckets)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    mergeLatencyBuckets(*threadBuckets, exitedThreads);
+    threads.erase(std::remove(threads.begin(), threads.end(), threadBuckets),
+                  threads.end());
+}
+
+std::vector<LatencySnapshot> LatencyRegistry::getSnapshots()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    std::vector<LatencySnapshot> snapshots(metricNames.size());
+    for (size_t i = 0; i < metricNames.size(); i++) {
+        snapshots[i].name = metricNames[i];
+    }
+
+    std::vector<ThreadLatencyBuckets*> allBuckets = threads;
+    allBuckets.emplace_back(&exitedThreads);
+
+    for (ThreadLatencyBuckets* t : allBuckets) {
+        for (size_t i = 0; i < snapshots.size(); i++) {
+            ThreadLatencyBuckets::Metric& m = t->metrics[i];
+            LatencySnapshot& s = snapshots[i];
+
+            for (int b = 0; b < LATENCY_BUCKETS; b++) {
+                s.buckets[b] += m.buckets[b].load(std::memory_order_relaxed);
+            }
+            s.count += m.count.load(std::memory_order_relaxed);
+            s.sumMicros += m.sumMicros.load(std::memory_order_relaxed);
+        }
+    }
+
+    return snapshots;
+}
+
+LatencySnapshot LatencyRegistry::getSnapshot(const std::string& name)
+{
+    for (auto& s : getSnapshots()) {
+        if (s.name == name) {
+            return s;
+        }
+    }
+
+    LatencySnapshot empty;
+    empty.name = name;
+    return empty;
+}
+
+/**
+ * Renders all histograms in the Prometheus text exposition format, as a
+ * single metric family labelled by operation.
+ */
+std::string LatencyRegistry::getPrometheusText()
+{
+    std::stringstream ss;
+    ss << "# HELP " << LATENCY_METRIC_NAME
+       << " Latency of Faasm runtime operations" << std::endl;
+    ss << "# TYPE " << LATENCY_METRIC_NAME << " histogram" << std::endl;
+
+    for (auto& s : getSnapshots()) {
+        std::string label = "op=\"" + s.name + "\"";
+
+        uint64_t cumulative = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            cumulative += s.buckets[b];
+
+            std::string le = "+Inf";
+            if (b < LATENCY_BUCKETS - 1) {
+                le = std::to_string((double)(1L << b) / 1000000.0);
+            }
+
+            ss << LATENCY_METRIC_NAME << "_bucket{" << label << ",le=\"" << le
+               << "\"} " << cumulative << std::endl;
+        }
+
+        ss << LATENCY_METRIC_NAME << "_sum{" << label << "} "
+           << std::to_string((double)s.sumMicros / 1000000.0) << std::endl;
+        ss << LATENCY_METRIC_NAME << "_count{" << label << "} " << s.count
+           << std::endl;
+    }
+
+    return ss.str();
+}
+
+/**
+ * Zeroes all counts. Metric IDs are kept, as they're cached at each call
+ * site.
+ */
+void LatencyRegistry::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    for (ThreadLatencyBuckets* t : threads) {
+        t->reset();
+    }
+    exitedThreads.reset();
+}
+}
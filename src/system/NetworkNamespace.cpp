@@ -1,11 +1,11 @@
 #include "NetworkNamespace.h"
+#include "LatencyMetrics.h"
 
 #include <boost/filesystem.hpp>
 
 #include <faabric/util/config.h>
 #include <faabric/util/environment.h>
 #include <faabric/util/logging.h>
-#include <faabric/util/timing.h>
 
 #include <errno.h>
 #include <fcntl.h>
@@ -69,7 +69,7 @@ void NetworkNamespace::addCurrentThread()
         return;
     }
 
-    PROF_START(netNsAdd)
+    LATENCY_START(netNsAdd)
     logger->debug("Adding thread to network ns: {}", name);
 
     // Open path to the namespace
@@ -77,7 +77,7 @@ void NetworkNamespace::addCurrentThread()
     nsPath.append(name);
 
     joinNamespace(nsPath);
-    PROF_END(netNsAdd)
+    LATENCY_END(netNsAdd)
 };
 
 void NetworkNamespace::removeCurrentThread()
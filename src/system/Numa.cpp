@@ -0,0 +1,225 @@
+#include "Numa.h"
+
+#include <faabric/util/files.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace boost::filesystem;
+
+namespace isolation {
+NumaTopology& getNumaTopology()
+{
+    static NumaTopology topology;
+    return topology;
+}
+
+/**
+ * Parses a sysfs CPU list, e.g. "0-3,8-11".
+ */
+std::vector<int> parseCpuList(const std::string& cpuList)
+{
+    std::vector<int> cpus;
+
+    std::string trimmed = boost::trim_copy(cpuList);
+    if (trimmed.empty()) {
+        return cpus;
+    }
+
+    std::vector<std::string> ranges;
+    boost::split(ranges, trimmed, [](char c) { return c == ','; });
+    for (const auto& range : ranges) {
+        size_t dashIdx = range.find('-');
+        if (dashIdx == std::string::npos) {
+            cpus.emplace_back(std::stoi(range));
+            continue;
+        }
+
+        int first = std::stoi(range.substr(0, dashIdx));
+        int last = std::stoi(range.substr(dashIdx + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.emplace_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+NumaTopology::NumaTopology(const std::string& sysfsDir)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    // Each node has a directory named nodeN containing its CPU list
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    path nodeDir(sysfsDir);
+    if (exists(nodeDir)) {
+        for (const auto& entry : directory_iterator(nodeDir)) {
+            std::string dirName = entry.path().filename().string();
+            if (dirName.rfind("node", 0) != 0 || dirName.size() == 4 ||
+                !std::all_of(dirName.begin() + 4, dirName.end(), ::isdigit)) {
+                continue;
+            }
+
+            path cpuListPath = entry.path();
+            cpuListPath.append("cpulist");
+            if (!exists(cpuListPath)) {
+                continue;
+            }
+
+            std::vector<int> cpus = parseCpuList(
+              faabric::util::readFileToString(cpuListPath.string()));
+
+            // Memory-only nodes have no CPUs to run Faaslets on
+            if (cpus.empty()) {
+                continue;
+            }
+
+            nodes.emplace_back(std::stoi(dirName.substr(4)), cpus);
+        }
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+    for (auto& node : nodes) {
+        nodeIds.emplace_back(node.first);
+        nodeCpus.emplace_back(node.second);
+    }
+
+    // Fall back to a single node with all the CPUs we can run on
+    if (nodeIds.empty()) {
+        nodeIds.emplace_back(0);
+        nodeCpus.emplace_back(getCurrentThreadAffinity());
+    }
+
+    logger->debug("Detected {} NUMA node(s)", nodeIds.size());
+}
+
+int NumaTopology::getNodeCount()
+{
+    return (int)nodeIds.size();
+}
+
+bool NumaTopology::isNuma()
+{
+    return nodeIds.size() > 1;
+}
+
+const std::vector<int>& NumaTopology::getNodeIds()
+{
+    return nodeIds;
+}
+
+size_t NumaTopology::getNodeIndex(int nodeId)
+{
+    auto it = std::find(nodeIds.begin(), nodeIds.end(), nodeId);
+    if (it == nodeIds.end()) {
+        throw std::runtime_error("Unknown NUMA node " + std::to_string(nodeId));
+    }
+
+    return it - nodeIds.begin();
+}
+
+const std::vector<int>& NumaTopology::getNodeCpus(int nodeId)
+{
+    return nodeCpus.at(getNodeIndex(nodeId));
+}
+
+int NumaTopology::getNodeForCpu(int cpu)
+{
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        const std::vector<int>& cpus = nodeCpus.at(i);
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+            return nodeIds.at(i);
+        }
+    }
+
+    return -1;
+}
+
+int NumaTopology::getCurrentNode()
+{
+    if (!isNuma()) {
+        return nodeIds.front();
+    }
+
+    return getNodeForCpu(sched_getcpu());
+}
+
+/**
+ * Pins the current thread according to its index in the pool. Threads are
+ * spread round-robin across nodes, and are either allowed to run on any CPU
+ * in their node, or pinned to a single core. Returns the node, or -1 if this
+ * isn't a NUMA host, in which case the thread is left alone.
+ */
+int NumaTopology::pinCurrentThread(int idx, bool toCore)
+{
+    if (!isNuma()) {
+        return -1;
+    }
+
+    size_t nodeIdx = idx % nodeIds.size();
+    int nodeId = nodeIds.at(nodeIdx);
+    const std::vector<int>& cpus = nodeCpus.at(nodeIdx);
+
+    if (toCore) {
+        int cpu = cpus.at((idx / nodeIds.size()) % cpus.size());
+        setCurrentThreadAffinity({ cpu });
+
+        faabric::util::getLogger()->debug(
+          "Pinned thread {} to core {} on node {}", idx, cpu, nodeId);
+    } else {
+        setCurrentThreadAffinity(cpus);
+
+        faabric::util::getLogger()->debug(
+          "Pinned thread {} to node {}", idx, nodeId);
+    }
+
+    return nodeId;
+}
+
+int NumaTopology::pinCurrentThreadToNode(int nodeId)
+{
+    if (!isNuma()) {
+        return -1;
+    }
+
+    setCurrentThreadAffinity(getNodeCpus(nodeId));
+    return nodeId;
+}
+
+void setCurrentThreadAffinity(const std::vector<int>& cpus)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+
+    int res = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (res != 0) {
+        faabric::util::getLogger()->error("Failed to set thread affinity: {}",
+                                          res);
+        throw std::runtime_error("Failed to set thread affinity");
+    }
+}
+
+std::vector<int> getCurrentThreadAffinity()
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpuSet)) {
+            cpus.emplace_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+}
@@ -0,0 +1,69 @@
+#include "Pagemap.h"
+
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+
+namespace isolation {
+/**
+ * Reads which host pages in the given range of a private mapping have been
+ * touched or dirtied since it was mapped. A page is touched if it's mapped or
+ * swapped out, and dirtied if it's been copied on write, i.e. is mapped
+ * exclusively and no longer backed by the file. Reads of anonymous memory map
+ * the shared zero page so don't count as dirtying it.
+ *
+ * Pages the kernel mapped around a faulting read (fault-around) count as
+ * touched, so touched counts are an upper bound at that granularity.
+ */
+std::vector<uint8_t> readPageStates(const uint8_t* start, size_t nBytes)
+{
+    const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t nPages = (nBytes + pageSize - 1) / pageSize;
+    std::vector<uint8_t> states(nPages, 0);
+
+    int fd = open("/proc/self/pagemap", O_RDONLY);
+    if (fd < 0) {
+        logger->error("Failed to open pagemap: {}", strerror(errno));
+        throw std::runtime_error("Failed to open pagemap");
+    }
+
+    std::vector<uint64_t> entries(PAGEMAP_BATCH_SIZE);
+    off_t firstEntry = ((uintptr_t)start / pageSize) * sizeof(uint64_t);
+    for (size_t p = 0; p < nPages; p += PAGEMAP_BATCH_SIZE) {
+        size_t nEntries = std::min<size_t>(PAGEMAP_BATCH_SIZE, nPages - p);
+        size_t nEntryBytes = nEntries * sizeof(uint64_t);
+        ssize_t nRead = pread(fd,
+                              entries.data(),
+                              nEntryBytes,
+                              firstEntry + p * sizeof(uint64_t));
+        if (nRead != (ssize_t)nEntryBytes) {
+            close(fd);
+            logger->error("Failed to read pagemap: {}", strerror(errno));
+            throw std::runtime_error("Failed to read pagemap");
+        }
+
+        for (size_t e = 0; e < nEntries; e++) {
+            uint64_t entry = entries[e];
+
+            // Only private copies are swapped, file pages are dropped instead
+            if (entry & PAGEMAP_SWAPPED) {
+                states[p + e] = PAGE_TOUCHED | PAGE_DIRTIED;
+            } else if (entry & PAGEMAP_PRESENT) {
+                bool copied = (entry & PAGEMAP_EXCLUSIVE) &&
+                              !(entry & PAGEMAP_FILE_OR_SHARED);
+                states[p + e] = copied ? PAGE_TOUCHED | PAGE_DIRTIED
+                                       : PAGE_TOUCHED;
+            }
+        }
+    }
+
+    close(fd);
+    return states;
+}
+}
@@ -0,0 +1,114 @@
+#include "ResourceUsage.h"
+
+#include <faabric/util/logging.h>
+
+#include <chrono>
+#include <sys/resource.h>
+
+#define RESOURCE_USAGE_LOG_CAPACITY 10000
+
+namespace isolation {
+ResourceUsageLog& getResourceUsageLog()
+{
+    static ResourceUsageLog log(RESOURCE_USAGE_LOG_CAPACITY);
+    return log;
+}
+
+ResourceUsageLog::ResourceUsageLog(size_t capacityIn)
+  : capacity(capacityIn)
+{}
+
+void ResourceUsageLog::record(unsigned int messageId,
+                              const CallResourceUsage& usage)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    if (usages.find(messageId) == usages.end()) {
+        order.push_back(messageId);
+    }
+    usages[messageId] = usage;
+
+    while (order.size() > capacity) {
+        usages.erase(order.front());
+        order.pop_front();
+    }
+}
+
+bool ResourceUsageLog::getUsage(unsigned int messageId,
+                                CallResourceUsage& usage)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = usages.find(messageId);
+    if (it == usages.end()) {
+        return false;
+    }
+
+    usage = it->second;
+    return true;
+}
+
+size_t ResourceUsageLog::getSize()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    return usages.size();
+}
+
+void ResourceUsageLog::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    order.clear();
+    usages.clear();
+}
+
+ResourceUsageMeter::ResourceUsageMeter(unsigned int messageIdIn)
+  : messageId(messageIdIn)
+{
+    startMicros = getSteadyClockMicros();
+    startCpuMicros = getThreadCpuMicros();
+}
+
+ResourceUsageMeter::~ResourceUsageMeter()
+{
+    CallResourceUsage usage;
+    usage.cpuTimeMicros = getThreadCpuMicros() - startCpuMicros;
+    usage.startMicros = startMicros;
+    usage.endMicros = getSteadyClockMicros();
+    usage.instructions = instructions;
+    usage.finalMemoryBytes = finalMemoryBytes;
+
+    faabric::util::getLogger()->trace("Call {} used {}us CPU, {} bytes memory",
+                                      messageId,
+                                      usage.cpuTimeMicros,
+                                      usage.finalMemoryBytes);
+
+    getResourceUsageLog().record(messageId, usage);
+}
+
+void ResourceUsageMeter::setInstructions(long instructionsIn)
+{
+    instructions = instructionsIn;
+}
+
+void ResourceUsageMeter::setFinalMemory(long finalMemoryBytesIn)
+{
+    finalMemoryBytes = finalMemoryBytesIn;
+}
+
+long getThreadCpuMicros()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    long userMicros = usage.ru_utime.tv_sec * 1000000L + usage.ru_utime.tv_usec;
+    long sysMicros = usage.ru_stime.tv_sec * 1000000L + usage.ru_stime.tv_usec;
+    return userMicros + sysMicros;
+}
+
+long getSteadyClockMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}
@@ -8,6 +8,7 @@
 #include <faabric/util/config.h>
 #include <faabric/util/files.h>
 #include <storage/FileLoader.h>
+#include <storage/FunctionVersions.h>
 
 namespace edge {
 void setPermissiveHeaders(http_response& response)
@@ -291,6 +292,9 @@ void UploadServer::handleFunctionUpload(const http_request& request)
     storage::FileLoader& l = storage::getFileLoader();
     l.uploadFunction(msg);
 
+    // Let hosts know their cached artefacts for this function are stale
+    storage::getFunctionVersions().bumpVersion(msg);
+
     request.reply(status_codes::OK, "Function upload complete\n");
 }
 
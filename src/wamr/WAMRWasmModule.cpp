@@ -258,6 +258,17 @@ uint8_t* WAMRWasmModule::wasmPointerToNative(int32_t wasmPtr)
     return static_cast<uint8_t*>(nativePtr);
 }
 
+size_t WAMRWasmModule::getMemorySizeBytes()
+{
+    if (!_isBound) {
+        return 0;
+    }
+
+    // WAMR doesn't expose the size of the linear memory, so we use the stack
+    // and heap it was instantiated with
+    return (STACK_SIZE_KB + HEAP_SIZE_KB) * 1024;
+}
+
 uint32_t WAMRWasmModule::mmapFile(uint32_t fp, uint32_t length)
 {
     // TODO - implement
@@ -4,6 +4,8 @@
 #include <faabric/util/macros.h>
 #include <proto/faabric.pb.h>
 #include <wamr/native.h>
+#include <wasm/LocalCallBuffers.h>
+#include <wasm/OutputStreams.h>
 #include <wasm/WasmModule.h>
 #include <wasm/chaining.h>
 #include <wasm_export.h>
@@ -21,18 +23,16 @@ static int32_t __faasm_read_input_wrapper(wasm_exec_env_t exec_env,
       "S - faasm_read_input {} {}", inBuff, inLen);
 
     faabric::Message* call = getExecutingCall();
-    std::vector<uint8_t> inputBytes =
-      faabric::util::stringToBytes(call->inputdata());
 
-    // If nothing, return nothing
-    if (inputBytes.empty()) {
-        return 0;
+    // Zero-length buffer means the caller just wants the input size
+    if (inLen <= 0) {
+        return (int32_t)getCallInputSize(*call);
     }
 
     // Write to the wasm buffer
-    int inputSize = faabric::util::safeCopyToBuffer(
-      inputBytes, reinterpret_cast<uint8_t*>(inBuff), inLen);
-    return inputSize;
+    size_t inputSize =
+      readCallInput(*call, reinterpret_cast<uint8_t*>(inBuff), inLen);
+    return (int32_t)inputSize;
 }
 
 /**
@@ -46,7 +46,22 @@ static void __faasm_write_output_wrapper(wasm_exec_env_t exec_env,
       "S - faasm_write_output {} {}", outBuff, outLen);
 
     faabric::Message* call = getExecutingCall();
-    call->set_outputdata(outBuff, outLen);
+    writeCallOutput(*call, reinterpret_cast<uint8_t*>(outBuff), outLen);
+}
+
+/**
+ * Append a chunk to the function's streamed output
+ */
+static void __faasm_write_output_chunk_wrapper(wasm_exec_env_t exec_env,
+                                               char* chunkBuff,
+                                               int32_t chunkLen)
+{
+    faabric::util::getLogger()->debug(
+      "S - faasm_write_output_chunk {} {}", chunkBuff, chunkLen);
+
+    faabric::Message* call = getExecutingCall();
+    writeCallOutputChunk(
+      *call, reinterpret_cast<uint8_t*>(chunkBuff), chunkLen);
 }
 
 /**
@@ -77,9 +92,30 @@ static int32_t __faasm_await_call_wrapper(wasm_exec_env_t exec_env,
     return result;
 }
 
+/**
+ * Read the next part of a chained function's streamed output
+ */
+static int32_t __faasm_read_call_output_chunk_wrapper(wasm_exec_env_t exec_env,
+                                                      int32_t callId,
+                                                      char* buffer,
+                                                      int32_t bufferLen)
+{
+    faabric::util::getLogger()->debug(
+      "S - faasm_read_call_output_chunk {} {}", callId, bufferLen);
+
+    if (bufferLen <= 0) {
+        return 0;
+    }
+
+    return (int32_t)readCallOutputChunk(
+      (uint32_t)callId, reinterpret_cast<uint8_t*>(buffer), bufferLen);
+}
+
 static NativeSymbol ns[] = {
     REG_NATIVE_FUNC(__faasm_write_output, "($i)"),
     REG_NATIVE_FUNC(__faasm_read_input, "($i)i"),
+    REG_NATIVE_FUNC(__faasm_write_output_chunk, "(*~)"),
+    REG_NATIVE_FUNC(__faasm_read_call_output_chunk, "(i*~)i"),
     REG_NATIVE_FUNC(__faasm_chain_ptr, "(i$i)i"),
     REG_NATIVE_FUNC(__faasm_await_call, "(i)i"),
 };
@@ -0,0 +1,89 @@
+#include "CallGraph.h"
+
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+
+namespace wasm {
+CallGraph& getCallGraph()
+{
+    static CallGraph g;
+    return g;
+}
+
+void CallGraph::recordCall(const faabric::Message& msg)
+{
+    const std::string key = faabric::util::funcToString(msg, false);
+
+    faabric::util::FullLock lock(mx);
+    callCounts[key]++;
+}
+
+void CallGraph::recordChainedCall(const faabric::Message& parent,
+                                  const faabric::Message& child)
+{
+    const std::string key = faabric::util::funcToString(parent, false);
+
+    faabric::util::FullLock lock(mx);
+    chainedCallCounts[key][child.function()]++;
+}
+
+long CallGraph::getCallCount(const faabric::Message& msg)
+{
+    const std::string key = faabric::util::funcToString(msg, false);
+
+    faabric::util::SharedLock lock(mx);
+    auto it = callCounts.find(key);
+    return it == callCounts.end() ? 0 : it->second;
+}
+
+long CallGraph::getChainedCallCount(const faabric::Message& parent,
+                                    const faabric::Message& child)
+{
+    const std::string key = faabric::util::funcToString(parent, false);
+
+    faabric::util::SharedLock lock(mx);
+    auto it = chainedCallCounts.find(key);
+    if (it == chainedCallCounts.end()) {
+        return 0;
+    }
+
+    auto childIt = it->second.find(child.function());
+    return childIt == it->second.end() ? 0 : childIt->second;
+}
+
+/**
+ * Returns the children which are chained by at least the given percentage of
+ * calls to this function. Note that a function can chain the same child many
+ * times in one call, so this is an upper bound on the real likelihood.
+ */
+std::vector<std::string> CallGraph::getLikelyChildren(
+  const faabric::Message& msg,
+  int minPercentage)
+{
+    const std::string key = faabric::util::funcToString(msg, false);
+    std::vector<std::string> children;
+
+    faabric::util::SharedLock lock(mx);
+    auto callIt = callCounts.find(key);
+    auto chainIt = chainedCallCounts.find(key);
+    if (callIt == callCounts.end() || chainIt == chainedCallCounts.end()) {
+        return children;
+    }
+
+    long nCalls = callIt->second;
+    for (const auto& p : chainIt->second) {
+        if (p.second * 100 >= minPercentage * nCalls) {
+            children.emplace_back(p.first);
+        }
+    }
+
+    return children;
+}
+
+void CallGraph::clear()
+{
+    faabric::util::FullLock lock(mx);
+    callCounts.clear();
+    chainedCallCounts.clear();
+}
+}
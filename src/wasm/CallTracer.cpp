@@ -0,0 +1,255 @@
+#include "wasm/CallTracer.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/clock.h>
+#include <faabric/util/files.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <unistd.h>
+
+namespace wasm {
+// Calls being traced on this thread. Usually just the one executing, but a
+// call's trace stays open until it's been reset, by which point the Faaslet
+// may have executed others in a batch.
+static thread_local std::
+  unordered_map<unsigned int, std::unique_ptr<isolation::CallTrace>>
+    threadCallTraces;
+
+CallTracer& getCallTracer()
+{
+    static CallTracer tracer;
+    return tracer;
+}
+
+/**
+ * Checks whether the call should be traced, and if so which trace it's part
+ * of. Cheap when nothing is being traced.
+ */
+bool CallTracer::shouldTrace(const faabric::Message& msg,
+                             unsigned long& traceId)
+{
+    if (enabledCount > 0) {
+        std::scoped_lock<std::mutex> guard(mx);
+        auto it = enabledCalls.find(msg.id());
+        if (it != enabledCalls.end()) {
+            traceId = it->second;
+            return true;
+        }
+    }
+
+    if (conf::isFunctionInList(conf::getFaasmConfig().traceFunctions, msg)) {
+        traceId = msg.id();
+        return true;
+    }
+
+    return false;
+}
+
+void CallTracer::enableForCall(unsigned int messageId, unsigned long traceId)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    enabledCalls[messageId] = traceId == 0 ? messageId : traceId;
+    enabledCount = enabledCalls.size() + tracedWorlds.size();
+}
+
+/**
+ * Starts recording the call's events on this thread, if it's being traced.
+ * Also records how long the call waited between being created and starting.
+ */
+void CallTracer::startCall(const faabric::Message& msg)
+{
+    // Stop recording into a previous call's trace, e.g. earlier in a batch
+    isolation::setActiveCallTrace(nullptr);
+
+    unsigned long traceId;
+    if (!shouldTrace(msg, traceId)) {
+        return;
+    }
+
+    auto trace = std::make_unique<isolation::CallTrace>();
+    trace->traceId = traceId;
+    trace->messageId = msg.id();
+    trace->funcStr = faabric::util::funcToString(msg, false);
+
+    if (msg.timestamp() > 0) {
+        long nowMs = faabric::util::getGlobalClock().epochMillis();
+        long waitedUs = std::max(nowMs - (long)msg.timestamp(), 0L) * 1000;
+        long nowUs = isolation::traceMicros(std::chrono::steady_clock::now());
+        trace->events.push_back(
+          { "lifecycle", "scheduled", nowUs - waitedUs, waitedUs });
+    }
+
+    isolation::setActiveCallTrace(trace.get());
+    threadCallTraces[msg.id()] = std::move(trace);
+}
+
+/**
+ * Makes the call's trace the one being recorded into again, if it's traced.
+ */
+void CallTracer::resumeCall(const faabric::Message& msg)
+{
+    if (threadCallTraces.empty()) {
+        return;
+    }
+
+    auto it = threadCallTraces.find(msg.id());
+    if (it != threadCallTraces.end()) {
+        isolation::setActiveCallTrace(it->second.get());
+    }
+}
+
+void CallTracer::finishCall(const faabric::Message& msg)
+{
+    if (threadCallTraces.empty()) {
+        return;
+    }
+
+    auto it = threadCallTraces.find(msg.id());
+    if (it == threadCallTraces.end()) {
+        return;
+    }
+
+    std::shared_ptr<isolation::CallTrace> trace = std::move(it->second);
+    threadCallTraces.erase(it);
+
+    if (isolation::getActiveCallTrace() == trace.get()) {
+        isolation::setActiveCallTrace(nullptr);
+    }
+
+    {
+        std::scoped_lock<std::mutex> guard(mx);
+
+        enabledCalls.erase(msg.id());
+        for (auto w = tracedWorlds.begin(); w != tracedWorlds.end();) {
+            if (w->second.second == msg.id()) {
+                w = tracedWorlds.erase(w);
+            } else {
+                ++w;
+            }
+        }
+        enabledCount = enabledCalls.size() + tracedWorlds.size();
+
+        finishedCalls.push_back(trace);
+        while (finishedCalls.size() > TRACE_LOG_CAPACITY) {
+            finishedCalls.pop_front();
+        }
+    }
+
+    if (!conf::getFaasmConfig().traceDir.empty()) {
+        writeTraceFile(trace->traceId);
+    }
+}
+
+/**
+ * Traces a call chained by the call being traced on this thread as part of
+ * the same trace.
+ */
+void CallTracer::propagateToCall(unsigned int messageId)
+{
+    isolation::CallTrace* active = isolation::getActiveCallTrace();
+    if (active != nullptr) {
+        enableForCall(messageId, active->traceId);
+    }
+}
+
+/**
+ * Marks an MPI world created by the call being traced on this thread, so that
+ * the other ranks join the trace.
+ */
+void CallTracer::propagateToMpiWorld(int worldId)
+{
+    isolation::CallTrace* active = isolation::getActiveCallTrace();
+    if (active == nullptr) {
+        return;
+    }
+
+    std::scoped_lock<std::mutex> guard(mx);
+    tracedWorlds[worldId] = { active->traceId, active->messageId };
+    enabledCount = enabledCalls.size() + tracedWorlds.size();
+}
+
+/**
+ * Starts tracing an MPI rank part way through its call if its world is
+ * traced. Must be called once the world's creator has marked it, e.g. after
+ * the barrier in MPI_Init.
+ */
+void CallTracer::joinMpiWorld(const faabric::Message& msg, int worldId)
+{
+    if (enabledCount == 0 || isolation::getActiveCallTrace() != nullptr) {
+        return;
+    }
+
+    {
+        std::scoped_lock<std::mutex> guard(mx);
+        auto it = tracedWorlds.find(worldId);
+        if (it == tracedWorlds.end()) {
+            return;
+        }
+
+        enabledCalls[msg.id()] = it->second.first;
+        enabledCount = enabledCalls.size() + tracedWorlds.size();
+    }
+
+    startCall(msg);
+}
+
+std::vector<std::shared_ptr<isolation::CallTrace>> CallTracer::getTrace(
+  unsigned long traceId)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    std::vector<std::shared_ptr<isolation::CallTrace>> calls;
+    for (auto& t : finishedCalls) {
+        if (t->traceId == traceId) {
+            calls.emplace_back(t);
+        }
+    }
+
+    return calls;
+}
+
+std::string CallTracer::getTraceJson(unsigned long traceId)
+{
+    return isolation::callTracesToChromeJson(getTrace(traceId));
+}
+
+std::string CallTracer::getTraceFilePath(unsigned long traceId)
+{
+    return conf::getFaasmConfig().traceDir + "/trace-" +
+           std::to_string(traceId) + ".json";
+}
+
+/**
+ * Rewrites the whole trace, replacing the file with a rename so that readers
+ * never see it partially written.
+ */
+void CallTracer::writeTraceFile(unsigned long traceId)
+{
+    std::string path = getTraceFilePath(traceId);
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+
+    try {
+        boost::filesystem::create_directories(conf::getFaasmConfig().traceDir);
+
+        std::string json = getTraceJson(traceId);
+        faabric::util::writeBytesToFile(
+          tmpPath, std::vector<uint8_t>(json.begin(), json.end()));
+        boost::filesystem::rename(tmpPath, path);
+    } catch (std::exception& e) {
+        faabric::util::getLogger()->error(
+          "Failed to write trace to {}: {}", path, e.what());
+    }
+}
+
+void CallTracer::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    enabledCalls.clear();
+    tracedWorlds.clear();
+    enabledCount = 0;
+    finishedCalls.clear();
+}
+}
@@ -0,0 +1,185 @@
+#include "ExecutionWatchdog.h"
+
+#include <conf/FaasmConfig.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <pthread.h>
+
+#define WATCHDOG_INTERVAL_MS 5
+
+namespace wasm {
+ExecutionWatchdog& getExecutionWatchdog()
+{
+    static ExecutionWatchdog watchdog;
+    return watchdog;
+}
+
+/**
+ * Looks up the limits for the given function, falling back to the limits for
+ * all functions.
+ */
+CallTimeLimits getCallTimeLimits(const faabric::Message& msg)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    CallTimeLimits limits;
+    limits.wallMs = faasmConf.callTimeLimitMs;
+    limits.cpuMs = faasmConf.callCpuLimitMs;
+
+    if (faasmConf.callTimeLimits.empty() && faasmConf.callCpuLimits.empty()) {
+        return limits;
+    }
+
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    auto wallLimits = conf::parseIntMap(faasmConf.callTimeLimits);
+    auto wallIt = wallLimits.find(funcStr);
+    if (wallIt != wallLimits.end()) {
+        limits.wallMs = wallIt->second;
+    }
+
+    auto cpuLimits = conf::parseIntMap(faasmConf.callCpuLimits);
+    auto cpuIt = cpuLimits.find(funcStr);
+    if (cpuIt != cpuLimits.end()) {
+        limits.cpuMs = cpuIt->second;
+    }
+
+    return limits;
+}
+
+ExecutionWatchdog::~ExecutionWatchdog()
+{
+    {
+        faabric::util::UniqueLock lock(mx);
+        running = false;
+    }
+    cv.notify_all();
+
+    if (watchdogThread.joinable()) {
+        watchdogThread.join();
+    }
+}
+
+/**
+ * Starts watching the calling thread with the given limits, returning an ID
+ * to disarm the watch with. The CPU limit applies to the calling thread only.
+ */
+int ExecutionWatchdog::arm(const CallTimeLimits& limits,
+                           std::function<void()> interrupt)
+{
+    Watch watch;
+    watch.interrupt = std::move(interrupt);
+
+    if (limits.wallMs > 0) {
+        watch.deadline = std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(limits.wallMs);
+    } else {
+        watch.deadline = std::chrono::steady_clock::time_point::max();
+    }
+
+    watch.cpuLimitMicros = limits.cpuMs * 1000L;
+    pthread_getcpuclockid(pthread_self(), &watch.cpuClock);
+    watch.startCpuMicros = getCpuClockMicros(watch.cpuClock);
+
+    faabric::util::UniqueLock lock(mx);
+
+    // Start the watchdog thread the first time it's needed
+    if (!running) {
+        running = true;
+        watchdogThread = std::thread([this] { run(); });
+    }
+
+    int watchId = nextWatchId++;
+    watches.emplace(watchId, std::move(watch));
+
+    return watchId;
+}
+
+/**
+ * Stops watching, returning true and the reason if the call was interrupted.
+ */
+bool ExecutionWatchdog::disarm(int watchId, std::string& reason)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    auto it = watches.find(watchId);
+    if (it == watches.end()) {
+        return false;
+    }
+
+    bool fired = it->second.fired;
+    reason = it->second.reason;
+    watches.erase(it);
+
+    return fired;
+}
+
+void ExecutionWatchdog::run()
+{
+    faabric::util::UniqueLock lock(mx);
+
+    while (running) {
+        checkWatches();
+
+        cv.wait_for(lock, std::chrono::milliseconds(WATCHDOG_INTERVAL_MS));
+    }
+}
+
+void ExecutionWatchdog::checkWatches()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto& p : watches) {
+        Watch& watch = p.second;
+        if (watch.fired) {
+            watch.interrupt();
+            continue;
+        }
+
+        if (now >= watch.deadline) {
+            watch.reason = "wall-clock time limit exceeded";
+        } else if (watch.cpuLimitMicros > 0) {
+            long cpuMicros =
+              getCpuClockMicros(watch.cpuClock) - watch.startCpuMicros;
+            if (cpuMicros >= watch.cpuLimitMicros) {
+                watch.reason = "CPU time limit exceeded";
+            }
+        }
+
+        if (watch.reason.empty()) {
+            continue;
+        }
+
+        faabric::util::getLogger()->warn("Interrupting call: {}",
+                                         watch.reason);
+
+        watch.fired = true;
+        interruptCount++;
+        watch.interrupt();
+    }
+}
+
+int ExecutionWatchdog::getWatchCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return (int)watches.size();
+}
+
+long ExecutionWatchdog::getInterruptCount()
+{
+    return interruptCount.load();
+}
+
+long getCpuClockMicros(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+}
@@ -0,0 +1,62 @@
+#include "wasm/FunctionCosts.h"
+
+#include <faabric/util/func.h>
+
+namespace wasm {
+FunctionCosts& getFunctionCosts()
+{
+    static FunctionCosts costs;
+    return costs;
+}
+
+void FunctionCosts::record(const faabric::Message& msg, int64_t instructions)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+
+    std::scoped_lock<std::mutex> guard(mx);
+    Cost& cost = costs[funcStr];
+
+    // The first call sets the average rather than being weighted against zero
+    if (cost.calls == 0) {
+        cost.average = (double)instructions;
+    } else {
+        cost.average += FUNCTION_COST_EWMA_WEIGHT *
+                        ((double)instructions - cost.average);
+    }
+    cost.calls++;
+}
+
+/**
+ * Returns the function's average instructions per call, or zero if none of
+ * its calls have been metered.
+ */
+double FunctionCosts::getAverage(const std::string& funcStr)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = costs.find(funcStr);
+    if (it == costs.end()) {
+        return 0;
+    }
+
+    return it->second.average;
+}
+
+long FunctionCosts::getCallCount(const std::string& funcStr)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = costs.find(funcStr);
+    if (it == costs.end()) {
+        return 0;
+    }
+
+    return it->second.calls;
+}
+
+void FunctionCosts::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    costs.clear();
+}
+}
@@ -0,0 +1,249 @@
+#include "LocalCallBuffers.h"
+
+#include <faabric/util/bytes.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace wasm {
+LocalCallBuffers& getLocalCallBuffers()
+{
+    static LocalCallBuffers b;
+    return b;
+}
+
+void LocalCallBuffers::addCall(unsigned int messageId,
+                               unsigned int callerId,
+                               const std::vector<uint8_t>& input)
+{
+    auto buffer = std::make_shared<LocalCallBuffer>();
+    buffer->callerId = callerId;
+    buffer->input = input;
+
+    faabric::util::FullLock lock(mx);
+    buffers[messageId] = buffer;
+    callerCalls[callerId].emplace_back(messageId);
+}
+
+std::shared_ptr<LocalCallBuffer> LocalCallBuffers::getBuffer(
+  unsigned int messageId)
+{
+    faabric::util::SharedLock lock(mx);
+    auto it = buffers.find(messageId);
+    if (it == buffers.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+bool LocalCallBuffers::isLocalCall(unsigned int messageId)
+{
+    return getBuffer(messageId) != nullptr;
+}
+
+size_t LocalCallBuffers::getInputSize(unsigned int messageId)
+{
+    std::shared_ptr<LocalCallBuffer> callBuffer = getBuffer(messageId);
+    if (callBuffer == nullptr) {
+        throw std::runtime_error("No local buffer for call");
+    }
+
+    return callBuffer->input.size();
+}
+
+size_t LocalCallBuffers::readInput(unsigned int messageId,
+                                   uint8_t* buffer,
+                                   size_t bufferLen)
+{
+    std::shared_ptr<LocalCallBuffer> callBuffer = getBuffer(messageId);
+    if (callBuffer == nullptr) {
+        throw std::runtime_error("No local buffer for call");
+    }
+
+    size_t copyLen = std::min(bufferLen, callBuffer->input.size());
+    if (copyLen > 0) {
+        std::memcpy(buffer, callBuffer->input.data(), copyLen);
+    }
+
+    return copyLen;
+}
+
+void LocalCallBuffers::writeOutput(unsigned int messageId,
+                                   const uint8_t* data,
+                                   size_t len)
+{
+    std::shared_ptr<LocalCallBuffer> callBuffer = getBuffer(messageId);
+    if (callBuffer == nullptr) {
+        throw std::runtime_error("No local buffer for call");
+    }
+
+    faabric::util::UniqueLock lock(callBuffer->outputMx);
+    callBuffer->output.assign(data, data + len);
+    callBuffer->hasOutput = true;
+}
+
+/**
+ * Copies out the call's output if it has written any, returning false if not.
+ */
+bool LocalCallBuffers::readOutput(unsigned int messageId,
+                                  std::vector<uint8_t>& output)
+{
+    std::shared_ptr<LocalCallBuffer> callBuffer = getBuffer(messageId);
+    if (callBuffer == nullptr) {
+        return false;
+    }
+
+    faabric::util::UniqueLock lock(callBuffer->outputMx);
+    if (!callBuffer->hasOutput) {
+        return false;
+    }
+
+    output = callBuffer->output;
+    return true;
+}
+
+std::shared_ptr<LocalCallBuffer> LocalCallBuffers::removeCall(
+  unsigned int messageId)
+{
+    faabric::util::FullLock lock(mx);
+    auto it = buffers.find(messageId);
+    if (it == buffers.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<LocalCallBuffer> callBuffer = it->second;
+    doRemoveCall(messageId);
+
+    return callBuffer;
+}
+
+/**
+ * Called when a call finishes, whether or not it ran on the fast path. Its
+ * own buffer and those of any calls it made but didn't await are removed once
+ * the other side has finished with them too.
+ */
+void LocalCallBuffers::finishCall(unsigned int messageId)
+{
+    faabric::util::FullLock lock(mx);
+
+    auto it = buffers.find(messageId);
+    if (it != buffers.end()) {
+        if (it->second->callerFinished) {
+            doRemoveCall(messageId);
+        } else {
+            it->second->calleeFinished = true;
+        }
+    }
+
+    auto callerIt = callerCalls.find(messageId);
+    if (callerIt == callerCalls.end()) {
+        return;
+    }
+
+    std::vector<unsigned int> calls = callerIt->second;
+    for (auto callId : calls) {
+        auto callIt = buffers.find(callId);
+        if (callIt == buffers.end()) {
+            continue;
+        }
+
+        if (callIt->second->calleeFinished) {
+            doRemoveCall(callId);
+        } else {
+            callIt->second->callerFinished = true;
+        }
+    }
+
+    callerCalls.erase(messageId);
+}
+
+void LocalCallBuffers::doRemoveCall(unsigned int messageId)
+{
+    auto it = buffers.find(messageId);
+    unsigned int callerId = it->second->callerId;
+    buffers.erase(it);
+
+    auto callerIt = callerCalls.find(callerId);
+    if (callerIt != callerCalls.end()) {
+        std::vector<unsigned int>& calls = callerIt->second;
+        calls.erase(std::remove(calls.begin(), calls.end(), messageId),
+                    calls.end());
+        if (calls.empty()) {
+            callerCalls.erase(callerIt);
+        }
+    }
+}
+
+size_t LocalCallBuffers::getCallCount()
+{
+    faabric::util::SharedLock lock(mx);
+    return buffers.size();
+}
+
+void LocalCallBuffers::clear()
+{
+    faabric::util::FullLock lock(mx);
+    buffers.clear();
+    callerCalls.clear();
+}
+
+size_t getCallInputSize(const faabric::Message& msg)
+{
+    LocalCallBuffers& localBuffers = getLocalCallBuffers();
+    if (localBuffers.isLocalCall(msg.id())) {
+        return localBuffers.getInputSize(msg.id());
+    }
+
+    return msg.inputdata().size();
+}
+
+size_t readCallInput(const faabric::Message& msg,
+                     uint8_t* buffer,
+                     size_t bufferLen)
+{
+    LocalCallBuffers& localBuffers = getLocalCallBuffers();
+    if (localBuffers.isLocalCall(msg.id())) {
+        return localBuffers.readInput(msg.id(), buffer, bufferLen);
+    }
+
+    const std::string& inputData = msg.inputdata();
+    size_t copyLen = std::min(bufferLen, inputData.size());
+    if (copyLen > 0) {
+        std::memcpy(buffer, inputData.data(), copyLen);
+    }
+
+    return copyLen;
+}
+
+void writeCallOutput(faabric::Message& msg, const uint8_t* data, size_t len)
+{
+    LocalCallBuffers& localBuffers = getLocalCallBuffers();
+    if (localBuffers.isLocalCall(msg.id())) {
+        localBuffers.writeOutput(msg.id(), data, len);
+        return;
+    }
+
+    msg.set_outputdata(data, len);
+}
+
+std::vector<uint8_t> getCallInput(const faabric::Message& msg)
+{
+    std::vector<uint8_t> input(getCallInputSize(msg));
+    readCallInput(msg, input.data(), input.size());
+
+    return input;
+}
+
+std::vector<uint8_t> getCallOutput(const faabric::Message& msg)
+{
+    std::vector<uint8_t> output;
+    if (getLocalCallBuffers().readOutput(msg.id(), output)) {
+        return output;
+    }
+
+    return faabric::util::stringToBytes(msg.outputdata());
+}
+}
@@ -0,0 +1,175 @@
+#include "OutputCapture.h"
+
+#include <conf/FaasmConfig.h>
+
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define MAX_SINK_LINE_BYTES 65536
+
+namespace wasm {
+/**
+ * Looks up the size of the capture buffer for the given function.
+ */
+size_t getOutputCaptureBytes(const faabric::Message& msg)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    long captureKb = faasmConf.stdoutBufferKb;
+    if (!faasmConf.stdoutBufferLimits.empty()) {
+        auto limits = conf::parseIntMap(faasmConf.stdoutBufferLimits);
+        auto it = limits.find(faabric::util::funcToString(msg, false));
+        if (it != limits.end()) {
+            captureKb = it->second;
+        }
+    }
+
+    return (size_t)std::max(captureKb, 1L) * 1024;
+}
+
+OutputCapture::OutputCapture(const faabric::Message& msg,
+                             size_t capacityBytesIn)
+  : buffer(capacityBytesIn)
+  , sink(conf::getFaasmConfig().stdoutSink)
+  , funcStr(faabric::util::funcToString(msg, false))
+  , messageId(msg.id())
+{
+    if (sink != "file") {
+        return;
+    }
+
+    // One file per function, with each line tagged with the message ID
+    boost::filesystem::path sinkPath(conf::getFaasmConfig().stdoutSinkDir);
+    boost::filesystem::create_directories(sinkPath);
+    sinkPath.append(msg.user() + "_" + msg.function() + ".log");
+
+    sinkFd = ::open(sinkPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (sinkFd < 0) {
+        faabric::util::getLogger()->warn(
+          "Failed to open output sink {}, not streaming", sinkPath.string());
+        sink = "off";
+    }
+}
+
+OutputCapture::~OutputCapture()
+{
+    // Flush any incomplete last line
+    if (!partialLine.empty()) {
+        writeLine(partialLine);
+    }
+
+    if (sinkFd >= 0) {
+        ::close(sinkFd);
+    }
+}
+
+void OutputCapture::write(const char* data, size_t len)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    writtenBytes += len;
+
+    if (sink == "log" || sink == "file") {
+        streamLines(data, len);
+    }
+
+    // Only the end of anything bigger than the buffer can be kept
+    size_t capacity = buffer.size();
+    if (len > capacity) {
+        data += len - capacity;
+        len = capacity;
+    }
+
+    size_t tail = (head + bufferedBytes) % capacity;
+    size_t firstLen = std::min(len, capacity - tail);
+    std::copy(data, data + firstLen, buffer.begin() + tail);
+    std::copy(data + firstLen, data + len, buffer.begin());
+
+    // Drop the oldest output if full
+    bufferedBytes += len;
+    if (bufferedBytes > capacity) {
+        head = (head + bufferedBytes - capacity) % capacity;
+        bufferedBytes = capacity;
+    }
+}
+
+std::string OutputCapture::read()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    std::string output;
+
+    size_t dropped = writtenBytes - bufferedBytes;
+    if (dropped > 0) {
+        output = fmt::format(OUTPUT_TRUNCATED_MARKER, dropped);
+    }
+
+    size_t capacity = buffer.size();
+    size_t firstLen = std::min(bufferedBytes, capacity - head);
+    output.append(buffer.data() + head, firstLen);
+    output.append(buffer.data(), bufferedBytes - firstLen);
+
+    return output;
+}
+
+void OutputCapture::streamLines(const char* data, size_t len)
+{
+    const char* end = data + len;
+    while (data < end) {
+        const char* newline = std::find(data, end, '\n');
+        partialLine.append(data, newline);
+
+        if (newline == end) {
+            // Don't let a very long line grow without bound
+            if (partialLine.size() >= MAX_SINK_LINE_BYTES) {
+                writeLine(partialLine);
+                partialLine.clear();
+            }
+            break;
+        }
+
+        writeLine(partialLine);
+        partialLine.clear();
+        data = newline + 1;
+    }
+}
+
+void OutputCapture::writeLine(const std::string& line)
+{
+    if (sink == "log") {
+        faabric::util::getLogger()->info(
+          "{} ({}): {}", funcStr, messageId, line);
+        return;
+    }
+
+    std::string tagged = fmt::format("[{}] {}\n", messageId, line);
+    ssize_t res = ::write(sinkFd, tagged.data(), tagged.size());
+    if (res < 0) {
+        faabric::util::getLogger()->warn("Failed writing to output sink: {}",
+                                         strerror(errno));
+    }
+}
+
+size_t OutputCapture::getCapacityBytes()
+{
+    return buffer.size();
+}
+
+size_t OutputCapture::getWrittenBytes()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    return writtenBytes;
+}
+
+size_t OutputCapture::getDroppedBytes()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    return writtenBytes - bufferedBytes;
+}
+}
@@ -0,0 +1,678 @@
+#include "OutputStreams.h"
+#include "LocalCallBuffers.h"
+#include "chaining.h"
+
+#include <conf/FaasmConfig.h>
+
+#include <faabric/redis/Redis.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/bytes.h>
+#include <faabric/util/config.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Remote chunks are prefixed with one of these to say what they hold
+#define CHUNK_DATA 'D'
+#define CHUNK_END 'E'
+#define CHUNK_NOT_STREAMED 'N'
+
+#define REMOTE_STREAM_EXPIRY_SECONDS 60
+#define REMOTE_STREAM_POLL_MS 1
+
+namespace wasm {
+
+// --------------------------------------
+// Local streams
+// --------------------------------------
+
+OutputStream::OutputStream(size_t capacityBytesIn)
+  : capacityBytes(capacityBytesIn)
+{}
+
+void OutputStream::write(const uint8_t* data, size_t len, int timeoutMs)
+{
+    if (len == 0) {
+        return;
+    }
+
+    faabric::util::UniqueLock lock(mx);
+    if (closed) {
+        throw std::runtime_error("Writing to closed output stream");
+    }
+
+    // Wait for the reader to make space. A chunk bigger than the whole stream
+    // can still be written once the stream is empty.
+    bool hasSpace =
+      cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, len] {
+          return abandoned || bufferedBytes == 0 ||
+                 bufferedBytes + len <= capacityBytes;
+      });
+
+    if (!hasSpace) {
+        throw std::runtime_error("Timed out writing to output stream");
+    }
+
+    // Nobody will read this
+    if (abandoned) {
+        return;
+    }
+
+    chunks.emplace_back(data, data + len);
+    bufferedBytes += len;
+    written = true;
+
+    cv.notify_all();
+}
+
+/**
+ * Reads up to bufferLen bytes from the stream, blocking until some data is
+ * available. Returns zero once the stream is closed and fully read.
+ */
+size_t OutputStream::read(uint8_t* buffer, size_t bufferLen, int timeoutMs)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    bool isReady =
+      cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+          return closed || !chunks.empty();
+      });
+
+    if (!isReady) {
+        throw std::runtime_error("Timed out reading from output stream");
+    }
+
+    if (chunks.empty()) {
+        return 0;
+    }
+
+    std::vector<uint8_t>& head = chunks.front();
+    size_t readLen = std::min(bufferLen, head.size() - headOffset);
+    std::memcpy(buffer, head.data() + headOffset, readLen);
+
+    headOffset += readLen;
+    if (headOffset == head.size()) {
+        chunks.pop_front();
+        headOffset = 0;
+    }
+
+    bufferedBytes -= readLen;
+    cv.notify_all();
+
+    return readLen;
+}
+
+void OutputStream::close()
+{
+    faabric::util::UniqueLock lock(mx);
+    closed = true;
+    cv.notify_all();
+}
+
+/**
+ * Called when the reader goes away, so that a writer blocked on a full stream
+ * doesn't wait for space that will never come.
+ */
+void OutputStream::abandon()
+{
+    faabric::util::UniqueLock lock(mx);
+    abandoned = true;
+    chunks.clear();
+    headOffset = 0;
+    bufferedBytes = 0;
+    cv.notify_all();
+}
+
+bool OutputStream::isClosed()
+{
+    faabric::util::UniqueLock lock(mx);
+    return closed;
+}
+
+bool OutputStream::hasWritten()
+{
+    faabric::util::UniqueLock lock(mx);
+    return written;
+}
+
+size_t OutputStream::getBufferedBytes()
+{
+    faabric::util::UniqueLock lock(mx);
+    return bufferedBytes;
+}
+
+// --------------------------------------
+// Registry
+// --------------------------------------
+
+OutputStreams& getOutputStreams()
+{
+    static OutputStreams s;
+    return s;
+}
+
+std::string getOutputStreamKey(unsigned int messageId)
+{
+    return "output_stream_" + std::to_string(messageId);
+}
+
+std::string getOutputStreamReaderKey(unsigned int messageId)
+{
+    return "output_stream_reader_" + std::to_string(messageId);
+}
+
+bool isOutputStreamed(const faabric::Message& msg)
+{
+    return conf::isFunctionInList(conf::getFaasmConfig().outputStreamFunctions,
+                                  msg);
+}
+
+static void deleteRemoteReader(unsigned int messageId)
+{
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    redis.del(getOutputStreamReaderKey(messageId));
+    redis.del(getOutputStreamKey(messageId));
+}
+
+/**
+ * Registers a reader for the given call. If the call streams its output and
+ * runs on another host, this tells the callee that someone is listening.
+ */
+void OutputStreams::addReader(unsigned int messageId,
+                              unsigned int callerId,
+                              bool isLocal,
+                              bool isStreamed)
+{
+    auto reader = std::make_shared<OutputStreamReader>();
+    reader->callerId = callerId;
+    reader->isLocal = isLocal;
+    reader->isStreamed = isStreamed;
+
+    if (isStreamed && isLocal) {
+        size_t capacityBytes =
+          (size_t)conf::getFaasmConfig().outputStreamBufferKb * 1024;
+        reader->localStream = std::make_shared<OutputStream>(capacityBytes);
+    } else if (isStreamed) {
+        // Outlive the call itself, the caller removes this when it's done
+        int expirySeconds =
+          faabric::util::getSystemConfig().chainedCallTimeout / 1000 +
+          REMOTE_STREAM_EXPIRY_SECONDS;
+
+        faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+        const std::string readerKey = getOutputStreamReaderKey(messageId);
+        redis.setLong(readerKey, 1);
+        redis.expire(readerKey, expirySeconds);
+    }
+
+    faabric::util::FullLock lock(mx);
+    readers[messageId] = reader;
+    callerReaders[callerId].emplace_back(messageId);
+}
+
+void OutputStreams::addCompletedReader(unsigned int messageId,
+                                       unsigned int callerId,
+                                       const std::vector<uint8_t>& output)
+{
+    auto reader = std::make_shared<OutputStreamReader>();
+    reader->callerId = callerId;
+    reader->chunk = output;
+    reader->eof = true;
+
+    reader->hasResult = true;
+    reader->result.set_id(messageId);
+    reader->result.set_returnvalue(0);
+
+    faabric::util::FullLock lock(mx);
+    readers[messageId] = reader;
+    callerReaders[callerId].emplace_back(messageId);
+}
+
+std::shared_ptr<OutputStreamReader> OutputStreams::getReader(
+  unsigned int messageId)
+{
+    faabric::util::SharedLock lock(mx);
+    auto it = readers.find(messageId);
+    if (it == readers.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+std::shared_ptr<OutputStream> OutputStreams::getLocalStream(
+  unsigned int messageId)
+{
+    std::shared_ptr<OutputStreamReader> reader = getReader(messageId);
+    if (reader == nullptr) {
+        return nullptr;
+    }
+
+    return reader->localStream;
+}
+
+void OutputStreams::removeReader(unsigned int messageId)
+{
+    std::shared_ptr<OutputStreamReader> reader;
+    {
+        faabric::util::FullLock lock(mx);
+        reader = doRemoveReader(messageId);
+    }
+
+    if (reader != nullptr && reader->isStreamed && !reader->isLocal) {
+        deleteRemoteReader(messageId);
+    }
+}
+
+/**
+ * Drops the readers for any calls the given caller made but never awaited.
+ * Callees still streaming to these readers stop waiting for them.
+ */
+void OutputStreams::finishCall(unsigned int callerId)
+{
+    std::vector<unsigned int> remoteIds;
+    {
+        faabric::util::FullLock lock(mx);
+        auto it = callerReaders.find(callerId);
+        if (it == callerReaders.end()) {
+            return;
+        }
+
+        std::vector<unsigned int> messageIds = it->second;
+        for (auto messageId : messageIds) {
+            std::shared_ptr<OutputStreamReader> reader =
+              doRemoveReader(messageId);
+            if (reader->isStreamed && !reader->isLocal) {
+                remoteIds.emplace_back(messageId);
+            }
+        }
+    }
+
+    for (auto messageId : remoteIds) {
+        deleteRemoteReader(messageId);
+    }
+}
+
+/**
+ * Must be called with the full lock held.
+ */
+std::shared_ptr<OutputStreamReader> OutputStreams::doRemoveReader(
+  unsigned int messageId)
+{
+    auto it = readers.find(messageId);
+    if (it == readers.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<OutputStreamReader> reader = it->second;
+    readers.erase(it);
+
+    if (reader->localStream != nullptr) {
+        reader->localStream->abandon();
+    }
+
+    unsigned int callerId = reader->callerId;
+
+    auto callerIt = callerReaders.find(callerId);
+    if (callerIt != callerReaders.end()) {
+        std::vector<unsigned int>& messageIds = callerIt->second;
+        messageIds.erase(
+          std::remove(messageIds.begin(), messageIds.end(), messageId),
+          messageIds.end());
+        if (messageIds.empty()) {
+            callerReaders.erase(callerIt);
+        }
+    }
+
+    return reader;
+}
+
+std::shared_ptr<RemoteStreamWriter> OutputStreams::getRemoteWriter(
+  unsigned int messageId)
+{
+    faabric::util::SharedLock lock(mx);
+    auto it = remoteWriters.find(messageId);
+    if (it == remoteWriters.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+std::shared_ptr<RemoteStreamWriter> OutputStreams::addRemoteWriter(
+  unsigned int messageId,
+  bool hasReader)
+{
+    auto writer = std::make_shared<RemoteStreamWriter>();
+    writer->hasReader = hasReader;
+
+    faabric::util::FullLock lock(mx);
+    remoteWriters[messageId] = writer;
+    return writer;
+}
+
+std::shared_ptr<RemoteStreamWriter> OutputStreams::removeRemoteWriter(
+  unsigned int messageId)
+{
+    faabric::util::FullLock lock(mx);
+    auto it = remoteWriters.find(messageId);
+    if (it == remoteWriters.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<RemoteStreamWriter> writer = it->second;
+    remoteWriters.erase(it);
+    return writer;
+}
+
+size_t OutputStreams::getReaderCount()
+{
+    faabric::util::SharedLock lock(mx);
+    return readers.size();
+}
+
+void OutputStreams::clear()
+{
+    faabric::util::FullLock lock(mx);
+    readers.clear();
+    callerReaders.clear();
+    remoteWriters.clear();
+}
+
+// --------------------------------------
+// Callee side
+// --------------------------------------
+
+static size_t getChunkBytes()
+{
+    return (size_t)conf::getFaasmConfig().outputStreamChunkKb * 1024;
+}
+
+/**
+ * Whether anyone is reading the given call's output from another host. Only
+ * calls to streamed functions are checked, so other calls never touch Redis.
+ */
+static bool hasRemoteReader(const faabric::Message& msg)
+{
+    // Only chained calls can have a remote reader. Threads are awaited
+    // directly and never stream.
+    if (!msg.isasync() || !msg.snapshotkey().empty()) {
+        return false;
+    }
+
+    if (!isOutputStreamed(msg)) {
+        return false;
+    }
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    return redis.getLong(getOutputStreamReaderKey(msg.id())) > 0;
+}
+
+/**
+ * Pushes a chunk onto the remote stream, waiting while the stream is full.
+ * Returns false if the reader has gone away in the meantime.
+ */
+static bool writeRemoteChunk(unsigned int messageId,
+                             const std::vector<uint8_t>& chunk,
+                             int timeoutMs)
+{
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    long maxChunks = std::max(
+      faasmConf.outputStreamBufferKb / faasmConf.outputStreamChunkKb, 1);
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    const std::string key = getOutputStreamKey(messageId);
+    const std::string readerKey = getOutputStreamReaderKey(messageId);
+
+    // Wait for the reader to catch up
+    auto start = std::chrono::steady_clock::now();
+    while (redis.listLength(key) >= maxChunks) {
+        if (redis.getLong(readerKey) == 0) {
+            return false;
+        }
+
+        auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+        if (waited.count() > timeoutMs) {
+            throw std::runtime_error("Timed out writing to output stream");
+        }
+
+        std::this_thread::sleep_for(
+          std::chrono::milliseconds(REMOTE_STREAM_POLL_MS));
+    }
+
+    redis.enqueueBytes(key, chunk);
+    redis.expire(key, REMOTE_STREAM_EXPIRY_SECONDS);
+
+    return true;
+}
+
+/**
+ * Appends a chunk to the output stream of the given call. Large writes are
+ * split into chunks of OUTPUT_STREAM_CHUNK_KB. If nobody is reading the
+ * stream, the chunk is appended to the call's output instead.
+ */
+void writeCallOutputChunk(faabric::Message& msg,
+                          const uint8_t* data,
+                          size_t len)
+{
+    OutputStreams& streams = getOutputStreams();
+    int timeoutMs = faabric::util::getSystemConfig().chainedCallTimeout;
+    size_t chunkBytes = getChunkBytes();
+
+    std::shared_ptr<OutputStream> localStream =
+      streams.getLocalStream(msg.id());
+
+    std::shared_ptr<RemoteStreamWriter> remoteWriter = nullptr;
+    if (localStream == nullptr) {
+        remoteWriter = streams.getRemoteWriter(msg.id());
+        if (remoteWriter == nullptr) {
+            remoteWriter =
+              streams.addRemoteWriter(msg.id(), hasRemoteReader(msg));
+        }
+
+        if (!remoteWriter->hasReader) {
+            std::vector<uint8_t> output = getCallOutput(msg);
+            output.insert(output.end(), data, data + len);
+            writeCallOutput(msg, output.data(), output.size());
+            return;
+        }
+    }
+
+    for (size_t offset = 0; offset < len; offset += chunkBytes) {
+        size_t pieceLen = std::min(chunkBytes, len - offset);
+
+        if (localStream != nullptr) {
+            localStream->write(data + offset, pieceLen, timeoutMs);
+            continue;
+        }
+
+        std::vector<uint8_t> chunk = { CHUNK_DATA };
+        chunk.insert(chunk.end(), data + offset, data + offset + pieceLen);
+        if (!writeRemoteChunk(msg.id(), chunk, timeoutMs)) {
+            // Reader has gone, drop the rest of the output
+            remoteWriter->hasReader = false;
+            return;
+        }
+
+        remoteWriter->hasWritten = true;
+    }
+}
+
+/**
+ * Marks the end of the call's output stream. Must be called for every call
+ * once it has finished, whether it has streamed or not.
+ */
+void closeCallOutputStream(const faabric::Message& msg)
+{
+    OutputStreams& streams = getOutputStreams();
+
+    std::shared_ptr<OutputStream> localStream =
+      streams.getLocalStream(msg.id());
+    if (localStream != nullptr) {
+        localStream->close();
+        return;
+    }
+
+    int timeoutMs = faabric::util::getSystemConfig().chainedCallTimeout;
+    std::shared_ptr<RemoteStreamWriter> remoteWriter =
+      streams.removeRemoteWriter(msg.id());
+    if (remoteWriter == nullptr) {
+        if (hasRemoteReader(msg)) {
+            writeRemoteChunk(msg.id(), { CHUNK_NOT_STREAMED }, timeoutMs);
+        }
+    } else if (remoteWriter->hasReader) {
+        char marker = remoteWriter->hasWritten ? CHUNK_END : CHUNK_NOT_STREAMED;
+        writeRemoteChunk(msg.id(), { (uint8_t)marker }, timeoutMs);
+    }
+}
+
+// --------------------------------------
+// Caller side
+// --------------------------------------
+
+static void fetchResult(unsigned int messageId, OutputStreamReader& reader)
+{
+    int timeoutMs = faabric::util::getSystemConfig().chainedCallTimeout;
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    reader.result = sch.getFunctionResult(messageId, timeoutMs);
+    reader.hasResult = true;
+}
+
+static void fetchNextChunk(unsigned int messageId, OutputStreamReader& reader)
+{
+    int timeoutMs = faabric::util::getSystemConfig().chainedCallTimeout;
+    size_t chunkBytes = getChunkBytes();
+
+    reader.chunk.clear();
+    reader.offset = 0;
+
+    // Calls that don't stream hand back their whole output once finished
+    if (!reader.isStreamed) {
+        reader.eof = true;
+        fetchResult(messageId, reader);
+        if (!reader.isLocal ||
+            !getLocalCallBuffers().readOutput(messageId, reader.chunk)) {
+            reader.chunk =
+              faabric::util::stringToBytes(reader.result.outputdata());
+        }
+
+        return;
+    }
+
+    if (reader.isLocal) {
+        std::vector<uint8_t> buffer(chunkBytes);
+        size_t readLen =
+          reader.localStream->read(buffer.data(), buffer.size(), timeoutMs);
+        if (readLen > 0) {
+            buffer.resize(readLen);
+            reader.chunk = std::move(buffer);
+            return;
+        }
+
+        reader.eof = true;
+
+        // If the callee didn't stream, hand back its whole output
+        if (!reader.localStream->hasWritten()) {
+            if (!getLocalCallBuffers().readOutput(messageId, reader.chunk)) {
+                fetchResult(messageId, reader);
+                reader.chunk =
+                  faabric::util::stringToBytes(reader.result.outputdata());
+            }
+        }
+
+        return;
+    }
+
+    faabric::redis::Redis& redis = faabric::redis::Redis::getQueue();
+    std::vector<uint8_t> bytes =
+      redis.dequeueBytes(getOutputStreamKey(messageId), timeoutMs);
+    if (bytes.empty()) {
+        throw std::runtime_error("Invalid output stream chunk");
+    }
+
+    switch (bytes.at(0)) {
+        case CHUNK_DATA: {
+            reader.chunk.assign(bytes.begin() + 1, bytes.end());
+            break;
+        }
+        case CHUNK_END: {
+            reader.eof = true;
+            break;
+        }
+        case CHUNK_NOT_STREAMED: {
+            reader.eof = true;
+            fetchResult(messageId, reader);
+            reader.chunk =
+              faabric::util::stringToBytes(reader.result.outputdata());
+            break;
+        }
+        default: {
+            throw std::runtime_error("Invalid output stream chunk");
+        }
+    }
+}
+
+/**
+ * Reads the next part of a chained call's output, blocking until some is
+ * available. Returns zero once the output has been fully read. Calls that
+ * don't stream their output look like a stream with a single chunk.
+ */
+size_t readCallOutputChunk(unsigned int messageId,
+                           uint8_t* buffer,
+                           size_t bufferLen)
+{
+    std::shared_ptr<OutputStreamReader> reader =
+      getOutputStreams().getReader(messageId);
+    if (reader == nullptr) {
+        faabric::util::getLogger()->error("No output stream for {}",
+                                          messageId);
+        throw std::runtime_error("No output stream for call");
+    }
+
+    if (bufferLen == 0) {
+        return 0;
+    }
+
+    while (reader->offset >= reader->chunk.size()) {
+        if (reader->eof) {
+            return 0;
+        }
+
+        AwaitScope awaitScope;
+        fetchNextChunk(messageId, *reader);
+    }
+
+    size_t readLen = std::min(bufferLen, reader->chunk.size() - reader->offset);
+    std::memcpy(buffer, reader->chunk.data() + reader->offset, readLen);
+    reader->offset += readLen;
+
+    return readLen;
+}
+
+/**
+ * Reads the rest of a chained call's output in one go.
+ */
+std::vector<uint8_t> drainCallOutputStream(unsigned int messageId)
+{
+    size_t chunkBytes = getChunkBytes();
+
+    std::vector<uint8_t> output;
+    std::vector<uint8_t> buffer(chunkBytes);
+    while (true) {
+        size_t readLen =
+          readCallOutputChunk(messageId, buffer.data(), buffer.size());
+        if (readLen == 0) {
+            break;
+        }
+
+        output.insert(output.end(), buffer.begin(), buffer.begin() + readLen);
+    }
+
+    return output;
+}
+}
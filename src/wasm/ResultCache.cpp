@@ -0,0 +1,339 @@
+#include "ResultCache.h"
+
+#include <conf/FaasmConfig.h>
+#include <storage/FunctionVersions.h>
+
+#include <faabric/util/files.h>
+#include <faabric/util/func.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace wasm {
+ResultCache& getResultCache()
+{
+    static ResultCache c;
+    return c;
+}
+
+static std::string getMemoName(const faabric::Message& msg)
+{
+    if (msg.ispython()) {
+        return msg.pythonuser() + "/" + msg.pythonfunction();
+    }
+
+    return faabric::util::funcToString(msg, false);
+}
+
+/**
+ * Results are only valid for the version of the function that produced them,
+ * so a re-upload makes them unreachable even before they're evicted.
+ */
+static long getMemoVersion(const faabric::Message& msg)
+{
+    if (msg.ispython()) {
+        faabric::Message pyMsg = faabric::util::messageFactory(
+          msg.pythonuser(), msg.pythonfunction());
+        return storage::getFunctionVersions().getVersion(pyMsg);
+    }
+
+    return storage::getFunctionVersions().getVersion(msg);
+}
+
+static std::string getInputHash(const std::vector<uint8_t>& input)
+{
+    std::string_view inputView((const char*)input.data(), input.size());
+    size_t hash = std::hash<std::string_view>{}(inputView);
+
+    return fmt::format("{:016x}_{}", hash, input.size());
+}
+
+static std::string getResultKey(const faabric::Message& msg,
+                                const std::vector<uint8_t>& input)
+{
+    // Calls to a different entrypoint of the same function may give a
+    // different result, so these are included in the key
+    return fmt::format("{}_v{}_{}_{}_{}",
+                       getMemoName(msg),
+                       getMemoVersion(msg),
+                       msg.funcptr(),
+                       msg.pythonentry(),
+                       getInputHash(input));
+}
+
+static std::string getResultPath(const faabric::Message& msg,
+                                 const std::vector<uint8_t>& input)
+{
+    const std::string& memoDir = conf::getFaasmConfig().memoizeDir;
+    if (memoDir.empty()) {
+        return "";
+    }
+
+    boost::filesystem::path p(memoDir);
+    p.append(getMemoName(msg));
+    p.append(fmt::format("v{}_{}_{}_{}",
+                         getMemoVersion(msg),
+                         msg.funcptr(),
+                         msg.pythonentry(),
+                         getInputHash(input)));
+
+    return p.string();
+}
+
+bool ResultCache::isMemoizable(const faabric::Message& msg)
+{
+    const std::string& configStr = conf::getFaasmConfig().memoizeFunctions;
+    if (configStr.empty()) {
+        return false;
+    }
+
+    // Threads run against a snapshot, so their output doesn't depend only on
+    // their input
+    if (!msg.snapshotkey().empty()) {
+        return false;
+    }
+
+    faabric::util::UniqueLock lock(mx);
+
+    // Re-parse the list of functions if it's changed
+    if (configStr != memoizedFunctionsStr) {
+        std::vector<std::string> funcs;
+        boost::split(funcs, configStr, [](char c) { return c == ','; });
+
+        memoizedFunctions.clear();
+        for (auto& f : funcs) {
+            boost::trim(f);
+            if (!f.empty()) {
+                memoizedFunctions.insert(f);
+            }
+        }
+
+        memoizedFunctionsStr = configStr;
+    }
+
+    return memoizedFunctions.count(getMemoName(msg)) > 0;
+}
+
+/**
+ * Looks up the output of a previous call with the same input, checking the
+ * local filesystem if the result isn't in memory. Returns true on a hit.
+ */
+bool ResultCache::getResult(const faabric::Message& msg,
+                            const std::vector<uint8_t>& input,
+                            std::vector<uint8_t>& output)
+{
+    const std::string key = getResultKey(msg, input);
+
+    {
+        faabric::util::UniqueLock lock(mx);
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.first.input == input) {
+            // Move to the front of the LRU
+            lru.splice(lru.begin(), lru, it->second.second);
+
+            output = it->second.first.output;
+            hitCount++;
+            return true;
+        }
+    }
+
+    // Fall back to the filesystem
+    const std::string path = getResultPath(msg, input);
+    ResultCacheEntry entry;
+    entry.name = getMemoName(msg);
+    if (!path.empty() && loadEntry(path, entry) && entry.input == input) {
+        output = entry.output;
+
+        faabric::util::UniqueLock lock(mx);
+        insertEntry(key, entry);
+        hitCount++;
+        return true;
+    }
+
+    missCount++;
+    return false;
+}
+
+void ResultCache::putResult(const faabric::Message& msg,
+                            const std::vector<uint8_t>& input,
+                            const std::vector<uint8_t>& output)
+{
+    const std::string key = getResultKey(msg, input);
+    ResultCacheEntry entry{ getMemoName(msg), input, output };
+
+    {
+        faabric::util::UniqueLock lock(mx);
+        insertEntry(key, entry);
+    }
+
+    const std::string path = getResultPath(msg, input);
+    if (!path.empty()) {
+        persistEntry(path, entry);
+    }
+}
+
+void ResultCache::insertEntry(const std::string& key,
+                              const ResultCacheEntry& entry)
+{
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        lru.erase(it->second.second);
+        entries.erase(it);
+    }
+
+    lru.push_front(key);
+    entries[key] = std::make_pair(entry, lru.begin());
+
+    // Evict the least recently used entries
+    size_t maxEntries = std::max(conf::getFaasmConfig().memoizeMaxEntries, 0);
+    while (entries.size() > maxEntries) {
+        entries.erase(lru.back());
+        lru.pop_back();
+        evictionCount++;
+    }
+}
+
+bool ResultCache::loadEntry(const std::string& path, ResultCacheEntry& entry)
+{
+    if (!boost::filesystem::exists(path)) {
+        return false;
+    }
+
+    // File holds the input and output sizes, then the input, then the output
+    std::vector<uint8_t> bytes = faabric::util::readFileToBytes(path);
+    uint64_t inputSize;
+    uint64_t outputSize;
+    size_t headerSize = sizeof(inputSize) + sizeof(outputSize);
+    if (bytes.size() < headerSize) {
+        faabric::util::getLogger()->warn("Invalid memoized result at {}",
+                                         path);
+        return false;
+    }
+
+    std::memcpy(&inputSize, bytes.data(), sizeof(inputSize));
+    std::memcpy(
+      &outputSize, bytes.data() + sizeof(inputSize), sizeof(outputSize));
+
+    // Anything other than an exact match means the file is truncated or
+    // corrupt, so must not be served
+    uint64_t bodySize = bytes.size() - headerSize;
+    if (inputSize > bodySize || outputSize != bodySize - inputSize) {
+        faabric::util::getLogger()->warn("Truncated memoized result at {}",
+                                         path);
+        return false;
+    }
+
+    auto inputStart = bytes.begin() + headerSize;
+    auto outputStart = inputStart + inputSize;
+    entry.input.assign(inputStart, outputStart);
+    entry.output.assign(outputStart, bytes.end());
+
+    return true;
+}
+
+/**
+ * Writes the entry to a temporary file and renames it into place, so that
+ * a crash or concurrent writer never leaves a partial entry at the path.
+ */
+void ResultCache::persistEntry(const std::string& path,
+                               const ResultCacheEntry& entry)
+{
+    uint64_t inputSize = entry.input.size();
+    uint64_t outputSize = entry.output.size();
+    std::vector<uint8_t> bytes(sizeof(inputSize) + sizeof(outputSize));
+    std::memcpy(bytes.data(), &inputSize, sizeof(inputSize));
+    std::memcpy(
+      bytes.data() + sizeof(inputSize), &outputSize, sizeof(outputSize));
+    bytes.insert(bytes.end(), entry.input.begin(), entry.input.end());
+    bytes.insert(bytes.end(), entry.output.begin(), entry.output.end());
+
+    // Threads in this process may be writing the same entry
+    std::string tmpPath = fmt::format(
+      "{}.tmp.{}.{}", path, getpid(), (pid_t)syscall(SYS_gettid));
+
+    try {
+        boost::filesystem::path p(path);
+        boost::filesystem::create_directories(p.parent_path());
+        faabric::util::writeBytesToFile(tmpPath, bytes);
+        boost::filesystem::rename(tmpPath, path);
+    } catch (std::exception& e) {
+        // Persistence is best-effort, we still have the result in memory
+        faabric::util::getLogger()->warn(
+          "Failed to persist memoized result to {}: {}", path, e.what());
+        boost::system::error_code ec;
+        boost::filesystem::remove(tmpPath, ec);
+    }
+}
+
+long ResultCache::getHitCount()
+{
+    return hitCount;
+}
+
+long ResultCache::getMissCount()
+{
+    return missCount;
+}
+
+long ResultCache::getEvictionCount()
+{
+    return evictionCount;
+}
+
+size_t ResultCache::getEntryCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return entries.size();
+}
+
+/**
+ * Removes all results for the given function, including any persisted ones,
+ * e.g. when a new version of it has been uploaded.
+ */
+void ResultCache::clearFunction(const faabric::Message& msg)
+{
+    const std::string name = getMemoName(msg);
+
+    {
+        faabric::util::UniqueLock lock(mx);
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.first.name == name) {
+                lru.erase(it->second.second);
+                it = entries.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    const std::string& memoDir = conf::getFaasmConfig().memoizeDir;
+    if (!memoDir.empty()) {
+        boost::filesystem::path p(memoDir);
+        p.append(name);
+        boost::filesystem::remove_all(p);
+    }
+}
+
+/**
+ * Clears the in-memory results and counters. Anything persisted to the
+ * filesystem is left alone.
+ */
+void ResultCache::clear()
+{
+    faabric::util::UniqueLock lock(mx);
+    lru.clear();
+    entries.clear();
+
+    hitCount = 0;
+    missCount = 0;
+    evictionCount = 0;
+}
+}
@@ -131,79 +131,75 @@ std::vector<uint8_t> WasmModule::snapshotToMemory()
     return std::vector<uint8_t>(outStr.begin(), outStr.end());
 }
 
-int WasmModule::getStdoutFd()
-{
-    if (stdoutMemFd == 0) {
-        stdoutMemFd = memfd_create("stdoutfd", 0);
-        faabric::util::getLogger()->debug("Capturing stdout: fd={}",
-                                          stdoutMemFd);
+/**
+ * Returns the capture buffer for the current call, creating it on the first
+ * write.
+ */
+OutputCapture& WasmModule::getStdoutCapture()
+{
+    if (stdoutCapture == nullptr) {
+        faabric::Message* call = getExecutingCall();
+        faabric::Message msg;
+        if (call != nullptr) {
+            msg = *call;
+        } else {
+            msg.set_user(boundUser);
+            msg.set_function(boundFunction);
+        }
+
+        stdoutCapture =
+          std::make_unique<OutputCapture>(msg, getOutputCaptureBytes(msg));
     }
 
-    return stdoutMemFd;
+    return *stdoutCapture;
 }
 
 ssize_t WasmModule::captureStdout(const struct iovec* iovecs, int iovecCount)
 {
-    int memFd = getStdoutFd();
-    ssize_t writtenSize = ::writev(memFd, iovecs, iovecCount);
+    OutputCapture& capture = getStdoutCapture();
 
-    if (writtenSize < 0) {
-        faabric::util::getLogger()->error("Failed capturing stdout: {}",
-                                          strerror(errno));
-        throw std::runtime_error(std::string("Failed capturing stdout: ") +
-                                 strerror(errno));
+    ssize_t writtenSize = 0;
+    for (int i = 0; i < iovecCount; i++) {
+        capture.write(static_cast<const char*>(iovecs[i].iov_base),
+                      iovecs[i].iov_len);
+        writtenSize += iovecs[i].iov_len;
     }
 
     faabric::util::getLogger()->debug("Captured {} bytes of formatted stdout",
                                       writtenSize);
-    stdoutSize += writtenSize;
     return writtenSize;
 }
 
 ssize_t WasmModule::captureStdout(const void* buffer)
 {
-    int memFd = getStdoutFd();
+    OutputCapture& capture = getStdoutCapture();
 
-    ssize_t writtenSize =
-      dprintf(memFd, "%s\n", reinterpret_cast<const char*>(buffer));
-
-    if (writtenSize < 0) {
-        faabric::util::getLogger()->error("Failed capturing stdout: {}",
-                                          strerror(errno));
-        throw std::runtime_error("Failed capturing stdout");
-    }
+    std::string line = std::string(reinterpret_cast<const char*>(buffer));
+    line += "\n";
+    capture.write(line.data(), line.size());
 
     faabric::util::getLogger()->debug("Captured {} bytes of unformatted stdout",
-                                      writtenSize);
-    stdoutSize += writtenSize;
-    return writtenSize;
+                                      line.size());
+    return line.size();
+}
+
+int64_t WasmModule::getMeteredInstructions()
+{
+    return meteredInstructions;
 }
 
 std::string WasmModule::getCapturedStdout()
 {
-    if (stdoutSize == 0) {
+    if (stdoutCapture == nullptr) {
         return "";
     }
 
-    // Go back to start
-    int memFd = getStdoutFd();
-    lseek(memFd, 0, SEEK_SET);
-
-    // Read in and return
-    char* buf = new char[stdoutSize];
-    read(memFd, buf, stdoutSize);
-    std::string stdoutString(buf, stdoutSize);
-    faabric::util::getLogger()->debug(
-      "Read stdout length {}:\n{}", stdoutSize, stdoutString);
-
-    return stdoutString;
+    return stdoutCapture->read();
 }
 
 void WasmModule::clearCapturedStdout()
 {
-    close(stdoutMemFd);
-    stdoutMemFd = 0;
-    stdoutSize = 0;
+    stdoutCapture.reset();
 }
 
 uint32_t WasmModule::getArgc()
@@ -357,6 +353,11 @@ uint8_t* WasmModule::wasmPointerToNative(int32_t wasmPtr)
     throw std::runtime_error("wasmPointerToNative not implemented");
 }
 
+size_t WasmModule::getMemorySizeBytes()
+{
+    return 0;
+}
+
 void WasmModule::printDebugInfo()
 {
     throw std::runtime_error("printDebugInfo not implemented");
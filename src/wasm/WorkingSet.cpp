@@ -0,0 +1,174 @@
+#include "wasm/WorkingSet.h"
+
+#include <conf/FaasmConfig.h>
+#include <system/Pagemap.h>
+
+#include <faabric/util/func.h>
+
+#include <algorithm>
+
+namespace wasm {
+static const char* regionNames[WORKING_SET_N_REGIONS] = { "stack",
+                                                          "data",
+                                                          "heap" };
+
+FunctionWorkingSets& getFunctionWorkingSets()
+{
+    static FunctionWorkingSets workingSets;
+    return workingSets;
+}
+
+/**
+ * Counts the pages in each region, assigning each page to the region its
+ * start falls in.
+ */
+std::array<RegionPages, WORKING_SET_N_REGIONS> CallWorkingSet::getRegionPages()
+  const
+{
+    std::array<RegionPages, WORKING_SET_N_REGIONS> regions;
+    for (size_t p = 0; p < pageStates.size(); p++) {
+        size_t offset = p * pageSize;
+        int region = WORKING_SET_HEAP;
+        if (offset < dataStart) {
+            region = WORKING_SET_STACK;
+        } else if (offset < heapStart) {
+            region = WORKING_SET_DATA;
+        }
+
+        regions[region].pages++;
+        if (pageStates[p] & PAGE_TOUCHED) {
+            regions[region].touched++;
+        }
+        if (pageStates[p] & PAGE_DIRTIED) {
+            regions[region].dirtied++;
+        }
+    }
+
+    return regions;
+}
+
+std::string CallWorkingSet::toString() const
+{
+    std::array<RegionPages, WORKING_SET_N_REGIONS> regions = getRegionPages();
+
+    std::string str;
+    for (int r = 0; r < WORKING_SET_N_REGIONS; r++) {
+        str += std::string(r > 0 ? ", " : "") + regionNames[r] + " " +
+               std::to_string(regions[r].touched) + "/" +
+               std::to_string(regions[r].pages) + " touched " +
+               std::to_string(regions[r].dirtied) + " dirtied";
+    }
+
+    return str;
+}
+
+std::string WorkingSetReport::toString() const
+{
+    char buf[256];
+    snprintf(buf,
+             sizeof(buf),
+             "%li calls, %lu byte pages\n"
+             "%-8s %10s %14s %10s %14s %10s %12s %12s\n",
+             calls,
+             pageSize,
+             "Region",
+             "Pages",
+             "Touched mean",
+             "max",
+             "Dirtied mean",
+             "max",
+             "Ever touched",
+             "Ever dirtied");
+    std::string str = buf;
+
+    for (int r = 0; r < WORKING_SET_N_REGIONS; r++) {
+        const RegionReport& region = regions[r];
+        snprintf(buf,
+                 sizeof(buf),
+                 "%-8s %10li %14.1f %10li %14.1f %10li %12li %12li\n",
+                 regionNames[r],
+                 region.pages,
+                 calls > 0 ? (double)region.totalTouched / calls : 0,
+                 region.maxTouched,
+                 calls > 0 ? (double)region.totalDirtied / calls : 0,
+                 region.maxDirtied,
+                 region.everTouched,
+                 region.everDirtied);
+        str += buf;
+    }
+
+    return str;
+}
+
+bool FunctionWorkingSets::shouldAnalyse(const faabric::Message& msg)
+{
+    return conf::isFunctionInList(conf::getFaasmConfig().workingSetFunctions,
+                                  msg);
+}
+
+void FunctionWorkingSets::record(const faabric::Message& msg,
+                                 const CallWorkingSet& workingSet)
+{
+    const std::string funcStr = faabric::util::funcToString(msg, false);
+    std::array<RegionPages, WORKING_SET_N_REGIONS> regions =
+      workingSet.getRegionPages();
+
+    std::scoped_lock<std::mutex> guard(mx);
+    FunctionWorkingSet& functionWorkingSet = workingSets[funcStr];
+
+    WorkingSetReport& report = functionWorkingSet.report;
+    report.calls++;
+    report.pageSize = workingSet.pageSize;
+    for (int r = 0; r < WORKING_SET_N_REGIONS; r++) {
+        RegionReport& region = report.regions[r];
+        region.totalTouched += regions[r].touched;
+        region.maxTouched = std::max(region.maxTouched, regions[r].touched);
+        region.totalDirtied += regions[r].dirtied;
+        region.maxDirtied = std::max(region.maxDirtied, regions[r].dirtied);
+    }
+
+    // Memory only grows, so the latest layout covers all earlier calls
+    CallWorkingSet& combined = functionWorkingSet.combined;
+    combined.pageSize = workingSet.pageSize;
+    combined.dataStart = workingSet.dataStart;
+    combined.heapStart = workingSet.heapStart;
+    combined.memoryBytes =
+      std::max(combined.memoryBytes, workingSet.memoryBytes);
+
+    if (combined.pageStates.size() < workingSet.pageStates.size()) {
+        combined.pageStates.resize(workingSet.pageStates.size(), 0);
+    }
+    for (size_t p = 0; p < workingSet.pageStates.size(); p++) {
+        combined.pageStates[p] |= workingSet.pageStates[p];
+    }
+}
+
+bool FunctionWorkingSets::getReport(const std::string& funcStr,
+                                    WorkingSetReport& report)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = workingSets.find(funcStr);
+    if (it == workingSets.end()) {
+        return false;
+    }
+
+    report = it->second.report;
+
+    std::array<RegionPages, WORKING_SET_N_REGIONS> combined =
+      it->second.combined.getRegionPages();
+    for (int r = 0; r < WORKING_SET_N_REGIONS; r++) {
+        report.regions[r].pages = combined[r].pages;
+        report.regions[r].everTouched = combined[r].touched;
+        report.regions[r].everDirtied = combined[r].dirtied;
+    }
+
+    return true;
+}
+
+void FunctionWorkingSets::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    workingSets.clear();
+}
+}
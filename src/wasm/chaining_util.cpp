@@ -1,20 +1,65 @@
 #include "WasmModule.h"
+#include "wasm/CallGraph.h"
+#include "wasm/CallTracer.h"
+#include "wasm/LocalCallBuffers.h"
+#include "wasm/OutputStreams.h"
+#include "wasm/ResultCache.h"
 #include "wasm/chaining.h"
 
+#include <conf/FaasmConfig.h>
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/util/bytes.h>
+#include <system/LatencyMetrics.h>
 
 namespace wasm {
+static thread_local AwaitHooks* awaitHooks = nullptr;
+static thread_local int awaitDepth = 0;
+
+void setThreadAwaitHooks(AwaitHooks* hooks)
+{
+    awaitHooks = hooks;
+}
+
+AwaitScope::AwaitScope()
+{
+    if (awaitDepth++ == 0 && awaitHooks != nullptr) {
+        awaitHooks->beforeAwait();
+    }
+}
+
+AwaitScope::~AwaitScope()
+{
+    if (--awaitDepth == 0 && awaitHooks != nullptr) {
+        awaitHooks->afterAwait();
+    }
+}
+
 int awaitChainedCall(unsigned int messageId)
 {
     int callTimeoutMs = faabric::util::getSystemConfig().chainedCallTimeout;
 
+    AwaitScope awaitScope;
+    LATENCY_START(chainedCallAwait)
+
     int returnCode = 1;
     try {
-        faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
-        const faabric::Message result =
-          sch.getFunctionResult(messageId, callTimeoutMs);
-        returnCode = result.returnvalue();
+        // Drain the output stream, otherwise a callee which streams more
+        // output than fits in the stream would never finish
+        std::shared_ptr<OutputStreamReader> reader =
+          getOutputStreams().getReader(messageId);
+        if (reader != nullptr) {
+            drainCallOutputStream(messageId);
+        }
+
+        if (reader != nullptr && reader->hasResult) {
+            returnCode = reader->result.returnvalue();
+        } else {
+            faabric::scheduler::Scheduler& sch =
+              faabric::scheduler::getScheduler();
+            const faabric::Message result =
+              sch.getFunctionResult(messageId, callTimeoutMs);
+            returnCode = result.returnvalue();
+        }
     } catch (faabric::redis::RedisNoResponseException& ex) {
         faabric::util::getLogger()->error(
           "Timed out waiting for chained call: {}", messageId);
@@ -23,6 +68,12 @@ int awaitChainedCall(unsigned int messageId)
           "Non-timeout exception waiting for chained call: {}", ex.what());
     }
 
+    LATENCY_END(chainedCallAwait)
+
+    // Drop any local buffers, the output isn't needed
+    getLocalCallBuffers().removeCall(messageId);
+    getOutputStreams().removeReader(messageId);
+
     return returnCode;
 }
 
@@ -38,7 +89,8 @@ int makeChainedCall(const std::string& functionName,
     // the message queue
     faabric::Message call =
       faabric::util::messageFactory(originalCall->user(), functionName);
-    call.set_inputdata(inputData.data(), inputData.size());
+    faabric::util::setMessageId(call);
+    getCallTracer().propagateToCall(call.id());
     call.set_funcptr(wasmFuncPtr);
     call.set_isasync(true);
 
@@ -53,8 +105,47 @@ int makeChainedCall(const std::string& functionName,
       faabric::util::funcToString(*originalCall, false);
     const std::string chainedStr = faabric::util::funcToString(call, false);
 
+    // If this call has been made before with the same input we don't need to
+    // dispatch it at all
+    ResultCache& resultCache = getResultCache();
+    if (resultCache.isMemoizable(call)) {
+        std::vector<uint8_t> output;
+        if (resultCache.getResult(call, inputData, output)) {
+            faabric::util::getLogger()->debug(
+              "Chained {} -> {} memoized", origStr, chainedStr);
+
+            // The caller collects the output like any other call's
+            getOutputStreams().addCompletedReader(
+              call.id(), originalCall->id(), output);
+            return call.id();
+        }
+    }
+
+    // If the call will run on this host anyway we can skip serialising the
+    // input and output into the messages and pass them through local buffers
+    // instead. Note that the call must then be forced to execute locally.
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
-    sch.callFunction(call);
+    bool isLocal = false;
+    if (conf::getFaasmConfig().chainedCallFastPath == "on") {
+        const std::string bestHost = sch.getBestHostForFunction(call);
+        isLocal = bestHost == conf.endpointHost;
+    }
+
+    if (isLocal) {
+        getLocalCallBuffers().addCall(call.id(), originalCall->id(), inputData);
+    } else {
+        call.set_inputdata(inputData.data(), inputData.size());
+    }
+
+    // The caller can read the output as a stream, although only functions
+    // that opt in actually stream it
+    getOutputStreams().addReader(
+      call.id(), originalCall->id(), isLocal, isOutputStreamed(call));
+
+    LATENCY_START(chainedCallDispatch)
+    sch.callFunction(call, isLocal);
+    LATENCY_END(chainedCallDispatch)
+
     faabric::util::getLogger()->debug("Chained {} ({}) -> {} ({})",
                                       origStr,
                                       conf.endpointHost,
@@ -62,6 +153,7 @@ int makeChainedCall(const std::string& functionName,
                                       call.scheduledhost());
 
     sch.logChainedFunction(originalCall->id(), call.id());
+    getCallGraph().recordChainedCall(*originalCall, call);
 
     return call.id();
 }
@@ -113,25 +205,48 @@ int awaitChainedCallOutput(unsigned int messageId,
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
     int callTimeoutMs = faabric::util::getSystemConfig().chainedCallTimeout;
+    AwaitScope awaitScope;
 
-    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
-    const faabric::Message result =
-      sch.getFunctionResult(messageId, callTimeoutMs);
+    // Chained calls hand back their output through the output stream, which
+    // includes whatever the caller hasn't already read from it
+    std::shared_ptr<OutputStreamReader> reader =
+      getOutputStreams().getReader(messageId);
 
-    if (result.type() == faabric::Message_MessageType_EMPTY) {
-        logger->error("Cannot find output for {}", messageId);
+    std::vector<uint8_t> outputData;
+    if (reader != nullptr) {
+        outputData = drainCallOutputStream(messageId);
     }
 
-    std::vector<uint8_t> outputData =
-      faabric::util::stringToBytes(result.outputdata());
+    int returnValue;
+    if (reader != nullptr && reader->hasResult) {
+        returnValue = reader->result.returnvalue();
+    } else {
+        faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+        const faabric::Message result =
+          sch.getFunctionResult(messageId, callTimeoutMs);
+
+        if (result.type() == faabric::Message_MessageType_EMPTY) {
+            logger->error("Cannot find output for {}", messageId);
+        }
+
+        if (reader == nullptr) {
+            outputData = faabric::util::stringToBytes(result.outputdata());
+        }
+
+        returnValue = result.returnvalue();
+    }
+
+    getLocalCallBuffers().removeCall(messageId);
+    getOutputStreams().removeReader(messageId);
+
     int outputLen =
       faabric::util::safeCopyToBuffer(outputData, buffer, bufferLen);
-
-    if (outputLen < outputData.size()) {
-        logger->warn(
-          "Undersized output buffer: {} for {} output", bufferLen, outputLen);
+    if ((size_t)outputLen < outputData.size()) {
+        logger->warn("Undersized output buffer: {} for {} output",
+                     bufferLen,
+                     outputData.size());
     }
 
-    return result.returnvalue();
+    return returnValue;
 }
 }
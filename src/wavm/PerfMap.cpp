@@ -0,0 +1,150 @@
+#include <wavm/PerfMap.h>
+
+#include <Runtime/RuntimePrivate.h>
+#include <WAVM/IR/Module.h>
+#include <WAVM/RuntimeABI/RuntimeABI.h>
+#include <faabric/util/logging.h>
+
+#include <fstream>
+#include <unistd.h>
+
+using namespace WAVM;
+
+namespace wasm {
+PerfMap& getPerfMap()
+{
+    static PerfMap perfMap;
+    return perfMap;
+}
+
+PerfMap::PerfMap()
+  : path("/tmp/perf-" + std::to_string(getpid()) + ".map")
+{}
+
+uint64_t PerfMap::addRegion(const std::vector<PerfMapEntry>& entries)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    uint64_t regionId = nextRegionId++;
+    regions[regionId] = entries;
+
+    // New entries can just be appended
+    writeEntries(entries, true);
+
+    return regionId;
+}
+
+/**
+ * Removes a region's entries. The map file can only be appended to, so the
+ * whole file is rewritten without them.
+ */
+void PerfMap::removeRegion(uint64_t regionId)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    if (regions.erase(regionId) == 0) {
+        return;
+    }
+
+    std::vector<PerfMapEntry> remaining;
+    for (auto& r : regions) {
+        remaining.insert(remaining.end(), r.second.begin(), r.second.end());
+    }
+
+    writeEntries(remaining, false);
+}
+
+void PerfMap::writeEntries(const std::vector<PerfMapEntry>& entries,
+                           bool append)
+{
+    std::ofstream out(path, append ? std::ios::app : std::ios::trunc);
+    if (!out.is_open()) {
+        faabric::util::getLogger()->warn("Could not write perf map at {}",
+                                         path);
+        return;
+    }
+
+    // Each line is: <start addr> <size> <name>, with numbers in hex
+    char buf[32];
+    for (auto& e : entries) {
+        snprintf(buf, sizeof(buf), "%lx %lx ", e.start, e.size);
+        out << buf << e.name << "\n";
+    }
+}
+
+size_t PerfMap::getEntryCount()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    size_t count = 0;
+    for (auto& r : regions) {
+        count += r.second.size();
+    }
+
+    return count;
+}
+
+std::string PerfMap::getPath()
+{
+    return path;
+}
+
+void PerfMap::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    regions.clear();
+    ::unlink(path.c_str());
+}
+
+PerfMapRegion::PerfMapRegion(uint64_t regionIdIn)
+  : regionId(regionIdIn)
+{}
+
+PerfMapRegion::~PerfMapRegion()
+{
+    getPerfMap().removeRegion(regionId);
+}
+
+uint64_t PerfMapRegion::getRegionId()
+{
+    return regionId;
+}
+
+/**
+ * Builds entries for the functions defined in an instantiated module, named
+ * with the given prefix and the names from the module's name section.
+ */
+std::vector<PerfMapEntry> getPerfMapEntries(Runtime::Instance* instance,
+                                            IR::Module& irModule,
+                                            const std::string& prefix)
+{
+    IR::DisassemblyNames disassemblyNames;
+    getDisassemblyNames(irModule, disassemblyNames);
+
+    std::vector<PerfMapEntry> entries;
+    Uptr nImports = irModule.functions.imports.size();
+    for (Uptr i = nImports; i < instance->functions.size(); i++) {
+        Runtime::Function* func = instance->functions[i];
+        if (func == nullptr || func->mutableData == nullptr ||
+            func->mutableData->numCodeBytes == 0) {
+            continue;
+        }
+
+        std::string funcName;
+        if (i < disassemblyNames.functions.size()) {
+            funcName = disassemblyNames.functions[i].name;
+        }
+        if (funcName.empty()) {
+            funcName = "functionDef" + std::to_string(i - nImports);
+        }
+
+        PerfMapEntry entry;
+        entry.start = reinterpret_cast<uintptr_t>(func->code);
+        entry.size = func->mutableData->numCodeBytes;
+        entry.name = prefix + funcName;
+        entries.emplace_back(entry);
+    }
+
+    return entries;
+}
+}
@@ -0,0 +1,340 @@
+#include <wavm/SamplingProfiler.h>
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <execinfo.h>
+#include <mutex>
+#include <sstream>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace wasm {
+// The profiler running on this thread, if any
+static thread_local SamplingProfiler* activeProfiler = nullptr;
+
+static void profilerSignalHandler(int sig, siginfo_t* info, void* context)
+{
+    int savedErrno = errno;
+
+    SamplingProfiler* profiler = activeProfiler;
+    if (profiler != nullptr) {
+        void* pc = nullptr;
+#if defined(__x86_64__)
+        auto* ucontext = static_cast<ucontext_t*>(context);
+        pc = reinterpret_cast<void*>(ucontext->uc_mcontext.gregs[REG_RIP]);
+#endif
+        profiler->takeSample(pc);
+    }
+
+    errno = savedErrno;
+}
+
+/**
+ * Installs the SIGPROF handler once for the whole process. It's never
+ * removed, as a timer signal may still be pending after a profiler stops.
+ */
+static void installSignalHandler()
+{
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        // The first backtrace may load the unwinder, which isn't safe in a
+        // signal handler, so do it here
+        void* frames[1];
+        backtrace(frames, 1);
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = profilerSignalHandler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+
+        if (sigaction(SIGPROF, &action, nullptr) != 0) {
+            faabric::util::getLogger()->error(
+              "Failed to install SIGPROF handler: {}", strerror(errno));
+            throw std::runtime_error("Failed to install SIGPROF handler");
+        }
+    });
+}
+
+SamplingProfiler::SamplingProfiler(int intervalUsIn)
+  : intervalUs(intervalUsIn)
+{}
+
+SamplingProfiler::~SamplingProfiler()
+{
+    stop();
+}
+
+void SamplingProfiler::start()
+{
+    if (running) {
+        return;
+    }
+
+    installSignalHandler();
+
+    samples.resize(PROFILE_MAX_SAMPLES);
+    sampleCount = 0;
+    droppedCount = 0;
+    activeProfiler = this;
+
+    // Deliver SIGPROF to this thread only, as it uses its CPU time
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timerId) != 0) {
+        activeProfiler = nullptr;
+        faabric::util::getLogger()->error("Failed to create profiler timer: {}",
+                                          strerror(errno));
+        throw std::runtime_error("Failed to create profiler timer");
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = intervalUs / 1000000;
+    spec.it_interval.tv_nsec = (intervalUs % 1000000) * 1000L;
+    spec.it_value = spec.it_interval;
+    timer_settime(timerId, 0, &spec, nullptr);
+
+    running = true;
+}
+
+void SamplingProfiler::stop()
+{
+    if (!running) {
+        return;
+    }
+
+    timer_delete(timerId);
+    activeProfiler = nullptr;
+    running = false;
+}
+
+size_t SamplingProfiler::getSampleCount()
+{
+    return sampleCount;
+}
+
+size_t SamplingProfiler::getDroppedCount()
+{
+    return droppedCount;
+}
+
+/**
+ * Called from the signal handler, so must only do async-signal-safe work.
+ */
+void SamplingProfiler::takeSample(void* pc)
+{
+    size_t idx = sampleCount.load(std::memory_order_relaxed);
+    if (idx >= samples.size()) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ProfileSample& sample = samples[idx];
+    sample.pc = pc;
+    sample.depth = backtrace(sample.frames, PROFILE_MAX_DEPTH);
+    sampleCount.store(idx + 1, std::memory_order_release);
+}
+
+/**
+ * Resolves each sample against the given guest code ranges. Frames outside
+ * guest code are dropped, except that time spent in host calls made by the
+ * guest is attributed to a single host frame.
+ */
+FoldedStacks SamplingProfiler::getFoldedStacks(
+  std::vector<PerfMapEntry> codeRanges)
+{
+    std::sort(codeRanges.begin(),
+              codeRanges.end(),
+              [](const PerfMapEntry& a, const PerfMapEntry& b) {
+                  return a.start < b.start;
+              });
+
+    auto findFunction = [&codeRanges](uintptr_t addr) -> const PerfMapEntry* {
+        auto it = std::upper_bound(
+          codeRanges.begin(),
+          codeRanges.end(),
+          addr,
+          [](uintptr_t a, const PerfMapEntry& e) { return a < e.start; });
+        if (it == codeRanges.begin()) {
+            return nullptr;
+        }
+
+        --it;
+        if (addr >= it->start + it->size) {
+            return nullptr;
+        }
+
+        return &(*it);
+    };
+
+    FoldedStacks stacks;
+    size_t nSamples = sampleCount.load(std::memory_order_acquire);
+    for (size_t s = 0; s < nSamples; s++) {
+        ProfileSample& sample = samples[s];
+
+        // Skip the signal handler's own frames, up to the interrupted one
+        int leaf = std::min(PROFILE_HANDLER_FRAMES, sample.depth);
+        for (int f = 0; f < sample.depth; f++) {
+            if (sample.pc != nullptr && sample.frames[f] == sample.pc) {
+                leaf = f;
+                break;
+            }
+        }
+
+        // Walk from the leaf up, noting guest frames
+        std::vector<std::string> frames;
+        bool inHost = false;
+        for (int f = leaf; f < sample.depth; f++) {
+            // Return addresses point after the call, except for the leaf
+            uintptr_t addr = reinterpret_cast<uintptr_t>(sample.frames[f]);
+            if (f > leaf) {
+                addr -= 1;
+            }
+
+            const PerfMapEntry* func = findFunction(addr);
+            if (func != nullptr) {
+                frames.emplace_back(func->name);
+            } else if (frames.empty()) {
+                inHost = true;
+            }
+        }
+
+        std::string stack = PROFILE_HOST_FRAME;
+        if (!frames.empty()) {
+            stack.clear();
+            for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+                stack += (stack.empty() ? "" : ";") + *it;
+            }
+
+            if (inHost) {
+                stack += ";" PROFILE_HOST_FRAME;
+            }
+        }
+
+        stacks[stack]++;
+    }
+
+    return stacks;
+}
+
+CallProfiles& getCallProfiles()
+{
+    static CallProfiles profiles;
+    return profiles;
+}
+
+/**
+ * Checks whether a call should be profiled, either because its function is
+ * listed in PROFILE_FUNCTIONS or because it was enabled for this call. Cheap
+ * when nothing is being profiled.
+ */
+bool CallProfiles::shouldProfile(const faabric::Message& msg)
+{
+    if (conf::isFunctionInList(conf::getFaasmConfig().profileFunctions, msg)) {
+        return true;
+    }
+
+    if (enabledCallCount == 0) {
+        return false;
+    }
+
+    std::scoped_lock<std::mutex> guard(mx);
+    return enabledCalls.count(msg.id()) > 0;
+}
+
+void CallProfiles::enableForCall(unsigned int messageId)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    enabledCalls.insert(messageId);
+    enabledCallCount = enabledCalls.size();
+}
+
+void CallProfiles::record(const faabric::Message& msg,
+                          const FoldedStacks& stacks)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    enabledCalls.erase(msg.id());
+    enabledCallCount = enabledCalls.size();
+
+    if (callProfiles.find(msg.id()) == callProfiles.end()) {
+        order.push_back(msg.id());
+    }
+    callProfiles[msg.id()] = stacks;
+
+    while (order.size() > PROFILE_LOG_CAPACITY) {
+        callProfiles.erase(order.front());
+        order.pop_front();
+    }
+
+    FoldedStacks& functionStacks =
+      functionProfiles[faabric::util::funcToString(msg, false)];
+    for (auto& s : stacks) {
+        functionStacks[s.first] += s.second;
+    }
+}
+
+bool CallProfiles::getCallProfile(unsigned int messageId, FoldedStacks& stacks)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = callProfiles.find(messageId);
+    if (it == callProfiles.end()) {
+        return false;
+    }
+
+    stacks = it->second;
+    return true;
+}
+
+FoldedStacks CallProfiles::getFunctionProfile(const std::string& funcStr)
+{
+    std::scoped_lock<std::mutex> guard(mx);
+
+    auto it = functionProfiles.find(funcStr);
+    if (it == functionProfiles.end()) {
+        return {};
+    }
+
+    return it->second;
+}
+
+void CallProfiles::clear()
+{
+    std::scoped_lock<std::mutex> guard(mx);
+    enabledCalls.clear();
+    enabledCallCount = 0;
+    order.clear();
+    callProfiles.clear();
+    functionProfiles.clear();
+}
+
+/**
+ * Renders stacks in the folded format read by flame graph tools, i.e. one
+ * "frame;frame;frame count" line per stack.
+ */
+std::string foldedStacksToString(const FoldedStacks& stacks)
+{
+    std::stringstream ss;
+    for (auto& s : stacks) {
+        ss << s.first << " " << s.second << std::endl;
+    }
+
+    return ss.str();
+}
+}
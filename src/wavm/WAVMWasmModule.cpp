@@ -1,20 +1,30 @@
 #include "syscalls.h"
 #include <wavm/WAVMWasmModule.h>
 
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <cereal/archives/binary.hpp>
+#include <csignal>
+#include <cstring>
+#include <pthread.h>
 #include <stdexcept>
 #include <sys/mman.h>
 #include <sys/types.h>
+#include <ucontext.h>
+#include <unistd.h>
 
 #include <faabric/util/bytes.h>
 #include <faabric/util/config.h>
 #include <faabric/util/func.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/memory.h>
-#include <faabric/util/timing.h>
 #include <ir_cache/IRModuleCache.h>
 #include <storage/SharedFiles.h>
+#include <system/IsolationManager.h>
+#include <system/LatencyMetrics.h>
+#include <system/Pagemap.h>
+#include <wasm/ExecutionWatchdog.h>
+#include <wasm/WorkingSet.h>
 #include <wasm/serialisation.h>
 
 #include <Runtime/RuntimePrivate.h>
@@ -26,7 +36,10 @@
 #include <WAVM/Runtime/Runtime.h>
 #include <WAVM/WASM/WASM.h>
 
+#include <conf/FaasmConfig.h>
 #include <wavm/OMPThreadPool.h>
+#include <wavm/PerfMap.h>
+#include <wavm/SamplingProfiler.h>
 #include <wavm/openmp/ThreadState.h>
 
 constexpr int THREAD_STACK_SIZE(2 * ONE_MB_BYTES);
@@ -36,6 +49,78 @@ using namespace WAVM;
 namespace wasm {
 static thread_local WAVMWasmModule* executingModule;
 
+// Signal the watchdog sends to interrupt a call. Ignored by default, so a
+// stray one is harmless
+#define INTERRUPT_SIGNAL SIGURG
+
+// The guest code of the call on this thread while it can be interrupted,
+// sorted by address
+static thread_local std::vector<PerfMapEntry>* interruptibleCode = nullptr;
+
+// Set when the handler unwinds the call on this thread
+static thread_local bool callInterrupted = false;
+
+static bool isGuestCode(const std::vector<PerfMapEntry>& ranges, uintptr_t pc)
+{
+    auto it = std::upper_bound(
+      ranges.begin(), ranges.end(), pc, [](uintptr_t p, const PerfMapEntry& e) {
+          return p < e.start;
+      });
+
+    if (it == ranges.begin()) {
+        return false;
+    }
+
+    --it;
+    return pc < it->start + it->size;
+}
+
+/**
+ * Unwinds the call if the signal lands in guest code. Anywhere else, e.g. in
+ * a host intrinsic that may hold locks or be using guest memory, it does
+ * nothing and the watchdog tries again on its next check.
+ */
+static void interruptSignalHandler(int sig, siginfo_t* info, void* context)
+{
+    std::vector<PerfMapEntry>* ranges = interruptibleCode;
+    if (ranges == nullptr) {
+        return;
+    }
+
+    uintptr_t pc = 0;
+#if defined(__x86_64__)
+    auto* ucontext = static_cast<ucontext_t*>(context);
+    pc = (uintptr_t)ucontext->uc_mcontext.gregs[REG_RIP];
+#endif
+
+    if (!isGuestCode(*ranges, pc)) {
+        return;
+    }
+
+    // WAVM unwinds guest code from its own trap handlers in the same way
+    interruptibleCode = nullptr;
+    callInterrupted = true;
+    Runtime::throwException(Runtime::ExceptionTypes::calledAbort);
+}
+
+static void installInterruptHandler()
+{
+    static std::once_flag flag;
+    std::call_once(flag, [] {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = interruptSignalHandler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+
+        if (sigaction(INTERRUPT_SIGNAL, &action, nullptr) != 0) {
+            faabric::util::getLogger()->error(
+              "Failed to install interrupt handler: {}", strerror(errno));
+            throw std::runtime_error("Failed to install interrupt handler");
+        }
+    });
+}
+
 static Runtime::Instance* baseEnvModule = nullptr;
 static Runtime::Instance* baseWasiModule = nullptr;
 
@@ -57,15 +142,15 @@ static void instantiateBaseModules()
     // Set up the basic modules common to all functions
     Runtime::Compartment* compartment =
       Runtime::createCompartment("baseModules");
-    PROF_START(BaseEnvModule)
+    LATENCY_START(BaseEnvModule)
     baseEnvModule = Intrinsics::instantiateModule(
       compartment, { WAVM_INTRINSIC_MODULE_REF(env) }, "env");
-    PROF_END(BaseEnvModule)
+    LATENCY_END(BaseEnvModule)
 
-    PROF_START(BaseWasiModule)
+    LATENCY_START(BaseWasiModule)
     baseWasiModule = Intrinsics::instantiateModule(
       compartment, { WAVM_INTRINSIC_MODULE_REF(wasi) }, "env");
-    PROF_END(BaseWasiModule)
+    LATENCY_END(BaseWasiModule)
 }
 
 void WAVMWasmModule::flush()
@@ -96,32 +181,28 @@ void setExecutingModule(WAVMWasmModule* other)
     executingModule = other;
 }
 
-WAVMWasmModule::WAVMWasmModule()
-{
-    stdoutMemFd = 0;
-    stdoutSize = 0;
-}
+WAVMWasmModule::WAVMWasmModule() {}
 
 WAVMWasmModule& WAVMWasmModule::operator=(const WAVMWasmModule& other)
 {
-    PROF_START(wasmAssignOp)
+    LATENCY_START(wasmAssignOp)
 
     // Do the clone
     clone(other);
 
-    PROF_END(wasmAssignOp)
+    LATENCY_END(wasmAssignOp)
 
     return *this;
 }
 
 WAVMWasmModule::WAVMWasmModule(const WAVMWasmModule& other)
 {
-    PROF_START(wasmCopyConstruct)
+    LATENCY_START(wasmCopyConstruct)
 
     // Do the clone
     clone(other);
 
-    PROF_END(wasmCopyConstruct)
+    LATENCY_END(wasmCopyConstruct)
 }
 
 void WAVMWasmModule::clone(const WAVMWasmModule& other)
@@ -141,14 +222,19 @@ void WAVMWasmModule::clone(const WAVMWasmModule& other)
 
     filesystem = other.filesystem;
 
+    // Clones run the same code, so keep it in the perf map until all are gone
+    perfMapRegions = other.perfMapRegions;
+
+    pgoInstrumented = other.pgoInstrumented;
+    metered = other.metered;
+
     wasmEnvironment = other.wasmEnvironment;
 
     // Do not copy over any captured stdout
-    stdoutMemFd = 0;
-    stdoutSize = 0;
+    stdoutCapture.reset();
 
     if (other._isBound) {
-        if (memoryFd > 0) {
+        if (memoryFd != nullptr) {
             // Clone compartment excluding memory
             compartment =
               Runtime::cloneCompartment(other.compartment, "", false);
@@ -174,7 +260,7 @@ void WAVMWasmModule::clone(const WAVMWasmModule& other)
         defaultTable = Runtime::getDefaultTable(moduleInstance);
 
         // Map memory contents if necessary
-        if (memoryFd > 0) {
+        if (memoryFd != nullptr) {
             mapMemoryFromFd();
         }
 
@@ -206,7 +292,7 @@ WAVMWasmModule::~WAVMWasmModule()
 
 bool WAVMWasmModule::tearDown()
 {
-    PROF_START(wasmTearDown)
+    LATENCY_START(wasmTearDown)
 
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
 
@@ -223,6 +309,8 @@ bool WAVMWasmModule::tearDown()
     }
     dynamicModuleMap.clear();
 
+    perfMapRegions.clear();
+
     // --- WAVM stuff ---
 
     // Set all reference to GC pointers to null to allow WAVM GC to clear up
@@ -247,7 +335,7 @@ bool WAVMWasmModule::tearDown()
         logger->debug("Successful GC for compartment");
     }
 
-    PROF_END(wasmTearDown)
+    LATENCY_END(wasmTearDown)
 
     return compartmentCleared;
 }
@@ -412,16 +500,16 @@ void WAVMWasmModule::doBindToFunction(const faabric::Message& msg,
     boundFunction = msg.function();
 
     // Set up the compartment and context
-    PROF_START(wasmContext)
+    LATENCY_START(wasmContext)
     compartment = Runtime::createCompartment();
     executionContext = Runtime::createContext(compartment);
-    PROF_END(wasmContext)
+    LATENCY_END(wasmContext)
 
     // Create the module instance
     moduleInstance =
       createModuleInstance(faabric::util::funcToString(msg, false), "");
 
-    PROF_START(wasmBind)
+    LATENCY_START(wasmBind)
 
     // Keep reference to memory and table
     defaultMemory = Runtime::getDefaultMemory(moduleInstance);
@@ -462,7 +550,7 @@ void WAVMWasmModule::doBindToFunction(const faabric::Message& msg,
                   initialMemoryPages,
                   initialTableSize);
 
-    PROF_END(wasmBind)
+    LATENCY_END(wasmBind)
 }
 
 void WAVMWasmModule::writeStringArrayToMemory(
@@ -507,7 +595,7 @@ Runtime::Instance* WAVMWasmModule::createModuleInstance(
 {
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
 
-    PROF_START(wasmCreateModule)
+    LATENCY_START(wasmCreateModule)
 
     IRModuleCache& moduleRegistry = wasm::getIRModuleCache();
     bool isMainModule = sharedModulePath.empty();
@@ -518,6 +606,9 @@ Runtime::Instance* WAVMWasmModule::createModuleInstance(
       moduleRegistry.getModule(boundUser, boundFunction, sharedModulePath);
 
     if (isMainModule) {
+        pgoInstrumented = isInstrumented(irModule);
+        metered = isMetered(irModule);
+
         // Normal (C/C++) env
         envModule = Runtime::cloneInstance(getEnvModule(), compartment);
 
@@ -609,6 +700,20 @@ Runtime::Instance* WAVMWasmModule::createModuleInstance(
                  boundFunction,
                  sharedModulePath);
 
+    // Publish the module's code for perf if enabled
+    if (conf::getFaasmConfig().perfMap == "on") {
+        std::string prefix = "wasm:" + boundUser + "/" + boundFunction + ":";
+        if (!isMainModule) {
+            prefix +=
+              boost::filesystem::path(sharedModulePath).filename().string() +
+              ":";
+        }
+
+        uint64_t regionId =
+          getPerfMap().addRegion(getPerfMapEntries(instance, irModule, prefix));
+        perfMapRegions.emplace_back(std::make_shared<PerfMapRegion>(regionId));
+    }
+
     // Here there may be some entries missing from the GOT that we need to
     // patch up. They may be exported from the dynamic module itself. I
     // don't know how this happens but occasionally it does
@@ -654,7 +759,7 @@ Runtime::Instance* WAVMWasmModule::createModuleInstance(
         dynamicModule.log();
     }
 
-    PROF_END(wasmCreateModule)
+    LATENCY_END(wasmCreateModule)
 
     return instance;
 }
@@ -827,6 +932,8 @@ bool WAVMWasmModule::execute(faabric::Message& msg, bool forceNoop)
 
     setExecutingModule(this);
     setExecutingCall(&msg);
+    isolationContext = isolation::getThreadIsolationContext();
+    meteredInstructions = -1;
 
     // Ensure Python function file in place (if necessary)
     storage::SharedFiles::syncPythonFunctionFile(msg);
@@ -889,6 +996,77 @@ bool WAVMWasmModule::execute(faabric::Message& msg, bool forceNoop)
     if (forceNoop) {
         logger->debug("NOTE: Explicitly forcing a noop");
     } else {
+        // Enforce any time limits by having the watchdog signal this thread.
+        // The call is only unwound when the signal lands in its guest code,
+        // so host intrinsics and the module's other threads are left alone.
+        CallTimeLimits limits = getCallTimeLimits(msg);
+        std::vector<PerfMapEntry> guestCode;
+        int watchId = 0;
+        if (limits.isLimited()) {
+            installInterruptHandler();
+
+            guestCode = getCodeRanges();
+            std::sort(guestCode.begin(),
+                      guestCode.end(),
+                      [](const PerfMapEntry& a, const PerfMapEntry& b) {
+                          return a.start < b.start;
+                      });
+
+            pthread_t callThread = pthread_self();
+            watchId = getExecutionWatchdog().arm(limits, [callThread] {
+                pthread_kill(callThread, INTERRUPT_SIGNAL);
+            });
+        }
+
+        // Returns the reason the call was interrupted, if it was. The
+        // watchdog may fire after the call has returned, or while it's only
+        // in host code, in which case the call's own result stands.
+        auto finishWatch = [&watchId] {
+            interruptibleCode = nullptr;
+
+            std::string reason;
+            if (watchId > 0) {
+                getExecutionWatchdog().disarm(watchId, reason);
+            }
+            watchId = 0;
+
+            if (!callInterrupted) {
+                reason.clear();
+            }
+            callInterrupted = false;
+
+            return reason;
+        };
+
+        // Instrumented builds count from wherever the zygote left off
+        PgoProfile pgoCountsBefore;
+        if (pgoInstrumented) {
+            pgoCountsBefore = readPgoCounters(
+              moduleInstance,
+              executionContext,
+              getIRModuleCache().getModule(boundUser, boundFunction, ""));
+        }
+
+        // Metered builds also count from wherever the zygote left off
+        int64_t meterBefore = 0;
+        threadInstructions = 0;
+        if (metered) {
+            meterBefore = readMeterCounter(moduleInstance, executionContext);
+        }
+
+        // Sample the call's stack if it's being profiled
+        std::unique_ptr<SamplingProfiler> profiler;
+        CallProfiles& callProfiles = getCallProfiles();
+        if (callProfiles.shouldProfile(msg)) {
+            profiler = std::make_unique<SamplingProfiler>(
+              conf::getFaasmConfig().profileIntervalUs);
+            profiler->start();
+        }
+
+        if (watchId > 0) {
+            callInterrupted = false;
+            interruptibleCode = &guestCode;
+        }
 
         try {
             Runtime::catchRuntimeExceptions(
@@ -917,6 +1095,42 @@ bool WAVMWasmModule::execute(faabric::Message& msg, bool forceNoop)
             logger->debug("Caught wasm exit exception (code {})", e.exitCode);
             returnValue = e.exitCode;
             success = e.exitCode == 0;
+        } catch (...) {
+            finishWatch();
+            throw;
+        }
+
+        if (profiler != nullptr) {
+            profiler->stop();
+            FoldedStacks stacks = profiler->getFoldedStacks(getCodeRanges());
+            callProfiles.record(msg, stacks);
+        }
+
+        if (pgoInstrumented) {
+            PgoProfile pgoCounts = readPgoCounters(
+              moduleInstance,
+              executionContext,
+              getIRModuleCache().getModule(boundUser, boundFunction, ""));
+            pgoCounts.subtract(pgoCountsBefore);
+            getPgoProfileStore().record(msg, pgoCounts);
+        }
+
+        if (metered) {
+            meteredInstructions =
+              readMeterCounter(moduleInstance, executionContext) -
+              meterBefore + threadInstructions;
+        }
+
+        if (getFunctionWorkingSets().shouldAnalyse(msg)) {
+            recordWorkingSet(msg);
+        }
+
+        // The module is left mid-call, so is reset from the zygote along
+        // with any other failed call
+        std::string interruptReason = finishWatch();
+        if (!interruptReason.empty()) {
+            msg.set_returnvalue(1);
+            throw CallTimeoutException("Call interrupted: " + interruptReason);
         }
     }
 
@@ -926,6 +1140,34 @@ bool WAVMWasmModule::execute(faabric::Message& msg, bool forceNoop)
     return success;
 }
 
+/**
+ * Records which pages of memory the call touched and dirtied. Only meaningful
+ * when the module was cloned from a zygote written to an fd just before the
+ * call, as it is for each call a Faaslet executes, so that no pages were
+ * mapped beforehand.
+ */
+void WAVMWasmModule::recordWorkingSet(const faabric::Message& msg)
+{
+    CallWorkingSet workingSet;
+    workingSet.pageSize = sysconf(_SC_PAGESIZE);
+    workingSet.memoryBytes =
+      Runtime::getMemoryNumPages(defaultMemory) * WASM_BYTES_PER_PAGE;
+
+    // The stack is at the bottom of memory, checked when binding
+    I32 heapBase = getGlobalI32("__heap_base", executionContext);
+    workingSet.heapStart = heapBase > 0 ? heapBase : 0;
+    workingSet.dataStart = std::min<size_t>(STACK_SIZE, workingSet.heapStart);
+
+    workingSet.pageStates = isolation::readPageStates(
+      Runtime::getMemoryBaseAddress(defaultMemory), workingSet.memoryBytes);
+
+    faabric::util::getLogger()->info("Working set of {}: {}",
+                                     faabric::util::funcToString(msg, true),
+                                     workingSet.toString());
+
+    getFunctionWorkingSets().record(msg, workingSet);
+}
+
 void WAVMWasmModule::executeRemoteOMP(faabric::Message& msg)
 {
     int funcPtr = msg.funcptr();
@@ -1068,6 +1310,15 @@ uint8_t* WAVMWasmModule::wasmPointerToNative(int32_t wasmPtr)
     return wasmMemoryRegionPtr;
 }
 
+size_t WAVMWasmModule::getMemorySizeBytes()
+{
+    if (!_isBound) {
+        return 0;
+    }
+
+    return Runtime::getMemoryNumPages(defaultMemory) * WASM_BYTES_PER_PAGE;
+}
+
 bool WAVMWasmModule::resolve(const std::string& moduleName,
                              const std::string& name,
                              IR::ExternType type,
@@ -1301,6 +1552,33 @@ std::map<std::string, std::string> WAVMWasmModule::buildDisassemblyMap()
     return output;
 }
 
+/**
+ * Returns the native code of each guest function in the main module and any
+ * dynamic modules, named as in the function's name section.
+ */
+std::vector<PerfMapEntry> WAVMWasmModule::getCodeRanges()
+{
+    IRModuleCache& moduleRegistry = wasm::getIRModuleCache();
+
+    IR::Module& irModule =
+      moduleRegistry.getModule(boundUser, boundFunction, "");
+    std::vector<PerfMapEntry> ranges =
+      getPerfMapEntries(moduleInstance, irModule, "");
+
+    for (auto& p : dynamicModuleMap) {
+        std::string prefix =
+          boost::filesystem::path(p.second.path).filename().string() + ":";
+        std::vector<PerfMapEntry> dynamicRanges = getPerfMapEntries(
+          p.second.ptr,
+          moduleRegistry.getModule(boundUser, boundFunction, p.second.path),
+          prefix);
+
+        ranges.insert(ranges.end(), dynamicRanges.begin(), dynamicRanges.end());
+    }
+
+    return ranges;
+}
+
 int WAVMWasmModule::getDynamicModuleCount()
 {
     return dynamicModuleMap.size();
@@ -1345,13 +1623,31 @@ int WAVMWasmModule::getDataOffsetFromGOT(const std::string& name)
     return globalOffsetMemoryMap[name].first;
 }
 
+MemoryFd::MemoryFd(int fdIn)
+  : fd(fdIn)
+{}
+
+MemoryFd::~MemoryFd()
+{
+    close(fd);
+}
+
+int MemoryFd::getFd()
+{
+    return fd;
+}
+
+/**
+ * Takes ownership of the fd, which is closed once this module and any cloned
+ * from it are gone.
+ */
 void WAVMWasmModule::writeMemoryToFd(int fd)
 {
-    memoryFd = fd;
+    memoryFd = std::make_shared<MemoryFd>(fd);
 
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
     logger->debug(
-      "Writing memory for {}/{} to fd {}", boundUser, boundFunction, memoryFd);
+      "Writing memory for {}/{} to fd {}", boundUser, boundFunction, fd);
 
     Uptr numPages = Runtime::getMemoryNumPages(defaultMemory);
     Uptr numBytes = numPages * WASM_BYTES_PER_PAGE;
@@ -1359,13 +1655,13 @@ void WAVMWasmModule::writeMemoryToFd(int fd)
 
     // Make the fd big enough
     memoryFdSize = numBytes;
-    int ferror = ftruncate(memoryFd, memoryFdSize);
+    int ferror = ftruncate(fd, memoryFdSize);
     if (ferror) {
         logger->error("ferror call failed with error {}", ferror);
     }
 
     // Write the data
-    ssize_t werror = write(memoryFd, memoryBase, memoryFdSize);
+    ssize_t werror = write(fd, memoryBase, memoryFdSize);
     if (werror == -1) {
         logger->error("write call failed");
     }
@@ -1377,7 +1673,7 @@ void WAVMWasmModule::mapMemoryFromFd()
     logger->debug("Mapping memory for {}/{} from fd {}",
                   boundUser,
                   boundFunction,
-                  memoryFd);
+                  memoryFd->getFd());
 
     U8* memoryBase = Runtime::getMemoryBaseAddress(defaultMemory);
 
@@ -1385,10 +1681,19 @@ void WAVMWasmModule::mapMemoryFromFd()
          memoryFdSize,
          PROT_WRITE,
          MAP_PRIVATE | MAP_FIXED,
-         memoryFd,
+         memoryFd->getFd(),
          0);
 }
 
+int WAVMWasmModule::getMemoryFd()
+{
+    if (memoryFd == nullptr) {
+        return -1;
+    }
+
+    return memoryFd->getFd();
+}
+
 void WAVMWasmModule::doSnapshot(std::ostream& outStream)
 {
     cereal::BinaryOutputArchive archive(outStream);
@@ -1454,6 +1759,10 @@ I64 WAVMWasmModule::executeThreadLocally(WasmThreadSpec& spec)
 
     threadContext->runtimeData->mutableGlobals[0] = stackTop;
 
+    // Run in the calling Faaslet's network namespace, as a thread of the
+    // same process would
+    isolation::ThreadIsolationScope isolationScope(isolationContext);
+
     int returnValue = 0;
     IR::UntaggedValue result;
     try {
@@ -1483,6 +1792,22 @@ I64 WAVMWasmModule::executeThreadLocally(WasmThreadSpec& spec)
         returnValue = e.exitCode;
     }
 
+    // Thread contexts start with zeroed counters, so all of these are new
+    if (metered) {
+        threadInstructions += readMeterCounter(moduleInstance, threadContext);
+    }
+
+    if (pgoInstrumented) {
+        faabric::Message msg =
+          faabric::util::messageFactory(boundUser, boundFunction);
+        getPgoProfileStore().record(
+          msg,
+          readPgoCounters(
+            moduleInstance,
+            threadContext,
+            getIRModuleCache().getModule(boundUser, boundFunction, "")));
+    }
+
     return returnValue;
 }
 
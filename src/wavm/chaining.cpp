@@ -2,6 +2,7 @@
 #include "syscalls.h"
 
 #include <faabric/scheduler/Scheduler.h>
+#include <wasm/OutputStreams.h>
 #include <wasm/chaining.h>
 
 #include <WAVM/Runtime/Intrinsics.h>
@@ -42,6 +43,28 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     return awaitChainedCallOutput(messageId, buffer, bufferLen);
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_read_call_output_chunk",
+                               I32,
+                               __faasm_read_call_output_chunk,
+                               U32 messageId,
+                               I32 bufferPtr,
+                               I32 bufferLen)
+{
+    faabric::util::getLogger()->debug(
+      "S - read_call_output_chunk - {} {} {}", messageId, bufferPtr, bufferLen);
+
+    if (bufferLen <= 0) {
+        return 0;
+    }
+
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    U8* buffer =
+      Runtime::memoryArrayPtr<U8>(memoryPtr, (Uptr)bufferPtr, (Uptr)bufferLen);
+
+    return (I32)readCallOutputChunk(messageId, buffer, bufferLen);
+}
+
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                "__faasm_chain_name",
                                U32,
@@ -12,13 +12,12 @@
 using namespace WAVM;
 
 namespace wasm {
-std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& bytes,
-                                 const std::string& fileName)
+static void parseModule(std::vector<uint8_t>& bytes,
+                        const std::string& fileName,
+                        IR::Module& moduleIR)
 {
     auto logger = faabric::util::getLogger();
 
-    IR::Module moduleIR;
-
     // Feature flags
     moduleIR.featureSpec.simd = true;
 
@@ -48,9 +47,61 @@ std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& bytes,
         }
     }
 
+}
+
+std::vector<uint8_t> wavmCodegen(std::vector<uint8_t>& bytes,
+                                 const std::string& fileName,
+                                 bool meter)
+{
+    IR::Module moduleIR;
+    parseModule(bytes, fileName, moduleIR);
+
+    // Metered modules count the instructions each call executes
+    PgoPlan plan;
+    plan.metered = meter;
+    applyPgoPlan(moduleIR, plan);
+
     // Compile the module to object code
     Runtime::ModuleRef module = Runtime::compileModule(moduleIR);
     std::vector<uint8_t> objBytes = Runtime::getObjectCode(module);
+    appendPgoPlan(objBytes, plan);
+
+    return objBytes;
+}
+
+/**
+ * Generates either an instrumented object which counts function entries and
+ * calls, or one optimised using counts collected by an instrumented build.
+ * The plan used is appended to the object, and returned for reporting.
+ */
+std::vector<uint8_t> wavmPgoCodegen(std::vector<uint8_t>& bytes,
+                                    const std::string& fileName,
+                                    const PgoProfile* profile,
+                                    PgoPlan& plan,
+                                    bool meter)
+{
+    auto logger = faabric::util::getLogger();
+
+    IR::Module moduleIR;
+    parseModule(bytes, fileName, moduleIR);
+
+    if (profile == nullptr) {
+        plan = PgoPlan();
+        plan.mode = PgoMode::instrument;
+    } else {
+        plan = planInlining(moduleIR, *profile);
+        logger->info("Inlining {} call sites in {}",
+                     plan.inlinedSites.size(),
+                     fileName);
+    }
+
+    plan.metered = meter;
+    applyPgoPlan(moduleIR, plan);
+
+    Runtime::ModuleRef module = Runtime::compileModule(moduleIR);
+    std::vector<uint8_t> objBytes = Runtime::getObjectCode(module);
+    appendPgoPlan(objBytes, plan);
+
     return objBytes;
 }
 }
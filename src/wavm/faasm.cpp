@@ -8,6 +8,9 @@
 #include <faabric/util/bytes.h>
 #include <faabric/util/files.h>
 #include <faabric/util/state.h>
+#include <system/CallTrace.h>
+#include <wasm/LocalCallBuffers.h>
+#include <wasm/OutputStreams.h>
 
 using namespace WAVM;
 
@@ -21,6 +24,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                __faasm_push_state,
                                I32 keyPtr)
 {
+    TRACE_SPAN("state", "__faasm_push_state")
+
     auto kv = getStateKV(keyPtr, 0);
     faabric::util::getLogger()->debug("S - push_state - {}", kv->key);
     kv->pushFull();
@@ -32,6 +37,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                __faasm_push_state_partial,
                                I32 keyPtr)
 {
+    TRACE_SPAN("state", "__faasm_push_state_partial")
+
     auto kv = getStateKV(keyPtr, 0);
     faabric::util::getLogger()->debug("S - push_state_partial - {}", kv->key);
     kv->pushPartial();
@@ -59,6 +66,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 keyPtr,
                                I32 stateLen)
 {
+    TRACE_SPAN("state", "__faasm_pull_state")
+
     auto kv = getStateKV(keyPtr, stateLen);
     faabric::util::getLogger()->debug(
       "S - pull_state - {} {}", kv->key, stateLen);
@@ -72,6 +81,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                __faasm_lock_state_global,
                                I32 keyPtr)
 {
+    TRACE_SPAN("state", "__faasm_lock_state_global")
+
     auto kv = getStateKV(keyPtr, 0);
     faabric::util::getLogger()->debug("S - lock_state_global - {}", kv->key);
 
@@ -96,6 +107,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                __faasm_lock_state_read,
                                I32 keyPtr)
 {
+    TRACE_SPAN("state", "__faasm_lock_state_read")
+
     auto kv = getStateKV(keyPtr, 0);
     faabric::util::getLogger()->debug("S - lock_state_read - {}", kv->key);
 
@@ -120,6 +133,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                __faasm_lock_state_write,
                                I32 keyPtr)
 {
+    TRACE_SPAN("state", "__faasm_lock_state_write")
+
     auto kv = getStateKV(keyPtr, 0);
     faabric::util::getLogger()->debug("S - lock_state_write - {}", kv->key);
 
@@ -415,22 +430,19 @@ I32 _readInputImpl(I32 bufferPtr, I32 bufferLen)
 {
     // Get the input
     faabric::Message* call = getExecutingCall();
-    std::vector<uint8_t> inputBytes =
-      faabric::util::stringToBytes(call->inputdata());
 
-    // If nothing, return nothing
-    if (inputBytes.empty()) {
-        return 0;
+    // Zero-length buffer means the caller just wants the input size
+    if (bufferLen <= 0) {
+        return (I32)getCallInputSize(*call);
     }
 
-    // Write to the wasm buffer
+    // Write straight into the wasm buffer
     Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
     U8* buffer =
       Runtime::memoryArrayPtr<U8>(memoryPtr, (Uptr)bufferPtr, (Uptr)bufferLen);
 
-    int inputSize =
-      faabric::util::safeCopyToBuffer(inputBytes, buffer, bufferLen);
-    return inputSize;
+    size_t inputSize = readCallInput(*call, buffer, bufferLen);
+    return (I32)inputSize;
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
@@ -448,9 +460,12 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
 
 void _writeOutputImpl(I32 outputPtr, I32 outputLen)
 {
-    std::vector<uint8_t> outputData = getBytesFromWasm(outputPtr, outputLen);
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    U8* outputData =
+      Runtime::memoryArrayPtr<U8>(memoryPtr, (Uptr)outputPtr, (Uptr)outputLen);
+
     faabric::Message* call = getExecutingCall();
-    call->set_outputdata(outputData.data(), outputData.size());
+    writeCallOutput(*call, outputData, outputLen);
 }
 
 WAVM_DEFINE_INTRINSIC_FUNCTION(env,
@@ -465,6 +480,24 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
     _writeOutputImpl(outputPtr, outputLen);
 }
 
+WAVM_DEFINE_INTRINSIC_FUNCTION(env,
+                               "__faasm_write_output_chunk",
+                               void,
+                               __faasm_write_output_chunk,
+                               I32 chunkPtr,
+                               I32 chunkLen)
+{
+    faabric::util::getLogger()->debug(
+      "S - write_output_chunk - {} {}", chunkPtr, chunkLen);
+
+    Runtime::Memory* memoryPtr = getExecutingWAVMModule()->defaultMemory;
+    U8* chunkData =
+      Runtime::memoryArrayPtr<U8>(memoryPtr, (Uptr)chunkPtr, (Uptr)chunkLen);
+
+    faabric::Message* call = getExecutingCall();
+    writeCallOutputChunk(*call, chunkData, chunkLen);
+}
+
 void _readPythonInput(I32 buffPtr, I32 buffLen, const std::string& value)
 {
     // Get wasm buffer
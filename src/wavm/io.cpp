@@ -4,7 +4,9 @@
 #include <faabric/util/bytes.h>
 #include <faabric/util/config.h>
 
+#include <conf/FaasmConfig.h>
 #include <storage/FileDescriptor.h>
+#include <system/CallTrace.h>
 
 #include <cstring>
 #include <dirent.h>
@@ -51,8 +53,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
         return __WASI_EBADF;
     }
 
-    storage::FileDescriptor& fileDesc =
-      module->getFileSystem().getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      module->getFileSystem().lookupFileDescriptor(fd);
 
     auto wasiPrestat =
       &Runtime::memoryRef<__wasi_prestat_t>(module->defaultMemory, prestatPtr);
@@ -78,8 +80,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
         return __WASI_EBADF;
     }
 
-    storage::FileDescriptor& fileDesc =
-      module->getFileSystem().getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      module->getFileSystem().lookupFileDescriptor(fd);
 
     // Copy the path into the wasm buffer
     char* buffer = Runtime::memoryArrayPtr<char>(
@@ -104,6 +106,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                I32 fdFlags,
                                I32 resFdPtr)
 {
+    TRACE_SPAN("io", "path_open")
+
 
     const std::string pathStr = getStringFromWasm(path);
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
@@ -324,6 +328,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                I32 iovecCount,
                                I32 resBytesWrittenPtr)
 {
+    TRACE_SPAN("io", "fd_write")
+
     auto logger = faabric::util::getLogger();
 
     storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
@@ -336,7 +342,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                   resBytesWrittenPtr,
                   path);
 
-    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      fileSystem.lookupFileDescriptor(fd);
 
     iovec* nativeIovecs = wasiIovecsToNativeIovecs(iovecsPtr, iovecCount);
 
@@ -348,9 +355,13 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
           "writev failed on fd {}: {}", fileDesc.getLinuxFd(), strerror(errno));
     }
 
-    // Catpure stdout if necessary, otherwise write as normal
+    // Capture stdout (and optionally stderr) if necessary, otherwise write
+    // as normal
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
-    if (fd == STDOUT_FILENO && conf.captureStdout == "on") {
+    bool isCaptured =
+      fd == STDOUT_FILENO ||
+      (fd == STDERR_FILENO && conf::getFaasmConfig().captureStderr == "on");
+    if (isCaptured && conf.captureStdout == "on") {
         getExecutingWAVMModule()->captureStdout(nativeIovecs, iovecCount);
     }
 
@@ -375,13 +386,16 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                I32 iovecCount,
                                I32 resBytesRead)
 {
+    TRACE_SPAN("io", "fd_read")
+
     storage::FileSystem& fileSystem = getExecutingWAVMModule()->getFileSystem();
     std::string path = fileSystem.getPathForFd(fd);
 
     faabric::util::getLogger()->debug(
       "S - fd_read - {} {} {} ({})", fd, iovecsPtr, iovecCount, path);
 
-    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      fileSystem.lookupFileDescriptor(fd);
     iovec* nativeIovecs = wasiIovecsToNativeIovecs(iovecsPtr, iovecCount);
 
     int bytesRead = readv(fileDesc.getLinuxFd(), nativeIovecs, iovecCount);
@@ -473,8 +487,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
     WAVMWasmModule* module = getExecutingWAVMModule();
     storage::FileDescriptor& oldFileDesc =
       module->getFileSystem().getFileDescriptor(fd);
-    storage::FileDescriptor& newFileDesc =
-      module->getFileSystem().getFileDescriptor(newFd);
+    const storage::FileDescriptor& newFileDesc =
+      module->getFileSystem().lookupFileDescriptor(newFd);
 
     const std::string& fullNewPath = newFileDesc.absPath(newPathStr);
     bool success = oldFileDesc.rename(fullNewPath, oldPathStr);
@@ -577,7 +591,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
     std::string path = fileSystem.getPathForFd(fd);
     logger->debug("S - fd_fdstat_get - {} {} ({})", fd, statPtr, path);
 
-    storage::FileDescriptor& fileDesc = fileSystem.getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      fileSystem.lookupFileDescriptor(fd);
     storage::Stat statResult = fileDesc.stat();
 
     if (statResult.failed) {
@@ -600,8 +615,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
 I32 doFileStat(int fd, const std::string& relativePath, I32 statPtr)
 {
     WAVMWasmModule* module = getExecutingWAVMModule();
-    storage::FileDescriptor& fileDesc =
-      module->getFileSystem().getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      module->getFileSystem().lookupFileDescriptor(fd);
     auto wasiFileStat =
       &Runtime::memoryRef<__wasi_filestat_t>(module->defaultMemory, statPtr);
 
@@ -663,8 +678,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
 
     WAVMWasmModule* module = getExecutingWAVMModule();
 
-    storage::FileDescriptor& fileDesc =
-      module->getFileSystem().getFileDescriptor(fd);
+    const storage::FileDescriptor& fileDesc =
+      module->getFileSystem().lookupFileDescriptor(fd);
     uint64_t offset = fileDesc.tell();
     Runtime::memoryRef<U64>(module->defaultMemory, resOffsetPtr) = offset;
     return 0;
@@ -958,6 +973,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(wasi,
                                I64 d,
                                I32 e)
 {
+    TRACE_SPAN("io", "fd_pread")
+
     throwException(Runtime::ExceptionTypes::calledUnimplementedIntrinsic);
 }
 
@@ -112,8 +112,8 @@ I32 doMmap(I32 addr, I32 length, I32 prot, I32 flags, I32 fd, I32 offset)
 
     if (fd != -1) {
         // If fd is provided, we're mapping a file into memory
-        storage::FileDescriptor& fileDesc =
-          module->getFileSystem().getFileDescriptor(fd);
+        const storage::FileDescriptor& fileDesc =
+          module->getFileSystem().lookupFileDescriptor(fd);
         return module->mmapFile(fileDesc.getLinuxFd(), length);
     } else {
         // Map memory
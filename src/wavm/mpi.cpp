@@ -9,6 +9,8 @@
 #include <faabric/scheduler/MpiContext.h>
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/util/gids.h>
+#include <system/CallTrace.h>
+#include <wasm/CallTracer.h>
 
 using namespace WAVM;
 
@@ -154,6 +156,9 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env, "MPI_Init", I32, MPI_Init, I32 a, I32 b)
 
         // Initialise the world
         executingContext.createWorld(*call);
+
+        // Other ranks join this call's trace, if it's traced
+        getCallTracer().propagateToMpiWorld(executingContext.getWorldId());
     } else {
         logger->debug("S - MPI_Init (join) {} {}", a, b);
 
@@ -166,6 +171,11 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env, "MPI_Init", I32, MPI_Init, I32 a, I32 b)
     faabric::scheduler::MpiWorld& world = getExecutingWorld();
     world.barrier(thisRank);
 
+    // The world's creator has marked it as traced by now, if it is
+    if (thisRank > 0) {
+        getCallTracer().joinMpiWorld(*call, executingContext.getWorldId());
+    }
+
     return 0;
 }
 
@@ -333,6 +343,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 tag,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Send")
+
     const std::shared_ptr<spdlog::logger>& logger = faabric::util::getLogger();
     logger->debug("S - MPI_Send {} {} {} {} {} {}",
                   buffer,
@@ -470,6 +482,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 comm,
                                I32 statusPtr)
 {
+    TRACE_SPAN("mpi", "MPI_Recv")
+
     faabric::util::getLogger()->debug("S - MPI_Recv {} {} {} {} {} {} {}",
                                       buffer,
                                       count,
@@ -510,6 +524,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 comm,
                                I32 statusPtr)
 {
+    TRACE_SPAN("mpi", "MPI_Sendrecv")
+
     faabric::util::getLogger()->debug(
       "S - MPI_Sendrecv {} {} {} {} {} {} {} {} {} {} {} {}",
       sendBuf,
@@ -594,6 +610,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 requestPtrPtr,
                                I32 status)
 {
+    TRACE_SPAN("mpi", "MPI_Wait")
+
     faabric::util::getLogger()->debug(
       "S - MPI_Wait {} {}", requestPtrPtr, status);
 
@@ -616,6 +634,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 requestArray,
                                I32 statusArray)
 {
+    TRACE_SPAN("mpi", "MPI_Waitall")
+
     faabric::util::getLogger()->debug(
       "S - MPI_Waitany {} {} {}", count, requestArray, statusArray);
 
@@ -694,6 +714,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 root,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Bcast")
+
     faabric::util::getLogger()->debug(
       "S - MPI_Bcast {} {} {} {} {}", buffer, count, datatype, root, comm);
     ContextWrapper ctx(comm);
@@ -718,6 +740,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
  */
 WAVM_DEFINE_INTRINSIC_FUNCTION(env, "MPI_Barrier", I32, MPI_Barrier, I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Barrier")
+
     faabric::util::getLogger()->debug("S - MPI_Barrier {}", comm);
     ContextWrapper ctx(comm);
 
@@ -742,6 +766,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 root,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Scatter")
+
 
     faabric::util::getLogger()->debug("S - MPI_Scatter {} {} {} {} {} {} {} {}",
                                       sendBuf,
@@ -790,6 +816,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 root,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Gather")
+
     faabric::util::getLogger()->debug("S - MPI_Gather {} {} {} {} {} {} {} {}",
                                       sendBuf,
                                       sendCount,
@@ -842,6 +870,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 recvType,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Allgather")
+
     faabric::util::getLogger()->debug("S - MPI_Allgather {} {} {} {} {} {} {}",
                                       sendBuf,
                                       sendCount,
@@ -929,6 +959,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 root,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Reduce")
+
     faabric::util::getLogger()->debug("S - MPI_Reduce {} {} {} {} {} {} {}",
                                       sendBuf,
                                       recvBuf,
@@ -1004,6 +1036,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 op,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Allreduce")
+
     faabric::util::getLogger()->debug("S - MPI_Allreduce {} {} {} {} {} {}",
                                       sendBuf,
                                       recvBuf,
@@ -1099,6 +1133,8 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
                                I32 recvType,
                                I32 comm)
 {
+    TRACE_SPAN("mpi", "MPI_Alltoall")
+
     faabric::util::getLogger()->debug("S - MPI_Alltoall {} {} {} {} {} {} {}",
                                       sendBuf,
                                       sendCount,
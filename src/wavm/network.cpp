@@ -2,6 +2,7 @@
 #include "syscalls.h"
 
 #include <faabric/util/bytes.h>
+#include <system/IsolationManager.h>
 
 #include <netdb.h>
 
@@ -111,6 +112,10 @@ I32 s__socketcall(I32 call, I32 argsPtr)
 
             faabric::util::getLogger()->debug(
               "S - socket - {} {} {}", domain, type, protocol);
+
+            // Functions only join their network namespace when they need it
+            isolation::attachThreadNetwork();
+
             I32 sock = (int)syscall(SYS_socket, domain, type, protocol);
 
             if (sock < 0) {
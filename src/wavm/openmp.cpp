@@ -8,6 +8,7 @@
 #include <faabric/scheduler/Scheduler.h>
 #include <faabric/state/StateKeyValue.h>
 #include <faabric/util/timing.h>
+#include <wasm/chaining.h>
 #include <wavm/OMPThreadPool.h>
 #include <wavm/WAVMWasmModule.h>
 #include <wavm/openmp/Level.h>
@@ -436,6 +437,9 @@ WAVM_DEFINE_INTRINSIC_FUNCTION(env,
             chainedThreads[threadNum] = call.id();
         }
 
+        // Give up anything held for this call while waiting on its threads
+        wasm::AwaitScope awaitScope;
+
         I64 numErrors = 0;
 
         for (int threadNum = 0; threadNum < nextNumThreads; threadNum++) {
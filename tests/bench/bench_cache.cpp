@@ -0,0 +1,49 @@
+#include "bench_utils.h"
+
+#include <ir_cache/IRModuleCache.h>
+#include <module_cache/WasmModuleCache.h>
+
+#include <benchmark/benchmark.h>
+
+/**
+ * Gets the zygote from the cache, as a Faaslet does when binding.
+ */
+static void BM_WasmModuleCacheLookup(benchmark::State& state)
+{
+    faabric::Message msg = bench::benchMessage();
+    module_cache::WasmModuleCache& cache = module_cache::getWasmModuleCache();
+    cache.getCachedModule(msg);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.getCachedModule(msg));
+    }
+}
+BENCHMARK(BM_WasmModuleCacheLookup)
+  ->ThreadRange(1, BENCH_MAX_THREADS)
+  ->UseRealTime();
+
+static void BM_IRModuleLookup(benchmark::State& state)
+{
+    wasm::IRModuleCache& cache = wasm::getIRModuleCache();
+    bench::getZygote();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          &cache.getModule(BENCH_USER, BENCH_FUNCTION, ""));
+    }
+}
+BENCHMARK(BM_IRModuleLookup)->ThreadRange(1, BENCH_MAX_THREADS)->UseRealTime();
+
+static void BM_IRCompiledModuleLookup(benchmark::State& state)
+{
+    wasm::IRModuleCache& cache = wasm::getIRModuleCache();
+    bench::getZygote();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          cache.getCompiledModule(BENCH_USER, BENCH_FUNCTION, ""));
+    }
+}
+BENCHMARK(BM_IRCompiledModuleLookup)
+  ->ThreadRange(1, BENCH_MAX_THREADS)
+  ->UseRealTime();
@@ -0,0 +1,125 @@
+#include "bench_utils.h"
+
+#include <ir_cache/IRModuleCache.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <benchmark/benchmark.h>
+#include <syscalls.h>
+#include <unistd.h>
+
+// Modules are replaced once they've grown by this much
+#define GROW_LIMIT_PAGES ONE_GB_PAGES
+
+#define IOVEC_BUFFER_SIZE 64
+
+/**
+ * Copies the zygote as a Faaslet does for each call. Includes tearing the
+ * copy down again.
+ */
+static void BM_ModuleCopy(benchmark::State& state)
+{
+    std::shared_ptr<wasm::WAVMWasmModule> zygote = bench::getZygote();
+
+    for (auto _ : state) {
+        wasm::WAVMWasmModule module(*zygote);
+        benchmark::DoNotOptimize(module.executionContext);
+    }
+}
+BENCHMARK(BM_ModuleCopy)->ThreadRange(1, BENCH_MAX_THREADS)->UseRealTime();
+
+/**
+ * Maps the zygote's memory into a copy, as when copying. With a non-zero
+ * argument also writes to every page, i.e. measures the copy-on-write faults
+ * a call pays for when it first touches memory.
+ */
+static void BM_MapMemoryFromFd(benchmark::State& state)
+{
+    wasm::WAVMWasmModule module(*bench::getZygote());
+    bool touchPages = state.range(0) > 0;
+    size_t nBytes = module.getMemorySizeBytes();
+    long pageSize = sysconf(_SC_PAGESIZE);
+    uint8_t* base = WAVM::Runtime::getMemoryBaseAddress(module.defaultMemory);
+
+    for (auto _ : state) {
+        module.mapMemoryFromFd();
+
+        if (touchPages) {
+            for (size_t b = 0; b < nBytes; b += pageSize) {
+                base[b] = 1;
+            }
+            benchmark::ClobberMemory();
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * nBytes);
+}
+BENCHMARK(BM_MapMemoryFromFd)
+  ->Arg(0)
+  ->Arg(1)
+  ->ThreadRange(1, BENCH_MAX_THREADS)
+  ->UseRealTime();
+
+/**
+ * Grows memory by the given number of pages, as when the guest calls mmap or
+ * brk.
+ */
+static void BM_GrowMemory(benchmark::State& state)
+{
+    std::shared_ptr<wasm::WAVMWasmModule> zygote = bench::getZygote();
+    wasm::WAVMWasmModule module(*zygote);
+    uint32_t pagesPerGrow = state.range(0);
+    uint32_t pagesGrown = 0;
+
+    for (auto _ : state) {
+        if (pagesGrown + pagesPerGrow > GROW_LIMIT_PAGES) {
+            state.PauseTiming();
+            module = *zygote;
+            pagesGrown = 0;
+            state.ResumeTiming();
+        }
+
+        benchmark::DoNotOptimize(module.mmapPages(pagesPerGrow));
+        pagesGrown += pagesPerGrow;
+    }
+
+    state.SetBytesProcessed(state.iterations() * pagesPerGrow *
+                            WASM_BYTES_PER_PAGE);
+}
+BENCHMARK(BM_GrowMemory)
+  ->Arg(1)
+  ->Arg(ONE_MB_PAGES)
+  ->Arg(16 * ONE_MB_PAGES)
+  ->ThreadRange(1, BENCH_MAX_THREADS)
+  ->UseRealTime();
+
+/**
+ * Converts the given number of WASI iovecs to native ones, as done on every
+ * read and write.
+ */
+static void BM_WasiIovecsToNative(benchmark::State& state)
+{
+    wasm::WAVMWasmModule module(*bench::getZygote());
+    wasm::setExecutingModule(&module);
+
+    // Lay out the iovecs followed by the buffers they point to
+    int nIovecs = state.range(0);
+    uint32_t iovecsPtr = module.mmapMemory(
+      nIovecs * (sizeof(__wasi_ciovec_t) + IOVEC_BUFFER_SIZE));
+    uint32_t buffersPtr = iovecsPtr + nIovecs * sizeof(__wasi_ciovec_t);
+
+    auto iovecs = (__wasi_ciovec_t*)module.wasmPointerToNative(iovecsPtr);
+    for (int i = 0; i < nIovecs; i++) {
+        iovecs[i].buf = buffersPtr + i * IOVEC_BUFFER_SIZE;
+        iovecs[i].buf_len = IOVEC_BUFFER_SIZE;
+    }
+
+    for (auto _ : state) {
+        iovec* native = wasm::wasiIovecsToNativeIovecs(iovecsPtr, nIovecs);
+        benchmark::DoNotOptimize(native);
+        delete[] native;
+    }
+
+    state.SetItemsProcessed(state.iterations() * nIovecs);
+    wasm::setExecutingModule(nullptr);
+}
+BENCHMARK(BM_WasiIovecsToNative)->Arg(1)->Arg(16)->Arg(256);
@@ -0,0 +1,44 @@
+#include "bench_utils.h"
+
+#include <wasm/WasmModule.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <syscalls.h>
+
+#define STATE_VALUE_SIZE 1024
+
+/**
+ * Looks up a state key from a key string in wasm memory, as done by every
+ * state host function. With a zero argument all threads share one key,
+ * otherwise each has its own.
+ */
+static void BM_GetStateKV(benchmark::State& state)
+{
+    faabric::Message msg = bench::benchMessage();
+    wasm::WAVMWasmModule module(*bench::getZygote());
+    wasm::setExecutingModule(&module);
+    wasm::setExecutingCall(&msg);
+
+    std::string key = "bench_state";
+    if (state.range(0) > 0) {
+        key += "_" + std::to_string(state.thread_index);
+    }
+
+    uint32_t keyPtr = module.mmapMemory(key.size() + 1);
+    std::memcpy(
+      module.wasmPointerToNative(keyPtr), key.c_str(), key.size() + 1);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(wasm::getStateKV(keyPtr, STATE_VALUE_SIZE));
+    }
+
+    wasm::setExecutingCall(nullptr);
+    wasm::setExecutingModule(nullptr);
+}
+BENCHMARK(BM_GetStateKV)
+  ->Arg(0)
+  ->Arg(1)
+  ->ThreadRange(1, BENCH_MAX_THREADS)
+  ->UseRealTime();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <module_cache/WasmModuleCache.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/func.h>
+
+// Function whose modules are benchmarked, which must have been uploaded and
+// codegenned as for the tests
+#define BENCH_USER "demo"
+#define BENCH_FUNCTION "echo"
+
+// Most threads used by the multi-threaded variants
+#define BENCH_MAX_THREADS 16
+
+namespace bench {
+inline faabric::Message benchMessage()
+{
+    return faabric::util::messageFactory(BENCH_USER, BENCH_FUNCTION);
+}
+
+/**
+ * Gets the cached zygote, creating it on first use, along with the IR and
+ * compiled modules it's built from.
+ */
+inline std::shared_ptr<wasm::WAVMWasmModule> getZygote()
+{
+    return module_cache::getWasmModuleCache().getCachedModule(benchMessage());
+}
+}
@@ -0,0 +1,24 @@
+#include <module_cache/WasmModuleCache.h>
+
+#include <benchmark/benchmark.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+
+/**
+ * Runs the microbenchmarks, taking the usual Google Benchmark flags, e.g.
+ * --benchmark_filter and --benchmark_out.
+ */
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    // Keep state in memory so that its benchmarks don't measure Redis
+    faabric::util::getSystemConfig().stateMode = "inmemory";
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+
+    module_cache::getWasmModuleCache().clear();
+
+    return 0;
+}
@@ -0,0 +1,457 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faaslet/AdmissionController.h>
+#include <faaslet/Faaslet.h>
+#include <faaslet/FaasletPool.h>
+#include <wasm/chaining.h>
+#include <wasm/FunctionCosts.h>
+
+#include <faabric/util/func.h>
+
+#include <thread>
+
+using namespace faaslet;
+
+namespace tests {
+static void waitForWaiting(AdmissionController& controller, int expected)
+{
+    for (int i = 0; i < 500; i++) {
+        if (controller.getWaitingCount() == expected) {
+            return;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    FAIL("Timed out waiting for queued calls");
+}
+
+/**
+ * Queues each of the given calls in turn, then frees the held slot and
+ * returns the order in which the calls were admitted.
+ */
+static std::vector<std::string> getAdmissionOrder(
+  AdmissionController& controller,
+  const faabric::Message& held,
+  const std::vector<faabric::Message>& msgs)
+{
+    std::mutex orderMx;
+    std::vector<std::string> order;
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < msgs.size(); i++) {
+        threads.emplace_back([&controller, &orderMx, &order, &msgs, i] {
+            const faabric::Message& msg = msgs.at(i);
+            REQUIRE(controller.admit(msg));
+
+            {
+                std::scoped_lock<std::mutex> guard(orderMx);
+                order.emplace_back(msg.inputdata());
+            }
+
+            controller.release(msg);
+        });
+
+        waitForWaiting(controller, i + 1);
+    }
+
+    controller.release(held);
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    return order;
+}
+
+static faabric::Message labelledMessage(const std::string& user,
+                                        const std::string& func,
+                                        const std::string& label)
+{
+    faabric::Message msg = faabric::util::messageFactory(user, func);
+    msg.set_inputdata(label);
+    return msg;
+}
+
+TEST_CASE("Test admission concurrency limits", "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    AdmissionController controller;
+
+    faabric::Message msgA = faabric::util::messageFactory("demo", "echo");
+    faabric::Message msgB = faabric::util::messageFactory("demo", "hello");
+    faabric::Message msgC = faabric::util::messageFactory("demo", "echo");
+    faabric::Message other = faabric::util::messageFactory("foo", "bar");
+
+    SECTION("Function limit")
+    {
+        faasmConf.admissionFunctionLimits = "demo/echo=1";
+
+        // Another function for the same user isn't affected
+        REQUIRE(controller.admit(msgA));
+        REQUIRE(controller.admit(msgB));
+        REQUIRE(controller.getRunningCount("demo/echo") == 1);
+    }
+
+    SECTION("User limit")
+    {
+        faasmConf.admissionUserLimits = "demo=2";
+
+        REQUIRE(controller.admit(msgA));
+        REQUIRE(controller.admit(msgB));
+    }
+
+    // Other users can run regardless
+    REQUIRE(controller.admit(other));
+    REQUIRE(controller.getRunningCount() == 3);
+
+    // The third call waits until a slot for the function frees up
+    std::thread t([&controller, &msgC] {
+        REQUIRE(controller.admit(msgC));
+        controller.release(msgC);
+    });
+
+    waitForWaiting(controller, 1);
+    REQUIRE(controller.getQueuedCount() == 1);
+
+    controller.release(msgA);
+    t.join();
+
+    REQUIRE(controller.getWaitingCount() == 0);
+    REQUIRE(controller.getAdmittedCount() == 4);
+    REQUIRE(controller.getRejectedCount() == 0);
+
+    controller.release(msgB);
+    controller.release(other);
+    REQUIRE(controller.getRunningCount() == 0);
+}
+
+TEST_CASE("Test admission priority and fair queueing", "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    faasmConf.admissionMaxConcurrency = 1;
+
+    AdmissionController controller;
+    faabric::Message held = faabric::util::messageFactory("demo", "held");
+    REQUIRE(controller.admit(held));
+
+    std::vector<faabric::Message> msgs;
+    std::vector<std::string> expected;
+
+    SECTION("Fair between functions")
+    {
+        msgs = { labelledMessage("demo", "heavy", "h1"),
+                 labelledMessage("demo", "heavy", "h2"),
+                 labelledMessage("demo", "heavy", "h3"),
+                 labelledMessage("demo", "light", "l1") };
+        expected = { "h1", "l1", "h2", "h3" };
+    }
+
+    SECTION("Weighted")
+    {
+        faasmConf.admissionWeights = "demo/light=2";
+
+        msgs = { labelledMessage("demo", "heavy", "h1"),
+                 labelledMessage("demo", "heavy", "h2"),
+                 labelledMessage("demo", "light", "l1"),
+                 labelledMessage("demo", "light", "l2"),
+                 labelledMessage("demo", "light", "l3") };
+        expected = { "l1", "h1", "l2", "l3", "h2" };
+    }
+
+    SECTION("Priority")
+    {
+        faasmConf.admissionPriorities = "demo/urgent=10";
+
+        msgs = { labelledMessage("demo", "heavy", "h1"),
+                 labelledMessage("demo", "heavy", "h2"),
+                 labelledMessage("demo", "urgent", "u1") };
+        expected = { "u1", "h1", "h2" };
+    }
+
+    std::vector<std::string> actual =
+      getAdmissionOrder(controller, held, msgs);
+    REQUIRE(actual == expected);
+}
+
+TEST_CASE("Test admission rejection", "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    faasmConf.admissionMaxConcurrency = 1;
+
+    AdmissionController controller;
+    faabric::Message held = faabric::util::messageFactory("demo", "echo");
+    REQUIRE(controller.admit(held));
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+
+    SECTION("Queue full")
+    {
+        faasmConf.admissionMaxQueued = 1;
+
+        std::thread t([&controller, &msg] {
+            REQUIRE(controller.admit(msg));
+            controller.release(msg);
+        });
+        waitForWaiting(controller, 1);
+
+        // No room in the queue for another
+        REQUIRE(!controller.admit(msg));
+
+        controller.release(held);
+        t.join();
+    }
+
+    SECTION("Queue timeout")
+    {
+        faasmConf.admissionQueueTimeoutMs = 50;
+
+        REQUIRE(!controller.admit(msg));
+        controller.release(held);
+    }
+
+    REQUIRE(controller.getRejectedCount() == 1);
+    REQUIRE(controller.getWaitingCount() == 0);
+    REQUIRE(controller.getRunningCount() == 0);
+}
+
+TEST_CASE("Test admission limits heavy calls", "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    faasmConf.admissionMaxHeavy = 1;
+    faasmConf.admissionHeavyCost = 1000;
+
+    faabric::Message heavyA = faabric::util::messageFactory("demo", "heavy");
+    faabric::Message heavyB = faabric::util::messageFactory("demo", "heavy");
+    faabric::Message light = faabric::util::messageFactory("demo", "light");
+
+    // Costs are a moving average, so one cheap call doesn't change much
+    wasm::FunctionCosts& costs = wasm::getFunctionCosts();
+    costs.record(heavyA, 5000);
+    costs.record(heavyA, 100);
+    costs.record(light, 100);
+    REQUIRE(costs.getAverage("demo/heavy") == Approx(4020));
+    REQUIRE(costs.getAverage("demo/light") == Approx(100));
+    REQUIRE(costs.getCallCount("demo/heavy") == 2);
+
+    AdmissionController controller;
+    REQUIRE(controller.admit(heavyA));
+    REQUIRE(controller.getRunningHeavyCount() == 1);
+
+    // Light calls can still run alongside the heavy one
+    REQUIRE(controller.admit(light));
+
+    std::thread t([&controller, &heavyB] {
+        REQUIRE(controller.admit(heavyB));
+        controller.release(heavyB);
+    });
+
+    waitForWaiting(controller, 1);
+    controller.release(heavyA);
+    t.join();
+
+    controller.release(light);
+    REQUIRE(controller.getRunningHeavyCount() == 0);
+    REQUIRE(controller.getRunningCount() == 0);
+    REQUIRE(controller.getQueuedCount() == 1);
+}
+
+TEST_CASE("Test admission slot given up while awaiting", "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.admissionMaxConcurrency = 1;
+
+    AdmissionController& controller = getAdmissionController();
+    faabric::Message parent = faabric::util::messageFactory("demo", "chain");
+    faabric::Message child = faabric::util::messageFactory("demo", "echo");
+
+    // Threads of a call don't take a slot
+    faabric::Message thread = faabric::util::messageFactory("demo", "chain");
+    thread.set_snapshotkey("foobar");
+
+    {
+        AdmissionTicket parentTicket(parent);
+        REQUIRE(controller.getRunningCount() == 1);
+
+        {
+            AdmissionTicket threadTicket(thread);
+            REQUIRE(controller.getRunningCount() == 1);
+        }
+        REQUIRE(controller.getRunningCount() == 1);
+
+        // Child can only run while the parent awaits it
+        std::thread t([&controller, &child] {
+            REQUIRE(controller.admit(child));
+            controller.release(child);
+        });
+        waitForWaiting(controller, 1);
+
+        {
+            wasm::AwaitScope awaitScope;
+            t.join();
+
+            // Nested awaits don't release again
+            wasm::AwaitScope nestedScope;
+            REQUIRE(controller.getRunningCount() == 0);
+        }
+
+        REQUIRE(controller.getRunningCount() == 1);
+    }
+
+    REQUIRE(controller.getRunningCount() == 0);
+    REQUIRE(controller.getAdmittedCount() == 2);
+    REQUIRE(controller.getRejectedCount() == 0);
+
+    cleanSystem();
+}
+
+TEST_CASE("Test Faaslets only bind to functions below their limit",
+          "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    AdmissionController controller;
+
+    faabric::Message msgA = faabric::util::messageFactory("demo", "echo");
+    faabric::Message msgB = faabric::util::messageFactory("demo", "hello");
+    faabric::Message other = faabric::util::messageFactory("foo", "bar");
+
+    SECTION("Function limit")
+    {
+        faasmConf.admissionFunctionLimits = "demo/echo=1";
+
+        REQUIRE(controller.bind(msgA));
+        REQUIRE(!controller.bind(msgA));
+
+        // Another function for the same user isn't affected
+        REQUIRE(controller.bind(msgB));
+    }
+
+    SECTION("User limit")
+    {
+        faasmConf.admissionUserLimits = "demo=1";
+
+        REQUIRE(controller.bind(msgA));
+        REQUIRE(!controller.bind(msgA));
+
+        // A function with no Faaslets can still get one
+        REQUIRE(controller.bind(msgB));
+    }
+
+    SECTION("Spare Faaslets")
+    {
+        faasmConf.admissionFunctionLimits = "demo/echo=1";
+        faasmConf.admissionMaxBlocked = 1;
+
+        REQUIRE(controller.bind(msgA));
+        REQUIRE(controller.bind(msgA));
+        REQUIRE(!controller.bind(msgA));
+
+        // Unbinding makes room again
+        controller.unbind(msgA);
+        REQUIRE(controller.bind(msgA));
+    }
+
+    // Other users can bind regardless
+    REQUIRE(controller.bind(other));
+
+    // A Faaslet awaiting another call leaves room for one more
+    REQUIRE(controller.admit(msgA));
+    controller.suspend(msgA);
+    REQUIRE(controller.getRunningCount("demo/echo") == 0);
+    REQUIRE(controller.bind(msgA));
+    REQUIRE(!controller.bind(msgA));
+
+    controller.resume(msgA);
+    REQUIRE(controller.getRunningCount("demo/echo") == 1);
+    controller.release(msgA);
+
+    REQUIRE(controller.getDeclinedBindCount() == 2);
+}
+
+TEST_CASE("Test saturated function doesn't take every Faaslet", "[faaslet]")
+{
+    cleanSystem();
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.admissionFunctionLimits = "demo/echo=1";
+
+    AdmissionController& controller = getAdmissionController();
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    // A burst of the limited function, followed by a call to another
+    int nHeavy = 3;
+    std::vector<faabric::Message> heavyCalls;
+    for (int i = 0; i < nHeavy; i++) {
+        faabric::Message call = labelledMessage("demo", "echo", "heavy");
+        sch.callFunction(call);
+        heavyCalls.emplace_back(call);
+    }
+
+    faabric::Message light = faabric::util::messageFactory("demo", "hello");
+    sch.callFunction(light);
+
+    // Pool at its minimum size
+    FaasletPool pool(2);
+    Faaslet heavyFaaslet(1);
+    heavyFaaslet.bindToFunction(heavyCalls.at(0));
+
+    // The second Faaslet won't bind to the limited function, as it would only
+    // sit blocked waiting for admission
+    {
+        Faaslet spare(2);
+        REQUIRE_THROWS_AS(spare.bindToFunction(heavyCalls.at(1)),
+                          faabric::util::ExecutorFinishedException);
+    }
+    REQUIRE(controller.getDeclinedBindCount() == 1);
+
+    // So it's free to run the other function
+    Faaslet lightFaaslet(2);
+    lightFaaslet.bindToFunction(light);
+    lightFaaslet.processNextMessage();
+
+    faabric::Message lightResult = sch.getFunctionResult(light.id(), 1);
+    REQUIRE(lightResult.returnvalue() == 0);
+
+    // The limited function's calls all run on its own Faaslet
+    for (auto& call : heavyCalls) {
+        heavyFaaslet.processNextMessage();
+
+        faabric::Message result = sch.getFunctionResult(call.id(), 1);
+        REQUIRE(result.returnvalue() == 0);
+        REQUIRE(result.outputdata() == "heavy");
+    }
+
+    REQUIRE(controller.getAdmittedCount() == nHeavy + 1);
+    REQUIRE(controller.getQueuedCount() == 0);
+
+    heavyFaaslet.finish();
+    lightFaaslet.finish();
+
+    cleanSystem();
+}
+
+TEST_CASE("Test parsing key value lists", "[conf]")
+{
+    std::unordered_map<std::string, int> actual =
+      conf::parseIntMap("demo/echo=2, demo/hello = 5,bad,foo=-1");
+
+    std::unordered_map<std::string, int> expected = {
+        { "demo/echo", 2 }, { "demo/hello", 5 }, { "foo", -1 }
+    };
+    REQUIRE(actual == expected);
+    REQUIRE(conf::parseIntMap("").empty());
+}
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <faaslet/BoundModuleCache.h>
+#include <faaslet/Faaslet.h>
+#include <wavm/WAVMWasmModule.h>
+
+using namespace faaslet;
+
+namespace tests {
+static std::unique_ptr<wasm::WasmModule> bindModule(const std::string& func)
+{
+    faabric::Message msg = faabric::util::messageFactory("demo", func);
+    auto module = std::make_unique<wasm::WAVMWasmModule>();
+    module->bindToFunction(msg);
+    return module;
+}
+
+TEST_CASE("Test bound module cache LRU", "[faaslet]")
+{
+    cleanSystem();
+
+    size_t moduleBytes = bindModule("echo")->getMemorySizeBytes();
+    REQUIRE(moduleBytes > 0);
+
+    int maxModules;
+    size_t maxBytes;
+    SECTION("Limited by count")
+    {
+        maxModules = 2;
+        maxBytes = 100 * moduleBytes;
+    }
+
+    SECTION("Limited by memory")
+    {
+        maxModules = 10;
+        maxBytes = 2 * moduleBytes + 1;
+    }
+
+    BoundModuleCache cache(maxModules, maxBytes);
+    cache.put("echo", bindModule("echo"));
+    cache.put("hello", bindModule("hello"));
+    REQUIRE(cache.getModuleCount() == 2);
+
+    // Take and put back, so echo is most recently used
+    std::unique_ptr<wasm::WasmModule> echo = cache.take("echo");
+    REQUIRE(echo != nullptr);
+    REQUIRE(echo->getBoundFunction() == "echo");
+    REQUIRE(cache.getModuleCount() == 1);
+    cache.put("echo", std::move(echo));
+
+    // Adding another evicts the least recently used
+    cache.put("dummy", bindModule("dummy"));
+    REQUIRE(cache.getModuleCount() == 2);
+    REQUIRE(cache.getEvictionCount() == 1);
+    REQUIRE(cache.take("hello") == nullptr);
+    REQUIRE(cache.take("echo") != nullptr);
+
+    REQUIRE(cache.getHitCount() == 2);
+    REQUIRE(cache.getMissCount() == 1);
+
+    cache.clear();
+    REQUIRE(cache.getModuleCount() == 0);
+    REQUIRE(cache.getMemoryBytes() == 0);
+}
+
+TEST_CASE("Test Faaslet reuses module left in its slot", "[faaslet]")
+{
+    cleanSystem();
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalPreload = conf.pythonPreload;
+    conf.pythonPreload = "off";
+
+    BoundModuleCache cache(4, 1024L * 1024L * 1024L);
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    for (int i = 0; i < 2; i++) {
+        Faaslet w(0, nullptr, &cache);
+
+        faabric::Message call = faabric::util::messageFactory("demo", "echo");
+        call.set_inputdata("reuse " + std::to_string(i));
+        sch.callFunction(call);
+
+        // Bind and execute
+        w.processNextMessage();
+        w.processNextMessage();
+
+        faabric::Message result = sch.getFunctionResult(call.id(), 1);
+        REQUIRE(result.returnvalue() == 0);
+        REQUIRE(result.outputdata() == "reuse " + std::to_string(i));
+
+        // Module is handed back to the cache
+        w.finish();
+        REQUIRE(cache.getModuleCount() == 1);
+    }
+
+    // The second Faaslet didn't need to create a module
+    REQUIRE(cache.getMissCount() == 1);
+    REQUIRE(cache.getHitCount() == 1);
+
+    conf.pythonPreload = originalPreload;
+}
+
+TEST_CASE("Test module not kept in slot after flush", "[faaslet]")
+{
+    cleanSystem();
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalPreload = conf.pythonPreload;
+    conf.pythonPreload = "off";
+
+    BoundModuleCache cache(4, 1024L * 1024L * 1024L);
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    std::string keyBefore = getBoundModuleKey(call, 0);
+
+    Faaslet w(0, nullptr, &cache);
+    sch.callFunction(call);
+    w.processNextMessage();
+    w.processNextMessage();
+
+    REQUIRE_THROWS_AS(w.flush(), faabric::util::ExecutorFinishedException);
+    w.finish();
+
+    // Nothing is kept, and keys from before the flush don't match any more
+    REQUIRE(cache.getModuleCount() == 0);
+    REQUIRE(getBoundModuleKey(call, 0) != keyBefore);
+
+    conf.pythonPreload = originalPreload;
+}
+}
@@ -2,7 +2,9 @@
 
 #include "utils.h"
 
+#include <conf/FaasmConfig.h>
 #include <faabric/util/environment.h>
+#include <wasm/LocalCallBuffers.h>
 
 using namespace faaslet;
 
@@ -26,4 +28,49 @@ TEST_CASE("Test appended state", "[faaslet]")
       faabric::util::messageFactory("demo", "state_append");
     execFuncWithPool(call, false, 1);
 }
+
+TEST_CASE("Test chaining with and without local fast path", "[faaslet]")
+{
+    // Clean first, as this resets the config
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    SECTION("Fast path on") { faasmConf.chainedCallFastPath = "on"; }
+
+    SECTION("Fast path off") { faasmConf.chainedCallFastPath = "off"; }
+
+    std::string funcName;
+    SECTION("Chained output") { funcName = "chain_output"; }
+
+    SECTION("Chained payload") { funcName = "chain_payload"; }
+
+    faabric::Message call = faabric::util::messageFactory("demo", funcName);
+    execFuncWithPool(call, false, 1, false, 4, false);
+
+    // Check all local buffers have been tidied up
+    REQUIRE(wasm::getLocalCallBuffers().getCallCount() == 0);
+}
+
+TEST_CASE("Test streaming output from chained calls", "[faaslet]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    SECTION("Local stream") { faasmConf.chainedCallFastPath = "on"; }
+
+    SECTION("Remote stream") { faasmConf.chainedCallFastPath = "off"; }
+
+    // Make the stream smaller than the producer's output so that the producer
+    // is held back by the consumer
+    faasmConf.outputStreamBufferKb = 8;
+    faasmConf.outputStreamChunkKb = 1;
+    faasmConf.outputStreamFunctions = "demo/chain_stream";
+
+    // Function checks time to first byte itself
+    faabric::Message call =
+      faabric::util::messageFactory("demo", "chain_stream");
+    execFuncWithPool(call, false, 1, false, 4, false);
+}
 }
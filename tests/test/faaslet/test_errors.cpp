@@ -2,8 +2,10 @@
 
 #include "utils.h"
 
+#include <conf/FaasmConfig.h>
 #include <faabric/scheduler/InMemoryMessageQueue.h>
 #include <faaslet/FaasletPool.h>
+#include <wasm/ExecutionWatchdog.h>
 
 using namespace faaslet;
 
@@ -25,8 +27,6 @@ void execErrorFunction(faabric::Message& call)
 
 void checkError(const std::string& funcName, const std::string& expectedMsg)
 {
-    cleanSystem();
-
     faabric::Message call = faabric::util::messageFactory("errors", funcName);
 
     execErrorFunction(call);
@@ -56,9 +56,81 @@ void checkError(const std::string& funcName, const std::string& expectedMsg)
 
 TEST_CASE("Test non-zero return code is error", "[wasm]")
 {
+    cleanSystem();
     checkError("ret_one", "Call failed (return value=1)");
 }
 
+TEST_CASE("Test runaway call is interrupted", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    std::string expectedMsg;
+    SECTION("Wall-clock limit")
+    {
+        faasmConf.callTimeLimits = "errors/infinite_loop=200";
+        expectedMsg = "wall-clock time limit exceeded";
+    }
+
+    SECTION("CPU limit")
+    {
+        faasmConf.callCpuLimits = "errors/infinite_loop=200";
+        expectedMsg = "CPU time limit exceeded";
+    }
+
+    long interruptsBefore = wasm::getExecutionWatchdog().getInterruptCount();
+
+    checkError("infinite_loop", expectedMsg);
+
+    REQUIRE(wasm::getExecutionWatchdog().getInterruptCount() ==
+            interruptsBefore + 1);
+    REQUIRE(wasm::getExecutionWatchdog().getWatchCount() == 0);
+}
+
+TEST_CASE("Test call in host code is interrupted back in guest code", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    // Most signals land in the host call, which must be left to return
+    faasmConf.callTimeLimits = "errors/host_call_loop=200";
+
+    long interruptsBefore = wasm::getExecutionWatchdog().getInterruptCount();
+
+    checkError("host_call_loop", "wall-clock time limit exceeded");
+
+    REQUIRE(wasm::getExecutionWatchdog().getInterruptCount() ==
+            interruptsBefore + 1);
+    REQUIRE(wasm::getExecutionWatchdog().getWatchCount() == 0);
+}
+
+TEST_CASE("Test call returning before it's unwound isn't interrupted",
+          "[wasm]")
+{
+    cleanSystem();
+
+    // The watchdog fires while the call sleeps in a host call, then the call
+    // returns before a signal lands in its guest code
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.callTimeLimits = "errors/host_sleep=100";
+
+    long interruptsBefore = wasm::getExecutionWatchdog().getInterruptCount();
+
+    faabric::Message call =
+      faabric::util::messageFactory("errors", "host_sleep");
+    execErrorFunction(call);
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    faabric::Message result = sch.getFunctionResult(call.id(), 1);
+    REQUIRE(result.returnvalue() == 0);
+
+    REQUIRE(wasm::getExecutionWatchdog().getInterruptCount() ==
+            interruptsBefore + 1);
+    REQUIRE(wasm::getExecutionWatchdog().getWatchCount() == 0);
+}
+
 //    TEST_CASE("Test munmapped memory not usable", "[wasm]") {
 //        checkError("munmap", "");
 //    }
@@ -5,13 +5,16 @@
 #include "utils.h"
 
 #include <boost/filesystem.hpp>
+#include <conf/FaasmConfig.h>
 #include <faabric/executor/FaabricMain.h>
 #include <faabric/util/config.h>
 #include <faabric/util/files.h>
 #include <faabric/util/func.h>
 #include <faaslet/FaasletPool.h>
+#include <module_cache/ArtefactVersions.h>
 #include <module_cache/WasmModuleCache.h>
 #include <storage/FileLoader.h>
+#include <storage/FunctionVersions.h>
 
 namespace tests {
 TEST_CASE("Test flushing empty faaslet does not break", "[faaslet]")
@@ -156,4 +159,80 @@ TEST_CASE("Test flushing faaslet picks up new version of function")
     conf.functionDir = origFunctionDir;
     conf.objectFileDir = origObjDir;
 }
+
+TEST_CASE("Test new version of function evicts only that function")
+{
+    cleanSystem();
+
+    // Check for a new version on every call
+    conf::getFaasmConfig().functionVersionCheckMs = 0;
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    int origBoundTimeout = conf.boundTimeout;
+    int origUnboundTimeout = conf.unboundTimeout;
+    conf.boundTimeout = 1000;
+    conf.unboundTimeout = 1000;
+
+    // Prepare two versions of a dummy function with different wasm
+    faabric::Message origMsgA = faabric::util::messageFactory("demo", "hello");
+    faabric::Message origMsgB = faabric::util::messageFactory("demo", "echo");
+
+    storage::FileLoader& fileLoader = storage::getFileLoader();
+    std::vector<uint8_t> wasmA = fileLoader.loadFunctionWasm(origMsgA);
+    std::vector<uint8_t> wasmB = fileLoader.loadFunctionWasm(origMsgB);
+
+    faabric::Message uploadMsgA = faabric::util::messageFactory("demo", "foo");
+    uploadMsgA.set_inputdata(wasmA.data(), wasmA.size());
+    faabric::Message uploadMsgB = faabric::util::messageFactory("demo", "foo");
+    uploadMsgB.set_inputdata(wasmB.data(), wasmB.size());
+
+    std::string origFunctionDir = conf.functionDir;
+    std::string origObjDir = conf.objectFileDir;
+    conf.functionDir = "/tmp/faasm/funcs";
+    conf.objectFileDir = "/tmp/faasm/objs";
+
+    fileLoader.uploadFunction(uploadMsgA);
+
+    // Cache another function, which should survive the new version
+    module_cache::WasmModuleCache& reg = module_cache::getWasmModuleCache();
+    faabric::Message otherMsg = faabric::util::messageFactory("demo", "dummy");
+    reg.getCachedModule(otherMsg);
+
+    faaslet::FaasletPool pool(1);
+    pool.startThreadPool();
+
+    faabric::Message invokeMsgA = faabric::util::messageFactory("demo", "foo");
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    sch.callFunction(invokeMsgA);
+
+    faabric::Message resultA = sch.getFunctionResult(invokeMsgA.id(), 1000);
+    REQUIRE(resultA.returnvalue() == 0);
+    REQUIRE(resultA.outputdata() == "Hello Faasm!");
+
+    // Upload the second version and bump its version, without flushing
+    fileLoader.uploadFunction(uploadMsgB);
+    storage::getFunctionVersions().bumpVersion(uploadMsgB);
+
+    // The same Faaslet should rebind and run the new version
+    std::string inputB = "This should be echoed";
+    faabric::Message invokeMsgB = faabric::util::messageFactory("demo", "foo");
+    invokeMsgB.set_inputdata(inputB);
+    sch.callFunction(invokeMsgB);
+
+    faabric::Message resultB = sch.getFunctionResult(invokeMsgB.id(), 1000);
+    REQUIRE(resultB.returnvalue() == 0);
+    REQUIRE(resultB.outputdata() == inputB);
+
+    // Other function's zygote is still cached
+    REQUIRE(reg.isModuleCached(otherMsg));
+    REQUIRE(module_cache::getArtefactVersions().getCachedVersion(
+              invokeMsgB) == 1);
+
+    pool.shutdown();
+
+    conf.boundTimeout = origBoundTimeout;
+    conf.unboundTimeout = origUnboundTimeout;
+    conf.functionDir = origFunctionDir;
+    conf.objectFileDir = origObjDir;
+}
 }
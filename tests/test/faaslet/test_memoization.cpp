@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faaslet/Faaslet.h>
+#include <faaslet/FaasletPool.h>
+#include <wasm/ResultCache.h>
+
+using namespace faaslet;
+
+namespace tests {
+TEST_CASE("Test memoizing repeat invocations", "[faaslet]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.memoizeDir = "";
+
+    // Deliberately memoize a function that isn't pure, so we can tell when
+    // the result has come from the cache
+    std::string expectedSecond;
+    long expectedHits;
+    SECTION("Memoization off")
+    {
+        faasmConf.memoizeFunctions = "";
+        expectedSecond = "Counter: 002";
+        expectedHits = 0;
+    }
+
+    SECTION("Memoization on")
+    {
+        faasmConf.memoizeFunctions = "demo/increment";
+        expectedSecond = "Counter: 001";
+        expectedHits = 1;
+    }
+
+    faabric::Message call = faabric::util::messageFactory("demo", "increment");
+
+    FaasletPool pool(1);
+    Faaslet w(1);
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    sch.callFunction(call);
+
+    // Bind and exec
+    w.processNextMessage();
+    w.processNextMessage();
+
+    faabric::Message resultA = sch.getFunctionResult(call.id(), 1);
+    REQUIRE(resultA.returnvalue() == 0);
+    REQUIRE(resultA.outputdata() == "Counter: 001");
+
+    // Call again with the same input
+    call.set_id(0);
+    faabric::util::setMessageId(call);
+
+    sch.callFunction(call);
+    w.processNextMessage();
+
+    faabric::Message resultB = sch.getFunctionResult(call.id(), 1);
+    REQUIRE(resultB.returnvalue() == 0);
+    REQUIRE(resultB.outputdata() == expectedSecond);
+
+    wasm::ResultCache& cache = wasm::getResultCache();
+    REQUIRE(cache.getHitCount() == expectedHits);
+
+    cleanSystem();
+}
+}
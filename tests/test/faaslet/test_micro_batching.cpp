@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faaslet/Faaslet.h>
+#include <faaslet/FaasletPool.h>
+#include <system/LatencyMetrics.h>
+
+using namespace faaslet;
+
+namespace tests {
+TEST_CASE("Test micro-batching queued calls", "[faaslet]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.microBatchSize = 4;
+
+    // Stateful calls are reset before every call after the first in a batch,
+    // as well as at the end of each batch
+    long expectedResets;
+    SECTION("Stateful")
+    {
+        faasmConf.statelessFunctions = "";
+        expectedResets = 6;
+    }
+
+    SECTION("Stateless")
+    {
+        faasmConf.statelessFunctions = "demo/echo";
+        expectedResets = 2;
+    }
+
+    FaasletPool pool(1);
+    Faaslet w(1);
+
+    // Queue up more calls than fit in one batch
+    int nCalls = 6;
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    std::vector<faabric::Message> calls;
+    for (int i = 0; i < nCalls; i++) {
+        faabric::Message call = faabric::util::messageFactory("demo", "echo");
+        call.set_inputdata("batch input " + std::to_string(i));
+        sch.callFunction(call);
+        calls.emplace_back(call);
+    }
+
+    // Bind
+    w.processNextMessage();
+
+    // First batch takes the first four calls, leaving two queued
+    w.processNextMessage();
+    REQUIRE(sch.getFunctionQueue(calls.at(0))->size() == 2);
+
+    for (int i = 0; i < 4; i++) {
+        faabric::Message result = sch.getFunctionResult(calls.at(i).id(), 1);
+        REQUIRE(result.returnvalue() == 0);
+        REQUIRE(result.outputdata() == calls.at(i).inputdata());
+    }
+
+    // Second batch takes the rest
+    w.processNextMessage();
+    REQUIRE(sch.getFunctionQueue(calls.at(0))->size() == 0);
+
+    for (int i = 4; i < nCalls; i++) {
+        faabric::Message result = sch.getFunctionResult(calls.at(i).id(), 1);
+        REQUIRE(result.returnvalue() == 0);
+        REQUIRE(result.outputdata() == calls.at(i).inputdata());
+    }
+
+    isolation::LatencyRegistry& registry = isolation::getLatencyRegistry();
+    REQUIRE(registry.getSnapshot("callExecute").count == nCalls);
+    REQUIRE(registry.getSnapshot("preFinishCall").count == 2);
+    REQUIRE(registry.getSnapshot("moduleReset").count == expectedResets);
+
+    cleanSystem();
+}
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faaslet/Faaslet.h>
+#include <faaslet/PoolController.h>
+
+#include <thread>
+
+using namespace faaslet;
+
+namespace tests {
+TEST_CASE("Test pool controller grows with pending binds", "[faaslet]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.poolMinFreeMemoryMb = 0;
+
+    PoolController controller(1, 2);
+    auto notShutdown = [] { return false; };
+
+    // Always admits up to the minimum
+    REQUIRE(controller.shouldGrow());
+    controller.admit(notShutdown);
+    REQUIRE(controller.getActiveCount() == 1);
+
+    // No demand, so shouldn't grow
+    REQUIRE(!controller.shouldGrow());
+
+    // Pending bind can be taken by the unbound Faaslet
+    faabric::Message call = faabric::util::messageFactory("demo", "noop");
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    sch.callFunction(call);
+    REQUIRE(sch.getBindQueue()->size() == 1);
+    REQUIRE(!controller.shouldGrow());
+
+    // Once the Faaslet is bound, the pending bind needs a new one
+    controller.notifyBound();
+    REQUIRE(controller.getBoundCount() == 1);
+    REQUIRE(controller.shouldGrow());
+
+    // Shouldn't grow under memory pressure
+    faasmConf.poolMinFreeMemoryMb = 1024 * 1024 * 1024;
+    REQUIRE(!controller.shouldGrow());
+    faasmConf.poolMinFreeMemoryMb = 0;
+
+    // Grow to the maximum, then stop
+    controller.admit(notShutdown);
+    REQUIRE(controller.getActiveCount() == 2);
+    REQUIRE(controller.getPeakCount() == 2);
+    REQUIRE(!controller.shouldGrow());
+
+    // Shrink again
+    controller.release(true);
+    controller.release(false);
+    REQUIRE(controller.getActiveCount() == 0);
+    REQUIRE(controller.getBoundCount() == 0);
+    REQUIRE(controller.getPeakCount() == 2);
+
+    cleanSystem();
+}
+
+TEST_CASE("Test pool controller blocks until demand", "[faaslet]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.poolMinFreeMemoryMb = 0;
+
+    PoolController controller(0, 1);
+    auto notShutdown = [] { return false; };
+
+    std::atomic<bool> admitted = false;
+    std::thread t([&controller, &admitted, &notShutdown] {
+        controller.admit(notShutdown);
+        admitted = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(!admitted);
+
+    // Make a call that needs a Faaslet
+    faabric::Message call = faabric::util::messageFactory("demo", "noop");
+    faabric::scheduler::getScheduler().callFunction(call);
+
+    t.join();
+    REQUIRE(admitted);
+    REQUIRE(controller.getActiveCount() == 1);
+
+    cleanSystem();
+}
+
+TEST_CASE("Test Faaslets report to pool controller", "[faaslet]")
+{
+    cleanSystem();
+
+    PoolController controller(1, 1);
+    controller.admit([] { return false; });
+
+    {
+        Faaslet w(1, &controller);
+        REQUIRE(controller.getBoundCount() == 0);
+
+        faabric::Message call = faabric::util::messageFactory("demo", "noop");
+        w.bindToFunction(call);
+        REQUIRE(controller.getBoundCount() == 1);
+
+        w.finish();
+        REQUIRE(!w.module);
+    }
+
+    REQUIRE(controller.getActiveCount() == 0);
+    REQUIRE(controller.getBoundCount() == 0);
+}
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/files.h>
+
+#include <boost/filesystem.hpp>
+
+namespace tests {
+static int countOccurrences(const std::string& str, const std::string& sub)
+{
+    int count = 0;
+    for (size_t pos = str.find(sub); pos != std::string::npos;
+         pos = str.find(sub, pos + sub.size())) {
+        count++;
+    }
+    return count;
+}
+
+TEST_CASE("Test chained calls share a trace", "[faaslet]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    std::string traceDir = "/tmp/faasm-test-traces";
+    boost::filesystem::remove_all(traceDir);
+    faasmConf.traceFunctions = "demo/chain";
+    faasmConf.traceDir = traceDir;
+
+    faabric::Message call = faabric::util::messageFactory("demo", "chain");
+    execFuncWithPool(call, false, 1, false, 4, false);
+
+    // Cleaning up after the call resets the config
+    std::string tracePath =
+      traceDir + "/trace-" + std::to_string(call.id()) + ".json";
+    REQUIRE(boost::filesystem::exists(tracePath));
+
+    std::string json = faabric::util::readFileToString(tracePath);
+
+    // The main call, its three chained calls and one nested chained call
+    REQUIRE(countOccurrences(json, "\"thread_name\"") == 5);
+    REQUIRE(countOccurrences(json, "\"callExecute\"") == 5);
+    REQUIRE(countOccurrences(json, "\"chainedCallAwait\"") >= 4);
+
+    // Every event is part of the main call's trace
+    std::string traceIdArg = "\"traceId\": " + std::to_string(call.id());
+    REQUIRE(countOccurrences(json, traceIdArg) ==
+            countOccurrences(json, "\"ph\": \"X\""));
+
+    boost::filesystem::remove_all(traceDir);
+}
+}
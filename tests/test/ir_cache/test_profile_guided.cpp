@@ -0,0 +1,248 @@
+#include <catch2/catch.hpp>
+
+#include <ir_cache/ProfileGuided.h>
+
+#include <WAVM/IR/Module.h>
+#include <WAVM/Runtime/Runtime.h>
+#include <WAVM/WASTParse/WASTParse.h>
+
+using namespace WAVM;
+
+namespace tests {
+// Sums 0 to n - 1 by calling a small function from a loop
+static const std::string sumWast = R"(
+(module
+  (func $add (param i32 i32) (result i32)
+    (local i32)
+    local.get 0
+    local.get 1
+    i32.add
+    local.set 2
+    local.get 2
+    return)
+  (func (export "run") (param i32) (result i32)
+    (local i32 i32)
+    block
+      loop
+        local.get 1
+        local.get 0
+        i32.ge_s
+        br_if 1
+        local.get 2
+        local.get 1
+        call $add
+        local.set 2
+        local.get 1
+        i32.const 1
+        i32.add
+        local.set 1
+        br 0
+      end
+    end
+    local.get 2))
+)";
+
+static void parseSumModule(IR::Module& module)
+{
+    std::vector<WAST::Error> parseErrors;
+    bool success = WAST::parseModule(
+      sumWast.c_str(), sumWast.size() + 1, module, parseErrors);
+    REQUIRE(success);
+}
+
+/**
+ * Compiles and instantiates the module, calls run(n), then optionally reads
+ * the module's counters before everything is torn down.
+ */
+static I32 runSumModule(IR::Module& module,
+                        I32 n,
+                        wasm::PgoProfile* counts,
+                        int64_t* instructions = nullptr)
+{
+    Runtime::GCPointer<Runtime::Compartment> compartment =
+      Runtime::createCompartment();
+
+    I32 result;
+    {
+        Runtime::ModuleRef compiled = Runtime::compileModule(module);
+        Runtime::Instance* instance =
+          Runtime::instantiateModule(compartment, compiled, {}, "sum");
+        Runtime::Context* context = Runtime::createContext(compartment);
+
+        Runtime::Function* func =
+          Runtime::asFunction(Runtime::getInstanceExport(instance, "run"));
+
+        IR::UntaggedValue args[1] = { n };
+        IR::UntaggedValue returnValue;
+        Runtime::invokeFunction(
+          context, func, Runtime::getFunctionType(func), args, &returnValue);
+        result = returnValue.i32;
+
+        if (counts != nullptr) {
+            *counts = wasm::readPgoCounters(instance, context, module);
+        }
+
+        if (instructions != nullptr) {
+            *instructions = wasm::readMeterCounter(instance, context);
+        }
+    }
+
+    REQUIRE(Runtime::tryCollectCompartment(std::move(compartment)));
+    return result;
+}
+
+TEST_CASE("Test instrumented module counts entries and calls", "[ir_cache]")
+{
+    IR::Module module;
+    parseSumModule(module);
+    REQUIRE(!wasm::isInstrumented(module));
+
+    wasm::instrumentModule(module);
+    REQUIRE(wasm::isInstrumented(module));
+
+    wasm::PgoProfile counts;
+    REQUIRE(runSumModule(module, 100, &counts) == 4950);
+
+    // Function 0 is the callee, called from the only call site in function 1
+    REQUIRE(counts.entryCounts[0] == 100);
+    REQUIRE(counts.entryCounts[1] == 1);
+    REQUIRE(counts.edgeCounts.size() == 1);
+
+    wasm::PgoEdge edge = counts.edgeCounts[{ 1, 0 }];
+    REQUIRE(edge.callee == 0);
+    REQUIRE(edge.count == 100);
+}
+
+TEST_CASE("Test inlining hot call sites", "[ir_cache]")
+{
+    IR::Module module;
+    parseSumModule(module);
+
+    wasm::PgoProfile profile;
+    profile.entryCounts[0] = PGO_INLINE_MIN_CALLS;
+    profile.entryCounts[1] = 1;
+
+    SECTION("Cold call site")
+    {
+        profile.edgeCounts[{ 1, 0 }] = { 0, PGO_INLINE_MIN_CALLS - 1 };
+
+        wasm::PgoPlan plan = wasm::planInlining(module, profile);
+        REQUIRE(plan.mode == wasm::PgoMode::optimise);
+        REQUIRE(plan.inlinedSites.empty());
+    }
+
+    SECTION("Stale call site")
+    {
+        profile.edgeCounts[{ 1, 0 }] = { 1, PGO_INLINE_MIN_CALLS };
+
+        wasm::PgoPlan plan = wasm::planInlining(module, profile);
+        REQUIRE(plan.inlinedSites.empty());
+    }
+
+    SECTION("Hot call site")
+    {
+        profile.edgeCounts[{ 1, 0 }] = { 0, PGO_INLINE_MIN_CALLS };
+
+        wasm::PgoPlan plan = wasm::planInlining(module, profile);
+        std::set<wasm::PgoCallSite> expected = { { 1, 0 } };
+        REQUIRE(plan.inlinedSites == expected);
+
+        size_t originalLocals =
+          module.functions.defs[1].nonParameterLocalTypes.size();
+        wasm::applyPgoPlan(module, plan);
+
+        // Callee's parameters and local are added to the caller
+        REQUIRE(module.functions.defs[1].nonParameterLocalTypes.size() ==
+                originalLocals + 3);
+
+        // Results must be unchanged
+        REQUIRE(runSumModule(module, 100, nullptr) == 4950);
+        REQUIRE(runSumModule(module, 0, nullptr) == 0);
+    }
+}
+
+TEST_CASE("Test metered module counts instructions", "[ir_cache]")
+{
+    IR::Module module;
+    parseSumModule(module);
+    REQUIRE(!wasm::isMetered(module));
+
+    int64_t instructions;
+    REQUIRE(runSumModule(module, 10, nullptr, &instructions) == 45);
+    REQUIRE(instructions == -1);
+
+    wasm::meterModule(module);
+    REQUIRE(wasm::isMetered(module));
+    REQUIRE(!wasm::isInstrumented(module));
+
+    // The loop runs 8 operators once, 13 per iteration and $add runs 6
+    REQUIRE(runSumModule(module, 0, nullptr, &instructions) == 0);
+    REQUIRE(instructions == 8);
+
+    REQUIRE(runSumModule(module, 100, nullptr, &instructions) == 4950);
+    REQUIRE(instructions == 8 + 100 * (13 + 6));
+}
+
+TEST_CASE("Test profile-guided plans in object files", "[ir_cache]")
+{
+    std::vector<uint8_t> original = { 0, 1, 2, 3, 4, 5 };
+    std::vector<uint8_t> objectBytes = original;
+
+    wasm::PgoPlan plan;
+
+    SECTION("No plan")
+    {
+        wasm::appendPgoPlan(objectBytes, plan);
+        REQUIRE(objectBytes == original);
+    }
+
+    SECTION("Instrument") { plan.mode = wasm::PgoMode::instrument; }
+
+    SECTION("Optimise")
+    {
+        plan.mode = wasm::PgoMode::optimise;
+        plan.inlinedSites = { { 1, 0 }, { 3, 2 } };
+    }
+
+    SECTION("Metered") { plan.metered = true; }
+
+    SECTION("Optimise and metered")
+    {
+        plan.mode = wasm::PgoMode::optimise;
+        plan.inlinedSites = { { 1, 0 } };
+        plan.metered = true;
+    }
+
+    wasm::appendPgoPlan(objectBytes, plan);
+
+    wasm::PgoPlan actual = wasm::extractPgoPlan(objectBytes);
+    REQUIRE(objectBytes == original);
+    REQUIRE(actual.mode == plan.mode);
+    REQUIRE(actual.inlinedSites == plan.inlinedSites);
+    REQUIRE(actual.metered == plan.metered);
+}
+
+TEST_CASE("Test profile serialisation", "[ir_cache]")
+{
+    wasm::PgoProfile profile;
+    profile.entryCounts[0] = 10;
+    profile.entryCounts[4] = 3;
+    profile.edgeCounts[{ 4, 1 }] = { 0, 7 };
+
+    wasm::PgoProfile actual = wasm::PgoProfile::fromString(profile.toString());
+    REQUIRE(actual.entryCounts == profile.entryCounts);
+    REQUIRE(actual.edgeCounts.size() == 1);
+    REQUIRE(actual.edgeCounts[{ 4, 1 }].callee == 0);
+    REQUIRE(actual.edgeCounts[{ 4, 1 }].count == 7);
+
+    // Subtracting a snapshot leaves only the later counts
+    wasm::PgoProfile later = actual;
+    later.entryCounts[0] += 5;
+    later.edgeCounts[{ 4, 1 }].count += 2;
+    later.subtract(actual);
+
+    REQUIRE(later.entryCounts[0] == 5);
+    REQUIRE(later.entryCounts[4] == 0);
+    REQUIRE(later.edgeCounts[{ 4, 1 }].count == 2);
+}
+}
@@ -0,0 +1,164 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/func.h>
+#include <module_cache/ChainPrewarmer.h>
+#include <module_cache/WasmModuleCache.h>
+#include <wasm/CallGraph.h>
+
+namespace tests {
+
+TEST_CASE("Test prewarming chained functions", "[zygote]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.chainPrewarm = "on";
+    faasmConf.chainPrewarmThreshold = 50;
+
+    module_cache::ChainPrewarmer& prewarmer =
+      module_cache::getChainPrewarmer();
+    prewarmer.clear();
+
+    module_cache::WasmModuleCache& cache = module_cache::getWasmModuleCache();
+    wasm::CallGraph& graph = wasm::getCallGraph();
+    graph.clear();
+
+    // Set up a two-stage pipeline
+    faabric::Message parent =
+      faabric::util::messageFactory("demo", "chain_named_a");
+    faabric::Message child =
+      faabric::util::messageFactory("demo", "chain_named_b");
+
+    // Nothing to prewarm before the graph knows about the pipeline
+    prewarmer.prewarmChildren(parent);
+    prewarmer.waitForPrewarms();
+    REQUIRE(prewarmer.getPrewarmCount() == 0);
+    REQUIRE(!cache.isModuleCached(child));
+
+    // A cold start of the second stage is a miss
+    prewarmer.recordBind(child);
+    REQUIRE(prewarmer.getMissCount() == 1);
+    cache.getCachedModule(child);
+    cache.clear();
+
+    // Record the chaining
+    graph.recordCall(parent);
+    graph.recordChainedCall(parent, child);
+
+    // Now calling the parent should prewarm the child
+    prewarmer.prewarmChildren(parent);
+    prewarmer.waitForPrewarms();
+    REQUIRE(prewarmer.getPrewarmCount() == 1);
+    REQUIRE(cache.isModuleCached(child));
+    REQUIRE(prewarmer.getPrewarmedBytes() > 0);
+
+    // Bind the second stage, should be a hit using the prewarmed zygote
+    prewarmer.recordBind(child);
+    REQUIRE(prewarmer.getHitCount() == 1);
+    REQUIRE(prewarmer.getMissCount() == 1);
+    REQUIRE(prewarmer.getPrewarmedBytes() == 0);
+    REQUIRE(cache.isModuleCached(child));
+
+    // Check prewarming again does nothing
+    prewarmer.prewarmChildren(parent);
+    prewarmer.waitForPrewarms();
+    REQUIRE(prewarmer.getPrewarmCount() == 1);
+
+    prewarmer.clear();
+    graph.clear();
+}
+
+TEST_CASE("Test prewarming respects memory budget", "[zygote]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.chainPrewarm = "on";
+    faasmConf.chainPrewarmMemoryMb = 0;
+
+    module_cache::ChainPrewarmer& prewarmer =
+      module_cache::getChainPrewarmer();
+    prewarmer.clear();
+
+    wasm::CallGraph& graph = wasm::getCallGraph();
+    graph.clear();
+
+    faabric::Message parent =
+      faabric::util::messageFactory("demo", "chain_named_a");
+    faabric::Message child =
+      faabric::util::messageFactory("demo", "chain_named_b");
+    graph.recordCall(parent);
+    graph.recordChainedCall(parent, child);
+
+    prewarmer.prewarmChildren(parent);
+    prewarmer.waitForPrewarms();
+
+    REQUIRE(prewarmer.getPrewarmCount() == 0);
+    REQUIRE(prewarmer.getSkippedCount() == 1);
+    REQUIRE(!module_cache::getWasmModuleCache().isModuleCached(child));
+
+    prewarmer.clear();
+    graph.clear();
+}
+
+TEST_CASE("Test prewarming reserves and evicts within budget", "[zygote]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.chainPrewarm = "on";
+    faasmConf.chainPrewarmMemoryMb = 1024;
+
+    module_cache::ChainPrewarmer& prewarmer =
+      module_cache::getChainPrewarmer();
+    module_cache::WasmModuleCache& cache = module_cache::getWasmModuleCache();
+    wasm::CallGraph& graph = wasm::getCallGraph();
+
+    faabric::Message parent =
+      faabric::util::messageFactory("demo", "chain_named_a");
+    faabric::Message childA =
+      faabric::util::messageFactory("demo", "chain_named_b");
+    faabric::Message childB =
+      faabric::util::messageFactory("demo", "chain_named_c");
+    graph.recordCall(parent);
+    graph.recordChainedCall(parent, childA);
+    graph.recordChainedCall(parent, childB);
+
+    // Nothing is known about either child, so the first to be queued
+    // reserves the whole budget and the second is skipped
+    prewarmer.prewarmChildren(parent);
+    prewarmer.waitForPrewarms();
+    REQUIRE(prewarmer.getPrewarmCount() == 1);
+    REQUIRE(prewarmer.getSkippedCount() == 1);
+    REQUIRE(cache.isModuleCached(childA) != cache.isModuleCached(childB));
+
+    faabric::Message prewarmed = cache.isModuleCached(childA) ? childA : childB;
+    faabric::Message skipped = cache.isModuleCached(childA) ? childB : childA;
+
+    // Shrink the budget so that only one zygote fits, then predict the
+    // skipped child from another parent
+    size_t prewarmedBytes = prewarmer.getPrewarmedBytes();
+    REQUIRE(prewarmedBytes > 0);
+    size_t oneMb = 1024 * 1024;
+    faasmConf.chainPrewarmMemoryMb = (prewarmedBytes + oneMb - 1) / oneMb;
+
+    faabric::Message otherParent =
+      faabric::util::messageFactory("demo", "chain_simple");
+    graph.recordCall(otherParent);
+    graph.recordChainedCall(otherParent, skipped);
+
+    // The unused zygote is evicted to make room
+    prewarmer.prewarmChildren(otherParent);
+    prewarmer.waitForPrewarms();
+    REQUIRE(prewarmer.getPrewarmCount() == 2);
+    REQUIRE(prewarmer.getEvictedCount() == 1);
+    REQUIRE(!cache.isModuleCached(prewarmed));
+    REQUIRE(cache.isModuleCached(skipped));
+
+    prewarmer.clear();
+    graph.clear();
+}
+}
@@ -6,6 +6,8 @@
 #include <faabric/util/macros.h>
 #include <module_cache/WasmModuleCache.h>
 
+#include <fcntl.h>
+
 namespace tests {
 TEST_CASE("Test creating zygotes", "[zygote]")
 {
@@ -26,12 +28,14 @@ TEST_CASE("Test creating zygotes", "[zygote]")
 
     module_cache::WasmModuleCache& registry =
       module_cache::getWasmModuleCache();
-    wasm::WasmModule& moduleA = registry.getCachedModule(msgA);
-    wasm::WasmModule& moduleB = registry.getCachedModule(msgB);
+    std::shared_ptr<wasm::WAVMWasmModule> moduleA =
+      registry.getCachedModule(msgA);
+    std::shared_ptr<wasm::WAVMWasmModule> moduleB =
+      registry.getCachedModule(msgB);
 
     // Check modules are the same
-    REQUIRE(std::addressof(moduleA) == std::addressof(moduleB));
-    REQUIRE(moduleA.isBound());
+    REQUIRE(moduleA == moduleB);
+    REQUIRE(moduleA->isBound());
 
     // Execute the function normally and make sure zygote is not used directly
     faaslet::Faaslet faaslet(0);
@@ -40,6 +44,61 @@ TEST_CASE("Test creating zygotes", "[zygote]")
     REQUIRE(errorMessage.empty());
     REQUIRE(msgA.returnvalue() == 0);
 
-    REQUIRE(std::addressof(moduleA) != std::addressof(*faaslet.module));
+    REQUIRE(moduleA.get() != faaslet.module.get());
+}
+
+TEST_CASE("Test evicted zygote still usable by holders", "[zygote]")
+{
+    cleanSystem();
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    msg.set_inputdata("evicted");
+
+    module_cache::WasmModuleCache& registry =
+      module_cache::getWasmModuleCache();
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      registry.getCachedModule(msg);
+
+    registry.evictFunction(msg);
+    REQUIRE(!registry.isModuleCached(msg));
+
+    // Copying from the evicted zygote still works
+    wasm::WAVMWasmModule module(*zygote);
+    REQUIRE(module.execute(msg));
+    REQUIRE(msg.outputdata() == "evicted");
+
+    // Next lookup creates a new zygote
+    std::shared_ptr<wasm::WAVMWasmModule> newZygote =
+      registry.getCachedModule(msg);
+    REQUIRE(newZygote != zygote);
+    REQUIRE(registry.isModuleCached(msg));
+}
+
+TEST_CASE("Test evicted zygote memory fd closed when unused", "[zygote]")
+{
+    cleanSystem();
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+
+    module_cache::WasmModuleCache& registry =
+      module_cache::getWasmModuleCache();
+    std::shared_ptr<wasm::WAVMWasmModule> zygote =
+      registry.getCachedModule(msg);
+
+    int fd = zygote->getMemoryFd();
+    REQUIRE(fd > 0);
+
+    auto module = std::make_unique<wasm::WAVMWasmModule>(*zygote);
+    REQUIRE(module->getMemoryFd() == fd);
+
+    // Clone still needs the fd once the zygote has gone
+    registry.evictFunction(msg);
+    zygote.reset();
+    REQUIRE(fcntl(fd, F_GETFD) != -1);
+
+    // Closed when the last module using it has gone
+    module.reset();
+    REQUIRE(fcntl(fd, F_GETFD) == -1);
+    REQUIRE(errno == EBADF);
 }
 }
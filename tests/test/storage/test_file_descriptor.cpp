@@ -410,4 +410,70 @@ TEST_CASE("Test readdir iterator and buffer", "[storage]")
         checkWasiDirentInBuffer(buffer2.data(), entC);
     }
 }
+
+TEST_CASE("Test copied filesystem shares fds copy-on-write", "[storage]")
+{
+    SharedFiles::clear();
+
+    FileSystem original;
+    original.prepareFilesystem();
+
+    std::string wasmPath = "lib/python3.8";
+    int dirFd = original.openFileDescriptor(
+      DEFAULT_ROOT_FD, wasmPath, 0, 0, 0, __WASI_O_DIRECTORY, 0);
+    REQUIRE(dirFd > 0);
+
+    // Read the first entry to load the listing before copying
+    storage::DirEnt firstEnt = original.getFileDescriptor(dirFd).iterNext();
+
+    size_t fdCount = original.getFileDescriptorCount();
+    REQUIRE(original.getOwnedFileDescriptorCount() == fdCount);
+
+    // Copy, check nothing is owned by either
+    FileSystem copy = original;
+    REQUIRE(copy.getFileDescriptorCount() == fdCount);
+    REQUIRE(copy.getOwnedFileDescriptorCount() == 0);
+    REQUIRE(original.getOwnedFileDescriptorCount() == 0);
+    REQUIRE(copy.getPathForFd(dirFd) == original.getPathForFd(dirFd));
+
+    // Read-only lookups, e.g. for fd_prestat_get and fd_fdstat_get, don't copy
+    // anything either
+    const storage::FileDescriptor& preopenDesc =
+      copy.lookupFileDescriptor(DEFAULT_ROOT_FD);
+    REQUIRE(preopenDesc.wasiPreopenType == __WASI_PREOPENTYPE_DIR);
+    REQUIRE(!copy.lookupFileDescriptor(dirFd).stat().failed);
+    REQUIRE(copy.getOwnedFileDescriptorCount() == 0);
+    REQUIRE(original.getOwnedFileDescriptorCount() == 0);
+
+    // Accessing a descriptor in the copy gives it its own copy of just that one
+    storage::FileDescriptor& copyDesc = copy.getFileDescriptor(dirFd);
+    REQUIRE(copy.getOwnedFileDescriptorCount() == 1);
+    REQUIRE(original.getOwnedFileDescriptorCount() == 1);
+
+    // Check the iterator state was copied, and moving it doesn't affect the
+    // original
+    REQUIRE(copyDesc.iterStarted());
+    copyDesc.iterReset();
+    REQUIRE(!copyDesc.iterStarted());
+    REQUIRE(copyDesc.iterNext().path == firstEnt.path);
+    copyDesc.iterNext();
+
+    storage::FileDescriptor& originalDesc = original.getFileDescriptor(dirFd);
+    REQUIRE(originalDesc.iterNext().path != firstEnt.path);
+    originalDesc.iterBack();
+    originalDesc.iterBack();
+    REQUIRE(originalDesc.iterNext().path == firstEnt.path);
+
+    // Opening a new fd in the copy isn't visible in the original
+    int newFd = copy.openFileDescriptor(
+      DEFAULT_ROOT_FD, wasmPath, 0, 0, 0, __WASI_O_DIRECTORY, 0);
+    REQUIRE(copy.fileDescriptorExists(newFd));
+    REQUIRE(!original.fileDescriptorExists(newFd));
+    REQUIRE(copy.getFileDescriptorCount() == fdCount + 1);
+    REQUIRE(original.getFileDescriptorCount() == fdCount);
+
+    // Only the new fd and the one changed above are owned by the copy, not
+    // the root the new one was opened from
+    REQUIRE(copy.getOwnedFileDescriptorCount() == 2);
+}
 }
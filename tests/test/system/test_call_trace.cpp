@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+
+#include <system/CallTrace.h>
+#include <system/LatencyMetrics.h>
+
+#include <thread>
+#include <unistd.h>
+
+using namespace isolation;
+
+namespace tests {
+static void tracedOperation()
+{
+    TRACE_SPAN("test", "tracedOperation")
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+TEST_CASE("Test spans only recorded for traced calls", "[system]")
+{
+    CallTrace trace;
+    trace.traceId = 123;
+    trace.messageId = 456;
+
+    // Nothing recorded when no call is being traced
+    setActiveCallTrace(nullptr);
+    tracedOperation();
+    REQUIRE(trace.events.empty());
+
+    setActiveCallTrace(&trace);
+    tracedOperation();
+    {
+        LATENCY_START(testTracedLatency)
+        tracedOperation();
+        LATENCY_END(testTracedLatency)
+    }
+    setActiveCallTrace(nullptr);
+
+    // Spans are recorded as they finish, so the inner one comes first
+    REQUIRE(trace.events.size() == 3);
+    REQUIRE(std::string(trace.events[0].name) == "tracedOperation");
+    REQUIRE(std::string(trace.events[1].name) == "tracedOperation");
+    REQUIRE(std::string(trace.events[2].category) == "lifecycle");
+    REQUIRE(std::string(trace.events[2].name) == "testTracedLatency");
+
+    REQUIRE(trace.events[0].durationUs >= 2000);
+    REQUIRE(trace.events[2].startUs <= trace.events[1].startUs);
+    REQUIRE(trace.events[2].durationUs >= trace.events[1].durationUs);
+}
+
+TEST_CASE("Test rendering traces as Chrome trace events", "[system]")
+{
+    auto trace = std::make_shared<CallTrace>();
+    trace->traceId = 123;
+    trace->messageId = 456;
+    trace->funcStr = "demo/echo";
+    trace->events.push_back({ "lifecycle", "callExecute", 1000, 50 });
+
+    std::string json = callTracesToChromeJson({ trace });
+    std::string pid = std::to_string(getpid());
+
+    std::string expectedName =
+      "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " + pid +
+      ", \"tid\": 456, \"args\": {\"name\": \"demo/echo (456)\"}}";
+    std::string expectedEvent =
+      "{\"name\": \"callExecute\", \"cat\": \"lifecycle\", \"ph\": \"X\", "
+      "\"ts\": 1000, \"dur\": 50, \"pid\": " +
+      pid + ", \"tid\": 456, \"args\": {\"traceId\": 123}}";
+
+    REQUIRE(json.rfind("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", 0) ==
+            0);
+    REQUIRE(json.find(expectedName) != std::string::npos);
+    REQUIRE(json.find(expectedEvent) != std::string::npos);
+
+    REQUIRE(callTracesToChromeJson({}) ==
+            "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n]}\n");
+}
+
+TEST_CASE("Test trace strings are escaped", "[system]")
+{
+    auto trace = std::make_shared<CallTrace>();
+    trace->traceId = 1;
+    trace->messageId = 2;
+    trace->funcStr = "demo/\"quoted\"\n";
+    trace->events.push_back({ "cat\\egory", "na\tme\x01", 0, 1 });
+
+    std::string json = callTracesToChromeJson({ trace });
+
+    REQUIRE(json.find("\"name\": \"demo/\\\"quoted\\\"\\n (2)\"") !=
+            std::string::npos);
+    REQUIRE(json.find("\"name\": \"na\\tme\\u0001\"") != std::string::npos);
+    REQUIRE(json.find("\"cat\": \"cat\\\\egory\"") != std::string::npos);
+
+    // No raw control characters other than the newlines between events
+    for (char c : json) {
+        REQUIRE(((unsigned char)c >= 0x20 || c == '\n'));
+    }
+}
+}
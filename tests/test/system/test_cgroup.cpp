@@ -1,5 +1,6 @@
 #include <catch2/catch.hpp>
 
+#include <faabric/util/bytes.h>
 #include <faabric/util/config.h>
 #include <faabric/util/environment.h>
 #include <faabric/util/files.h>
@@ -103,4 +104,89 @@ TEST_CASE("Test adding thread to cpu controller", "[faaslet]")
 
     REQUIRE(cgroupCheckSuccessful == 1);
 }
+
+void checkCgroupV2Addition(CGroup* cg, std::string* tid)
+{
+    cg->addCurrentThread();
+    *tid = std::to_string((pid_t)syscall(SYS_gettid));
+}
+
+TEST_CASE("Test cgroup v2 child groups", "[faaslet]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalMode = conf.cgroupMode;
+    std::string originalRoot = getCgroupRoot();
+
+    // Mimic a v2 hierarchy in a temporary directory, so this doesn't need
+    // to run privileged
+    boost::filesystem::path root("/tmp/faasm_cgroup_test");
+    boost::filesystem::remove_all(root);
+    boost::filesystem::create_directories(root / BASE_CGROUP_NAME);
+    faabric::util::writeBytesToFile((root / "cgroup.controllers").string(),
+                                    faabric::util::stringToBytes("cpu"));
+
+    setCgroupRoot(root.string());
+    conf.cgroupMode = "on";
+
+    CGroup cg(std::string(BASE_CGROUP_NAME) + "/faaslet_1");
+    REQUIRE(cg.getVersion() == CgroupVersion::cg_v2);
+
+    CGroupLimits limits;
+    limits.cpuWeight = 50;
+    limits.cpuMax = "50000 100000";
+    cg.create(limits);
+    REQUIRE(cg.getMode() == CgroupMode::cg_on);
+
+    boost::filesystem::path groupPath = root / BASE_CGROUP_NAME / "faaslet_1";
+    auto readGroupFile = [&groupPath](const std::string& fileName) {
+        std::string contents =
+          faabric::util::readFileToString((groupPath / fileName).string());
+        boost::trim(contents);
+        return contents;
+    };
+
+    REQUIRE(readGroupFile("cgroup.type") == "threaded");
+    REQUIRE(readGroupFile("cpu.weight") == "50");
+    REQUIRE(readGroupFile("cpu.max") == "50000 100000");
+
+    // Thread is migrated through cgroup.threads
+    std::string tid;
+    std::thread t(checkCgroupV2Addition, &cg, &tid);
+    t.join();
+    REQUIRE(readGroupFile("cgroup.threads") == tid);
+
+    boost::filesystem::remove_all(root);
+    setCgroupRoot(originalRoot);
+    conf.cgroupMode = originalMode;
+}
+
+TEST_CASE("Test falling back when cgroups unavailable", "[faaslet]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalMode = conf.cgroupMode;
+    std::string originalRoot = getCgroupRoot();
+
+    // A v2 root where the group can't be created
+    boost::filesystem::path root("/tmp/faasm_cgroup_test");
+    boost::filesystem::remove_all(root);
+    boost::filesystem::create_directories(root);
+    faabric::util::writeBytesToFile((root / "cgroup.controllers").string(),
+                                    faabric::util::stringToBytes("cpu"));
+    faabric::util::writeBytesToFile((root / BASE_CGROUP_NAME).string(),
+                                    faabric::util::stringToBytes("x"));
+
+    setCgroupRoot(root.string());
+    conf.cgroupMode = "on";
+
+    CGroup cg(std::string(BASE_CGROUP_NAME) + "/faaslet_1");
+    cg.create(CGroupLimits());
+    REQUIRE(cg.getMode() == CgroupMode::cg_off);
+
+    // Should now be a no-op
+    cg.addCurrentThread();
+
+    boost::filesystem::remove_all(root);
+    setCgroupRoot(originalRoot);
+    conf.cgroupMode = originalMode;
+}
 }
@@ -0,0 +1,132 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/util/config.h>
+
+#include <system/IsolationManager.h>
+
+#include <thread>
+
+using namespace isolation;
+
+namespace tests {
+TEST_CASE("Test isolation contexts are pooled", "[faaslet]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalNsMode = conf.netNsMode;
+    conf.netNsMode = "off";
+
+    IsolationManager manager;
+    manager.prewarm(2);
+    REQUIRE(manager.getCreatedCount() == 2);
+    REQUIRE(manager.getFreeCount() == 2);
+
+    // Takes the pre-created contexts first
+    std::unique_ptr<IsolationContext> ctxA = manager.acquire();
+    std::unique_ptr<IsolationContext> ctxB = manager.acquire();
+    REQUIRE(manager.getFreeCount() == 0);
+    REQUIRE(ctxA->getIdx() != ctxB->getIdx());
+    REQUIRE(ctxA->getNetworkNamespace().getName() ==
+            BASE_NETNS_NAME + std::to_string(ctxA->getIdx()));
+
+    // Then creates more on demand
+    std::unique_ptr<IsolationContext> ctxC = manager.acquire();
+    REQUIRE(ctxC->getIdx() == 3);
+    REQUIRE(manager.getCreatedCount() == 3);
+
+    // Released contexts are reused
+    manager.release(std::move(ctxC));
+    REQUIRE(manager.getFreeCount() == 1);
+    std::unique_ptr<IsolationContext> ctxD = manager.acquire();
+    REQUIRE(ctxD->getIdx() == 3);
+    REQUIRE(manager.getCreatedCount() == 3);
+
+    manager.release(std::move(ctxA));
+    manager.release(std::move(ctxB));
+    manager.release(std::move(ctxD));
+    REQUIRE(manager.getFreeCount() == 3);
+
+    conf.netNsMode = originalNsMode;
+}
+
+TEST_CASE("Test network is attached lazily", "[faaslet]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalNsMode = conf.netNsMode;
+    conf.netNsMode = "off";
+
+    IsolationManager manager;
+    std::unique_ptr<IsolationContext> ctx = manager.acquire();
+
+    // Nothing happens for threads without a context
+    REQUIRE(getThreadIsolationContext() == nullptr);
+    attachThreadNetwork();
+    REQUIRE(!ctx->isNetworkAttached());
+
+    setThreadIsolationContext(ctx.get());
+    REQUIRE(!ctx->isNetworkAttached());
+
+    attachThreadNetwork();
+    REQUIRE(ctx->isNetworkAttached());
+
+    // Released contexts are detached
+    setThreadIsolationContext(nullptr);
+    IsolationContext* ctxPtr = ctx.get();
+    manager.release(std::move(ctx));
+    REQUIRE(!ctxPtr->isNetworkAttached());
+
+    conf.netNsMode = originalNsMode;
+}
+
+TEST_CASE("Test guest threads share the network context", "[faaslet]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    std::string originalNsMode = conf.netNsMode;
+    conf.netNsMode = "off";
+
+    IsolationManager manager;
+    std::unique_ptr<IsolationContext> ctx = manager.acquire();
+    IsolationContext* ctxPtr = ctx.get();
+
+    // The spawning thread has already joined the namespace
+    setThreadIsolationContext(ctxPtr);
+    attachThreadNetwork();
+    REQUIRE(ctxPtr->isNetworkAttached());
+
+    bool contextSeen = false;
+    bool attachedAtStart = true;
+    bool attachedAfterSocket = false;
+    std::thread t([ctxPtr,
+                   &contextSeen,
+                   &attachedAtStart,
+                   &attachedAfterSocket] {
+        ThreadIsolationScope scope(ctxPtr);
+        contextSeen = getThreadIsolationContext() == ctxPtr;
+
+        // Joining is per thread, so the new thread has to join itself
+        attachedAtStart = ctxPtr->isNetworkAttached();
+        attachThreadNetwork();
+        attachedAfterSocket = ctxPtr->isNetworkAttached();
+    });
+    t.join();
+
+    REQUIRE(contextSeen);
+    REQUIRE(!attachedAtStart);
+    REQUIRE(attachedAfterSocket);
+
+    // The spawning thread is unaffected by the scope ending
+    REQUIRE(getThreadIsolationContext() == ctxPtr);
+    REQUIRE(ctxPtr->isNetworkAttached());
+
+    // A scope on a thread already attached leaves it attached
+    {
+        ThreadIsolationScope scope(ctxPtr);
+    }
+    REQUIRE(ctxPtr->isNetworkAttached());
+
+    setThreadIsolationContext(nullptr);
+    manager.release(std::move(ctx));
+    REQUIRE(!ctxPtr->isNetworkAttached());
+
+    conf.netNsMode = originalNsMode;
+}
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <faabric/util/clock.h>
+#include <system/LatencyMetrics.h>
+
+#include <thread>
+
+using namespace isolation;
+
+namespace tests {
+TEST_CASE("Test latency bucket boundaries", "[system]")
+{
+    REQUIRE(getLatencyBucket(0) == 0);
+    REQUIRE(getLatencyBucket(1) == 0);
+    REQUIRE(getLatencyBucket(2) == 1);
+    REQUIRE(getLatencyBucket(3) == 2);
+    REQUIRE(getLatencyBucket(4) == 2);
+    REQUIRE(getLatencyBucket(5) == 3);
+    REQUIRE(getLatencyBucket(1024) == 10);
+    REQUIRE(getLatencyBucket(1025) == 11);
+    REQUIRE(getLatencyBucket(1L << 40) == LATENCY_BUCKETS - 1);
+}
+
+TEST_CASE("Test recording latencies across threads", "[system]")
+{
+    cleanSystem();
+
+    LatencyRegistry& registry = getLatencyRegistry();
+    int metricId = registry.getMetricId("testOp");
+    REQUIRE(registry.getMetricId("testOp") == metricId);
+
+    registry.record(metricId, 3);
+    registry.record(metricId, 100);
+
+    // Threads that have exited must still be counted
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&registry, metricId] {
+            for (int j = 0; j < 10; j++) {
+                registry.record(metricId, 3);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    LatencySnapshot snapshot = registry.getSnapshot("testOp");
+    REQUIRE(snapshot.count == 42);
+    REQUIRE(snapshot.sumMicros == 3 + 100 + 40 * 3);
+    REQUIRE(snapshot.buckets[2] == 41);
+    REQUIRE(snapshot.buckets[7] == 1);
+
+    // Clearing keeps the metric but zeroes its counts
+    registry.clear();
+    REQUIRE(registry.getMetricId("testOp") == metricId);
+    REQUIRE(registry.getSnapshot("testOp").count == 0);
+}
+
+TEST_CASE("Test disabling latency recording", "[system]")
+{
+    cleanSystem();
+
+    LatencyRegistry& registry = getLatencyRegistry();
+    int metricId = registry.getMetricId("disabledOp");
+
+    registry.setEnabled(false);
+    registry.record(metricId, 10);
+    REQUIRE(registry.getSnapshot("disabledOp").count == 0);
+
+    registry.setEnabled(true);
+    registry.record(metricId, 10);
+    REQUIRE(registry.getSnapshot("disabledOp").count == 1);
+}
+
+TEST_CASE("Test latency metrics Prometheus output", "[system]")
+{
+    cleanSystem();
+
+    LatencyRegistry& registry = getLatencyRegistry();
+    int metricId = registry.getMetricId("promOp");
+    registry.record(metricId, 3);
+    registry.record(metricId, 1500000);
+
+    std::string text = registry.getPrometheusText();
+
+    REQUIRE(text.find("# TYPE faasm_latency_seconds histogram") !=
+            std::string::npos);
+    REQUIRE(text.find("faasm_latency_seconds_bucket{op=\"promOp\","
+                      "le=\"0.000004\"} 1\n") != std::string::npos);
+    REQUIRE(text.find("faasm_latency_seconds_bucket{op=\"promOp\","
+                      "le=\"2.097152\"} 2\n") != std::string::npos);
+    REQUIRE(text.find("faasm_latency_seconds_bucket{op=\"promOp\","
+                      "le=\"+Inf\"} 2\n") != std::string::npos);
+    REQUIRE(text.find("faasm_latency_seconds_sum{op=\"promOp\"} 1.500003\n") !=
+            std::string::npos);
+    REQUIRE(text.find("faasm_latency_seconds_count{op=\"promOp\"} 2\n") !=
+            std::string::npos);
+}
+
+TEST_CASE("Test latencies recorded for executed call", "[system]")
+{
+    cleanSystem();
+
+    // Queued time runs from when the call was created
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    call.set_inputdata("latency");
+    call.set_timestamp(faabric::util::getGlobalClock().epochMillis() - 100);
+    execFunctionWithStringResult(call);
+
+    LatencyRegistry& registry = getLatencyRegistry();
+    REQUIRE(registry.getSnapshot("callExecute").count == 1);
+    REQUIRE(registry.getSnapshot("callQueued").count == 1);
+    REQUIRE(registry.getSnapshot("callQueued").sumMicros >= 100000);
+    REQUIRE(registry.getSnapshot("admissionWait").count == 1);
+    REQUIRE(registry.getSnapshot("preFinishCall").count == 1);
+}
+}
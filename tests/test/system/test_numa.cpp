@@ -0,0 +1,68 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/util/bytes.h>
+#include <faabric/util/files.h>
+
+#include <system/Numa.h>
+
+#include <boost/filesystem.hpp>
+
+using namespace isolation;
+
+namespace tests {
+TEST_CASE("Test parsing CPU lists", "[faaslet]")
+{
+    REQUIRE(parseCpuList("").empty());
+    REQUIRE(parseCpuList("3\n") == std::vector<int>({ 3 }));
+    REQUIRE(parseCpuList("0-2,8,10-11") ==
+            std::vector<int>({ 0, 1, 2, 8, 10, 11 }));
+}
+
+TEST_CASE("Test detecting NUMA topology", "[faaslet]")
+{
+    boost::filesystem::path sysfsDir("/tmp/faasm_numa_test");
+    boost::filesystem::remove_all(sysfsDir);
+
+    auto writeNode = [&sysfsDir](const std::string& node,
+                                 const std::string& cpuList) {
+        boost::filesystem::path nodeDir = sysfsDir / node;
+        boost::filesystem::create_directories(nodeDir);
+        faabric::util::writeBytesToFile((nodeDir / "cpulist").string(),
+                                        faabric::util::stringToBytes(cpuList));
+    };
+
+    SECTION("Two nodes")
+    {
+        writeNode("node1", "4-7\n");
+        writeNode("node0", "0-3\n");
+
+        // Memory-only node
+        writeNode("node2", "\n");
+
+        // Not a node
+        boost::filesystem::create_directories(sysfsDir / "power");
+
+        NumaTopology topology(sysfsDir.string());
+        REQUIRE(topology.isNuma());
+        REQUIRE(topology.getNodeIds() == std::vector<int>({ 0, 1 }));
+        REQUIRE(topology.getNodeCpus(1) == std::vector<int>({ 4, 5, 6, 7 }));
+        REQUIRE(topology.getNodeForCpu(2) == 0);
+        REQUIRE(topology.getNodeForCpu(6) == 1);
+        REQUIRE(topology.getNodeForCpu(8) == -1);
+    }
+
+    SECTION("No sysfs info")
+    {
+        NumaTopology topology(sysfsDir.string());
+        REQUIRE(!topology.isNuma());
+        REQUIRE(topology.getNodeCount() == 1);
+        REQUIRE(!topology.getNodeCpus(0).empty());
+
+        // Pinning is a no-op
+        REQUIRE(topology.pinCurrentThread(3, true) == -1);
+        REQUIRE(topology.getCurrentNode() == 0);
+    }
+
+    boost::filesystem::remove_all(sysfsDir);
+}
+}
@@ -0,0 +1,58 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <system/Pagemap.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace isolation;
+
+namespace tests {
+TEST_CASE("Test reading page states", "[system]")
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t nBytes = 8 * pageSize;
+
+    int fd = -1;
+    uint8_t* mem = nullptr;
+
+    SECTION("File-backed mapping")
+    {
+        fd = memfd_create("pagemap_test", 0);
+        REQUIRE(ftruncate(fd, nBytes) == 0);
+        mem = (uint8_t*)mmap(
+          nullptr, nBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+
+    SECTION("Anonymous mapping")
+    {
+        mem = (uint8_t*)mmap(nullptr,
+                             nBytes,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS,
+                             -1,
+                             0);
+    }
+
+    REQUIRE(mem != MAP_FAILED);
+
+    // Read one page and write another
+    volatile uint8_t readByte = mem[2 * pageSize];
+    REQUIRE(readByte == 0);
+    mem[5 * pageSize] = 1;
+
+    std::vector<uint8_t> expected(8, 0);
+    expected[2] = PAGE_TOUCHED;
+    expected[5] = PAGE_TOUCHED | PAGE_DIRTIED;
+
+    std::vector<uint8_t> actual = readPageStates(mem, nBytes);
+    REQUIRE(actual == expected);
+
+    munmap(mem, nBytes);
+    if (fd > 0) {
+        close(fd);
+    }
+}
+}
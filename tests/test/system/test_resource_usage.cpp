@@ -0,0 +1,51 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <system/ResourceUsage.h>
+#include <wasm/WasmModule.h>
+
+using namespace isolation;
+
+namespace tests {
+TEST_CASE("Test resource usage log eviction", "[faaslet]")
+{
+    ResourceUsageLog log(2);
+
+    CallResourceUsage usageA;
+    usageA.cpuTimeMicros = 10;
+    CallResourceUsage usageB;
+    usageB.cpuTimeMicros = 20;
+    CallResourceUsage usageC;
+    usageC.cpuTimeMicros = 30;
+
+    log.record(1, usageA);
+    log.record(2, usageB);
+    log.record(3, usageC);
+    REQUIRE(log.getSize() == 2);
+
+    // Oldest is dropped
+    CallResourceUsage actual;
+    REQUIRE(!log.getUsage(1, actual));
+    REQUIRE(log.getUsage(3, actual));
+    REQUIRE(actual.cpuTimeMicros == 30);
+}
+
+TEST_CASE("Test resource usage recorded for finished call", "[faaslet]")
+{
+    cleanSystem();
+
+    faabric::Message call = faabric::util::messageFactory("demo", "echo");
+    call.set_inputdata("usage");
+    execFunctionWithStringResult(call);
+
+    // Memory is the size of the call's own linear memory
+    CallResourceUsage usage;
+    REQUIRE(getResourceUsageLog().getUsage(call.id(), usage));
+    REQUIRE(usage.cpuTimeMicros >= 0);
+    REQUIRE(usage.finalMemoryBytes > 0);
+    REQUIRE(usage.finalMemoryBytes % WASM_BYTES_PER_PAGE == 0);
+    REQUIRE(usage.startMicros > 0);
+    REQUIRE(usage.endMicros >= usage.startMicros);
+}
+}
@@ -0,0 +1,55 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/util/func.h>
+#include <wasm/CallGraph.h>
+
+namespace tests {
+TEST_CASE("Test recording chained calls in call graph", "[wasm]")
+{
+    wasm::CallGraph& graph = wasm::getCallGraph();
+    graph.clear();
+
+    faabric::Message parent = faabric::util::messageFactory("demo", "a");
+    faabric::Message childB = faabric::util::messageFactory("demo", "b");
+    faabric::Message childC = faabric::util::messageFactory("demo", "c");
+
+    // Four calls to the parent, all of which chain b, one of which chains c
+    for (int i = 0; i < 4; i++) {
+        graph.recordCall(parent);
+        graph.recordChainedCall(parent, childB);
+    }
+    graph.recordChainedCall(parent, childC);
+
+    REQUIRE(graph.getCallCount(parent) == 4);
+    REQUIRE(graph.getCallCount(childB) == 0);
+    REQUIRE(graph.getChainedCallCount(parent, childB) == 4);
+    REQUIRE(graph.getChainedCallCount(parent, childC) == 1);
+    REQUIRE(graph.getChainedCallCount(childB, childC) == 0);
+
+    std::vector<std::string> expected;
+    int threshold;
+
+    SECTION("Low threshold")
+    {
+        threshold = 25;
+        expected = { "b", "c" };
+    }
+
+    SECTION("High threshold")
+    {
+        threshold = 50;
+        expected = { "b" };
+    }
+
+    std::vector<std::string> actual =
+      graph.getLikelyChildren(parent, threshold);
+    std::sort(actual.begin(), actual.end());
+    REQUIRE(actual == expected);
+
+    // Children of unknown functions
+    REQUIRE(graph.getLikelyChildren(childB, 0).empty());
+
+    graph.clear();
+    REQUIRE(graph.getCallCount(parent) == 0);
+}
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+
+#include <wasm/ExecutionWatchdog.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace wasm;
+
+namespace tests {
+TEST_CASE("Test watchdog interrupts calls over their limits", "[wasm]")
+{
+    ExecutionWatchdog watchdog;
+    std::atomic<int> interrupts = 0;
+
+    CallTimeLimits limits;
+    std::string expectedReason;
+
+    SECTION("Wall-clock limit")
+    {
+        limits.wallMs = 20;
+        expectedReason = "wall-clock time limit exceeded";
+    }
+
+    SECTION("CPU limit")
+    {
+        limits.cpuMs = 20;
+        expectedReason = "CPU time limit exceeded";
+    }
+
+    REQUIRE(limits.isLimited());
+    int watchId = watchdog.arm(limits, [&interrupts] { interrupts++; });
+    REQUIRE(watchdog.getWatchCount() == 1);
+
+    // Burn CPU until interrupted
+    auto start = std::chrono::steady_clock::now();
+    while (interrupts == 0) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(elapsed < std::chrono::seconds(5));
+    }
+
+    std::string reason;
+    REQUIRE(watchdog.disarm(watchId, reason));
+    REQUIRE(reason == expectedReason);
+
+    // Counted as one interrupt, however often the callback ran
+    REQUIRE(interrupts >= 1);
+    REQUIRE(watchdog.getInterruptCount() == 1);
+    REQUIRE(watchdog.getWatchCount() == 0);
+}
+
+TEST_CASE("Test watchdog leaves calls within their limits", "[wasm]")
+{
+    ExecutionWatchdog watchdog;
+    std::atomic<int> interrupts = 0;
+
+    CallTimeLimits limits;
+    limits.wallMs = 5000;
+    limits.cpuMs = 5000;
+
+    int watchId = watchdog.arm(limits, [&interrupts] { interrupts++; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    std::string reason;
+    REQUIRE(!watchdog.disarm(watchId, reason));
+    REQUIRE(reason.empty());
+    REQUIRE(interrupts == 0);
+
+    // Disarming again is harmless
+    REQUIRE(!watchdog.disarm(watchId, reason));
+}
+
+TEST_CASE("Test watchdog retries interrupt until disarmed", "[wasm]")
+{
+    ExecutionWatchdog watchdog;
+    std::atomic<int> interrupts = 0;
+
+    CallTimeLimits limits;
+    limits.wallMs = 5;
+
+    int watchId = watchdog.arm(limits, [&interrupts] { interrupts++; });
+
+    auto start = std::chrono::steady_clock::now();
+    while (interrupts < 3) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(elapsed < std::chrono::seconds(5));
+    }
+
+    std::string reason;
+    REQUIRE(watchdog.disarm(watchId, reason));
+    REQUIRE(watchdog.getInterruptCount() == 1);
+
+    // No more calls once disarmed
+    int interruptsAfter = interrupts;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(interrupts == interruptsAfter);
+}
+}
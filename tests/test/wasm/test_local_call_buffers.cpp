@@ -0,0 +1,93 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <faabric/util/func.h>
+#include <wasm/LocalCallBuffers.h>
+
+namespace tests {
+TEST_CASE("Test reading and writing local call buffers", "[wasm]")
+{
+    cleanSystem();
+
+    wasm::LocalCallBuffers& buffers = wasm::getLocalCallBuffers();
+
+    faabric::Message localMsg = faabric::util::messageFactory("demo", "echo");
+    faabric::util::setMessageId(localMsg);
+
+    faabric::Message remoteMsg = faabric::util::messageFactory("demo", "echo");
+    faabric::util::setMessageId(remoteMsg);
+
+    std::vector<uint8_t> localInput = { 0, 1, 2, 3, 4 };
+    std::vector<uint8_t> remoteInput = { 5, 6, 7 };
+    buffers.addCall(localMsg.id(), 1, localInput);
+    remoteMsg.set_inputdata(remoteInput.data(), remoteInput.size());
+
+    REQUIRE(buffers.isLocalCall(localMsg.id()));
+    REQUIRE(!buffers.isLocalCall(remoteMsg.id()));
+    REQUIRE(buffers.getCallCount() == 1);
+
+    // Check input sizes
+    REQUIRE(wasm::getCallInputSize(localMsg) == localInput.size());
+    REQUIRE(wasm::getCallInputSize(remoteMsg) == remoteInput.size());
+
+    // Check reading input into undersized and oversized buffers
+    std::vector<uint8_t> smallBuffer(2, 0);
+    REQUIRE(wasm::readCallInput(localMsg, smallBuffer.data(), 2) == 2);
+    REQUIRE(smallBuffer == std::vector<uint8_t>({ 0, 1 }));
+
+    std::vector<uint8_t> bigBuffer(10, 0);
+    REQUIRE(wasm::readCallInput(localMsg, bigBuffer.data(), 10) == 5);
+    REQUIRE(wasm::readCallInput(remoteMsg, bigBuffer.data(), 10) == 3);
+    REQUIRE(bigBuffer ==
+            std::vector<uint8_t>({ 5, 6, 7, 3, 4, 0, 0, 0, 0, 0 }));
+
+    // Write outputs and check local one doesn't end up in the message
+    std::vector<uint8_t> output = { 9, 8, 7 };
+    wasm::writeCallOutput(localMsg, output.data(), output.size());
+    wasm::writeCallOutput(remoteMsg, output.data(), output.size());
+
+    REQUIRE(localMsg.outputdata().empty());
+    REQUIRE(remoteMsg.outputdata() ==
+            std::string(output.begin(), output.end()));
+
+    // Remove the local call and check the output
+    std::shared_ptr<wasm::LocalCallBuffer> localBuffer =
+      buffers.removeCall(localMsg.id());
+    REQUIRE(localBuffer->hasOutput);
+    REQUIRE(localBuffer->output == output);
+
+    REQUIRE(buffers.getCallCount() == 0);
+    REQUIRE(buffers.removeCall(localMsg.id()) == nullptr);
+}
+
+TEST_CASE("Test local call buffers freed when both sides finish", "[wasm]")
+{
+    cleanSystem();
+
+    wasm::LocalCallBuffers& buffers = wasm::getLocalCallBuffers();
+
+    unsigned int callerId = 10;
+    std::vector<uint8_t> input = { 0, 1, 2 };
+    buffers.addCall(11, callerId, input);
+    buffers.addCall(12, callerId, input);
+    REQUIRE(buffers.getCallCount() == 2);
+
+    // Callee finishing first keeps its output for the caller
+    buffers.finishCall(11);
+    REQUIRE(buffers.getCallCount() == 2);
+
+    // Caller finishing without awaiting frees everything that's finished
+    buffers.finishCall(callerId);
+    REQUIRE(buffers.getCallCount() == 1);
+    REQUIRE(buffers.isLocalCall(12));
+
+    // Callee still running can read its input
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    msg.set_id(12);
+    REQUIRE(wasm::getCallInput(msg) == input);
+
+    buffers.finishCall(12);
+    REQUIRE(buffers.getCallCount() == 0);
+}
+}
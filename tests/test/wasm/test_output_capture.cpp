@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <wasm/OutputCapture.h>
+
+#include <faabric/util/files.h>
+#include <faabric/util/func.h>
+
+#include <boost/filesystem.hpp>
+
+using namespace wasm;
+
+namespace tests {
+TEST_CASE("Test output capture ring buffer", "[wasm]")
+{
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    OutputCapture capture(msg, 10);
+
+    REQUIRE(capture.read().empty());
+
+    std::string expected;
+    size_t expectedDropped = 0;
+
+    SECTION("Within capacity")
+    {
+        capture.write("abc", 3);
+        capture.write("defg", 4);
+        expected = "abcdefg";
+    }
+
+    SECTION("Wrapping around")
+    {
+        capture.write("abcdefgh", 8);
+        capture.write("ijkl", 4);
+        expected = "[output truncated, 2 bytes dropped]\ncdefghijkl";
+        expectedDropped = 2;
+    }
+
+    SECTION("Single write over capacity")
+    {
+        capture.write("0123456789abcdef", 16);
+        expected = "[output truncated, 6 bytes dropped]\n6789abcdef";
+        expectedDropped = 6;
+    }
+
+    REQUIRE(capture.read() == expected);
+    REQUIRE(capture.getDroppedBytes() == expectedDropped);
+}
+
+TEST_CASE("Test output capture size per function", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    faasmConf.stdoutBufferKb = 8;
+    faasmConf.stdoutBufferLimits = "demo/chatty=1";
+
+    faabric::Message msgA = faabric::util::messageFactory("demo", "echo");
+    faabric::Message msgB = faabric::util::messageFactory("demo", "chatty");
+
+    REQUIRE(getOutputCaptureBytes(msgA) == 8 * 1024);
+    REQUIRE(getOutputCaptureBytes(msgB) == 1024);
+
+    cleanSystem();
+}
+
+TEST_CASE("Test streaming output to a file sink", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+
+    faasmConf.stdoutSink = "file";
+    faasmConf.stdoutSinkDir = "/tmp/faasm/stdout_test";
+    boost::filesystem::remove_all(faasmConf.stdoutSinkDir);
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    std::string id = std::to_string(msg.id());
+
+    {
+        OutputCapture capture(msg, 4);
+        capture.write("first li", 8);
+        capture.write("ne\nsecond line\nthi", 18);
+        capture.write("rd", 2);
+
+        // Only the end is kept in the buffer
+        REQUIRE(capture.read() ==
+                "[output truncated, 24 bytes dropped]\nhird");
+    }
+
+    std::string expected = "[" + id + "] first line\n" + "[" + id +
+                           "] second line\n" + "[" + id + "] third\n";
+    std::string actual = faabric::util::readFileToString(
+      faasmConf.stdoutSinkDir + "/demo_echo.log");
+    REQUIRE(actual == expected);
+
+    cleanSystem();
+}
+}
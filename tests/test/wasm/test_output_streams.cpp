@@ -0,0 +1,179 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/func.h>
+#include <wasm/LocalCallBuffers.h>
+#include <wasm/OutputStreams.h>
+
+#include <thread>
+
+namespace tests {
+TEST_CASE("Test local output stream backpressure", "[wasm]")
+{
+    size_t chunkSize = 10;
+    int nChunks = 20;
+    wasm::OutputStream stream(3 * chunkSize);
+
+    // Writer will block once the stream is full
+    std::thread writer([&stream, chunkSize, nChunks] {
+        std::vector<uint8_t> chunk(chunkSize);
+        for (int c = 0; c < nChunks; c++) {
+            std::fill(chunk.begin(), chunk.end(), (uint8_t)c);
+            stream.write(chunk.data(), chunk.size(), 5000);
+        }
+
+        stream.close();
+    });
+
+    // Give the writer time to fill up the stream
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(stream.getBufferedBytes() == 3 * chunkSize);
+    REQUIRE(!stream.isClosed());
+
+    // Read everything back in pieces smaller than the chunks
+    std::vector<uint8_t> actual;
+    std::vector<uint8_t> buffer(chunkSize / 2 + 1);
+    while (true) {
+        size_t readLen = stream.read(buffer.data(), buffer.size(), 5000);
+        if (readLen == 0) {
+            break;
+        }
+
+        REQUIRE(stream.getBufferedBytes() <= 3 * chunkSize);
+        actual.insert(actual.end(), buffer.begin(), buffer.begin() + readLen);
+    }
+
+    writer.join();
+
+    std::vector<uint8_t> expected;
+    for (int c = 0; c < nChunks; c++) {
+        expected.insert(expected.end(), chunkSize, (uint8_t)c);
+    }
+
+    REQUIRE(actual == expected);
+    REQUIRE(stream.isClosed());
+    REQUIRE(stream.hasWritten());
+}
+
+TEST_CASE("Test reading streamed output of local call", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.outputStreamChunkKb = 1;
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    faabric::util::setMessageId(msg);
+
+    wasm::OutputStreams& streams = wasm::getOutputStreams();
+    wasm::getLocalCallBuffers().addCall(msg.id(), 1, {});
+
+    std::vector<uint8_t> expected;
+    bool isStreamed;
+
+    SECTION("Streamed")
+    {
+        isStreamed = true;
+        streams.addReader(msg.id(), 1, true, true);
+
+        // Write more than a chunk in one go, this should be split up
+        expected = std::vector<uint8_t>(1500, 3);
+        wasm::writeCallOutputChunk(msg, expected.data(), 1000);
+        wasm::writeCallOutputChunk(msg, expected.data() + 1000, 500);
+        REQUIRE(streams.getLocalStream(msg.id())->hasWritten());
+    }
+
+    SECTION("Not streamed")
+    {
+        isStreamed = false;
+        streams.addReader(msg.id(), 1, true, false);
+        REQUIRE(streams.getLocalStream(msg.id()) == nullptr);
+
+        // Chunks written without a stream end up in the output
+        expected = { 0, 1, 2, 3 };
+        wasm::writeCallOutput(msg, expected.data(), 2);
+        wasm::writeCallOutputChunk(msg, expected.data() + 2, 2);
+    }
+
+    wasm::closeCallOutputStream(msg);
+
+    // Calls that don't stream are only read once they've finished
+    if (!isStreamed) {
+        faabric::scheduler::getScheduler().setFunctionResult(msg);
+    }
+
+    std::vector<uint8_t> actual = wasm::drainCallOutputStream(msg.id());
+    REQUIRE(actual == expected);
+
+    // Reading again gives nothing
+    uint8_t buffer[4];
+    REQUIRE(wasm::readCallOutputChunk(msg.id(), buffer, 4) == 0);
+
+    cleanSystem();
+}
+
+TEST_CASE("Test output stream writer released when caller finishes", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    faasmConf.outputStreamBufferKb = 1;
+    faasmConf.outputStreamChunkKb = 1;
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    faabric::util::setMessageId(msg);
+
+    unsigned int callerId = 1;
+    wasm::OutputStreams& streams = wasm::getOutputStreams();
+    streams.addReader(msg.id(), callerId, true, true);
+    std::shared_ptr<wasm::OutputStream> stream =
+      streams.getLocalStream(msg.id());
+
+    // Writer fills the stream, then blocks as nobody is reading
+    std::vector<uint8_t> data(4 * 1024, 1);
+    std::thread writer([&msg, &data] {
+        wasm::writeCallOutputChunk(msg, data.data(), data.size());
+        wasm::closeCallOutputStream(msg);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(stream->getBufferedBytes() == 1024);
+
+    // Caller finishing without reading lets the writer carry on
+    streams.finishCall(callerId);
+    writer.join();
+
+    REQUIRE(streams.getReaderCount() == 0);
+    REQUIRE(stream->getBufferedBytes() == 0);
+
+    cleanSystem();
+}
+
+TEST_CASE("Test memoized output read like any other call", "[wasm]")
+{
+    cleanSystem();
+
+    wasm::OutputStreams& streams = wasm::getOutputStreams();
+
+    unsigned int callerId = 1;
+    std::vector<uint8_t> expected = { 0, 1, 2, 3 };
+    streams.addCompletedReader(2, callerId, expected);
+    streams.addCompletedReader(3, callerId, expected);
+    REQUIRE(streams.getReaderCount() == 2);
+
+    std::shared_ptr<wasm::OutputStreamReader> reader = streams.getReader(2);
+    REQUIRE(reader->hasResult);
+    REQUIRE(reader->result.returnvalue() == 0);
+    REQUIRE(wasm::drainCallOutputStream(2) == expected);
+
+    // Readers for calls that are never awaited go when the caller finishes
+    streams.removeReader(2);
+    REQUIRE(streams.getReaderCount() == 1);
+
+    streams.finishCall(callerId);
+    REQUIRE(streams.getReaderCount() == 0);
+}
+}
@@ -0,0 +1,100 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/files.h>
+#include <faabric/util/func.h>
+#include <wavm/PerfMap.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+using namespace wasm;
+
+namespace tests {
+std::vector<std::string> readPerfMapLines(const std::string& prefix)
+{
+    std::vector<std::string> lines;
+
+    std::string path = getPerfMap().getPath();
+    if (!boost::filesystem::exists(path)) {
+        return lines;
+    }
+
+    std::string contents = faabric::util::readFileToString(path);
+    std::vector<std::string> allLines;
+    boost::split(allLines, contents, [](char c) { return c == '\n'; });
+    for (auto& l : allLines) {
+        if (l.find(prefix) != std::string::npos) {
+            lines.emplace_back(l);
+        }
+    }
+
+    return lines;
+}
+
+TEST_CASE("Test perf map entries for loaded module", "[wasm]")
+{
+    cleanSystem();
+    getPerfMap().clear();
+
+    conf::FaasmConfig& conf = conf::getFaasmConfig();
+
+    std::string prefix = "wasm:demo/echo:";
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+
+    SECTION("Perf map off")
+    {
+        conf.perfMap = "off";
+
+        WAVMWasmModule module;
+        module.bindToFunction(msg);
+
+        REQUIRE(getPerfMap().getEntryCount() == 0);
+        REQUIRE(readPerfMapLines(prefix).empty());
+    }
+
+    SECTION("Perf map on")
+    {
+        conf.perfMap = "on";
+
+        auto module = std::make_unique<WAVMWasmModule>();
+        module->bindToFunction(msg);
+
+        // Check there's a well-formed entry for every function, including main
+        std::vector<std::string> lines = readPerfMapLines(prefix);
+        REQUIRE(!lines.empty());
+        REQUIRE(lines.size() == getPerfMap().getEntryCount());
+
+        bool foundMain = false;
+        for (auto& l : lines) {
+            std::vector<std::string> parts;
+            boost::split(parts, l, [](char c) { return c == ' '; });
+            REQUIRE(parts.size() == 3);
+            REQUIRE(std::stoul(parts[0], nullptr, 16) > 0);
+            REQUIRE(std::stoul(parts[1], nullptr, 16) > 0);
+            REQUIRE(parts[2].rfind(prefix, 0) == 0);
+
+            if (parts[2].find("main") != std::string::npos) {
+                foundMain = true;
+            }
+        }
+        REQUIRE(foundMain);
+
+        // Entries must stay while a clone is still using the code
+        auto clone = std::make_unique<WAVMWasmModule>(*module);
+        module.reset();
+        REQUIRE(readPerfMapLines(prefix).size() == lines.size());
+
+        // Once all are gone the entries must be removed
+        clone.reset();
+        REQUIRE(getPerfMap().getEntryCount() == 0);
+        REQUIRE(readPerfMapLines(prefix).empty());
+    }
+
+    getPerfMap().clear();
+    cleanSystem();
+}
+}
@@ -0,0 +1,215 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/func.h>
+#include <storage/FunctionVersions.h>
+#include <wasm/ResultCache.h>
+
+#include <boost/filesystem.hpp>
+
+namespace tests {
+TEST_CASE("Test memoization is opt-in per function", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    wasm::ResultCache& cache = wasm::getResultCache();
+
+    faabric::Message msgA = faabric::util::messageFactory("demo", "a");
+    faabric::Message msgB = faabric::util::messageFactory("demo", "b");
+    faabric::Message msgC = faabric::util::messageFactory("foo", "a");
+
+    faabric::Message thread = faabric::util::messageFactory("demo", "a");
+    thread.set_snapshotkey("foobar");
+
+    faabric::Message python = faabric::util::messageFactory("python", "py");
+    python.set_ispython(true);
+    python.set_pythonuser("demo");
+    python.set_pythonfunction("b");
+
+    faasmConf.memoizeFunctions = "";
+    REQUIRE(!cache.isMemoizable(msgA));
+
+    faasmConf.memoizeFunctions = "demo/a, demo/b";
+    REQUIRE(cache.isMemoizable(msgA));
+    REQUIRE(cache.isMemoizable(msgB));
+    REQUIRE(!cache.isMemoizable(msgC));
+    REQUIRE(!cache.isMemoizable(thread));
+    REQUIRE(cache.isMemoizable(python));
+
+    faasmConf.memoizeFunctions = "demo/b";
+    REQUIRE(!cache.isMemoizable(msgA));
+    REQUIRE(cache.isMemoizable(msgB));
+}
+
+TEST_CASE("Test memoized results and LRU eviction", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    wasm::ResultCache& cache = wasm::getResultCache();
+
+    faasmConf.memoizeMaxEntries = 2;
+    faasmConf.memoizeDir = "";
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "a");
+    faabric::Message otherMsg = faabric::util::messageFactory("demo", "b");
+
+    std::vector<uint8_t> inputA = { 0, 1, 2 };
+    std::vector<uint8_t> inputB = { 3, 4 };
+    std::vector<uint8_t> inputC = { 5 };
+    std::vector<uint8_t> outputA = { 9, 9 };
+    std::vector<uint8_t> outputB = { 8 };
+    std::vector<uint8_t> outputC = { 7, 7, 7 };
+
+    std::vector<uint8_t> actual;
+    REQUIRE(!cache.getResult(msg, inputA, actual));
+    REQUIRE(cache.getMissCount() == 1);
+
+    cache.putResult(msg, inputA, outputA);
+    cache.putResult(msg, inputB, outputB);
+    REQUIRE(cache.getEntryCount() == 2);
+
+    // Same input to a different function is not a hit
+    REQUIRE(!cache.getResult(otherMsg, inputA, actual));
+
+    REQUIRE(cache.getResult(msg, inputA, actual));
+    REQUIRE(actual == outputA);
+    REQUIRE(cache.getHitCount() == 1);
+    REQUIRE(cache.getMissCount() == 2);
+
+    // Adding a third should evict the least recently used (B)
+    cache.putResult(msg, inputC, outputC);
+    REQUIRE(cache.getEntryCount() == 2);
+    REQUIRE(cache.getEvictionCount() == 1);
+
+    REQUIRE(!cache.getResult(msg, inputB, actual));
+    REQUIRE(cache.getResult(msg, inputA, actual));
+    REQUIRE(actual == outputA);
+    REQUIRE(cache.getResult(msg, inputC, actual));
+    REQUIRE(actual == outputC);
+
+    REQUIRE(cache.getHitCount() == 3);
+    REQUIRE(cache.getMissCount() == 3);
+
+    cache.clear();
+}
+
+TEST_CASE("Test persisting memoized results", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    wasm::ResultCache& cache = wasm::getResultCache();
+
+    std::string memoDir = "/tmp/faasm-memo-test";
+    boost::filesystem::remove_all(memoDir);
+
+    faasmConf.memoizeMaxEntries = 1;
+    faasmConf.memoizeDir = memoDir;
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "a");
+    std::vector<uint8_t> inputA = { 0, 1, 2 };
+    std::vector<uint8_t> inputB = { 3, 4 };
+    std::vector<uint8_t> outputA = { 9, 9 };
+    std::vector<uint8_t> outputB = { 8 };
+
+    cache.putResult(msg, inputA, outputA);
+    cache.putResult(msg, inputB, outputB);
+    REQUIRE(cache.getEntryCount() == 1);
+
+    // Evicted result should still be on disk, even after clearing memory
+    cache.clear();
+
+    std::vector<uint8_t> actual;
+    REQUIRE(cache.getResult(msg, inputA, actual));
+    REQUIRE(actual == outputA);
+    REQUIRE(cache.getResult(msg, inputB, actual));
+    REQUIRE(actual == outputB);
+    REQUIRE(cache.getHitCount() == 2);
+
+    // Different input of the same size is a miss
+    std::vector<uint8_t> inputC = { 5, 6 };
+    REQUIRE(!cache.getResult(msg, inputC, actual));
+
+    boost::filesystem::remove_all(memoDir);
+
+    cache.clear();
+}
+
+TEST_CASE("Test truncated memoized results are a miss", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& faasmConf = conf::getFaasmConfig();
+    wasm::ResultCache& cache = wasm::getResultCache();
+
+    std::string memoDir = "/tmp/faasm-memo-test";
+    boost::filesystem::remove_all(memoDir);
+    faasmConf.memoizeDir = memoDir;
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "a");
+    std::vector<uint8_t> input = { 0, 1, 2 };
+    std::vector<uint8_t> output = { 9, 8, 7, 6 };
+    cache.putResult(msg, input, output);
+    cache.clear();
+
+    // Result should have been renamed into place, leaving a single file
+    boost::filesystem::path funcDir(memoDir);
+    funcDir.append("demo/a");
+    std::vector<boost::filesystem::path> files;
+    for (auto& f : boost::filesystem::directory_iterator(funcDir)) {
+        files.push_back(f.path());
+    }
+    REQUIRE(files.size() == 1);
+
+    size_t fullSize = boost::filesystem::file_size(files.at(0));
+
+    SECTION("Output cut short")
+    {
+        boost::filesystem::resize_file(files.at(0), fullSize - 1);
+    }
+
+    SECTION("Input cut short")
+    {
+        boost::filesystem::resize_file(files.at(0), fullSize - 5);
+    }
+
+    SECTION("Header cut short")
+    {
+        boost::filesystem::resize_file(files.at(0), 4);
+    }
+
+    std::vector<uint8_t> actual;
+    REQUIRE(!cache.getResult(msg, input, actual));
+    REQUIRE(cache.getHitCount() == 0);
+    REQUIRE(cache.getMissCount() == 1);
+
+    boost::filesystem::remove_all(memoDir);
+    cache.clear();
+}
+
+TEST_CASE("Test memoized results are per function version", "[wasm]")
+{
+    cleanSystem();
+
+    conf::getFaasmConfig().memoizeDir = "";
+    wasm::ResultCache& cache = wasm::getResultCache();
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "a");
+    std::vector<uint8_t> input = { 0, 1, 2 };
+    std::vector<uint8_t> output = { 9, 9 };
+    cache.putResult(msg, input, output);
+
+    std::vector<uint8_t> actual;
+    REQUIRE(cache.getResult(msg, input, actual));
+
+    // Uploading a new version hides the old result
+    storage::getFunctionVersions().bumpVersion(msg);
+    REQUIRE(!cache.getResult(msg, input, actual));
+
+    cleanSystem();
+}
+}
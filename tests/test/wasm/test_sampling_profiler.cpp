@@ -0,0 +1,99 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <faabric/util/func.h>
+#include <wavm/SamplingProfiler.h>
+#include <wavm/WAVMWasmModule.h>
+
+using namespace wasm;
+
+namespace tests {
+TEST_CASE("Test sampling profiler attributes samples to guest functions",
+          "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& conf = conf::getFaasmConfig();
+    conf.profileIntervalUs = 500;
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "hot_loop");
+    CallProfiles& profiles = getCallProfiles();
+
+    SECTION("Profiling off")
+    {
+        conf.profileFunctions = "";
+
+        WAVMWasmModule module;
+        module.bindToFunction(msg);
+        REQUIRE(module.execute(msg));
+
+        FoldedStacks stacks;
+        REQUIRE(!profiles.getCallProfile(msg.id(), stacks));
+        REQUIRE(profiles.getFunctionProfile("demo/hot_loop").empty());
+    }
+
+    SECTION("Profiling on")
+    {
+        SECTION("Enabled for function")
+        {
+            conf.profileFunctions = "demo/hot_loop";
+        }
+
+        SECTION("Enabled for call")
+        {
+            conf.profileFunctions = "";
+            profiles.enableForCall(msg.id());
+        }
+
+        WAVMWasmModule module;
+        module.bindToFunction(msg);
+        REQUIRE(module.execute(msg));
+
+        FoldedStacks stacks;
+        REQUIRE(profiles.getCallProfile(msg.id(), stacks));
+        REQUIRE(!stacks.empty());
+
+        // The hottest stack should end in the hot function
+        long total = 0;
+        std::string hottest;
+        long hottestCount = 0;
+        for (auto& s : stacks) {
+            total += s.second;
+            if (s.second > hottestCount) {
+                hottest = s.first;
+                hottestCount = s.second;
+            }
+        }
+        REQUIRE(total > 0);
+
+        std::string leaf = hottest.substr(hottest.rfind(';') + 1);
+        REQUIRE(leaf.find("hotFunction") != std::string::npos);
+
+        // Check the function's aggregate matches
+        REQUIRE(profiles.getFunctionProfile("demo/hot_loop") == stacks);
+
+        // A subsequent call is only profiled if the function is listed
+        faabric::Message msgB =
+          faabric::util::messageFactory("demo", "hot_loop");
+        WAVMWasmModule moduleB;
+        moduleB.bindToFunction(msgB);
+        REQUIRE(moduleB.execute(msgB));
+
+        FoldedStacks stacksB;
+        bool expectedB = !conf.profileFunctions.empty();
+        REQUIRE(profiles.getCallProfile(msgB.id(), stacksB) == expectedB);
+    }
+
+    cleanSystem();
+}
+
+TEST_CASE("Test folded stacks output", "[wasm]")
+{
+    FoldedStacks stacks = { { "main;foo", 3 }, { "main;foo;bar", 1 } };
+
+    std::string expected = "main;foo 3\nmain;foo;bar 1\n";
+    REQUIRE(foldedStacksToString(stacks) == expected);
+}
+}
@@ -0,0 +1,132 @@
+#include <catch2/catch.hpp>
+
+#include "utils.h"
+
+#include <conf/FaasmConfig.h>
+#include <module_cache/WasmModuleCache.h>
+#include <system/Pagemap.h>
+#include <wasm/WorkingSet.h>
+#include <wavm/WAVMWasmModule.h>
+
+#include <faabric/util/func.h>
+
+using namespace wasm;
+
+namespace tests {
+static CallWorkingSet makeWorkingSet(std::vector<uint8_t> pageStates)
+{
+    // Two pages each of stack and data, then the heap
+    CallWorkingSet workingSet;
+    workingSet.pageSize = 4096;
+    workingSet.dataStart = 2 * 4096;
+    workingSet.heapStart = 4 * 4096;
+    workingSet.memoryBytes = pageStates.size() * 4096;
+    workingSet.pageStates = pageStates;
+    return workingSet;
+}
+
+TEST_CASE("Test combining call working sets", "[wasm]")
+{
+    cleanSystem();
+
+    uint8_t t = PAGE_TOUCHED;
+    uint8_t d = PAGE_TOUCHED | PAGE_DIRTIED;
+    CallWorkingSet callA = makeWorkingSet({ t, d, 0, t, 0, d });
+    CallWorkingSet callB = makeWorkingSet({ t, 0, d, 0, 0, 0, t });
+
+    std::array<RegionPages, WORKING_SET_N_REGIONS> regionsA =
+      callA.getRegionPages();
+    REQUIRE(regionsA[WORKING_SET_STACK].pages == 2);
+    REQUIRE(regionsA[WORKING_SET_STACK].touched == 2);
+    REQUIRE(regionsA[WORKING_SET_STACK].dirtied == 1);
+    REQUIRE(regionsA[WORKING_SET_DATA].pages == 2);
+    REQUIRE(regionsA[WORKING_SET_DATA].touched == 1);
+    REQUIRE(regionsA[WORKING_SET_DATA].dirtied == 0);
+    REQUIRE(regionsA[WORKING_SET_HEAP].pages == 2);
+    REQUIRE(regionsA[WORKING_SET_HEAP].touched == 1);
+    REQUIRE(regionsA[WORKING_SET_HEAP].dirtied == 1);
+
+    FunctionWorkingSets& workingSets = getFunctionWorkingSets();
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    workingSets.record(msg, callA);
+    workingSets.record(msg, callB);
+
+    WorkingSetReport report;
+    REQUIRE(!workingSets.getReport("demo/foo", report));
+    REQUIRE(workingSets.getReport("demo/echo", report));
+    REQUIRE(report.calls == 2);
+
+    RegionReport& stack = report.regions[WORKING_SET_STACK];
+    REQUIRE(stack.pages == 2);
+    REQUIRE(stack.totalTouched == 3);
+    REQUIRE(stack.maxTouched == 2);
+    REQUIRE(stack.totalDirtied == 1);
+    REQUIRE(stack.everTouched == 2);
+    REQUIRE(stack.everDirtied == 1);
+
+    RegionReport& data = report.regions[WORKING_SET_DATA];
+    REQUIRE(data.totalTouched == 2);
+    REQUIRE(data.totalDirtied == 1);
+    REQUIRE(data.everTouched == 2);
+    REQUIRE(data.everDirtied == 1);
+
+    // The heap grew in the second call
+    RegionReport& heap = report.regions[WORKING_SET_HEAP];
+    REQUIRE(heap.pages == 3);
+    REQUIRE(heap.maxTouched == 1);
+    REQUIRE(heap.maxDirtied == 1);
+    REQUIRE(heap.everTouched == 2);
+    REQUIRE(heap.everDirtied == 1);
+}
+
+TEST_CASE("Test working set recorded for listed functions", "[wasm]")
+{
+    cleanSystem();
+
+    conf::FaasmConfig& conf = conf::getFaasmConfig();
+
+    faabric::Message msg = faabric::util::messageFactory("demo", "echo");
+    msg.set_inputdata("working set");
+
+    bool expectRecorded = false;
+    SECTION("Not listed")
+    {
+        conf.workingSetFunctions = "";
+    }
+
+    SECTION("Listed")
+    {
+        conf.workingSetFunctions = "demo/echo";
+        expectRecorded = true;
+    }
+
+    std::shared_ptr<WAVMWasmModule> zygote =
+      module_cache::getWasmModuleCache().getCachedModule(msg);
+    WAVMWasmModule module(*zygote);
+    REQUIRE(module.execute(msg));
+
+    WorkingSetReport report;
+    REQUIRE(getFunctionWorkingSets().getReport("demo/echo", report) ==
+            expectRecorded);
+
+    if (expectRecorded) {
+        REQUIRE(report.calls == 1);
+
+        // The call uses its stack, and only a fraction of its memory
+        long totalPages = 0;
+        long totalTouched = 0;
+        for (auto& region : report.regions) {
+            REQUIRE(region.maxDirtied <= region.maxTouched);
+            REQUIRE(region.maxTouched <= region.pages);
+            totalPages += region.pages;
+            totalTouched += region.maxTouched;
+        }
+
+        REQUIRE(report.regions[WORKING_SET_STACK].maxDirtied > 0);
+        REQUIRE(totalPages * report.pageSize == module.getMemorySizeBytes());
+        REQUIRE(totalTouched < totalPages);
+    }
+
+    cleanSystem();
+}
+}
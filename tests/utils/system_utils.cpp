@@ -4,7 +4,24 @@
 
 #include "utils.h"
 
+#include <conf/FaasmConfig.h>
+#include <faaslet/AdmissionController.h>
+#include <ir_cache/ProfileGuided.h>
+#include <module_cache/ArtefactVersions.h>
+#include <module_cache/ChainPrewarmer.h>
 #include <module_cache/WasmModuleCache.h>
+#include <storage/FunctionVersions.h>
+#include <system/IsolationManager.h>
+#include <system/LatencyMetrics.h>
+#include <system/ResourceUsage.h>
+#include <wasm/CallGraph.h>
+#include <wasm/CallTracer.h>
+#include <wasm/FunctionCosts.h>
+#include <wasm/LocalCallBuffers.h>
+#include <wasm/OutputStreams.h>
+#include <wasm/ResultCache.h>
+#include <wasm/WorkingSet.h>
+#include <wavm/SamplingProfiler.h>
 
 namespace tests {
 void cleanSystem()
@@ -15,7 +32,44 @@ void cleanSystem()
     // Clear shared files
     storage::FileSystem::clearSharedFiles();
 
-    // Clear zygotes
+    // Clear zygotes, waiting for any prewarming to finish first
+    module_cache::getChainPrewarmer().clear();
     module_cache::getWasmModuleCache().clear();
+    wasm::getCallGraph().clear();
+
+    // Clear function versions
+    storage::getFunctionVersions().clear();
+    module_cache::getArtefactVersions().clear();
+
+    // Clear local chaining buffers
+    wasm::getLocalCallBuffers().clear();
+    wasm::getOutputStreams().clear();
+
+    // Clear memoized results
+    wasm::getResultCache().clear();
+
+    // Clear per-call resource usage
+    isolation::getResourceUsageLog().clear();
+
+    // Clear admission counters
+    faaslet::getAdmissionController().clear();
+
+    // Clear pooled isolation contexts
+    isolation::getIsolationManager().clear();
+
+    // Zero latency histograms
+    isolation::getLatencyRegistry().clear();
+
+    // Clear recorded call profiles
+    wasm::getCallProfiles().clear();
+
+    // Drop collected profile-guided counts
+    wasm::getPgoProfileStore().clear();
+    wasm::getCallTracer().clear();
+    wasm::getFunctionCosts().clear();
+    wasm::getFunctionWorkingSets().clear();
+
+    // Reset Faasm config
+    conf::getFaasmConfig().reset();
 }
 }